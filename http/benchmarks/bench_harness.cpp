@@ -0,0 +1,118 @@
+#include "benchmarks.hpp"
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+static thread_local uint64_t thread_allocations = 0;
+static std::vector<Bench_Result> results;
+static std::string name_filter;
+
+// Counting replacements for the global allocation functions, the other forms forward to these
+void* operator new(std::size_t size) {
+    thread_allocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// Aligned forms are what std::pmr::new_delete_resource() allocates through
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    thread_allocations++;
+    size_t align = std::max(static_cast<size_t>(alignment), sizeof(void*));
+    if (void* p = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return ::operator new(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+uint64_t thread_allocation_count() {
+    return thread_allocations;
+}
+
+bool bench_selected(const std::string& name) {
+    return name_filter.empty() || name.find(name_filter) != std::string::npos;
+}
+
+void bench_set_filter(const std::string& filter) {
+    name_filter = filter;
+}
+
+void bench_record(const Bench_Result& result) {
+    results.push_back(result);
+}
+
+void bench_report(std::ostream& out) {
+    out << std::left << std::setw(48) << "benchmark" << std::right
+        << std::setw(14) << "ns/op" << std::setw(14) << "MB/s" << std::setw(12) << "allocs/op" << "\n";
+    for (const auto& result : results) {
+        out << std::left << std::setw(48) << result.name << std::right << std::fixed
+            << std::setw(14) << std::setprecision(1) << result.ns_per_op
+            << std::setw(14) << std::setprecision(1) << result.bytes_per_second / 1e6
+            << std::setw(12) << std::setprecision(2) << result.allocations_per_op << "\n";
+    }
+}
+
+// One object per benchmark so runs from different releases can be diffed by name
+bool bench_write_json(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i{}; i < results.size(); i++) {
+        const Bench_Result& result = results[i];
+        out << "    {\"name\": \"" << result.name << "\""
+            << ", \"iterations\": " << result.iterations
+            << std::fixed << std::setprecision(3)
+            << ", \"ns_per_op\": " << result.ns_per_op
+            << ", \"bytes_per_second\": " << result.bytes_per_second
+            << ", \"allocations_per_op\": " << result.allocations_per_op << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out);
+}
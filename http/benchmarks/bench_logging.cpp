@@ -0,0 +1,40 @@
+#include "benchmarks.hpp"
+#include "../http_parse.hpp"
+#include "../../sctp_stack/sctp_log.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Floods the parser with requests that fail header validation. The baseline reproduces the
+// old behaviour of writing every rejection synchronously to std::cout, the other run uses the
+// rate-limited asynchronous logger. Both write to stdout.
+constexpr uint64_t MALFORMED_FLOOD_REQUESTS = 200000;
+
+void bench_logging() {
+    std::string raw =
+        "GET /index.html HTTP/2.5\r\n"
+        "Host: example.com\r\n"
+        "X-Broken-Header no colon here\r\n"
+        "\r\n";
+    std::vector<uint8_t> raw_request(raw.begin(), raw.end());
+
+    if (bench_selected("logging/malformed_flood/sync_stdout")) {
+        log_set_level(Log_Level::Off);
+        run_benchmark_fixed("logging/malformed_flood/sync_stdout", MALFORMED_FLOOD_REQUESTS, raw.size(), [&] {
+            auto request = parse_http_request(raw_request);
+            if (!request) {
+                std::cout << "Malformed header line (missing colon): " << "X-Broken-Header no colon here" << "\n";
+            }
+        });
+        std::cout.flush();
+    }
+
+    if (bench_selected("logging/malformed_flood/async_logger")) {
+        log_set_level(Log_Level::Trace);
+        run_benchmark_fixed("logging/malformed_flood/async_logger", MALFORMED_FLOOD_REQUESTS, raw.size(), [&] {
+            auto request = parse_http_request(raw_request);
+            bench_keep(request);
+        });
+        log_flush();
+    }
+}
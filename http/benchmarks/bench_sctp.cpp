@@ -0,0 +1,49 @@
+#include "benchmarks.hpp"
+#include "../../sctp_stack/sctp_serialize.hpp"
+#include "../../sctp_stack/sctp_checksum.hpp"
+#include <vector>
+
+constexpr size_t SCTP_BENCH_PAYLOAD_SIZES[] = {64, 512, 1400, 8192, 32768};
+
+static SCTP_Packet make_data_packet(size_t payload_size) {
+    SCTP_Packet packet;
+    packet.header = SCTP_Common_Header{.src_port = 5000, .des_port = 8080, .verification_tag = 0x1234, .checksum = 0};
+    packet.chunks.push_back(SCTP_Chunk{
+        .chunk_header = {
+            .type = DATA,
+            .flag = 0,
+            .length = static_cast<unsigned short>(sizeof(SCTP_Chunk_Header) + payload_size)
+        },
+        .chunk_value = data_chunk_value {
+            .tsn = 1,
+            .stream_identifier = 0,
+            .stream_seq_num = 0,
+            .payload_protocal = 0,
+            .user_data = std::vector<uint8_t>(payload_size, 0xAB)
+        }
+    });
+    return packet;
+}
+
+void bench_sctp() {
+    for (size_t payload_size : SCTP_BENCH_PAYLOAD_SIZES) {
+        std::string suffix = "/" + std::to_string(payload_size);
+        SCTP_Packet packet = make_data_packet(payload_size);
+        std::vector<uint8_t> serialized = serialize_sctp_packet(packet);
+
+        run_benchmark("sctp/serialize_sctp_packet" + suffix, serialized.size(), [&] {
+            auto out = serialize_sctp_packet(packet);
+            bench_keep(out);
+        });
+
+        run_benchmark("sctp/deserialize_sctp_packet" + suffix, serialized.size(), [&] {
+            auto out = deserialize_sctp_packet(serialized.data(), serialized.size());
+            bench_keep(out);
+        });
+
+        run_benchmark("sctp/calculate_sctp_checksum" + suffix, serialized.size(), [&] {
+            uint32_t checksum = calculate_sctp_checksum(serialized.data(), serialized.size());
+            bench_keep(checksum);
+        });
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef BENCHMARKS_HPP
+#define BENCHMARKS_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <chrono>
+#include <ostream>
+#include <algorithm>
+
+struct Bench_Result {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double bytes_per_second; // 0 when the benchmark has no natural byte count
+    double allocations_per_op;
+};
+
+constexpr auto BENCH_CALIBRATION_TIME = std::chrono::milliseconds(20);
+constexpr auto BENCH_TARGET_TIME = std::chrono::milliseconds(200);
+
+uint64_t thread_allocation_count(); // operator new calls made by the calling thread
+bool bench_selected(const std::string& name);
+void bench_set_filter(const std::string& filter);
+void bench_record(const Bench_Result& result);
+void bench_report(std::ostream& out);
+bool bench_write_json(const std::string& path);
+
+// Keeps the optimizer from discarding a result that is otherwise unused
+template <typename T>
+inline void bench_keep(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+template <typename Fn>
+void run_benchmark_fixed(const std::string& name, uint64_t iterations, size_t bytes_per_op, Fn&& fn) {
+    uint64_t allocations_before = thread_allocation_count();
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i{}; i < iterations; i++) {
+        fn();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocations = thread_allocation_count() - allocations_before;
+
+    double ns_per_op = elapsed / iterations;
+    bench_record(Bench_Result {
+        .name = name,
+        .iterations = iterations,
+        .ns_per_op = ns_per_op,
+        .bytes_per_second = bytes_per_op > 0 ? bytes_per_op * 1e9 / ns_per_op : 0.0,
+        .allocations_per_op = static_cast<double>(allocations) / iterations
+    });
+}
+
+// Doubles the iteration count until a run takes BENCH_CALIBRATION_TIME, then measures
+// for roughly BENCH_TARGET_TIME
+template <typename Fn>
+void run_benchmark(const std::string& name, size_t bytes_per_op, Fn&& fn) {
+    if (!bench_selected(name)) {
+        return;
+    }
+
+    uint64_t iterations = 1;
+    std::chrono::nanoseconds elapsed{};
+    while (iterations < (1ull << 32)) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i{}; i < iterations; i++) {
+            fn();
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed >= BENCH_CALIBRATION_TIME) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    uint64_t target = iterations * std::chrono::nanoseconds(BENCH_TARGET_TIME).count() / std::max<int64_t>(elapsed.count(), 1);
+    run_benchmark_fixed(name, std::max<uint64_t>(target, 1), bytes_per_op, fn);
+}
+
+void bench_sctp();
+void bench_http();
+void bench_logging();
+void bench_server();
+
+#endif
@@ -0,0 +1,32 @@
+#include "benchmarks.hpp"
+#include <iostream>
+#include <string>
+
+// Usage: bench.exe [--filter <substring>] [--json <path>] > NUL
+// Results go to stderr, anything the code under test logs goes to stdout.
+int main(int argc, char** argv) {
+    std::string json_path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            bench_set_filter(argv[++i]);
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    bench_sctp();
+    bench_http();
+    bench_logging();
+    bench_server();
+
+    bench_report(std::cerr);
+    if (!json_path.empty() && !bench_write_json(json_path)) {
+        std::cerr << "Failed to write " << json_path << "\n";
+        return 1;
+    }
+    return 0;
+}
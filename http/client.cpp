@@ -1,21 +1,34 @@
 #include "client.hpp"
 #include "http_parse.hpp"
+#include "http_scan.hpp"
+#include "http_compression.hpp"
+#include "../sctp_stack/sctp_log.hpp"
 #include <iostream>
 #include <chrono>
-#include <thread>
+#include <charconv>
 
-Client::Client(const std::string& ip, int p) : ip_address(ip), port(p), connected(false), socket() {
+static Log_Rate_Limit stray_response_limit{10};
+static Log_Rate_Limit undecodable_response_limit{10};
+static Log_Rate_Limit undecodable_header_block_limit{10};
+static Log_Rate_Limit malformed_binary_limit{10};
+
+Client::Client(const std::string& ip, int p) : ip_address(ip), port(p), connected(false), socket(), next_stream_id(1), next_deadline_ns(INT64_MAX), wire_format(WIRE_TEXT), binary_accepted(false) {
+        socket.sctp_bind(ip, p);
+}
+
+Client::Client(const std::string& ip, int p, std::unique_ptr<Datagram_Transport> transport) : socket(std::move(transport)), ip_address(ip), port(p), connected(false), next_stream_id(1), next_deadline_ns(INT64_MAX), wire_format(WIRE_TEXT), binary_accepted(false) {
         socket.sctp_bind(ip, p);
 }
 
 Client::~Client() {
-    if (connected) {
-        disconnect();
-    }
+    // The event hook calls into this object, so the loop is stopped before any member goes away
+    stop();
+    socket.sctp_set_event_hook(nullptr);
 }
 
-void Client::start() {
-    if (!socket.sctp_run()) {
+void Client::start(Event_Loop_Mode mode) {
+    socket.sctp_set_event_hook([this](bool data_ready) { run_completions(data_ready); });
+    if (!socket.sctp_run(mode)) {
         socket.sctp_close();
         throw std::runtime_error("Failed to start SCTP socket");
     }
@@ -28,33 +41,118 @@ void Client::stop() {
     socket.sctp_close();
 }
 
+bool Client::poll() {
+    bool socket_work = socket.sctp_poll();
+    bool completion_work = run_completions(true);
+    return socket_work || completion_work;
+}
+
 bool Client::connect(const std::string& server_ip, int server_port) {
+    if (!begin_connect(server_ip, server_port)) {
+        return false;
+    }
+
+    // Wait for association to be established
+    int result = socket.await_established_association(server_association_key, 5000);
+
+    if (result == 0) {
+        connected = true;
+        return true;
+    } else {
+        std::cout << "Failed to establish SCTP association with server\n";
+        return false;
+    }
+}
+
+bool Client::begin_connect(const std::string& server_ip, int server_port) {
     try {
         // Associate with the server
-        Association_Key key = socket.sctp_associate(server_ip, server_port);
-        
-        // Wait for association to be established
-        int result = socket.await_established_association(key, 5000);
-        
-        if (result == 0) {
-            connected = true;
-            server_association_key = key;
-            return true;
-        } else {
-            std::cout << "Failed to establish SCTP association with server\n";
-            return false;
-        }
+        server_association_key = socket.sctp_associate(server_ip, server_port);
+        return true;
     } catch (const std::exception& e) {
         std::cout << "Connection error: " << e.what() << "\n";
         return false;
     }
 }
 
+bool Client::poll_connected() {
+    if (!connected && socket.is_established(server_association_key)) {
+        connected = true;
+    }
+    return connected;
+}
+
 void Client::disconnect() {
-    if (connected) {
+    if (connected.exchange(false)) {
         socket.sctp_close();
-        connected = false;
     }
+
+    // The event loop is joined, nothing else can complete what is still pending
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    std::unordered_map<uint64_t, Completion> pending = std::move(completions);
+    completions.clear();
+    for (const auto& [stream_id, completion] : pending) {
+        in_flight_streams.erase(stream_id);
+    }
+    for (auto& [stream_id, writer] : uploads) {
+        writer->cancel();
+    }
+    uploads.clear();
+    partial_responses.clear();
+    next_deadline_ns.store(INT64_MAX, std::memory_order_relaxed);
+    // A new association negotiates again with empty tables
+    request_encoder.reset();
+    binary_accepted = false;
+    if (header_compression) {
+        response_decoder.emplace(header_compression->table_size);
+    }
+    streams_lock.unlock();
+
+    for (auto& [stream_id, completion] : pending) {
+        completion.on_complete(std::nullopt);
+    }
+}
+
+void Client::configure_header_compression(const Header_Compression_Config& config) {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    header_compression = config;
+    response_decoder.emplace(config.table_size);
+}
+
+bool Client::header_compression_active() const {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    return request_encoder.has_value();
+}
+
+void Client::configure_wire_format(Wire_Format format) {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    wire_format = format;
+}
+
+bool Client::binary_wire_active() const {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    return binary_accepted;
+}
+
+void Client::configure_deadlines(std::chrono::milliseconds deadline) {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    default_deadline = deadline;
+}
+
+bool Client::cancel(uint64_t stream_id) {
+    Ready ready;
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    if (!in_flight_streams.contains(stream_id)) {
+        return false;
+    }
+    std::vector<uint8_t> reset;
+    write_stream_frame(FRAME_RESET, stream_id, {}, reset);
+    send_frame(std::move(reset));
+    complete_stream(stream_id, std::nullopt, ready);
+    streams_lock.unlock();
+
+    deliver(ready);
+    return true;
 }
 
 bool Client::is_connected() const {
@@ -68,52 +166,451 @@ Request Client::build_request(const std::string& method, const std::string& uri,
     request.request_line.version = "HTTP/2.5";
     
     // Add default headers
-    request.headers["Host"] = ip_address + ":" + std::to_string(port);
-    request.headers["Connection"] = "close";
-    request.headers["User-Agent"] = "HTTP2.5-Client/1.0";
+    request.headers.add(HEADER_HOST, ip_address + ":" + std::to_string(port));
+    request.headers.add(HEADER_CONNECTION, "keep-alive");
+    request.headers.add(HEADER_USER_AGENT, "HTTP2.5-Client/1.0");
+    request.headers.add(HEADER_ACCEPT_ENCODING, "gzip, deflate"); // Responses are decoded before they are handed out
     
     // Add body if provided
     if (!body.empty()) {
-        request.headers["Content-Length"] = std::to_string(body.length());
-        request.headers["Content-Type"] = "application/octet-stream";
+        request.headers.add(HEADER_CONTENT_LENGTH, std::to_string(body.length()));
+        request.headers.add(HEADER_CONTENT_TYPE, "application/octet-stream");
         request.body.insert(request.body.end(), body.begin(), body.end());
     }
     
     return request;
 }
 
-std::optional<Response> Client::send_request(const Request& request) {
+std::optional<Response> Client::send_request(const Request& request, std::chrono::milliseconds timeout) {
     if (!connected) {
         std::cout << "Client is not connected to server\n";
         return std::nullopt;
     }
-    
-    size_t received{0};
-    try {
-        while (received == 0) {
-            // Serialize the request
-            std::vector<uint8_t> serialized_request = serialize_request(request);
-                
-            // Send the request
-            socket.sctp_send_data(server_association_key, serialized_request);
-            
-            // Receive the response
-            std::vector<uint8_t> response_buffer(65536);
-            received = socket.sctp_recv_data_from(server_association_key, response_buffer);
-            
-            if (received > 0) {
-                response_buffer.resize(received);
-                return parse_http_response(response_buffer);
+    return send_request_async(request, timeout).get();
+}
+
+std::future<std::optional<Response>> Client::send_request_async(const Request& request, std::chrono::milliseconds timeout) {
+    auto promise = std::make_shared<std::promise<std::optional<Response>>>();
+    std::future<std::optional<Response>> result = promise->get_future();
+    send_request(request, [promise](std::optional<Response> response) {
+        promise->set_value(std::move(response));
+    }, timeout);
+    return result;
+}
+
+uint64_t Client::send_request(const Request& request, Response_Callback on_complete, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    // Registered before the send, the event loop cannot see the response first
+    uint64_t stream_id = begin_request_locked(request, false, timeout);
+    if (stream_id == 0) {
+        streams_lock.unlock();
+        on_complete(std::nullopt);
+        return 0;
+    }
+    add_completion_locked(stream_id, std::move(on_complete), nullptr, timeout);
+    return stream_id;
+}
+
+uint64_t Client::send_request(const Request& request, Body_Chunk_Callback on_chunk, Response_Callback on_complete, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    uint64_t stream_id = begin_request_locked(request, false, timeout);
+    if (stream_id == 0) {
+        streams_lock.unlock();
+        on_complete(std::nullopt);
+        return 0;
+    }
+    auto consumer = std::make_shared<Chunk_Consumer>();
+    consumer->on_chunk = std::move(on_chunk);
+    add_completion_locked(stream_id, std::move(on_complete), std::move(consumer), timeout);
+    return stream_id;
+}
+
+std::shared_ptr<Body_Writer> Client::begin_upload(const Request& request, Response_Callback on_complete, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    // Registered before the head goes out, the event loop cannot see the first credit first
+    uint64_t stream_id = begin_request_locked(request, true, timeout);
+    if (stream_id == 0) {
+        streams_lock.unlock();
+        on_complete(std::nullopt);
+        return nullptr;
+    }
+    auto writer = std::make_shared<Body_Writer>(stream_id, [this](std::vector<uint8_t>&& frame) { send_frame(std::move(frame)); });
+    uploads.emplace(stream_id, writer);
+    add_completion_locked(stream_id, std::move(on_complete), nullptr, timeout);
+    return writer;
+}
+
+void Client::add_completion_locked(uint64_t stream_id, Response_Callback on_complete, std::shared_ptr<Chunk_Consumer> consumer, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    completions.emplace(stream_id, Completion{std::move(on_complete), deadline, timeout, std::move(consumer)});
+    int64_t deadline_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    if (deadline_ns < next_deadline_ns.load(std::memory_order_relaxed)) {
+        next_deadline_ns.store(deadline_ns, std::memory_order_relaxed);
+    }
+}
+
+uint64_t Client::begin_request(const Request& request) {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    return begin_request_locked(request);
+}
+
+void Client::send_frame(std::vector<uint8_t>&& frame) {
+    socket.sctp_send_data(server_association_key, std::move(frame));
+}
+
+uint64_t Client::begin_request_locked(const Request& request, bool streamed_body, std::optional<std::chrono::milliseconds> timeout) {
+    if (!connected) {
+        return 0;
+    }
+    uint64_t stream_id = next_stream_id++;
+    in_flight_streams.insert(stream_id);
+    std::optional<std::chrono::milliseconds> deadline;
+    if (default_deadline && !request.headers.contains(HEADER_REQUEST_TIMEOUT)) {
+        deadline = timeout ? timeout : default_deadline;
+    }
+    // Messages are not fragmented, a body too large for one follows the head in frames
+    bool framed_body = !streamed_body && request.body.size() > MAX_INLINE_BODY;
+    if (binary_accepted && !streamed_body && !framed_body) {
+        std::vector<uint8_t> encoded;
+        encode_binary_request(request, stream_id, encoded, deadline);
+        socket.sctp_send_data(server_association_key, std::move(encoded));
+        return stream_id;
+    }
+    if (request_encoder && !streamed_body && !framed_body) {
+        std::vector<uint8_t> encoded;
+        request_encoder->encode_request(request, stream_id, encoded, deadline);
+        socket.sctp_send_data(server_association_key, std::move(encoded));
+        return stream_id;
+    }
+
+    std::vector<uint8_t> serialized;
+    if (framed_body) {
+        Request head;
+        head.request_line = request.request_line;
+        head.headers = request.headers;
+        head.headers.remove(HEADER_CONTENT_LENGTH);
+        serialized = serialize_request(head);
+    } else {
+        serialized = serialize_request(request);
+    }
+    // Goes right after the request line, ahead of any Stream-Id the caller's headers carry
+    size_t line_end = scan_find_crlf(std::string_view(reinterpret_cast<const char*>(serialized.data()), serialized.size()), 0);
+    std::string stream_header = std::string(header_name(HEADER_STREAM_ID)) + ": " + std::to_string(stream_id) + std::string(SEPERATOR);
+    if (deadline) {
+        stream_header += std::string(header_name(HEADER_REQUEST_TIMEOUT)) + ": " + std::to_string(deadline->count()) + std::string(SEPERATOR);
+    }
+    if (header_compression && !request_encoder) {
+        stream_header += std::string(HEADER_COMPRESSION) + ": " + header_compression_offer(header_compression->table_size) + std::string(SEPERATOR);
+    }
+    if (wire_format == WIRE_BINARY && !binary_accepted) {
+        stream_header += std::string(WIRE_FORMAT) + ": " + std::string(WIRE_FORMAT_BINARY) + std::string(SEPERATOR);
+    }
+    serialized.insert(serialized.begin() + line_end + SEPERATOR.size(), stream_header.begin(), stream_header.end());
+
+    if (streamed_body || framed_body) {
+        std::vector<uint8_t> frame;
+        frame.reserve(STREAM_FRAME_HEADER_SIZE + serialized.size());
+        write_stream_frame(FRAME_HEAD, stream_id, serialized, frame);
+        serialized = std::move(frame);
+    }
+    socket.sctp_send_data(server_association_key, std::move(serialized));
+    if (framed_body) {
+        auto writer = std::make_shared<Body_Writer>(stream_id, [this](std::vector<uint8_t>&& frame) { send_frame(std::move(frame)); });
+        uploads.emplace(stream_id, writer);
+        auto body = std::make_shared<const std::vector<uint8_t>>(request.body);
+        writer->send_body(*body, body);
+    }
+    return stream_id;
+}
+
+void Client::receive_responses(Ready& ready) {
+    std::vector<uint8_t> message;
+    while (socket.sctp_recv_message_from(server_association_key, message)) {
+        if (is_stream_frame(message)) {
+            receive_frame(message, ready);
+            continue;
+        }
+        std::optional<Response> response;
+        if (is_header_block_message(message)) {
+            response = response_decoder ? response_decoder->decode_response(message) : std::nullopt;
+            if (!response) {
+                log_event_limited<Log_Level::Warn>(undecodable_header_block_limit, "undecodable header block dropped", {}, {{"bytes", message.size()}});
+                continue;
+            }
+        } else if (is_binary_message(message)) {
+            response = decode_binary_response(message);
+            if (!response) {
+                log_event_limited<Log_Level::Warn>(malformed_binary_limit, "malformed binary response dropped", {}, {{"bytes", message.size()}});
+                continue;
+            }
+        } else {
+            response = parse_http_response(message);
+            if (!response) {
+                continue;
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
-        return std::nullopt;
-    } catch (const std::exception& e) {
-        std::cout << "Error sending request: " << e.what() << "\n";
-        return std::nullopt;
+        // The server decodes what we compress from its answer to our offer on
+        if (header_compression && !request_encoder) {
+            auto accepted = response->headers.get(HEADER_COMPRESSION);
+            if (auto table_size = accepted ? parse_header_compression_offer(*accepted) : std::nullopt) {
+                request_encoder.emplace(std::min(header_compression->table_size, *table_size), header_compression->huffman);
+            }
+        }
+        if (wire_format == WIRE_BINARY && !binary_accepted) {
+            auto accepted = response->headers.get(WIRE_FORMAT);
+            binary_accepted = accepted && iequals(*accepted, WIRE_FORMAT_BINARY);
+        }
+        if (!decode_content(response->headers, response->body)) {
+            log_event_limited<Log_Level::Warn>(undecodable_response_limit, "response body could not be decoded", response->headers.get(HEADER_CONTENT_ENCODING).value_or(""), {});
+        }
+
+        // A server without stream ids answers in order, so the oldest request is the one answered
+        uint64_t stream_id = in_flight_streams.empty() ? 0 : *in_flight_streams.begin();
+        if (auto echoed = response->headers.get(HEADER_STREAM_ID)) {
+            if (std::from_chars(echoed->data(), echoed->data() + echoed->size(), stream_id).ec != std::errc()) {
+                stream_id = 0;
+            }
+        }
+        if (!in_flight_streams.contains(stream_id)) {
+            log_event_limited<Log_Level::Warn>(stray_response_limit, "response for unknown stream dropped", {}, {{"stream_id", stream_id}});
+            continue;
+        }
+        complete_stream(stream_id, std::move(response), ready);
     }
 }
 
+void Client::complete_stream(uint64_t stream_id, std::optional<Response> response, Ready& ready) {
+    in_flight_streams.erase(stream_id);
+    partial_responses.erase(stream_id);
+    // An answer before the whole body went out, e.g. a 413, ends the upload too
+    auto upload = uploads.find(stream_id);
+    if (upload != uploads.end()) {
+        upload->second->cancel();
+        uploads.erase(upload);
+    }
+
+    auto completion = completions.find(stream_id);
+    if (completion == completions.end()) {
+        if (response) {
+            arrived_responses.emplace(stream_id, std::move(*response));
+            arrival_order.push_back(stream_id);
+        }
+        return;
+    }
+    if (response && completion->second.consumer && !response->body.empty()) {
+        ready.chunks.push_back(Ready_Chunk{completion->second.consumer, stream_id, std::move(response->body), 0, false});
+        response->body.clear();
+    }
+    ready.completions.emplace_back(std::move(completion->second.on_complete), std::move(response));
+    completions.erase(completion);
+}
+
+void Client::receive_frame(std::vector<uint8_t>& message, Ready& ready) {
+    auto frame = parse_stream_frame(message);
+    if (!frame) {
+        log_event_limited<Log_Level::Warn>(stray_response_limit, "malformed stream frame dropped", {}, {{"bytes", message.size()}});
+        return;
+    }
+    uint64_t stream_id = frame->stream_id;
+    // A RESET crossing our END, or the server giving up on a body it no longer reads, is expected
+    if (!in_flight_streams.contains(stream_id)) {
+        if (frame->type != FRAME_RESET) {
+            log_event_limited<Log_Level::Warn>(stray_response_limit, "frame for unknown stream dropped", {}, {{"stream_id", stream_id}});
+        }
+        return;
+    }
+
+    // A stream stays alive as long as frames keep coming
+    auto completion = completions.find(stream_id);
+    if (completion != completions.end()) {
+        completion->second.deadline = std::chrono::steady_clock::now() + completion->second.timeout;
+    }
+    auto partial = partial_responses.find(stream_id);
+    auto upload = uploads.find(stream_id);
+    switch (frame->type) {
+        case FRAME_HEAD: {
+            std::optional<Response> head = parse_http_response(std::vector<uint8_t>(frame->payload.begin(), frame->payload.end()));
+            if (!head) {
+                std::vector<uint8_t> reset;
+                write_stream_frame(FRAME_RESET, stream_id, {}, reset);
+                send_frame(std::move(reset));
+                complete_stream(stream_id, std::nullopt, ready);
+                return;
+            }
+            bool encoded = head->headers.contains(HEADER_CONTENT_ENCODING);
+            partial_responses.insert_or_assign(stream_id, Partial_Response{std::move(*head), 0, encoded});
+            return;
+        }
+        case FRAME_DATA: {
+            if (partial == partial_responses.end()) {
+                return;
+            }
+            if (completion != completions.end() && completion->second.consumer && !partial->second.encoded) {
+                ready.chunks.push_back(Ready_Chunk{completion->second.consumer, stream_id, std::move(message), STREAM_FRAME_HEADER_SIZE, true});
+                return;
+            }
+            // Collected for a caller that wants the whole response, credit goes straight back
+            std::vector<uint8_t>& body = partial->second.response.body;
+            body.insert(body.end(), frame->payload.begin(), frame->payload.end());
+            partial->second.unacknowledged += static_cast<uint32_t>(frame->payload.size());
+            if (partial->second.unacknowledged >= STREAM_WINDOW / 2) {
+                std::vector<uint8_t> credit;
+                write_credit_frame(stream_id, partial->second.unacknowledged, credit);
+                send_frame(std::move(credit));
+                partial->second.unacknowledged = 0;
+            }
+            return;
+        }
+        case FRAME_END: {
+            if (partial != partial_responses.end()) {
+                Response response = std::move(partial->second.response);
+                if (!decode_content(response.headers, response.body)) {
+                    log_event_limited<Log_Level::Warn>(undecodable_response_limit, "response body could not be decoded", response.headers.get(HEADER_CONTENT_ENCODING).value_or(""), {});
+                }
+                complete_stream(stream_id, std::move(response), ready);
+            }
+            return;
+        }
+        case FRAME_CREDIT:
+            if (upload != uploads.end()) {
+                upload->second->add_credit(frame->credit);
+            }
+            return;
+        case FRAME_RESET: {
+            // While the upload is open the server only stopped reading and its answer follows;
+            // otherwise it abandoned the response
+            bool uploading = upload != uploads.end() && !upload->second->closed();
+            if (upload != uploads.end()) {
+                upload->second->cancel();
+                uploads.erase(upload);
+            }
+            if (!uploading) {
+                complete_stream(stream_id, std::nullopt, ready);
+            }
+            return;
+        }
+    }
+}
+
+// A late response for an expired stream is then dropped as unknown
+void Client::expire_completions(Ready& ready) {
+    auto now = std::chrono::steady_clock::now();
+    int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    if (now_ns < next_deadline_ns.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    int64_t next_ns = INT64_MAX;
+    std::vector<uint64_t> expired;
+    for (const auto& [stream_id, completion] : completions) {
+        if (completion.deadline > now) {
+            next_ns = std::min(next_ns, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(completion.deadline.time_since_epoch()).count()));
+        } else {
+            expired.push_back(stream_id);
+        }
+    }
+    next_deadline_ns.store(next_ns, std::memory_order_relaxed);
+
+    // The server stops streaming to, or waiting on, a request we gave up on. With deadlines it
+    // also drops one still queued, so retries do not pile up behind the requests they replace.
+    for (uint64_t stream_id : expired) {
+        if (default_deadline || partial_responses.contains(stream_id) || uploads.contains(stream_id)) {
+            std::vector<uint8_t> reset;
+            write_stream_frame(FRAME_RESET, stream_id, {}, reset);
+            send_frame(std::move(reset));
+        }
+        complete_stream(stream_id, std::nullopt, ready);
+    }
+}
+
+bool Client::run_completions(bool data_ready) {
+    // The common idle pass, nothing arrived and no deadline is due, takes no lock
+    if (!data_ready) {
+        int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (now_ns < next_deadline_ns.load(std::memory_order_relaxed)) {
+            return false;
+        }
+    }
+
+    Ready ready;
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    if (data_ready) {
+        receive_responses(ready);
+    }
+    expire_completions(ready);
+    streams_lock.unlock();
+
+    deliver(ready);
+    return !ready.completions.empty() || !ready.chunks.empty();
+}
+
+// Outside the lock, a callback may send the next request
+void Client::deliver(Ready& ready) {
+    for (auto& chunk : ready.chunks) {
+        std::span<const uint8_t> body = std::span<const uint8_t>(chunk.bytes).subspan(chunk.offset);
+        chunk.consumer->on_chunk(body);
+        if (!chunk.streamed) {
+            continue;
+        }
+        // Credit only for what the consumer has taken, in half-window steps
+        uint32_t consumed = chunk.consumer->unacknowledged.fetch_add(static_cast<uint32_t>(body.size())) + static_cast<uint32_t>(body.size());
+        if (consumed >= STREAM_WINDOW / 2) {
+            if (uint32_t grant = chunk.consumer->unacknowledged.exchange(0)) {
+                std::vector<uint8_t> credit;
+                write_credit_frame(chunk.stream_id, grant, credit);
+                send_frame(std::move(credit));
+            }
+        }
+    }
+    for (auto& [on_complete, response] : ready.completions) {
+        on_complete(std::move(response));
+    }
+}
+
+std::optional<Response> Client::poll_response() {
+    Ready ready;
+    std::optional<Response> result;
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    receive_responses(ready);
+    while (!arrival_order.empty() && !result) {
+        auto response = arrived_responses.find(arrival_order.front());
+        arrival_order.pop_front();
+        // Entries already taken through poll_response(stream_id) are skipped
+        if (response != arrived_responses.end()) {
+            result = std::move(response->second);
+            arrived_responses.erase(response);
+        }
+    }
+    streams_lock.unlock();
+
+    deliver(ready);
+    return result;
+}
+
+std::optional<Response> Client::poll_response(uint64_t stream_id) {
+    Ready ready;
+    std::optional<Response> result;
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    receive_responses(ready);
+    auto response = arrived_responses.find(stream_id);
+    if (response != arrived_responses.end()) {
+        result = std::move(response->second);
+        arrived_responses.erase(response);
+        while (!arrival_order.empty() && !arrived_responses.contains(arrival_order.front())) {
+            arrival_order.pop_front();
+        }
+    }
+    streams_lock.unlock();
+
+    deliver(ready);
+    return result;
+}
+
+size_t Client::in_flight() const {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    return in_flight_streams.size();
+}
+
 std::optional<Response> Client::get_request(const std::string& uri) {
     Request request = build_request("GET", uri);
     return send_request(request);
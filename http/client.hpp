@@ -4,23 +4,92 @@
 #include "../sctp_stack/sctp_socket.hpp"
 #include "http_request.hpp"
 #include "http_response.hpp"
+#include "http_stream.hpp"
+#include "http_header_codec.hpp"
+#include "http_binary_codec.hpp"
 #include <string>
 #include <optional>
+#include <set>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <functional>
+#include <span>
+
+constexpr std::chrono::milliseconds DEFAULT_REQUEST_TIMEOUT{5000};
+
+using Response_Callback = std::function<void(std::optional<Response>)>; // nullopt on timeout or when not connected
+using Body_Chunk_Callback = std::function<void(std::span<const uint8_t> chunk)>;
 
 class Client {
     public:
         Client(const std::string& ip, int port);
+        Client(const std::string& ip, int port, std::unique_ptr<Datagram_Transport> transport);
         ~Client();
         
         std::optional<Response> get_request(const std::string& uri);
         std::optional<Response> post_request(const std::string& uri, const std::string& body);
         std::optional<Response> put_request(const std::string& uri, const std::string& body);
         std::optional<Response> delete_request(const std::string& uri);
-        std::optional<Response> send_request(const Request& request);
+        std::optional<Response> send_request(const Request& request, std::chrono::milliseconds timeout = DEFAULT_REQUEST_TIMEOUT); // Blocks, EVENT_LOOP_THREADED only
+
+        // Completed on the socket's event loop thread as soon as the response arrives, or inside
+        // poll() in EVENT_LOOP_MANUAL mode. A callback must not block.
+        std::future<std::optional<Response>> send_request_async(const Request& request, std::chrono::milliseconds timeout = DEFAULT_REQUEST_TIMEOUT);
+        // Stream id of the request for cancel(), 0 when not connected
+        uint64_t send_request(const Request& request, Response_Callback on_complete, std::chrono::milliseconds timeout = DEFAULT_REQUEST_TIMEOUT);
+        // on_chunk gets the body piece by piece as it arrives, streamed by the server or not (a
+        // compressed body in one piece once decoded), then on_complete gets the head with an empty body. Credit goes back to a streaming server as
+        // on_chunk returns, so a slow consumer slows the server down instead of piling up bytes.
+        // For streamed responses the timeout runs from the last frame received.
+        uint64_t send_request(const Request& request, Body_Chunk_Callback on_chunk, Response_Callback on_complete,
+                              std::chrono::milliseconds timeout = DEFAULT_REQUEST_TIMEOUT);
+        // The head goes out now, the body through the returned writer as the server grants credit;
+        // nullptr (and on_complete(nullopt)) when not connected. The writer must not outlive the
+        // client. In EVENT_LOOP_MANUAL use try_write, write() would wait on the thread driving poll().
+        std::shared_ptr<Body_Writer> begin_upload(const Request& request, Response_Callback on_complete,
+                                                  std::chrono::milliseconds timeout = DEFAULT_REQUEST_TIMEOUT);
+        Request build_request(const std::string& method, const std::string& uri, const std::string& body = "");
         
-        void start();
+        // Before connecting. Requests offer header compression until a response accepts it, then go
+        // out compressed; streamed uploads keep a plain head.
+        void configure_header_compression(const Header_Compression_Config& config);
+        bool header_compression_active() const; // The server accepted, requests are compressed
+        // Before connecting. WIRE_BINARY offers the binary format until a response accepts it, then
+        // requests go out binary, ahead of header compression; streamed uploads keep a text head.
+        // Responses are understood in any format.
+        void configure_wire_format(Wire_Format format);
+        bool binary_wire_active() const; // The server accepted, requests are binary
+        // Before sending. Requests then carry Request-Timeout, the time until this client gives up on
+        // them: the timeout of send_request and begin_upload, `deadline` for begin_request. The
+        // server drops requests it can no longer answer in time, and requests that time out here
+        // are cancelled there. A Request-Timeout the caller set is sent as it is.
+        void configure_deadlines(std::chrono::milliseconds deadline = DEFAULT_REQUEST_TIMEOUT);
+
+        // Gives up on a request in flight: its completion gets nullopt, an upload stops, and the
+        // server drops the request if still queued or cancels its handler's token. False when the
+        // stream is not in flight.
+        bool cancel(uint64_t stream_id);
+
+        void start(Event_Loop_Mode mode = EVENT_LOOP_THREADED);
         void stop();
+        bool poll(); // Drives the socket and completions in EVENT_LOOP_MANUAL mode
         bool connect(const std::string& server_ip, int server_port);
+
+        // Non-blocking halves of connect() and send_request() for EVENT_LOOP_MANUAL mode. Each request
+        // gets a stream id, sent as Stream-Id and echoed by the server, so any number of requests can
+        // be in flight on the association and responses are matched to them in any order.
+        bool begin_connect(const std::string& server_ip, int server_port);
+        bool poll_connected();
+        uint64_t begin_request(const Request& request); // Stream id of the request, 0 when not connected
+        std::optional<Response> poll_response(); // Next response on any stream without a completion, in arrival order
+        std::optional<Response> poll_response(uint64_t stream_id);
+        size_t in_flight() const; // Requests sent whose response has not arrived yet
+
         void disconnect();
         bool is_connected() const;
         
@@ -28,10 +97,70 @@ class Client {
         SCTP_Socket socket;
         std::string ip_address;
         int port;
-        bool connected;
+        std::atomic<bool> connected; // Callers on any thread check it while another one disconnects
         Association_Key server_association_key;
-        
-        Request build_request(const std::string& method, const std::string& uri, const std::string& body = "");
+        struct Chunk_Consumer {
+            Body_Chunk_Callback on_chunk;
+            std::atomic<uint32_t> unacknowledged{0}; // Streamed bytes consumed since the last credit
+        };
+
+        struct Completion {
+            Response_Callback on_complete;
+            std::chrono::steady_clock::time_point deadline;
+            std::chrono::milliseconds timeout;
+            std::shared_ptr<Chunk_Consumer> consumer; // Set when the body goes to on_chunk
+        };
+
+        struct Partial_Response {
+            Response response; // Head, and the body so far when there is no consumer or it is encoded
+            uint32_t unacknowledged;
+            bool encoded; // Content-Encoding: collected and decoded at the END, also for a consumer
+        };
+
+        using Ready_Completion = std::pair<Response_Callback, std::optional<Response>>;
+
+        struct Ready_Chunk {
+            std::shared_ptr<Chunk_Consumer> consumer;
+            uint64_t stream_id;
+            std::vector<uint8_t> bytes;
+            size_t offset; // Where the body starts in bytes
+            bool streamed; // Credit is owed for it
+        };
+
+        // Collected under the lock, run outside it: chunks in arrival order, then completions
+        struct Ready {
+            std::vector<Ready_Chunk> chunks;
+            std::vector<Ready_Completion> completions;
+        };
+
+        // Stream state is shared with the event loop thread, which completes requests
+        mutable std::mutex streams_mutex;
+        uint64_t next_stream_id;
+        std::set<uint64_t> in_flight_streams;
+        std::unordered_map<uint64_t, Response> arrived_responses; // Received, not yet polled
+        std::deque<uint64_t> arrival_order;
+        std::unordered_map<uint64_t, Completion> completions;
+        std::unordered_map<uint64_t, Partial_Response> partial_responses; // Streamed responses between HEAD and END
+        std::unordered_map<uint64_t, std::shared_ptr<Body_Writer>> uploads;
+        std::atomic<int64_t> next_deadline_ns; // Earliest completion deadline on the steady clock
+        // Blocks are encoded and sent, or received and decoded, under streams_mutex, so both
+        // tables see them in wire order
+        std::optional<Header_Compression_Config> header_compression;
+        std::optional<Header_Encoder> request_encoder; // Once the server accepted
+        std::optional<Header_Decoder> response_decoder;
+        Wire_Format wire_format;
+        bool binary_accepted;
+        std::optional<std::chrono::milliseconds> default_deadline; // Set when deadlines are sent
+
+        uint64_t begin_request_locked(const Request& request, bool streamed_body = false, std::optional<std::chrono::milliseconds> timeout = std::nullopt);
+        void add_completion_locked(uint64_t stream_id, Response_Callback on_complete, std::shared_ptr<Chunk_Consumer> consumer, std::chrono::milliseconds timeout);
+        void complete_stream(uint64_t stream_id, std::optional<Response> response, Ready& ready);
+        void receive_responses(Ready& ready);
+        void receive_frame(std::vector<uint8_t>& message, Ready& ready);
+        void expire_completions(Ready& ready);
+        void deliver(Ready& ready);
+        bool run_completions(bool data_ready);
+        void send_frame(std::vector<uint8_t>&& frame);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "client_pool.hpp"
+#include "../sctp_stack/sctp_log.hpp"
+#include <algorithm>
+#include <charconv>
+#include <future>
+
+constexpr double POOL_LATENCY_EWMA_WEIGHT = 0.2; // Weight of the newest sample
+
+static Log_Rate_Limit backend_state_limit{10};
+
+Client_Pool::Client_Pool(const Client_Pool_Config& config) : config(config), running(false), rng(config.seed), next_backend(0) {}
+
+Client_Pool::~Client_Pool() {
+    stop();
+}
+
+void Client_Pool::add_backend(const std::string& ip, int port) {
+    std::unique_lock<std::mutex> pool_lock(pool_mutex);
+    auto backend = std::make_unique<Backend>();
+    backend->ip = ip;
+    backend->port = port;
+    backend->local_port = config.local_port_base + static_cast<int>(backends.size());
+    backend->state = BACKEND_CONNECTING;
+    backend->consecutive_failures = 0;
+    backend->latency_ewma_us = 0.0;
+    backend->completed = 0;
+    backend->failures = 0;
+    backend->timeouts = 0;
+    backend->reconnects = 0;
+    backends.push_back(std::move(backend));
+}
+
+void Client_Pool::start(Event_Loop_Mode mode) {
+    std::unique_lock<std::mutex> pool_lock(pool_mutex);
+    clock::time_point now = clock::now();
+    for (auto& backend : backends) {
+        connect(*backend, now);
+    }
+    running = true;
+    pool_lock.unlock();
+
+    if (mode == EVENT_LOOP_THREADED) {
+        event_loop_thread = std::thread(&Client_Pool::event_loop, this);
+    }
+}
+
+void Client_Pool::stop() {
+    running = false;
+    if (event_loop_thread.joinable()) {
+        event_loop_thread.join();
+    }
+
+    std::vector<Completion> completions;
+    std::unique_lock<std::mutex> pool_lock(pool_mutex);
+    for (auto& queued_request : queued) {
+        completions.emplace_back(std::move(queued_request.on_complete), std::nullopt);
+    }
+    queued.clear();
+    for (auto& backend : backends) {
+        for (auto& [stream_id, outstanding] : backend->outstanding) {
+            completions.emplace_back(std::move(outstanding.on_complete), std::nullopt);
+        }
+        backend->outstanding.clear();
+        backend->client.reset();
+    }
+    pool_lock.unlock();
+
+    for (auto& [on_complete, response] : completions) {
+        on_complete(std::move(response));
+    }
+}
+
+void Client_Pool::event_loop() {
+    while (running) {
+        if (!poll()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Starts a fresh association without waiting for it, poll_backend picks up the result
+void Client_Pool::connect(Backend& backend, clock::time_point now) {
+    backend.client.reset();
+    backend.state = BACKEND_CONNECTING;
+    backend.state_since = now;
+    try {
+        if (config.transport_factory) {
+            backend.client = std::make_unique<Client>(config.local_ip, backend.local_port, config.transport_factory());
+        } else {
+            backend.client = std::make_unique<Client>(config.local_ip, backend.local_port);
+        }
+        backend.client->start(EVENT_LOOP_MANUAL);
+        backend.client->begin_connect(backend.ip, backend.port);
+    } catch (const std::exception& e) {
+        log_event_limited<Log_Level::Warn>(backend_state_limit, "backend connect failed", e.what(), {{"port", static_cast<uint64_t>(backend.port)}});
+        backend.client.reset();
+    }
+}
+
+void Client_Pool::record_result(Backend& backend, bool failed, clock::time_point now) {
+    backend.consecutive_failures = failed ? backend.consecutive_failures + 1 : 0;
+    bool too_many_failures = backend.consecutive_failures >= config.failures_to_eject;
+    bool too_slow = config.latency_to_eject.count() > 0 &&
+                    backend.latency_ewma_us > std::chrono::duration<double, std::micro>(config.latency_to_eject).count();
+    if (backend.state == BACKEND_HEALTHY && (too_many_failures || too_slow)) {
+        log_event_limited<Log_Level::Warn>(backend_state_limit, "backend ejected", backend.ip,
+                                           {{"port", static_cast<uint64_t>(backend.port)}, {"consecutive_failures", backend.consecutive_failures},
+                                            {"latency_ewma_us", static_cast<uint64_t>(backend.latency_ewma_us)}});
+        backend.state = BACKEND_EJECTED;
+        backend.state_since = now;
+    }
+}
+
+bool Client_Pool::poll_backend(Backend& backend, clock::time_point now, std::vector<Completion>& completions) {
+    bool did_work = false;
+    if (backend.state == BACKEND_CONNECTING) {
+        if (backend.client) {
+            did_work = backend.client->poll();
+        }
+        if (backend.client && backend.client->poll_connected()) {
+            backend.state = BACKEND_HEALTHY;
+            backend.state_since = now;
+            backend.consecutive_failures = 0;
+            backend.latency_ewma_us = 0.0;
+            return true;
+        }
+        if (now - backend.state_since >= config.connect_timeout) {
+            backend.reconnects++;
+            connect(backend, now);
+            return true;
+        }
+        return did_work;
+    }
+
+    if (backend.state == BACKEND_EJECTED && now - backend.state_since >= config.ejection_time) {
+        // Whatever is still outstanding went to the old association and cannot complete anymore
+        for (auto& [stream_id, outstanding] : backend.outstanding) {
+            backend.timeouts++;
+            completions.emplace_back(std::move(outstanding.on_complete), std::nullopt);
+        }
+        backend.outstanding.clear();
+        backend.reconnects++;
+        connect(backend, now);
+        return true;
+    }
+
+    if (!backend.client) {
+        return false;
+    }
+    // Ejected backends are still drained, so requests already sent to them can complete
+    did_work = backend.client->poll();
+    while (auto response = backend.client->poll_response()) {
+        did_work = true;
+        uint64_t stream_id = 0;
+        if (auto echoed = response->headers.get(HEADER_STREAM_ID)) {
+            std::from_chars(echoed->data(), echoed->data() + echoed->size(), stream_id);
+        }
+        auto outstanding = backend.outstanding.find(stream_id);
+        if (outstanding == backend.outstanding.end()) {
+            continue; // Already timed out
+        }
+
+        double latency_us = std::chrono::duration<double, std::micro>(now - outstanding->second.sent).count();
+        backend.latency_ewma_us = backend.latency_ewma_us == 0.0 ? latency_us :
+                                  backend.latency_ewma_us + POOL_LATENCY_EWMA_WEIGHT * (latency_us - backend.latency_ewma_us);
+        bool failed = response->response_line.status_code >= 500;
+        backend.completed++;
+        backend.failures += failed ? 1 : 0;
+        completions.emplace_back(std::move(outstanding->second.on_complete), std::move(response));
+        backend.outstanding.erase(outstanding);
+        record_result(backend, failed, now);
+    }
+
+    for (auto outstanding = backend.outstanding.begin(); outstanding != backend.outstanding.end();) {
+        if (outstanding->second.deadline > now) {
+            ++outstanding;
+            continue;
+        }
+        did_work = true;
+        backend.timeouts++;
+        completions.emplace_back(std::move(outstanding->second.on_complete), std::nullopt);
+        outstanding = backend.outstanding.erase(outstanding);
+        record_result(backend, true, now);
+    }
+    return did_work;
+}
+
+Client_Pool::Backend* Client_Pool::pick_backend() {
+    std::vector<Backend*> candidates;
+    for (size_t i{}; i < backends.size(); i++) {
+        Backend* backend = backends[(next_backend + i) % backends.size()].get();
+        if (backend->state == BACKEND_HEALTHY && backend->outstanding.size() < config.max_in_flight_per_backend) {
+            candidates.push_back(backend);
+        }
+    }
+    if (candidates.empty()) {
+        return nullptr;
+    }
+    next_backend++;
+
+    auto less_loaded = [](const Backend* a, const Backend* b) {
+        if (a->outstanding.size() != b->outstanding.size()) {
+            return a->outstanding.size() < b->outstanding.size();
+        }
+        return a->latency_ewma_us < b->latency_ewma_us;
+    };
+    if (config.policy == BALANCE_POWER_OF_TWO && candidates.size() > 2) {
+        std::uniform_int_distribution<size_t> pick(0, candidates.size() - 1);
+        size_t first = pick(rng);
+        size_t second = pick(rng);
+        while (second == first) {
+            second = pick(rng);
+        }
+        return less_loaded(candidates[second], candidates[first]) ? candidates[second] : candidates[first];
+    }
+    return *std::min_element(candidates.begin(), candidates.end(), less_loaded);
+}
+
+bool Client_Pool::dispatch(clock::time_point now, std::vector<Completion>& completions) {
+    bool did_work = false;
+    while (!queued.empty()) {
+        Queued_Request& next = queued.front();
+        if (next.deadline <= now) {
+            completions.emplace_back(std::move(next.on_complete), std::nullopt);
+            queued.pop_front();
+            did_work = true;
+            continue;
+        }
+
+        Backend* backend = pick_backend();
+        if (!backend) {
+            break;
+        }
+        uint64_t stream_id = backend->client->begin_request(next.request);
+        if (stream_id == 0) {
+            backend->state = BACKEND_EJECTED;
+            backend->state_since = now;
+            continue;
+        }
+        backend->outstanding.emplace(stream_id, Outstanding{std::move(next.on_complete), now, next.deadline});
+        queued.pop_front();
+        did_work = true;
+    }
+
+    // Anything still queued waits for capacity, but not past its deadline
+    for (auto request = queued.begin(); request != queued.end();) {
+        if (request->deadline > now) {
+            ++request;
+            continue;
+        }
+        completions.emplace_back(std::move(request->on_complete), std::nullopt);
+        request = queued.erase(request);
+        did_work = true;
+    }
+    return did_work;
+}
+
+bool Client_Pool::poll() {
+    std::vector<Completion> completions;
+    std::unique_lock<std::mutex> pool_lock(pool_mutex);
+    if (!running) {
+        return false;
+    }
+    clock::time_point now = clock::now();
+    bool did_work = false;
+    for (auto& backend : backends) {
+        did_work |= poll_backend(*backend, now, completions);
+    }
+    did_work |= dispatch(now, completions);
+    pool_lock.unlock();
+
+    // Outside the lock, a callback may submit the next request
+    for (auto& [on_complete, response] : completions) {
+        on_complete(std::move(response));
+    }
+    return did_work;
+}
+
+void Client_Pool::send_request(const Request& request, Response_Callback on_complete) {
+    std::unique_lock<std::mutex> pool_lock(pool_mutex);
+    queued.push_back(Queued_Request{request, std::move(on_complete), clock::now() + config.request_timeout});
+}
+
+std::optional<Response> Client_Pool::send_request(const Request& request) {
+    auto promise = std::make_shared<std::promise<std::optional<Response>>>();
+    std::future<std::optional<Response>> result = promise->get_future();
+    send_request(request, [promise](std::optional<Response> response) {
+        promise->set_value(std::move(response));
+    });
+    return result.get();
+}
+
+std::vector<Backend_Stats> Client_Pool::stats() const {
+    std::unique_lock<std::mutex> pool_lock(pool_mutex);
+    std::vector<Backend_Stats> result;
+    for (const auto& backend : backends) {
+        result.push_back(Backend_Stats{
+            .address = backend->ip + ":" + std::to_string(backend->port),
+            .state = backend->state,
+            .in_flight = backend->outstanding.size(),
+            .completed = backend->completed,
+            .failures = backend->failures,
+            .timeouts = backend->timeouts,
+            .reconnects = backend->reconnects,
+            .latency_ewma_us = backend->latency_ewma_us
+        });
+    }
+    return result;
+}
@@ -0,0 +1,123 @@
+#ifndef CLIENT_POOL_HPP
+#define CLIENT_POOL_HPP
+
+#include "client.hpp"
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <optional>
+#include <functional>
+#include <unordered_map>
+
+enum Balance_Policy {
+    BALANCE_LEAST_OUTSTANDING,
+    BALANCE_POWER_OF_TWO // Fewer outstanding of two random backends, cheaper to decide with many backends
+};
+
+enum Backend_State {
+    BACKEND_CONNECTING,
+    BACKEND_HEALTHY,
+    BACKEND_EJECTED // Out of rotation until ejection_time passes, then reconnected
+};
+
+struct Client_Pool_Config {
+    std::string local_ip = "127.0.0.1";
+    int local_port_base = 30000; // Backend i binds local_port_base + i
+    Balance_Policy policy = BALANCE_LEAST_OUTSTANDING;
+    size_t max_in_flight_per_backend = 64; // Further requests wait in the pool
+    std::chrono::milliseconds request_timeout{2000}; // From submission, including time queued in the pool
+    std::chrono::milliseconds connect_timeout{1000}; // Handshakes slower than this are restarted
+    uint32_t failures_to_eject = 3; // Consecutive timeouts or 5xx responses
+    std::chrono::milliseconds latency_to_eject{0}; // Smoothed latency that takes a backend out, 0 disables
+    std::chrono::milliseconds ejection_time{1000};
+    std::function<std::unique_ptr<Datagram_Transport>()> transport_factory; // Empty uses UDP
+    uint64_t seed = 1;
+};
+
+struct Backend_Stats {
+    std::string address; // "ip:port"
+    Backend_State state;
+    size_t in_flight;
+    uint64_t completed;
+    uint64_t failures; // 5xx responses
+    uint64_t timeouts;
+    uint64_t reconnects;
+    double latency_ewma_us;
+};
+
+// Warm associations to a set of backends, balanced per request. The pool's own event loop (or
+// poll() in EVENT_LOOP_MANUAL mode) drives every association, reconnects and health checks, so
+// handshakes never happen on the request path; requests only go to established backends.
+class Client_Pool {
+    public:
+        explicit Client_Pool(const Client_Pool_Config& config = {});
+        ~Client_Pool();
+
+        void add_backend(const std::string& ip, int port); // Before start()
+        void start(Event_Loop_Mode mode = EVENT_LOOP_THREADED);
+        void stop(); // Pending requests complete with nullopt
+        bool poll(); // One pass in EVENT_LOOP_MANUAL mode, returns whether any work was done
+
+        // The callback runs on the pool's event loop thread and must not block it
+        void send_request(const Request& request, Response_Callback on_complete);
+        std::optional<Response> send_request(const Request& request); // Blocks, EVENT_LOOP_THREADED only
+        std::vector<Backend_Stats> stats() const;
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        struct Outstanding {
+            Response_Callback on_complete;
+            clock::time_point sent;
+            clock::time_point deadline;
+        };
+
+        struct Backend {
+            std::string ip;
+            int port;
+            int local_port;
+            std::unique_ptr<Client> client;
+            Backend_State state;
+            clock::time_point state_since;
+            std::unordered_map<uint64_t, Outstanding> outstanding; // By stream id
+            uint32_t consecutive_failures;
+            double latency_ewma_us;
+            uint64_t completed;
+            uint64_t failures;
+            uint64_t timeouts;
+            uint64_t reconnects;
+        };
+
+        struct Queued_Request {
+            Request request;
+            Response_Callback on_complete;
+            clock::time_point deadline;
+        };
+
+        using Completion = std::pair<Response_Callback, std::optional<Response>>;
+
+        Client_Pool_Config config;
+        std::vector<std::unique_ptr<Backend>> backends;
+        std::deque<Queued_Request> queued;
+        mutable std::mutex pool_mutex;
+        std::atomic<bool> running;
+        std::thread event_loop_thread;
+        std::mt19937_64 rng;
+        size_t next_backend; // Rotates ties between equally loaded backends
+
+        void event_loop();
+        void connect(Backend& backend, clock::time_point now);
+        bool poll_backend(Backend& backend, clock::time_point now, std::vector<Completion>& completions);
+        void record_result(Backend& backend, bool failed, clock::time_point now);
+        Backend* pick_backend();
+        bool dispatch(clock::time_point now, std::vector<Completion>& completions);
+};
+
+#endif
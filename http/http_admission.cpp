@@ -0,0 +1,68 @@
+#include "http_admission.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Exponential averages over roughly the last 10 requests
+constexpr double LATENCY_WEIGHT = 2.0 / 11;
+constexpr double MIN_GRADIENT = 0.5;
+
+Concurrency_Limiter::Concurrency_Limiter(const Admission_Config& config) : config(config), current_limit(static_cast<double>(config.initial_limit)),
+                                                                           in_flight(0), latency(0), service_time(0), min_latency(0), admitted(0), shed{} {}
+
+bool Concurrency_Limiter::has_room_locked(Route_Priority priority) const {
+    double allowed = std::max(1.0, std::floor(current_limit * config.shares[priority]));
+    return static_cast<double>(in_flight) < allowed;
+}
+
+bool Concurrency_Limiter::has_room(Route_Priority priority) const {
+    std::unique_lock<std::mutex> limiter_lock(limiter_mutex);
+    return has_room_locked(priority);
+}
+
+bool Concurrency_Limiter::try_acquire(Route_Priority priority) {
+    std::unique_lock<std::mutex> limiter_lock(limiter_mutex);
+    if (!has_room_locked(priority)) {
+        shed[priority]++;
+        return false;
+    }
+    in_flight++;
+    admitted++;
+    return true;
+}
+
+void Concurrency_Limiter::release(std::chrono::nanoseconds request_latency, std::chrono::nanoseconds request_service_time) {
+    std::unique_lock<std::mutex> limiter_lock(limiter_mutex);
+    size_t was_in_flight = in_flight;
+    in_flight = in_flight > 0 ? in_flight - 1 : 0;
+
+    double sample = static_cast<double>(std::max<int64_t>(request_latency.count(), 1));
+    double service_sample = std::min(static_cast<double>(std::max<int64_t>(request_service_time.count(), 0)), sample);
+    if (min_latency == 0) {
+        latency = sample;
+        service_time = service_sample;
+        min_latency = sample;
+        return;
+    }
+    latency += (sample - latency) * LATENCY_WEIGHT;
+    service_time += (service_sample - service_time) * LATENCY_WEIGHT;
+    min_latency = std::min(min_latency, sample);
+
+    double unqueued = std::max(service_time, min_latency);
+    double gradient = std::clamp(config.tolerance * unqueued / latency, MIN_GRADIENT, 1.0);
+    double target = current_limit * gradient + std::sqrt(current_limit);
+    if (target > current_limit && 2 * was_in_flight < current_limit) {
+        return;
+    }
+    double next = current_limit * (1 - config.smoothing) + target * config.smoothing;
+    current_limit = std::clamp(next, static_cast<double>(config.min_limit), static_cast<double>(config.max_limit));
+}
+
+size_t Concurrency_Limiter::limit() const {
+    std::unique_lock<std::mutex> limiter_lock(limiter_mutex);
+    return static_cast<size_t>(current_limit);
+}
+
+Admission_Stats Concurrency_Limiter::stats() const {
+    std::unique_lock<std::mutex> limiter_lock(limiter_mutex);
+    return Admission_Stats{static_cast<size_t>(current_limit), in_flight, admitted, shed, latency / 1e6, service_time / 1e6};
+}
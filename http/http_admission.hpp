@@ -0,0 +1,70 @@
+#ifndef HTTP_ADMISSION_HPP
+#define HTTP_ADMISSION_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <chrono>
+#include <mutex>
+
+// Per route, given at register_route. Under load the least important class is shed first.
+enum Route_Priority {
+    PRIORITY_CRITICAL,
+    PRIORITY_NORMAL,
+    PRIORITY_SHEDDABLE,
+    PRIORITY_COUNT
+};
+
+struct Admission_Config {
+    size_t initial_limit = 20; // Requests in flight (queued or running) before anything is shed
+    size_t min_limit = 4;
+    size_t max_limit = 1000;
+    // Latency may grow to this multiple of the handler time before the limit comes down
+    double tolerance = 1.5;
+    double smoothing = 0.2; // Weight of each new estimate in the limit
+    // Fraction of the limit each class may fill, so critical requests still get in when the
+    // others are already turned away
+    std::array<double, PRIORITY_COUNT> shares{1.0, 0.9, 0.5};
+    uint32_t retry_after_seconds = 1; // Sent with 503 in Retry-After
+};
+
+struct Admission_Stats {
+    size_t limit;
+    size_t in_flight;
+    uint64_t admitted;
+    std::array<uint64_t, PRIORITY_COUNT> shed; // Per class
+    double latency_ms; // Recent requests, admission to response
+    double service_ms; // Recent requests, in the handler
+};
+
+// Gradient concurrency limit: the ratio of what a request would take without queueing to what
+// it took from admission to response scales the limit down as requests queue, and sqrt(limit)
+// of headroom lets it probe upwards while they do not. Without queueing a request takes its
+// handler time, or the lowest latency seen when that is more, which covers the handoff to a
+// worker. The limit only grows while at least half of it is in use, an idle server learns
+// nothing about its capacity.
+class Concurrency_Limiter {
+    public:
+        explicit Concurrency_Limiter(const Admission_Config& config = {});
+
+        bool has_room(Route_Priority priority) const; // Whether try_acquire would admit now
+        bool try_acquire(Route_Priority priority); // Counted in flight until release, or counted as shed
+        void release(std::chrono::nanoseconds latency, std::chrono::nanoseconds service_time);
+        size_t limit() const;
+        Admission_Stats stats() const;
+
+    private:
+        Admission_Config config;
+        mutable std::mutex limiter_mutex;
+        double current_limit;
+        size_t in_flight;
+        double latency; // Nanoseconds, exponential averages
+        double service_time;
+        double min_latency;
+        uint64_t admitted;
+        std::array<uint64_t, PRIORITY_COUNT> shed;
+
+        bool has_room_locked(Route_Priority priority) const;
+};
+
+#endif
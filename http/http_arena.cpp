@@ -0,0 +1,79 @@
+#include "http_arena.hpp"
+#include <algorithm>
+
+void* Request_Arena::Overflow_Resource::do_allocate(size_t bytes, size_t alignment) {
+    allocations++;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void Request_Arena::Overflow_Resource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool Request_Arena::Overflow_Resource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+Request_Arena::Request_Arena(const Arena_Config& config) : arena_config(config), block_bytes(std::max<size_t>(config.initial_bytes, 1)),
+                                                           block(new std::byte[block_bytes]) {
+    arena.emplace(block.get(), block_bytes, &overflow);
+}
+
+std::pmr::memory_resource* Request_Arena::resource() {
+    return &*arena;
+}
+
+bool Request_Arena::overflowed() const {
+    return overflow.allocations > 0;
+}
+
+size_t Request_Arena::capacity() const {
+    return block_bytes;
+}
+
+const Arena_Config& Request_Arena::config() const {
+    return arena_config;
+}
+
+void Request_Arena::reset() {
+    if (!overflowed() || block_bytes >= arena_config.max_bytes) {
+        arena->release();
+        overflow.allocations = 0;
+        return;
+    }
+    // Requests this size come again, the next one should fit
+    arena.reset();
+    block_bytes = std::min(block_bytes * 2, arena_config.max_bytes);
+    block.reset(new std::byte[block_bytes]);
+    arena.emplace(block.get(), block_bytes, &overflow);
+    overflow.allocations = 0;
+}
+
+static thread_local std::optional<Request_Arena> thread_arena;
+static thread_local bool thread_arena_leased = false;
+
+Arena_Lease::Arena_Lease(const Arena_Config& config) : leased(nullptr) {
+    if (thread_arena_leased) {
+        return;
+    }
+    if (!thread_arena || thread_arena->config().initial_bytes != config.initial_bytes || thread_arena->config().max_bytes != config.max_bytes) {
+        thread_arena.emplace(config);
+    }
+    thread_arena_leased = true;
+    leased = &*thread_arena;
+}
+
+Arena_Lease::~Arena_Lease() {
+    if (leased) {
+        leased->reset();
+        thread_arena_leased = false;
+    }
+}
+
+std::pmr::memory_resource* Arena_Lease::resource() const {
+    return leased ? leased->resource() : std::pmr::get_default_resource();
+}
+
+bool Arena_Lease::overflowed() const {
+    return leased && leased->overflowed();
+}
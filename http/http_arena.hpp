@@ -0,0 +1,65 @@
+#ifndef HTTP_ARENA_HPP
+#define HTTP_ARENA_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+struct Arena_Config {
+    size_t initial_bytes = 16 * 1024; // Block each thread keeps and hands out again for every request
+    size_t max_bytes = 256 * 1024; // The block doubles after a request outgrew it, up to this
+};
+
+// Monotonic arena for data that dies with its request: allocations bump a pointer through one
+// block, deallocation does nothing and reset() takes the whole block back at once. A request
+// that needs more gets further blocks from the heap, which reset() frees again.
+class Request_Arena {
+    public:
+        explicit Request_Arena(const Arena_Config& config = {});
+
+        std::pmr::memory_resource* resource();
+        bool overflowed() const; // Went to the heap since the last reset
+        size_t capacity() const; // Bytes of the block kept between requests
+        const Arena_Config& config() const;
+        void reset(); // Invalidates everything allocated since the last reset
+
+    private:
+        // Upstream of the arena, counts the blocks it has to get from the heap
+        class Overflow_Resource : public std::pmr::memory_resource {
+            public:
+                size_t allocations = 0;
+
+            private:
+                void* do_allocate(size_t bytes, size_t alignment) override;
+                void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+                bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+        };
+
+        Arena_Config arena_config;
+        size_t block_bytes;
+        std::unique_ptr<std::byte[]> block;
+        Overflow_Resource overflow;
+        std::optional<std::pmr::monotonic_buffer_resource> arena;
+};
+
+// The calling thread's arena for the duration of one request, so every worker recycles its own
+// block, made again when a server with another config leases it. Resets the arena when it goes
+// out of scope. A request served while another is still in the arena on this thread (a handler
+// driving a second server inline) falls back to the heap.
+class Arena_Lease {
+    public:
+        explicit Arena_Lease(const Arena_Config& config);
+        ~Arena_Lease();
+        Arena_Lease(const Arena_Lease&) = delete;
+        Arena_Lease& operator=(const Arena_Lease&) = delete;
+
+        std::pmr::memory_resource* resource() const;
+        bool overflowed() const;
+
+    private:
+        Request_Arena* leased;
+};
+
+#endif
@@ -0,0 +1,278 @@
+#include "http_binary_codec.hpp"
+#include "http_parse.hpp"
+#include "http_router.hpp"
+#include "http_scan.hpp"
+#include <charconv>
+
+constexpr std::string_view BINARY_VERSION = "HTTP/2.5";
+
+// Indexed by Http_Method, as far as METHOD_OTHER
+static constexpr std::string_view METHOD_NAMES[] = {"GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS"};
+
+bool is_binary_message(std::span<const uint8_t> message) {
+    return !message.empty() && message[0] == BINARY_MESSAGE_MARKER;
+}
+
+void encode_varint(uint64_t value, std::vector<uint8_t>& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+std::optional<uint64_t> decode_varint(std::span<const uint8_t> bytes, size_t& position) {
+    uint64_t value = 0;
+    for (size_t i{}; i < MAX_VARINT_SIZE && position < bytes.size(); i++) {
+        uint8_t byte = bytes[position++];
+        // The tenth byte holds the 64th bit only
+        if (i == MAX_VARINT_SIZE - 1 && byte > 1) {
+            return std::nullopt;
+        }
+        value |= uint64_t(byte & 0x7f) << (7 * i);
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    return std::nullopt;
+}
+
+static void encode_string(std::string_view text, std::vector<uint8_t>& out) {
+    encode_varint(text.size(), out);
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+static void encode_field(Header_Id id, std::string_view name, std::string_view value, std::vector<uint8_t>& out) {
+    out.push_back(id);
+    if (id == HEADER_OTHER) {
+        encode_string(name, out);
+    }
+    encode_string(value, out);
+}
+
+// The count goes ahead of the fields, so it is written once they are: one byte is set aside,
+// which is all but the rare message with 128 fields or more needs
+static void patch_field_count(std::vector<uint8_t>& out, size_t count_position, uint64_t count) {
+    if (count < 0x80) {
+        out[count_position] = static_cast<uint8_t>(count);
+        return;
+    }
+    std::vector<uint8_t> encoded;
+    encode_varint(count, encoded);
+    out[count_position] = encoded[0];
+    out.insert(out.begin() + count_position + 1, encoded.begin() + 1, encoded.end());
+}
+
+static void finish_message(std::span<const std::span<const uint8_t>> body, std::vector<uint8_t>& out) {
+    size_t body_size = 0;
+    for (const auto& segment : body) {
+        body_size += segment.size();
+    }
+    encode_varint(body_size, out);
+    for (const auto& segment : body) {
+        out.insert(out.end(), segment.begin(), segment.end());
+    }
+}
+
+void encode_binary_request(const Request& request, uint64_t stream_id, std::vector<uint8_t>& out, std::optional<std::chrono::milliseconds> timeout) {
+    const Request_Line& line = request.request_line;
+    out.reserve(out.size() + 2 * MAX_VARINT_SIZE + line.method.size() + line.uri.size() + request.headers.serialized_size() + request.body.size());
+    out.push_back(BINARY_MESSAGE_MARKER);
+    out.push_back(BINARY_REQUEST);
+    Http_Method method = http_method(line.method);
+    out.push_back(static_cast<uint8_t>(method));
+    if (method == METHOD_OTHER) {
+        encode_string(line.method, out);
+    }
+    encode_string(line.uri, out);
+
+    size_t count_position = out.size();
+    out.push_back(0);
+    uint64_t count = 0;
+    if (stream_id != 0) {
+        char digits[24];
+        encode_field(HEADER_STREAM_ID, {}, std::string_view(digits, std::to_chars(digits, digits + sizeof(digits), stream_id).ptr - digits), out);
+        count++;
+    }
+    if (timeout) {
+        char digits[24];
+        encode_field(HEADER_REQUEST_TIMEOUT, {}, std::string_view(digits, std::to_chars(digits, digits + sizeof(digits), timeout->count()).ptr - digits), out);
+        count++;
+    }
+    for (size_t i{}; i < request.headers.size(); i++) {
+        Header_Id id = request.headers.id_at(i);
+        if (id == HEADER_CONTENT_LENGTH || (id == HEADER_STREAM_ID && stream_id != 0) || (id == HEADER_REQUEST_TIMEOUT && timeout)) {
+            continue;
+        }
+        Header_View field = request.headers[i];
+        encode_field(id, field.name, field.value, out);
+        count++;
+    }
+    patch_field_count(out, count_position, count);
+
+    std::span<const uint8_t> body_segments[] = {request.body};
+    finish_message(body_segments, out);
+}
+
+static uint32_t id_bit(Header_Id id) {
+    return id == HEADER_OTHER ? 0 : 1u << id;
+}
+
+void encode_binary_response(Status_Code status_code, const Header_Block* header_block, const Headers* headers,
+                            std::span<const std::span<const uint8_t>> body, std::vector<uint8_t>& out) {
+    out.push_back(BINARY_MESSAGE_MARKER);
+    out.push_back(BINARY_RESPONSE);
+    encode_varint(static_cast<uint64_t>(status_code), out);
+
+    size_t count_position = out.size();
+    out.push_back(0);
+    uint64_t count = 0;
+    // Same precedence as write_response: block fields win over same-named headers
+    bool has_date = (headers && headers->contains(HEADER_DATE)) || (header_block && (header_block->id_mask & id_bit(HEADER_DATE)));
+    if (!has_date) {
+        std::string_view date_line = date_header_line();
+        encode_field(HEADER_DATE, {}, date_line.substr(6, date_line.size() - 6 - SEPERATOR.size()), out);
+        count++;
+    }
+    if (header_block) {
+        std::string_view lines = header_block->bytes;
+        while (!lines.empty()) {
+            size_t line_end = lines.find(SEPERATOR);
+            std::string_view line = lines.substr(0, line_end);
+            size_t colon = line.find(": ");
+            if (colon != std::string_view::npos) {
+                std::string_view name = line.substr(0, colon);
+                encode_field(header_id(name), name, line.substr(colon + 2), out);
+                count++;
+            }
+            lines.remove_prefix(line_end == std::string_view::npos ? lines.size() : line_end + SEPERATOR.size());
+        }
+    }
+    if (headers) {
+        for (size_t i{}; i < headers->size(); i++) {
+            Header_Id id = headers->id_at(i);
+            Header_View field = (*headers)[i];
+            if (!skip_response_header(header_block, id, field.name)) {
+                encode_field(id, field.name, field.value, out);
+                count++;
+            }
+        }
+    }
+    patch_field_count(out, count_position, count);
+    finish_message(body, out);
+}
+
+void encode_binary_response(const Response& response, const Header_Block* header_block, std::vector<uint8_t>& out) {
+    std::span<const uint8_t> body_segments[] = {response_body(response)};
+    encode_binary_response(response.response_line.status_code, header_block, &response.headers, body_segments, out);
+}
+
+static std::optional<std::string_view> decode_string(std::span<const uint8_t> message, size_t& position) {
+    auto length = decode_varint(message, position);
+    if (!length || *length > message.size() - position) {
+        return std::nullopt;
+    }
+    std::string_view text(reinterpret_cast<const char*>(message.data()) + position, *length);
+    position += *length;
+    return text;
+}
+
+// Fields, then the body, which must end exactly at the end of the message
+static std::optional<std::span<const uint8_t>> decode_fields_and_body(std::span<const uint8_t> message, size_t& position, Headers& headers) {
+    auto count = decode_varint(message, position);
+    // Every field takes at least two bytes, a larger count cannot be honest
+    if (!count || *count > (message.size() - position) / 2) {
+        return std::nullopt;
+    }
+    for (uint64_t i{}; i < *count; i++) {
+        if (position >= message.size() || message[position] >= HEADER_ID_COUNT) {
+            return std::nullopt;
+        }
+        Header_Id id = static_cast<Header_Id>(message[position++]);
+        std::optional<std::string_view> name;
+        if (id == HEADER_OTHER) {
+            // Interned names never travel spelled out, and anything else must be a token
+            name = decode_string(message, position);
+            if (!name || name->empty() || !scan_is_token(*name) || header_id(*name) != HEADER_OTHER) {
+                return std::nullopt;
+            }
+        }
+        auto value = decode_string(message, position);
+        if (!value) {
+            return std::nullopt;
+        }
+        if (id == HEADER_CONTENT_LENGTH) {
+            continue; // The body length is authoritative
+        }
+        if (name) {
+            headers.add(*name, *value);
+        } else {
+            headers.add(id, *value);
+        }
+    }
+    auto body_size = decode_varint(message, position);
+    if (!body_size || *body_size != message.size() - position) {
+        return std::nullopt;
+    }
+    return message.subspan(position);
+}
+
+static void add_content_length(Headers& headers, size_t body_size) {
+    char digits[24];
+    headers.add(HEADER_CONTENT_LENGTH, std::string_view(digits, std::to_chars(digits, digits + sizeof(digits), body_size).ptr - digits));
+}
+
+std::optional<Request> decode_binary_request(std::span<const uint8_t> message) {
+    if (message.size() < 3 || message[0] != BINARY_MESSAGE_MARKER || message[1] != BINARY_REQUEST || message[2] > METHOD_OTHER) {
+        return std::nullopt;
+    }
+    Request request;
+    size_t position = 3;
+    Http_Method method = static_cast<Http_Method>(message[2]);
+    if (method == METHOD_OTHER) {
+        auto name = decode_string(message, position);
+        if (!name || name->empty() || !scan_is_token(*name)) {
+            return std::nullopt;
+        }
+        request.request_line.method.assign(*name);
+    } else {
+        request.request_line.method.assign(METHOD_NAMES[method]);
+    }
+    auto uri = decode_string(message, position);
+    if (!uri || uri->empty()) {
+        return std::nullopt;
+    }
+    request.request_line.uri.assign(*uri);
+    request.request_line.version.assign(BINARY_VERSION);
+
+    auto body = decode_fields_and_body(message, position, request.headers);
+    if (!body) {
+        return std::nullopt;
+    }
+    if (!body->empty()) {
+        add_content_length(request.headers, body->size());
+    }
+    request.body.assign(body->begin(), body->end());
+    return request;
+}
+
+std::optional<Response> decode_binary_response(std::span<const uint8_t> message) {
+    if (message.size() < 3 || message[0] != BINARY_MESSAGE_MARKER || message[1] != BINARY_RESPONSE) {
+        return std::nullopt;
+    }
+    size_t position = 2;
+    auto status = decode_varint(message, position);
+    if (!status || *status < 100 || *status > 999) {
+        return std::nullopt;
+    }
+    Response response;
+    Status_Code status_code = static_cast<Status_Code>(*status);
+    response.response_line = Response_Line{std::string(BINARY_VERSION), status_code, std::string(reason_phrase(status_code))};
+    auto body = decode_fields_and_body(message, position, response.headers);
+    if (!body) {
+        return std::nullopt;
+    }
+    add_content_length(response.headers, body->size());
+    response.body.assign(body->begin(), body->end());
+    return response;
+}
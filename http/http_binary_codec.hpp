@@ -0,0 +1,56 @@
+#ifndef HTTP_BINARY_CODEC_HPP
+#define HTTP_BINARY_CODEC_HPP
+
+#include "http_headers.hpp"
+#include "http_request.hpp"
+#include "http_response.hpp"
+#include "http_response_writer.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Binary HTTP2.5 messages start with BINARY_MESSAGE_MARKER and the message kind, then:
+//   request:  method (Http_Method, METHOD_OTHER followed by the name as a string), URI string
+//   response: status code as a varint
+// then the field count, the fields, the body length and the body, which must end the message.
+// A field is a Header_Id byte (HEADER_OTHER followed by the name as a string) and the value as a
+// string; a string is its varint length and its bytes. Varints are unsigned LEB128. The version
+// is always HTTP/2.5 and Content-Length is implied by the body length.
+constexpr uint8_t BINARY_MESSAGE_MARKER = 0x02;
+constexpr uint8_t BINARY_REQUEST = 0x00;
+constexpr uint8_t BINARY_RESPONSE = 0x01;
+constexpr size_t MAX_VARINT_SIZE = 10;
+
+// Sent by the client as "Wire-Format: binary" until a response carries it back. Text stays the
+// default, and what a peer without the format configured gets, so messages remain readable.
+constexpr std::string_view WIRE_FORMAT = "Wire-Format";
+constexpr std::string_view WIRE_FORMAT_BINARY = "binary";
+
+enum Wire_Format {
+    WIRE_TEXT,
+    WIRE_BINARY
+};
+
+bool is_binary_message(std::span<const uint8_t> message);
+void encode_varint(uint64_t value, std::vector<uint8_t>& out);
+std::optional<uint64_t> decode_varint(std::span<const uint8_t> bytes, size_t& position); // nullopt when truncated or over 64 bits
+
+// Stream-Id goes first when stream_id is not 0, then Request-Timeout when set, replacing those the
+// request carries
+void encode_binary_request(const Request& request, uint64_t stream_id, std::vector<uint8_t>& out,
+                           std::optional<std::chrono::milliseconds> timeout = std::nullopt);
+// Same fields as write_response: Date unless present, the header block, then the headers
+void encode_binary_response(Status_Code status_code, const Header_Block* header_block, const Headers* headers,
+                            std::span<const std::span<const uint8_t>> body, std::vector<uint8_t>& out);
+void encode_binary_response(const Response& response, const Header_Block* header_block, std::vector<uint8_t>& out);
+
+// One bounds-checked pass; nullopt for anything truncated, overlong or of the other kind.
+// Content-Length is added from the body, as a text message would carry it.
+std::optional<Request> decode_binary_request(std::span<const uint8_t> message);
+std::optional<Response> decode_binary_response(std::span<const uint8_t> message);
+
+#endif
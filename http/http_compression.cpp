@@ -0,0 +1,332 @@
+#include "http_compression.hpp"
+#include <zlib.h>
+#include <algorithm>
+#include <charconv>
+#include <functional>
+
+constexpr int ZLIB_WINDOW_BITS = 15;
+constexpr int GZIP_WINDOW_BITS = ZLIB_WINDOW_BITS + 16;
+constexpr int AUTO_HEADER_WINDOW_BITS = ZLIB_WINDOW_BITS + 32; // Inflate detects gzip or zlib headers
+constexpr int RAW_WINDOW_BITS = -ZLIB_WINDOW_BITS;
+constexpr int ZLIB_MEMORY_LEVEL = 8;
+
+std::string_view coding_name(Content_Coding coding) {
+    switch (coding) {
+        case CODING_GZIP: return "gzip";
+        case CODING_DEFLATE: return "deflate";
+        default: return "identity";
+    }
+}
+
+std::optional<Content_Coding> content_coding(std::string_view name) {
+    if (iequals(name, "gzip") || iequals(name, "x-gzip")) {
+        return CODING_GZIP;
+    }
+    if (iequals(name, "deflate")) {
+        return CODING_DEFLATE;
+    }
+    if (iequals(name, "identity")) {
+        return CODING_IDENTITY;
+    }
+    return std::nullopt;
+}
+
+static std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// q-values have at most three decimals, kept as thousandths to stay in integers
+static int parse_quality(std::string_view params) {
+    int quality = 1000;
+    while (!params.empty()) {
+        size_t end = std::min(params.find(';'), params.size());
+        std::string_view param = trim(params.substr(0, end));
+        params.remove_prefix(std::min(end + 1, params.size()));
+        if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') || param[1] != '=') {
+            continue;
+        }
+        std::string_view value = param.substr(2);
+        quality = 0;
+        if (!value.empty() && value[0] == '1') {
+            quality = 1000;
+        } else if (value.size() > 2 && value[0] == '0' && value[1] == '.') {
+            int scale = 100;
+            for (size_t i = 2; i < value.size() && i < 5 && value[i] >= '0' && value[i] <= '9'; i++) {
+                quality += (value[i] - '0') * scale;
+                scale /= 10;
+            }
+        }
+    }
+    return quality;
+}
+
+Content_Coding negotiate_coding(std::string_view accept_encoding, uint32_t codings) {
+    // -1 is "not mentioned", which only "*" can change
+    int quality[3] = {-1, -1, -1};
+    int wildcard = -1;
+    while (!accept_encoding.empty()) {
+        size_t end = std::min(accept_encoding.find(','), accept_encoding.size());
+        std::string_view entry = accept_encoding.substr(0, end);
+        accept_encoding.remove_prefix(std::min(end + 1, accept_encoding.size()));
+
+        size_t params = std::min(entry.find(';'), entry.size());
+        std::string_view name = trim(entry.substr(0, params));
+        int q = parse_quality(entry.substr(std::min(params + 1, entry.size())));
+        if (name == "*") {
+            wildcard = q;
+        } else if (auto coding = content_coding(name)) {
+            quality[*coding] = std::max(quality[*coding], q);
+        }
+    }
+
+    Content_Coding best = CODING_IDENTITY;
+    int best_quality = 0;
+    for (Content_Coding coding : {CODING_GZIP, CODING_DEFLATE}) {
+        int q = quality[coding] >= 0 ? quality[coding] : std::max(wildcard, 0);
+        if ((codings & coding_bit(coding)) && q > best_quality) {
+            best = coding;
+            best_quality = q;
+        }
+    }
+    // Identity is always acceptable as the fallback, but only beats a coding the client ranked lower
+    if (best != CODING_IDENTITY && quality[CODING_IDENTITY] > best_quality) {
+        return CODING_IDENTITY;
+    }
+    return best;
+}
+
+// deflateInit allocates a few hundred KiB, so each thread keeps one stream per coding and resets it
+class Thread_Deflater {
+    public:
+        explicit Thread_Deflater(int window_bits) : window_bits(window_bits), level(-1), ready(false), stream{} {}
+
+        ~Thread_Deflater() {
+            if (ready) {
+                deflateEnd(&stream);
+            }
+        }
+
+        z_stream* acquire(int requested_level) {
+            if (!ready) {
+                if (deflateInit2(&stream, requested_level, Z_DEFLATED, window_bits, ZLIB_MEMORY_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    return nullptr;
+                }
+                ready = true;
+                level = requested_level;
+                return &stream;
+            }
+            deflateReset(&stream);
+            if (requested_level != level) {
+                if (deflateParams(&stream, requested_level, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    return nullptr;
+                }
+                level = requested_level;
+            }
+            return &stream;
+        }
+
+    private:
+        int window_bits;
+        int level;
+        bool ready;
+        z_stream stream;
+};
+
+bool compress_body(Content_Coding coding, int level, std::span<const uint8_t> body, std::vector<uint8_t>& out) {
+    if (coding == CODING_IDENTITY) {
+        out.insert(out.end(), body.begin(), body.end());
+        return true;
+    }
+    thread_local Thread_Deflater gzip_deflater(GZIP_WINDOW_BITS);
+    thread_local Thread_Deflater zlib_deflater(ZLIB_WINDOW_BITS);
+    z_stream* stream = (coding == CODING_GZIP ? gzip_deflater : zlib_deflater).acquire(std::clamp(level, 0, COMPRESSION_LEVEL_BEST));
+    if (!stream) {
+        return false;
+    }
+
+    size_t start = out.size();
+    out.resize(start + deflateBound(stream, body.size()));
+    stream->next_in = const_cast<Bytef*>(body.data());
+    stream->avail_in = static_cast<uInt>(body.size());
+    stream->next_out = out.data() + start;
+    stream->avail_out = static_cast<uInt>(out.size() - start);
+    int result = deflate(stream, Z_FINISH);
+    out.resize(out.size() - stream->avail_out);
+    if (result != Z_STREAM_END) {
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
+
+static bool inflate_with(int window_bits, std::span<const uint8_t> body, std::vector<uint8_t>& out, size_t max_size) {
+    z_stream stream{};
+    if (inflateInit2(&stream, window_bits) != Z_OK) {
+        return false;
+    }
+    size_t start = out.size();
+    stream.next_in = const_cast<Bytef*>(body.data());
+    stream.avail_in = static_cast<uInt>(body.size());
+    int result = Z_OK;
+    while (result == Z_OK) {
+        size_t produced = out.size() - start;
+        if (produced >= max_size) {
+            break;
+        }
+        size_t chunk = std::min(std::max(body.size() * 4, size_t{4096}), max_size - produced);
+        out.resize(out.size() + chunk);
+        stream.next_out = out.data() + out.size() - chunk;
+        stream.avail_out = static_cast<uInt>(chunk);
+        result = inflate(&stream, Z_NO_FLUSH);
+        out.resize(out.size() - stream.avail_out);
+        if (result == Z_BUF_ERROR && stream.avail_in == 0) {
+            break; // Truncated input
+        }
+    }
+    inflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
+
+bool decompress_body(Content_Coding coding, std::span<const uint8_t> body, std::vector<uint8_t>& out, size_t max_size) {
+    if (coding == CODING_IDENTITY) {
+        out.insert(out.end(), body.begin(), body.end());
+        return true;
+    }
+    if (inflate_with(AUTO_HEADER_WINDOW_BITS, body, out, max_size)) {
+        return true;
+    }
+    // Some peers send "deflate" without the zlib wrapper
+    return coding == CODING_DEFLATE && inflate_with(RAW_WINDOW_BITS, body, out, max_size);
+}
+
+// Repeated Vary fields are folded into one list
+void add_vary(Headers& headers, std::string_view name) {
+    std::string vary;
+    for (size_t i{}; i < headers.size(); i++) {
+        if (headers.id_at(i) != HEADER_VARY) {
+            continue;
+        }
+        std::string_view list = headers[i].value;
+        while (!list.empty()) {
+            size_t end = std::min(list.find(','), list.size());
+            std::string_view item = trim(list.substr(0, end));
+            list.remove_prefix(std::min(end + 1, list.size()));
+            if (item == "*" || iequals(item, name)) {
+                return;
+            }
+            if (!item.empty()) {
+                vary.append(vary.empty() ? "" : ", ").append(item);
+            }
+        }
+    }
+    vary.append(vary.empty() ? "" : ", ").append(name);
+    headers.set(HEADER_VARY, vary);
+}
+
+bool decode_content(Headers& headers, std::vector<uint8_t>& body) {
+    auto encoding = headers.get(HEADER_CONTENT_ENCODING);
+    if (!encoding) {
+        return true;
+    }
+    auto coding = content_coding(trim(*encoding));
+    if (!coding) {
+        return false;
+    }
+    std::vector<uint8_t> decoded;
+    if (!decompress_body(*coding, body, decoded)) {
+        return false;
+    }
+    body = std::move(decoded);
+    headers.remove(HEADER_CONTENT_ENCODING);
+    char digits[24];
+    headers.set(HEADER_CONTENT_LENGTH, std::string_view(digits, std::to_chars(digits, digits + sizeof(digits), body.size()).ptr - digits));
+    return true;
+}
+
+Compression_Cache::Compression_Cache(size_t max_bytes) : max_bytes(max_bytes), bytes(0), hits(0), misses(0), evictions(0) {}
+
+static uint64_t hash_body(std::span<const uint8_t> body) {
+    return std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(body.data()), body.size()));
+}
+
+std::list<Compression_Cache::Entry>::iterator Compression_Cache::find(uint64_t hash, Content_Coding coding, int level, std::span<const uint8_t> body) {
+    auto [first, last] = index.equal_range(hash);
+    for (auto candidate = first; candidate != last; ++candidate) {
+        const Entry& entry = *candidate->second;
+        if (entry.coding == coding && entry.level == level && std::ranges::equal(entry.original, body)) {
+            return candidate->second;
+        }
+    }
+    return entries.end();
+}
+
+std::vector<uint8_t> Compression_Cache::compress(Content_Coding coding, int level, std::span<const uint8_t> body) {
+    uint64_t hash = hash_body(body);
+    std::unique_lock<std::mutex> cache_lock(cache_mutex);
+    auto cached = find(hash, coding, level, body);
+    if (cached != entries.end()) {
+        hits++;
+        entries.splice(entries.begin(), entries, cached);
+        return cached->compressed;
+    }
+    misses++;
+    cache_lock.unlock();
+
+    // Two threads missing on the same body both compress it, the second insert is dropped
+    std::vector<uint8_t> compressed;
+    if (!compress_body(coding, level, body, compressed) || compressed.size() >= body.size()) {
+        return {};
+    }
+    insert(Entry{hash, coding, level, std::vector<uint8_t>(body.begin(), body.end()), compressed});
+    return compressed;
+}
+
+void Compression_Cache::insert(Entry entry) {
+    size_t entry_bytes = entry.original.size() + entry.compressed.size();
+    if (entry_bytes > max_bytes) {
+        return;
+    }
+    std::unique_lock<std::mutex> cache_lock(cache_mutex);
+    if (find(entry.hash, entry.coding, entry.level, entry.original) != entries.end()) {
+        return;
+    }
+    while (bytes + entry_bytes > max_bytes && !entries.empty()) {
+        Entry& oldest = entries.back();
+        auto [first, last] = index.equal_range(oldest.hash);
+        for (auto candidate = first; candidate != last; ++candidate) {
+            if (&*candidate->second == &oldest) {
+                index.erase(candidate);
+                break;
+            }
+        }
+        bytes -= oldest.original.size() + oldest.compressed.size();
+        entries.pop_back();
+        evictions++;
+    }
+    uint64_t hash = entry.hash;
+    entries.push_front(std::move(entry));
+    index.emplace(hash, entries.begin());
+    bytes += entry_bytes;
+}
+
+Compression_Cache_Stats Compression_Cache::stats() const {
+    std::unique_lock<std::mutex> cache_lock(cache_mutex);
+    return Compression_Cache_Stats{hits, misses, evictions, entries.size(), bytes};
+}
+
+void Compression_Cache::clear() {
+    std::unique_lock<std::mutex> cache_lock(cache_mutex);
+    entries.clear();
+    index.clear();
+    bytes = 0;
+}
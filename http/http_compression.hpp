@@ -0,0 +1,102 @@
+#ifndef HTTP_COMPRESSION_HPP
+#define HTTP_COMPRESSION_HPP
+
+#include "http_headers.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum Content_Coding {
+    CODING_IDENTITY,
+    CODING_GZIP,
+    CODING_DEFLATE // zlib-wrapped, as HTTP's "deflate" means
+};
+
+constexpr uint32_t coding_bit(Content_Coding coding) {
+    return 1u << coding;
+}
+
+constexpr int COMPRESSION_LEVEL_FAST = 1;
+constexpr int COMPRESSION_LEVEL_DEFAULT = 6;
+constexpr int COMPRESSION_LEVEL_BEST = 9;
+constexpr size_t MAX_DECOMPRESSED_SIZE = 64 * 1024 * 1024; // Bound on what a peer can make us inflate
+constexpr size_t DEFAULT_COMPRESSION_CACHE_BYTES = 16 * 1024 * 1024;
+
+// Per route, given at register_route
+struct Compression_Config {
+    bool enabled = true;
+    int level = COMPRESSION_LEVEL_DEFAULT; // zlib level, COMPRESSION_LEVEL_FAST trades ratio for speed
+    size_t min_size = 1024; // Smaller bodies go out as they are, the header overhead eats the gain
+    uint32_t codings = coding_bit(CODING_GZIP) | coding_bit(CODING_DEFLATE); // Offered to clients
+    bool cache = false; // Keep compressed bodies, for routes whose responses repeat byte for byte
+};
+
+std::string_view coding_name(Content_Coding coding);
+std::optional<Content_Coding> content_coding(std::string_view name); // nullopt for codings we do not implement
+
+// Best coding in codings the Accept-Encoding value allows, by q-value then gzip before deflate.
+// CODING_IDENTITY when nothing acceptable is offered or identity ranks higher.
+Content_Coding negotiate_coding(std::string_view accept_encoding, uint32_t codings);
+
+// Appends to out, false if zlib fails
+bool compress_body(Content_Coding coding, int level, std::span<const uint8_t> body, std::vector<uint8_t>& out);
+bool decompress_body(Content_Coding coding, std::span<const uint8_t> body, std::vector<uint8_t>& out, size_t max_size = MAX_DECOMPRESSED_SIZE);
+
+// Lists name in the Vary of a response that depends on it, after the names already there. A Vary
+// of "*" already covers it.
+void add_vary(Headers& headers, std::string_view name);
+
+// Undoes Content-Encoding on a received body and fixes up the headers to match, false when the
+// coding is unknown or the body does not inflate (the message is left untouched then)
+bool decode_content(Headers& headers, std::vector<uint8_t>& body);
+
+struct Compression_Cache_Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entries;
+    size_t bytes; // Original plus compressed bytes held
+};
+
+// Compressed bodies keyed by the exact original bytes and coding parameters, least recently used
+// dropped past the byte budget. Thread-safe, compression itself runs outside the lock.
+class Compression_Cache {
+    public:
+        explicit Compression_Cache(size_t max_bytes = DEFAULT_COMPRESSION_CACHE_BYTES);
+
+        // Compressed form of body, from the cache or compressed and inserted. Empty when zlib fails
+        // or the result is not smaller than the body.
+        std::vector<uint8_t> compress(Content_Coding coding, int level, std::span<const uint8_t> body);
+        Compression_Cache_Stats stats() const;
+        void clear();
+
+    private:
+        struct Entry {
+            uint64_t hash;
+            Content_Coding coding;
+            int level;
+            std::vector<uint8_t> original;
+            std::vector<uint8_t> compressed;
+        };
+
+        size_t max_bytes;
+        mutable std::mutex cache_mutex;
+        std::list<Entry> entries; // Most recently used first
+        std::unordered_multimap<uint64_t, std::list<Entry>::iterator> index;
+        size_t bytes;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+
+        std::list<Entry>::iterator find(uint64_t hash, Content_Coding coding, int level, std::span<const uint8_t> body);
+        void insert(Entry entry);
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include "http_deadline.hpp"
+#include <algorithm>
+#include <charconv>
+
+std::optional<std::chrono::milliseconds> parse_request_timeout(std::string_view value) {
+    uint64_t milliseconds = 0;
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), milliseconds);
+    if (value.empty() || error != std::errc() || end != value.data() + value.size()) {
+        return std::nullopt;
+    }
+    return std::chrono::milliseconds(std::min(milliseconds, MAX_REQUEST_TIMEOUT_MS));
+}
+
+Cancellation_Token Cancellation_Token::with_deadline(std::optional<std::chrono::steady_clock::time_point> deadline) {
+    Cancellation_Token token;
+    token.state = std::make_shared<State>();
+    token.state->deadline = deadline;
+    return token;
+}
+
+bool Cancellation_Token::cancelled() const {
+    if (!state) {
+        return false;
+    }
+    return state->cancelled.load(std::memory_order_relaxed) || (state->deadline && std::chrono::steady_clock::now() >= *state->deadline);
+}
+
+bool Cancellation_Token::cancel_requested() const {
+    return state && state->cancelled.load(std::memory_order_relaxed);
+}
+
+std::optional<std::chrono::steady_clock::time_point> Cancellation_Token::deadline() const {
+    return state ? state->deadline : std::nullopt;
+}
+
+std::chrono::nanoseconds Cancellation_Token::remaining() const {
+    if (cancel_requested()) {
+        return std::chrono::nanoseconds::zero();
+    }
+    if (!state || !state->deadline) {
+        return std::chrono::nanoseconds::max();
+    }
+    return std::max(std::chrono::nanoseconds::zero(), std::chrono::duration_cast<std::chrono::nanoseconds>(*state->deadline - std::chrono::steady_clock::now()));
+}
+
+void Cancellation_Token::cancel() {
+    if (state) {
+        state->cancelled.store(true, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef HTTP_DEADLINE_HPP
+#define HTTP_DEADLINE_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+// A request carries its deadline as Request-Timeout, the milliseconds its client still waits for
+// the response. Relative, so the two clocks need not agree; the server counts it from arrival.
+constexpr uint64_t MAX_REQUEST_TIMEOUT_MS = 24 * 3600 * 1000;
+
+std::optional<std::chrono::milliseconds> parse_request_timeout(std::string_view value); // nullopt unless plain digits, capped at a day
+
+// Handed to handlers with the request. A handler doing long work checks cancelled() between steps
+// and stops early, nobody will read its response: the deadline passed, or the client reset the
+// stream. Copies share the state; a default token is never cancelled and allocates nothing.
+class Cancellation_Token {
+    public:
+        Cancellation_Token() = default;
+        static Cancellation_Token with_deadline(std::optional<std::chrono::steady_clock::time_point> deadline);
+
+        bool cancelled() const; // cancel() was called or the deadline passed
+        bool cancel_requested() const; // cancel() was called
+        std::optional<std::chrono::steady_clock::time_point> deadline() const;
+        std::chrono::nanoseconds remaining() const; // Until the deadline, nanoseconds::max() without one, zero once cancelled
+        void cancel();
+
+    private:
+        struct State {
+            std::atomic<bool> cancelled{false};
+            std::optional<std::chrono::steady_clock::time_point> deadline;
+        };
+        std::shared_ptr<State> state;
+};
+
+#endif
@@ -0,0 +1,744 @@
+#include "http_header_codec.hpp"
+#include "http_parse.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <queue>
+
+constexpr std::string_view HEADER_COMPRESSION_TOKEN = "hpack";
+constexpr std::string_view DEFAULT_VERSION = "HTTP/2.5";
+
+// Representation prefixes, as in RFC 7541 section 6
+constexpr uint8_t INDEXED_FIELD = 0x80;
+constexpr uint8_t LITERAL_INDEXED = 0x40;
+constexpr uint8_t TABLE_SIZE_UPDATE = 0x20;
+constexpr uint8_t LITERAL_NEVER_INDEXED = 0x10;
+constexpr uint8_t LITERAL_NOT_INDEXED = 0x00;
+constexpr uint8_t HUFFMAN_STRING = 0x80;
+
+struct Static_Field {
+    std::string_view name;
+    std::string_view value;
+};
+
+// Indexed from 1. Pseudo-fields carry the request and status lines; the rest are the fields our
+// client and server send on nearly every message, with their usual values where there is one.
+static constexpr Static_Field STATIC_TABLE[] = {
+    {":method", "GET"},
+    {":method", "POST"},
+    {":method", "PUT"},
+    {":method", "DELETE"},
+    {":method", "HEAD"},
+    {":method", "PATCH"},
+    {":method", "OPTIONS"},
+    {":path", "/"},
+    {":version", "HTTP/2.5"},
+    {":status", "200"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "405"},
+    {":status", "413"},
+    {":status", "500"},
+    {":status", "503"},
+    {"Accept", "*/*"},
+    {"Accept", "application/json"},
+    {"Accept-Encoding", "gzip, deflate"},
+    {"Accept-Language", ""},
+    {"Age", ""},
+    {"Authorization", ""},
+    {"Cache-Control", "no-cache"},
+    {"Cache-Control", ""},
+    {"Connection", "keep-alive"},
+    {"Connection", "close"},
+    {"Content-Encoding", "gzip"},
+    {"Content-Encoding", "deflate"},
+    {"Content-Length", ""},
+    {"Content-Type", "application/json"},
+    {"Content-Type", "application/octet-stream"},
+    {"Content-Type", "text/html"},
+    {"Content-Type", "text/plain"},
+    {"Cookie", ""},
+    {"Date", ""},
+    {"ETag", ""},
+    {"Header-Compression", ""},
+    {"Host", ""},
+    {"If-Modified-Since", ""},
+    {"If-None-Match", ""},
+    {"Last-Modified", ""},
+    {"Request-Timeout", ""},
+    {"Retry-After", ""},
+    {"Server", "HTTP2.5-Server/1.0"},
+    {"Set-Cookie", ""},
+    {"Stream-Id", ""},
+    {"Transfer-Encoding", ""},
+    {"User-Agent", "HTTP2.5-Client/1.0"},
+    {"Vary", "Accept-Encoding"}
+};
+
+constexpr size_t STATIC_TABLE_COUNT = std::size(STATIC_TABLE);
+
+size_t static_header_table_count() {
+    return STATIC_TABLE_COUNT;
+}
+
+static void make_lookup_key(std::string& key, std::string_view name, std::string_view value) {
+    key.assign(name);
+    key.push_back('\0');
+    key.append(value);
+}
+
+struct Static_Index {
+    std::unordered_map<std::string, size_t> fields;
+    std::unordered_map<std::string, size_t> names; // Lowest index with the name
+};
+
+static const Static_Index& static_index() {
+    static const Static_Index index = [] {
+        Static_Index built;
+        std::string key;
+        for (size_t i = STATIC_TABLE_COUNT; i > 0; i--) {
+            make_lookup_key(key, STATIC_TABLE[i - 1].name, STATIC_TABLE[i - 1].value);
+            built.fields[key] = i;
+            built.names[std::string(STATIC_TABLE[i - 1].name)] = i;
+        }
+        return built;
+    }();
+    return index;
+}
+
+std::string header_compression_offer(size_t table_size) {
+    return std::string(HEADER_COMPRESSION_TOKEN) + "; table=" + std::to_string(table_size);
+}
+
+std::optional<size_t> parse_header_compression_offer(std::string_view value) {
+    if (value.substr(0, HEADER_COMPRESSION_TOKEN.size()) != HEADER_COMPRESSION_TOKEN) {
+        return std::nullopt;
+    }
+    value.remove_prefix(HEADER_COMPRESSION_TOKEN.size());
+    size_t table = value.find("table=");
+    if (table == std::string_view::npos) {
+        return value.find_first_not_of(" ;") == std::string_view::npos ? std::optional<size_t>(DEFAULT_HEADER_TABLE_SIZE) : std::nullopt;
+    }
+    size_t table_size = 0;
+    const char* digits = value.data() + table + 6;
+    if (std::from_chars(digits, value.data() + value.size(), table_size).ptr == digits) {
+        return std::nullopt;
+    }
+    return table_size;
+}
+
+bool is_header_block_message(std::span<const uint8_t> message) {
+    return !message.empty() && message[0] == HEADER_BLOCK_MARKER;
+}
+
+void encode_header_integer(uint64_t value, uint8_t prefix_bits, uint8_t flags, std::vector<uint8_t>& out) {
+    uint64_t prefix_max = (1u << prefix_bits) - 1;
+    if (value < prefix_max) {
+        out.push_back(static_cast<uint8_t>(flags | value));
+        return;
+    }
+    out.push_back(static_cast<uint8_t>(flags | prefix_max));
+    value -= prefix_max;
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+std::optional<uint64_t> decode_header_integer(std::span<const uint8_t> bytes, size_t& position, uint8_t prefix_bits) {
+    if (position >= bytes.size()) {
+        return std::nullopt;
+    }
+    uint64_t prefix_max = (1u << prefix_bits) - 1;
+    uint64_t value = bytes[position++] & prefix_max;
+    if (value < prefix_max) {
+        return value;
+    }
+    for (unsigned shift = 0; shift <= 56; shift += 7) {
+        if (position >= bytes.size()) {
+            return std::nullopt;
+        }
+        uint8_t byte = bytes[position++];
+        value += static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    return std::nullopt; // Longer than any length or index we would accept
+}
+
+// Header text the code is trained on: methods, paths, media types, codings, dates, agents, tokens
+static constexpr std::string_view HUFFMAN_TRAINING_TEXT =
+    "GET POST PUT DELETE /api/v1/users/42 /hello /index.html /static/app.js?version=3&lang=en /users/1337/orders "
+    "HTTP/2.5 200 304 404 application/json text/html; charset=utf-8 text/plain application/octet-stream "
+    "gzip, deflate keep-alive no-cache max-age=3600, public private, max-age=60 Accept-Encoding "
+    "Mon, 06 Nov 2026 08:49:37 GMT Tue, 17 Feb 2026 21:05:12 GMT Wed Thu Fri Sat Sun Jan Mar Apr May Jun Jul Aug Sep Oct Dec "
+    "HTTP2.5-Client/1.0 HTTP2.5-Server/1.0 Mozilla/5.0 (X11; Linux x86_64) 10.0.0.1:8080 127.0.0.1:8080 localhost:8080 example.com "
+    "Bearer eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9 session=8f14e45fceea167a5a36dedd4bea2543; theme=dark; lang=en-US "
+    "\"33a64df551425fcc55e4d42a148795d9f25f89d4\" W/\"0815\" en-US,en;q=0.9 */* hpack; table=4096 "
+    "0123456789 1024 2048 4096 8192 16384 31 57 113 230 461 922 1843 3687 7374 14748 29496 58993";
+
+constexpr uint16_t HUFFMAN_EOS = 256;
+constexpr size_t HUFFMAN_SYMBOLS = 257;
+constexpr size_t HUFFMAN_MAX_LENGTH = 32;
+constexpr unsigned HUFFMAN_FAST_BITS = 9; // Codes up to this long, most of them, decode with one table lookup
+
+struct Huffman_Fast_Entry {
+    uint16_t symbol;
+    uint8_t length; // 0 when the code is longer than HUFFMAN_FAST_BITS
+};
+
+struct Huffman_Code {
+    std::array<uint32_t, HUFFMAN_SYMBOLS> codes;
+    std::array<uint8_t, HUFFMAN_SYMBOLS> lengths;
+    // Canonical decoding: codes of one length are consecutive, in symbol order
+    std::array<uint32_t, HUFFMAN_MAX_LENGTH + 1> first_code;
+    std::array<uint16_t, HUFFMAN_MAX_LENGTH + 1> first_symbol;
+    std::array<uint16_t, HUFFMAN_MAX_LENGTH + 1> length_count;
+    std::array<uint16_t, HUFFMAN_SYMBOLS> symbols;
+    std::array<Huffman_Fast_Entry, 1u << HUFFMAN_FAST_BITS> fast; // Indexed by the next HUFFMAN_FAST_BITS bits
+    uint8_t min_length;
+    uint8_t max_length;
+};
+
+// Every byte gets a code; EOS, never sent, gets the longest and, being the last symbol, the all-ones
+// one, so padding with one bits is a prefix of it as in HPACK
+static Huffman_Code build_huffman_code() {
+    std::array<uint64_t, HUFFMAN_SYMBOLS> weights;
+    weights.fill(1);
+    weights[HUFFMAN_EOS] = 0;
+    for (char ch : HUFFMAN_TRAINING_TEXT) {
+        weights[static_cast<uint8_t>(ch)] += 8;
+    }
+
+    // Plain Huffman merge, ties broken by creation order so every build gives the same lengths
+    struct Node {
+        uint64_t weight;
+        size_t order;
+    };
+    auto heavier = [](const Node& a, const Node& b) { return a.weight != b.weight ? a.weight > b.weight : a.order > b.order; };
+    std::priority_queue<Node, std::vector<Node>, decltype(heavier)> queue(heavier);
+    std::vector<size_t> parent(HUFFMAN_SYMBOLS, 0);
+    for (size_t symbol{}; symbol < HUFFMAN_SYMBOLS; symbol++) {
+        queue.push(Node{weights[symbol], symbol});
+    }
+    while (queue.size() > 1) {
+        Node a = queue.top();
+        queue.pop();
+        Node b = queue.top();
+        queue.pop();
+        size_t merged = parent.size();
+        parent.push_back(0);
+        parent[a.order] = merged;
+        parent[b.order] = merged;
+        queue.push(Node{a.weight + b.weight, merged});
+    }
+    size_t root = parent.size() - 1;
+
+    Huffman_Code code{};
+    for (size_t symbol{}; symbol < HUFFMAN_SYMBOLS; symbol++) {
+        uint8_t length = 0;
+        for (size_t node = symbol; node != root; node = parent[node]) {
+            length++;
+        }
+        code.lengths[symbol] = length;
+    }
+
+    std::array<uint16_t, HUFFMAN_SYMBOLS> order;
+    for (uint16_t symbol{}; symbol < HUFFMAN_SYMBOLS; symbol++) {
+        order[symbol] = symbol;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint16_t a, uint16_t b) { return code.lengths[a] < code.lengths[b]; });
+    code.min_length = code.lengths[order.front()];
+    code.max_length = code.lengths[order.back()];
+
+    uint32_t next = 0;
+    uint8_t length = code.min_length;
+    for (size_t i{}; i < HUFFMAN_SYMBOLS; i++) {
+        uint16_t symbol = order[i];
+        if (code.lengths[symbol] != length) {
+            next <<= code.lengths[symbol] - length;
+            length = code.lengths[symbol];
+        }
+        if (code.length_count[length] == 0) {
+            code.first_code[length] = next;
+            code.first_symbol[length] = static_cast<uint16_t>(i);
+        }
+        code.length_count[length]++;
+        code.codes[symbol] = next++;
+        code.symbols[i] = symbol;
+        if (length <= HUFFMAN_FAST_BITS) {
+            uint32_t first = code.codes[symbol] << (HUFFMAN_FAST_BITS - length);
+            for (uint32_t entry = first; entry < first + (1u << (HUFFMAN_FAST_BITS - length)); entry++) {
+                code.fast[entry] = Huffman_Fast_Entry{symbol, length};
+            }
+        }
+    }
+    return code;
+}
+
+static const Huffman_Code& huffman_code() {
+    static const Huffman_Code code = build_huffman_code();
+    return code;
+}
+
+size_t huffman_encoded_size(std::string_view text) {
+    const Huffman_Code& code = huffman_code();
+    size_t bits = 0;
+    for (char ch : text) {
+        bits += code.lengths[static_cast<uint8_t>(ch)];
+    }
+    return (bits + 7) / 8;
+}
+
+void huffman_encode(std::string_view text, std::vector<uint8_t>& out) {
+    const Huffman_Code& code = huffman_code();
+    uint64_t pending = 0;
+    unsigned pending_bits = 0;
+    for (char ch : text) {
+        uint8_t symbol = static_cast<uint8_t>(ch);
+        pending = (pending << code.lengths[symbol]) | code.codes[symbol];
+        pending_bits += code.lengths[symbol];
+        while (pending_bits >= 8) {
+            pending_bits -= 8;
+            out.push_back(static_cast<uint8_t>(pending >> pending_bits));
+        }
+    }
+    if (pending_bits > 0) {
+        out.push_back(static_cast<uint8_t>((pending << (8 - pending_bits)) | (0xff >> pending_bits)));
+    }
+}
+
+bool huffman_decode(std::span<const uint8_t> bytes, std::string& out) {
+    const Huffman_Code& code = huffman_code();
+    uint64_t buffer = 0; // Unconsumed bits, left-justified
+    unsigned bits = 0;
+    size_t position = 0;
+    for (;;) {
+        while (bits <= 56 && position < bytes.size()) {
+            buffer |= static_cast<uint64_t>(bytes[position++]) << (56 - bits);
+            bits += 8;
+        }
+        uint32_t window = static_cast<uint32_t>(buffer >> 32);
+        Huffman_Fast_Entry fast = code.fast[window >> (32 - HUFFMAN_FAST_BITS)];
+        unsigned length = fast.length;
+        uint16_t symbol = fast.symbol;
+        if (length == 0) {
+            for (length = HUFFMAN_FAST_BITS + 1; length <= code.max_length; length++) {
+                uint32_t candidate = window >> (32 - length);
+                if (code.length_count[length] && candidate >= code.first_code[length] && candidate - code.first_code[length] < code.length_count[length]) {
+                    symbol = code.symbols[code.first_symbol[length] + (candidate - code.first_code[length])];
+                    break;
+                }
+            }
+        }
+        // Past the input only the padding is left
+        if (length > bits || length > code.max_length) {
+            break;
+        }
+        if (symbol == HUFFMAN_EOS) {
+            return false;
+        }
+        out.push_back(static_cast<char>(symbol));
+        buffer <<= length;
+        bits -= length;
+    }
+    // At most seven bits of padding, all ones
+    return bits < 8 && (bits == 0 || (buffer >> (64 - bits)) == (1u << bits) - 1);
+}
+
+Header_Table::Header_Table(size_t max_size) : bytes(0), limit(max_size), next_absolute(0) {}
+
+void Header_Table::insert(std::string_view name, std::string_view value) {
+    size_t entry_size = name.size() + value.size() + HEADER_ENTRY_OVERHEAD;
+    while (!entries.empty() && bytes + entry_size > limit) {
+        evict_oldest();
+    }
+    next_absolute++;
+    if (entry_size > limit) {
+        return;
+    }
+    entries.push_front(Header_Entry{std::string(name), std::string(value), next_absolute - 1});
+    bytes += entry_size;
+}
+
+void Header_Table::resize(size_t max_size) {
+    limit = max_size;
+    while (bytes > limit) {
+        evict_oldest();
+    }
+}
+
+void Header_Table::evict_oldest() {
+    const Header_Entry& entry = entries.back();
+    bytes -= entry.name.size() + entry.value.size() + HEADER_ENTRY_OVERHEAD;
+    entries.pop_back();
+}
+
+const Header_Entry* Header_Table::at(size_t index) const {
+    return index < entries.size() ? &entries[index] : nullptr;
+}
+
+const Header_Entry& Header_Table::oldest() const {
+    return entries.back();
+}
+
+size_t Header_Table::count() const {
+    return entries.size();
+}
+
+size_t Header_Table::size() const {
+    return bytes;
+}
+
+size_t Header_Table::max_size() const {
+    return limit;
+}
+
+uint64_t Header_Table::inserted() const {
+    return next_absolute;
+}
+
+// Interned names are matched in their canonical spelling, whatever the caller wrote
+static std::string_view field_name(std::string_view name) {
+    Header_Id id = header_id(name);
+    return id == HEADER_OTHER ? name : header_name(id);
+}
+
+// Credentials stay out of the tables, so a block never reveals them by its size
+static bool never_indexed(std::string_view name) {
+    Header_Id id = header_id(name);
+    return id == HEADER_AUTHORIZATION || id == HEADER_SET_COOKIE;
+}
+
+// Different on every message, an entry would only push useful ones out
+static bool not_worth_indexing(std::string_view name) {
+    Header_Id id = header_id(name);
+    return id == HEADER_STREAM_ID || id == HEADER_CONTENT_LENGTH;
+}
+
+Header_Encoder::Header_Encoder(size_t table_size, bool huffman) : table(table_size), huffman(huffman), size_update_pending(true) {}
+
+size_t Header_Encoder::table_size() const {
+    return table.size();
+}
+
+void Header_Encoder::begin_block() {
+    block.clear();
+    if (size_update_pending) {
+        encode_header_integer(table.max_size(), 5, TABLE_SIZE_UPDATE, block);
+        size_update_pending = false;
+    }
+}
+
+void Header_Encoder::encode_string(std::string_view text) {
+    size_t coded_size = huffman ? huffman_encoded_size(text) : text.size();
+    if (coded_size < text.size()) {
+        encode_header_integer(coded_size, 7, HUFFMAN_STRING, block);
+        huffman_encode(text, block);
+        return;
+    }
+    encode_header_integer(text.size(), 7, 0, block);
+    block.insert(block.end(), text.begin(), text.end());
+}
+
+void Header_Encoder::insert(std::string_view name, std::string_view value) {
+    size_t entry_size = name.size() + value.size() + HEADER_ENTRY_OVERHEAD;
+    while (table.count() > 0 && table.size() + entry_size > table.max_size()) {
+        // Map entries still pointing at an evicted entry are dropped with it
+        const Header_Entry& oldest = table.oldest();
+        make_lookup_key(lookup_key, oldest.name, oldest.value);
+        auto field = field_index.find(lookup_key);
+        if (field != field_index.end() && field->second == oldest.absolute) {
+            field_index.erase(field);
+        }
+        auto named = name_index.find(oldest.name);
+        if (named != name_index.end() && named->second == oldest.absolute) {
+            name_index.erase(named);
+        }
+        table.evict_oldest();
+    }
+    uint64_t absolute = table.inserted();
+    table.insert(name, value);
+    if (table.count() > 0 && table.at(0)->absolute == absolute) {
+        make_lookup_key(lookup_key, name, value);
+        field_index[lookup_key] = absolute;
+        name_index[std::string(name)] = absolute;
+    }
+}
+
+void Header_Encoder::encode_field(std::string_view name, std::string_view value) {
+    name = field_name(name);
+    const Static_Index& statics = static_index();
+    make_lookup_key(lookup_key, name, value);
+    auto static_field = statics.fields.find(lookup_key);
+    if (static_field != statics.fields.end()) {
+        encode_header_integer(static_field->second, 7, INDEXED_FIELD, block);
+        return;
+    }
+    bool sensitive = never_indexed(name);
+    auto dynamic_field = sensitive ? field_index.end() : field_index.find(lookup_key);
+    if (dynamic_field != field_index.end()) {
+        encode_header_integer(STATIC_TABLE_COUNT + 1 + (table.inserted() - 1 - dynamic_field->second), 7, INDEXED_FIELD, block);
+        return;
+    }
+
+    size_t name_reference = 0;
+    lookup_key.resize(name.size());
+    auto static_name = statics.names.find(lookup_key);
+    if (static_name != statics.names.end()) {
+        name_reference = static_name->second;
+    } else if (auto dynamic_name = name_index.find(lookup_key); dynamic_name != name_index.end()) {
+        name_reference = STATIC_TABLE_COUNT + 1 + (table.inserted() - 1 - dynamic_name->second);
+    }
+
+    bool indexed = !sensitive && !not_worth_indexing(name) && name.size() + value.size() + HEADER_ENTRY_OVERHEAD <= table.max_size() / 2;
+    if (indexed) {
+        encode_header_integer(name_reference, 6, LITERAL_INDEXED, block);
+    } else {
+        encode_header_integer(name_reference, 4, sensitive ? LITERAL_NEVER_INDEXED : LITERAL_NOT_INDEXED, block);
+    }
+    if (name_reference == 0) {
+        encode_string(name);
+    }
+    encode_string(value);
+    if (indexed) {
+        insert(name, value);
+    }
+}
+
+void Header_Encoder::finish_message(std::span<const std::span<const uint8_t>> body, std::vector<uint8_t>& out) {
+    size_t body_size = 0;
+    for (const auto& segment : body) {
+        body_size += segment.size();
+    }
+    out.reserve(out.size() + 1 + 10 + block.size() + body_size);
+    out.push_back(HEADER_BLOCK_MARKER);
+    encode_header_integer(block.size(), 8, 0, out);
+    out.insert(out.end(), block.begin(), block.end());
+    for (const auto& segment : body) {
+        out.insert(out.end(), segment.begin(), segment.end());
+    }
+}
+
+void Header_Encoder::encode_request(const Request& request, uint64_t stream_id, std::vector<uint8_t>& out, std::optional<std::chrono::milliseconds> timeout) {
+    begin_block();
+    encode_field(":method", request.request_line.method);
+    encode_field(":path", request.request_line.uri);
+    if (!request.request_line.version.empty() && request.request_line.version != DEFAULT_VERSION) {
+        encode_field(":version", request.request_line.version);
+    }
+    if (stream_id != 0) {
+        char digits[24];
+        encode_field(header_name(HEADER_STREAM_ID), std::string_view(digits, std::to_chars(digits, digits + sizeof(digits), stream_id).ptr - digits));
+    }
+    if (timeout) {
+        char digits[24];
+        encode_field(header_name(HEADER_REQUEST_TIMEOUT), std::string_view(digits, std::to_chars(digits, digits + sizeof(digits), timeout->count()).ptr - digits));
+    }
+    for (size_t i{}; i < request.headers.size(); i++) {
+        Header_Id id = request.headers.id_at(i);
+        if (id == HEADER_CONTENT_LENGTH || (id == HEADER_STREAM_ID && stream_id != 0) || (id == HEADER_REQUEST_TIMEOUT && timeout)) {
+            continue;
+        }
+        Header_View field = request.headers[i];
+        encode_field(field.name, field.value);
+    }
+    std::span<const uint8_t> body_segments[] = {request.body};
+    finish_message(body_segments, out);
+}
+
+static uint32_t id_bit(Header_Id id) {
+    return id == HEADER_OTHER ? 0 : 1u << id;
+}
+
+void Header_Encoder::encode_response(Status_Code status_code, const Header_Block* header_block, const Headers* headers,
+                                     std::span<const std::span<const uint8_t>> body, std::vector<uint8_t>& out) {
+    begin_block();
+    char digits[24];
+    encode_field(":status", std::string_view(digits, std::to_chars(digits, digits + sizeof(digits), static_cast<int>(status_code)).ptr - digits));
+
+    // Same precedence as write_response: block fields win over same-named headers
+    bool has_date = (headers && headers->contains(HEADER_DATE)) || (header_block && (header_block->id_mask & id_bit(HEADER_DATE)));
+    if (!has_date) {
+        std::string_view date_line = date_header_line();
+        encode_field(header_name(HEADER_DATE), date_line.substr(6, date_line.size() - 6 - SEPERATOR.size()));
+    }
+    if (header_block) {
+        std::string_view lines = header_block->bytes;
+        while (!lines.empty()) {
+            size_t line_end = lines.find(SEPERATOR);
+            std::string_view line = lines.substr(0, line_end);
+            size_t colon = line.find(": ");
+            if (colon != std::string_view::npos) {
+                encode_field(line.substr(0, colon), line.substr(colon + 2));
+            }
+            lines.remove_prefix(line_end == std::string_view::npos ? lines.size() : line_end + SEPERATOR.size());
+        }
+    }
+    if (headers) {
+        for (size_t i{}; i < headers->size(); i++) {
+            Header_View field = (*headers)[i];
+            if (!skip_response_header(header_block, headers->id_at(i), field.name)) {
+                encode_field(field.name, field.value);
+            }
+        }
+    }
+    finish_message(body, out);
+}
+
+void Header_Encoder::encode_response(const Response& response, const Header_Block* header_block, std::vector<uint8_t>& out) {
+    std::span<const uint8_t> body_segments[] = {response_body(response)};
+    encode_response(response.response_line.status_code, header_block, &response.headers, body_segments, out);
+}
+
+Header_Decoder::Header_Decoder(size_t max_table_size) : table(max_table_size), max_table_size(max_table_size) {}
+
+bool Header_Decoder::decode_string(std::span<const uint8_t> block, size_t& position, std::string& out) {
+    if (position >= block.size()) {
+        return false;
+    }
+    bool huffman_coded = block[position] & HUFFMAN_STRING;
+    auto length = decode_header_integer(block, position, 7);
+    if (!length || *length > block.size() - position) {
+        return false;
+    }
+    std::span<const uint8_t> bytes = block.subspan(position, *length);
+    position += *length;
+    out.clear();
+    if (huffman_coded) {
+        return huffman_decode(bytes, out);
+    }
+    out.assign(bytes.begin(), bytes.end());
+    return true;
+}
+
+bool Header_Decoder::add_field(std::string_view name, std::string_view value, Decoded_Head& head) {
+    if (name.empty()) {
+        return false;
+    }
+    if (name[0] != ':') {
+        head.headers.add(name, value);
+        return true;
+    }
+    // Pseudo-fields come before the headers and only once
+    if (!head.headers.empty()) {
+        return false;
+    }
+    std::string* target = name == ":method" ? &head.method : name == ":path" ? &head.path :
+                          name == ":version" ? &head.version : name == ":status" ? &head.status : nullptr;
+    if (!target || !target->empty()) {
+        return false;
+    }
+    target->assign(value);
+    return true;
+}
+
+std::optional<std::span<const uint8_t>> Header_Decoder::decode_message(std::span<const uint8_t> message, Decoded_Head& head) {
+    if (!is_header_block_message(message)) {
+        return std::nullopt;
+    }
+    size_t position = 1;
+    auto block_size = decode_header_integer(message, position, 8);
+    if (!block_size || *block_size > message.size() - position) {
+        return std::nullopt;
+    }
+    std::span<const uint8_t> block = message.subspan(position, *block_size);
+    std::span<const uint8_t> body = message.subspan(position + *block_size);
+
+    position = 0;
+    while (position < block.size()) {
+        uint8_t first = block[position];
+        if (first & INDEXED_FIELD) {
+            auto index = decode_header_integer(block, position, 7);
+            if (!index || *index == 0) {
+                return std::nullopt;
+            }
+            if (*index <= STATIC_TABLE_COUNT) {
+                if (!add_field(STATIC_TABLE[*index - 1].name, STATIC_TABLE[*index - 1].value, head)) {
+                    return std::nullopt;
+                }
+                continue;
+            }
+            const Header_Entry* entry = table.at(*index - STATIC_TABLE_COUNT - 1);
+            if (!entry || !add_field(entry->name, entry->value, head)) {
+                return std::nullopt;
+            }
+            continue;
+        }
+        if ((first & 0xe0) == TABLE_SIZE_UPDATE) {
+            auto size = decode_header_integer(block, position, 5);
+            if (!size || *size > max_table_size) {
+                return std::nullopt;
+            }
+            table.resize(*size);
+            continue;
+        }
+
+        bool indexed = (first & 0xc0) == LITERAL_INDEXED;
+        auto name_reference = decode_header_integer(block, position, indexed ? 6 : 4);
+        if (!name_reference) {
+            return std::nullopt;
+        }
+        // Copied out, the insertion below may evict the entry the name came from
+        if (*name_reference == 0) {
+            if (!decode_string(block, position, name_buffer)) {
+                return std::nullopt;
+            }
+        } else if (*name_reference <= STATIC_TABLE_COUNT) {
+            name_buffer.assign(STATIC_TABLE[*name_reference - 1].name);
+        } else if (const Header_Entry* entry = table.at(*name_reference - STATIC_TABLE_COUNT - 1)) {
+            name_buffer.assign(entry->name);
+        } else {
+            return std::nullopt;
+        }
+        if (!decode_string(block, position, value_buffer) || !add_field(name_buffer, value_buffer, head)) {
+            return std::nullopt;
+        }
+        if (indexed) {
+            table.insert(name_buffer, value_buffer);
+        }
+    }
+    return body;
+}
+
+static void add_content_length(Headers& headers, size_t body_size) {
+    char digits[24];
+    headers.add(HEADER_CONTENT_LENGTH, std::string_view(digits, std::to_chars(digits, digits + sizeof(digits), body_size).ptr - digits));
+}
+
+std::optional<Request> Header_Decoder::decode_request(std::span<const uint8_t> message) {
+    Decoded_Head head;
+    auto body = decode_message(message, head);
+    if (!body || head.method.empty() || head.path.empty() || !head.status.empty()) {
+        return std::nullopt;
+    }
+    Request request;
+    request.request_line = Request_Line{head.version.empty() ? std::string(DEFAULT_VERSION) : std::move(head.version), std::move(head.path), std::move(head.method)};
+    request.headers = std::move(head.headers);
+    if (!body->empty()) {
+        add_content_length(request.headers, body->size());
+    }
+    request.body.assign(body->begin(), body->end());
+    return request;
+}
+
+std::optional<Response> Header_Decoder::decode_response(std::span<const uint8_t> message) {
+    Decoded_Head head;
+    auto body = decode_message(message, head);
+    int status = 0;
+    if (!body || !head.method.empty() || !head.path.empty() ||
+        std::from_chars(head.status.data(), head.status.data() + head.status.size(), status).ptr != head.status.data() + head.status.size() ||
+        status < 100 || status > 999) {
+        return std::nullopt;
+    }
+    Response response;
+    Status_Code status_code = static_cast<Status_Code>(status);
+    response.response_line = Response_Line{std::string(DEFAULT_VERSION), status_code, std::string(reason_phrase(status_code))};
+    response.headers = std::move(head.headers);
+    add_content_length(response.headers, body->size());
+    response.body.assign(body->begin(), body->end());
+    return response;
+}
@@ -0,0 +1,137 @@
+#ifndef HTTP_HEADER_CODEC_HPP
+#define HTTP_HEADER_CODEC_HPP
+
+#include "http_headers.hpp"
+#include "http_request.hpp"
+#include "http_response.hpp"
+#include "http_response_writer.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A header-compressed message is HEADER_BLOCK_MARKER, the block length (an HPACK integer with an
+// 8-bit prefix), the header block and the body, which is the rest of the message. No request or
+// status line starts with this byte, so compressed and plain messages share an association.
+constexpr uint8_t HEADER_BLOCK_MARKER = 0x01;
+constexpr size_t DEFAULT_HEADER_TABLE_SIZE = 4096;
+constexpr size_t HEADER_ENTRY_OVERHEAD = 32; // Counted per dynamic table entry on top of name and value, as in HPACK
+
+// Sent by the client until a response carries it back: "hpack; table=<bytes>", the dynamic table
+// size the sender's decoder accepts. Each side compresses only once it knows the other decodes.
+constexpr std::string_view HEADER_COMPRESSION = "Header-Compression";
+
+struct Header_Compression_Config {
+    size_t table_size = DEFAULT_HEADER_TABLE_SIZE; // Dynamic table bytes our decoder accepts, and the most our encoder uses
+    bool huffman = true; // Huffman-code literals that come out shorter
+};
+
+std::string header_compression_offer(size_t table_size);
+std::optional<size_t> parse_header_compression_offer(std::string_view value);
+bool is_header_block_message(std::span<const uint8_t> message);
+
+// HPACK primitives (RFC 7541 integer and string representations). The Huffman code is canonical,
+// built once from the byte frequencies of typical HTTP2.5 headers rather than taken from the RFC.
+void encode_header_integer(uint64_t value, uint8_t prefix_bits, uint8_t flags, std::vector<uint8_t>& out);
+std::optional<uint64_t> decode_header_integer(std::span<const uint8_t> bytes, size_t& position, uint8_t prefix_bits);
+size_t huffman_encoded_size(std::string_view text);
+void huffman_encode(std::string_view text, std::vector<uint8_t>& out);
+bool huffman_decode(std::span<const uint8_t> bytes, std::string& out); // Appends, false on an invalid code or padding
+size_t static_header_table_count();
+
+struct Header_Entry {
+    std::string name;
+    std::string value;
+    uint64_t absolute; // Insertion number, stays with the entry while newer ones push it down
+};
+
+// HPACK dynamic table: index 0 is the newest entry, the oldest are evicted to stay within max_size
+class Header_Table {
+    public:
+        explicit Header_Table(size_t max_size);
+
+        void insert(std::string_view name, std::string_view value); // An entry larger than max_size empties the table
+        void resize(size_t max_size);
+        void evict_oldest();
+        const Header_Entry* at(size_t index) const; // nullptr past the end
+        const Header_Entry& oldest() const;
+        size_t count() const;
+        size_t size() const; // Bytes, HEADER_ENTRY_OVERHEAD included
+        size_t max_size() const;
+        uint64_t inserted() const; // Absolute number of the next entry
+
+    private:
+        std::deque<Header_Entry> entries;
+        size_t bytes;
+        size_t limit;
+        uint64_t next_absolute;
+};
+
+// Encodes the heads of one direction of an association. Blocks must be decoded in the order they
+// were encoded, so encode and send under one lock when several threads share an encoder.
+class Header_Encoder {
+    public:
+        Header_Encoder(size_t table_size, bool huffman = true);
+
+        // Pseudo-fields :method, :path and (unless HTTP/2.5) :version, then Stream-Id when not 0 and
+        // Request-Timeout when set, replacing those the request carries, then the headers.
+        // Content-Length is implied by the message size.
+        void encode_request(const Request& request, uint64_t stream_id, std::vector<uint8_t>& out,
+                            std::optional<std::chrono::milliseconds> timeout = std::nullopt);
+        // Same fields as write_response: :status, Date unless present, the header block, then headers
+        void encode_response(Status_Code status_code, const Header_Block* header_block, const Headers* headers,
+                             std::span<const std::span<const uint8_t>> body, std::vector<uint8_t>& out);
+        void encode_response(const Response& response, const Header_Block* header_block, std::vector<uint8_t>& out);
+        size_t table_size() const; // Dynamic table bytes in use
+
+    private:
+        Header_Table table;
+        bool huffman;
+        bool size_update_pending; // The decoder starts at its advertised size, ours may be smaller
+        std::unordered_map<std::string, uint64_t> field_index; // "name\0value" to absolute entry number
+        std::unordered_map<std::string, uint64_t> name_index;
+        std::string lookup_key;
+        std::vector<uint8_t> block;
+
+        void begin_block();
+        void encode_field(std::string_view name, std::string_view value);
+        void encode_string(std::string_view text);
+        void insert(std::string_view name, std::string_view value);
+        void finish_message(std::span<const std::span<const uint8_t>> body, std::vector<uint8_t>& out);
+};
+
+// Decodes what the peer's Header_Encoder produced; nullopt for a message that is not a valid
+// compressed message, after which the table can no longer be trusted
+class Header_Decoder {
+    public:
+        explicit Header_Decoder(size_t max_table_size);
+
+        std::optional<Request> decode_request(std::span<const uint8_t> message);
+        std::optional<Response> decode_response(std::span<const uint8_t> message);
+
+    private:
+        struct Decoded_Head {
+            std::string method;
+            std::string path;
+            std::string version;
+            std::string status;
+            Headers headers;
+        };
+
+        Header_Table table;
+        size_t max_table_size;
+        std::string name_buffer;
+        std::string value_buffer;
+
+        std::optional<std::span<const uint8_t>> decode_message(std::span<const uint8_t> message, Decoded_Head& head);
+        bool decode_string(std::span<const uint8_t> block, size_t& position, std::string& out);
+        bool add_field(std::string_view name, std::string_view value, Decoded_Head& head);
+};
+
+#endif
@@ -0,0 +1,371 @@
+#include "http_headers.hpp"
+#include <algorithm>
+
+static constexpr std::array<std::string_view, HEADER_ID_COUNT> HEADER_NAMES = {
+    "",
+    "Accept",
+    "Accept-Encoding",
+    "Accept-Language",
+    "Authorization",
+    "Cache-Control",
+    "Connection",
+    "Content-Encoding",
+    "Content-Length",
+    "Content-Type",
+    "Cookie",
+    "Date",
+    "ETag",
+    "Host",
+    "If-Modified-Since",
+    "If-None-Match",
+    "Last-Modified",
+    "Request-Timeout",
+    "Retry-After",
+    "Server",
+    "Set-Cookie",
+    "Stream-Id",
+    "Transfer-Encoding",
+    "User-Agent",
+    "Vary"
+};
+
+static constexpr char to_lower_ascii(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i{}; i < a.size(); i++) {
+        if (to_lower_ascii(a[i]) != to_lower_ascii(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr size_t HEADER_HASH_SIZE = 64;
+
+static constexpr size_t header_hash(std::string_view name) {
+    return (name.size() + to_lower_ascii(name.front()) + to_lower_ascii(name.back()) * 6) % HEADER_HASH_SIZE;
+}
+
+static constexpr std::array<Header_Id, HEADER_HASH_SIZE> HEADER_HASH_TABLE = [] {
+    std::array<Header_Id, HEADER_HASH_SIZE> table{};
+    for (size_t id = 1; id < HEADER_ID_COUNT; id++) {
+        table[header_hash(HEADER_NAMES[id])] = static_cast<Header_Id>(id);
+    }
+    return table;
+}();
+
+static_assert([] {
+    for (size_t id = 1; id < HEADER_ID_COUNT; id++) {
+        if (HEADER_HASH_TABLE[header_hash(HEADER_NAMES[id])] != id) {
+            return false;
+        }
+    }
+    return true;
+}(), "interned header names must not collide in HEADER_HASH_TABLE");
+
+Header_Id header_id(std::string_view name) {
+    if (name.empty()) {
+        return HEADER_OTHER;
+    }
+    Header_Id id = HEADER_HASH_TABLE[header_hash(name)];
+    if (id == HEADER_OTHER) {
+        return HEADER_OTHER;
+    }
+    // Senders nearly always use the canonical spelling, memcmp settles those
+    return HEADER_NAMES[id] == name || iequals(HEADER_NAMES[id], name) ? id : HEADER_OTHER;
+}
+
+std::string_view header_name(Header_Id id) {
+    return id < HEADER_ID_COUNT ? HEADER_NAMES[id] : std::string_view{};
+}
+
+Headers::Iterator::Iterator(const Headers* headers, size_t index) : headers(headers), index(index) {}
+
+Header_View Headers::Iterator::operator*() const {
+    return (*headers)[index];
+}
+
+Headers::Iterator& Headers::Iterator::operator++() {
+    index++;
+    return *this;
+}
+
+bool Headers::Iterator::operator==(const Iterator& other) const {
+    return headers == other.headers && index == other.index;
+}
+
+Headers::Headers() : Headers(std::pmr::get_default_resource()) {}
+
+Headers::Headers(std::pmr::memory_resource* resource) : overflow_fields(resource), field_count(0), storage(resource), view_base(nullptr) {
+    first_field.fill(NOT_PRESENT);
+}
+
+Headers::Field& Headers::field(size_t index) {
+    return index < HEADERS_INLINE_CAPACITY ? inline_fields[index] : overflow_fields[index - HEADERS_INLINE_CAPACITY];
+}
+
+const Headers::Field& Headers::field(size_t index) const {
+    return index < HEADERS_INLINE_CAPACITY ? inline_fields[index] : overflow_fields[index - HEADERS_INLINE_CAPACITY];
+}
+
+void Headers::push_field(const Field& new_field) {
+    if (field_count < HEADERS_INLINE_CAPACITY) {
+        inline_fields[field_count] = new_field;
+    } else {
+        overflow_fields.push_back(new_field);
+    }
+    if (new_field.id != HEADER_OTHER && first_field[new_field.id] == NOT_PRESENT) {
+        first_field[new_field.id] = static_cast<uint16_t>(field_count);
+    }
+    field_count++;
+}
+
+// The first allocation leaves room for the fields usually added later, by middleware or the
+// server, so most messages never grow it
+constexpr size_t MIN_STORAGE_CAPACITY = 256;
+
+void Headers::reserve_storage(size_t bytes) {
+    size_t needed = storage.size() + bytes;
+    if (needed > storage.capacity()) {
+        storage.reserve(std::max(needed, storage.capacity() < MIN_STORAGE_CAPACITY ? MIN_STORAGE_CAPACITY : storage.capacity() * 2));
+    }
+}
+
+uint32_t Headers::store(std::string_view bytes) {
+    reserve_storage(bytes.size());
+    uint32_t offset = static_cast<uint32_t>(storage.size());
+    storage.append(bytes);
+    return offset;
+}
+
+std::string_view Headers::name_of(const Field& f) const {
+    if (f.id != HEADER_OTHER) {
+        return HEADER_NAMES[f.id];
+    }
+    const char* base = f.viewed ? view_base : storage.data();
+    return std::string_view(base + f.name_offset, f.name_length);
+}
+
+std::string_view Headers::value_of(const Field& f) const {
+    const char* base = f.viewed ? view_base : storage.data();
+    return std::string_view(base + f.value_offset, f.value_length);
+}
+
+void Headers::add(std::string_view name, std::string_view value) {
+    Header_Id id = header_id(name);
+    if (id != HEADER_OTHER) {
+        add(id, value);
+        return;
+    }
+    uint32_t name_offset = store(name);
+    uint32_t value_offset = store(value);
+    push_field(Field{HEADER_OTHER, false, name_offset, static_cast<uint32_t>(name.size()), value_offset, static_cast<uint32_t>(value.size())});
+}
+
+void Headers::add(Header_Id id, std::string_view value) {
+    uint32_t value_offset = store(value);
+    push_field(Field{id, false, 0, 0, value_offset, static_cast<uint32_t>(value.size())});
+}
+
+void Headers::set(std::string_view name, std::string_view value) {
+    Header_Id id = header_id(name);
+    if (id != HEADER_OTHER) {
+        set(id, value);
+        return;
+    }
+    remove_if_matches(HEADER_OTHER, name);
+    uint32_t name_offset = store(name);
+    uint32_t value_offset = store(value);
+    push_field(Field{HEADER_OTHER, false, name_offset, static_cast<uint32_t>(name.size()), value_offset, static_cast<uint32_t>(value.size())});
+}
+
+void Headers::set(Header_Id id, std::string_view value) {
+    remove_if_matches(id, {});
+    add(id, value);
+}
+
+void Headers::add_view(Header_Id id, std::string_view name, std::string_view value, const char* base) {
+    view_base = base;
+    push_field(Field{
+        id,
+        true,
+        static_cast<uint32_t>(name.data() - base),
+        static_cast<uint32_t>(name.size()),
+        static_cast<uint32_t>(value.data() - base),
+        static_cast<uint32_t>(value.size())
+    });
+}
+
+void Headers::set_view_base(const char* base) {
+    view_base = base;
+}
+
+void Headers::detach_views() {
+    // Sized up front so the copies grow storage once
+    size_t viewed_bytes = 0;
+    for (size_t i{}; i < field_count; i++) {
+        const Field& f = field(i);
+        if (f.viewed) {
+            viewed_bytes += (f.id == HEADER_OTHER ? f.name_length : 0) + f.value_length;
+        }
+    }
+    reserve_storage(viewed_bytes);
+    for (size_t i{}; i < field_count; i++) {
+        Field& f = field(i);
+        if (!f.viewed) {
+            continue;
+        }
+        std::string_view name = name_of(f);
+        std::string_view value = value_of(f);
+        if (f.id == HEADER_OTHER) {
+            f.name_offset = store(name);
+        }
+        f.value_offset = store(value);
+        f.viewed = false;
+    }
+    view_base = nullptr;
+}
+
+size_t Headers::remove(std::string_view name) {
+    return remove_if_matches(header_id(name), name);
+}
+
+size_t Headers::remove(Header_Id id) {
+    return remove_if_matches(id, {});
+}
+
+// Bytes of removed fields stay in storage until clear()
+size_t Headers::remove_if_matches(Header_Id id, std::string_view name) {
+    if (id != HEADER_OTHER && first_field[id] == NOT_PRESENT) {
+        return 0;
+    }
+    auto matches = [&](const Field& f) {
+        return id != HEADER_OTHER ? f.id == id : (f.id == HEADER_OTHER && iequals(name_of(f), name));
+    };
+    // Fields before the first match stay where they are, set() of a new name moves nothing
+    size_t kept = id != HEADER_OTHER ? first_field[id] : 0;
+    while (kept < field_count && !matches(field(kept))) {
+        kept++;
+    }
+    if (kept == field_count) {
+        return 0;
+    }
+    for (size_t i = kept + 1; i < field_count; i++) {
+        const Field& f = field(i);
+        if (!matches(f)) {
+            field(kept++) = f;
+        }
+    }
+    size_t removed = field_count - kept;
+    field_count = kept;
+    if (field_count > HEADERS_INLINE_CAPACITY) {
+        overflow_fields.resize(field_count - HEADERS_INLINE_CAPACITY);
+    } else {
+        overflow_fields.clear();
+    }
+    rebuild_index();
+    return removed;
+}
+
+void Headers::rebuild_index() {
+    first_field.fill(NOT_PRESENT);
+    for (size_t i = field_count; i-- > 0;) {
+        const Field& f = field(i);
+        if (f.id != HEADER_OTHER) {
+            first_field[f.id] = static_cast<uint16_t>(i);
+        }
+    }
+}
+
+void Headers::clear() {
+    field_count = 0;
+    overflow_fields.clear();
+    first_field.fill(NOT_PRESENT);
+    storage.clear();
+    view_base = nullptr;
+}
+
+std::optional<std::string_view> Headers::get(std::string_view name) const {
+    Header_Id id = header_id(name);
+    if (id != HEADER_OTHER) {
+        return get(id);
+    }
+    for (size_t i{}; i < field_count; i++) {
+        const Field& f = field(i);
+        if (f.id == HEADER_OTHER && iequals(name_of(f), name)) {
+            return value_of(f);
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string_view> Headers::get(Header_Id id) const {
+    if (id == HEADER_OTHER || id >= HEADER_ID_COUNT || first_field[id] == NOT_PRESENT) {
+        return std::nullopt;
+    }
+    return value_of(field(first_field[id]));
+}
+
+bool Headers::contains(std::string_view name) const {
+    return get(name).has_value();
+}
+
+bool Headers::contains(Header_Id id) const {
+    return get(id).has_value();
+}
+
+size_t Headers::size() const {
+    return field_count;
+}
+
+bool Headers::empty() const {
+    return field_count == 0;
+}
+
+Header_View Headers::operator[](size_t index) const {
+    const Field& f = field(index);
+    return Header_View{name_of(f), value_of(f)};
+}
+
+Header_Id Headers::id_at(size_t index) const {
+    return field(index).id;
+}
+
+Headers::Iterator Headers::begin() const {
+    return Iterator(this, 0);
+}
+
+Headers::Iterator Headers::end() const {
+    return Iterator(this, field_count);
+}
+
+size_t Headers::serialized_size() const {
+    size_t total = 0;
+    for (size_t i{}; i < field_count; i++) {
+        const Field& f = field(i);
+        total += name_of(f).size() + f.value_length + 4;
+    }
+    return total;
+}
+
+void Headers::serialize_to(std::vector<uint8_t>& out) const {
+    size_t pos = out.size();
+    out.resize(pos + serialized_size());
+    uint8_t* write = out.data() + pos;
+    for (size_t i{}; i < field_count; i++) {
+        const Field& f = field(i);
+        std::string_view name = name_of(f);
+        std::string_view value = value_of(f);
+        write = std::copy(name.begin(), name.end(), write);
+        *write++ = ':';
+        *write++ = ' ';
+        write = std::copy(value.begin(), value.end(), write);
+        *write++ = '\r';
+        *write++ = '\n';
+    }
+}
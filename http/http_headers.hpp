@@ -0,0 +1,137 @@
+#ifndef HTTP_HEADERS_HPP
+#define HTTP_HEADERS_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <memory_resource>
+
+// Well-known headers, interned so lookups and serialization skip string compares
+enum Header_Id : uint8_t {
+    HEADER_OTHER,
+    HEADER_ACCEPT,
+    HEADER_ACCEPT_ENCODING,
+    HEADER_ACCEPT_LANGUAGE,
+    HEADER_AUTHORIZATION,
+    HEADER_CACHE_CONTROL,
+    HEADER_CONNECTION,
+    HEADER_CONTENT_ENCODING,
+    HEADER_CONTENT_LENGTH,
+    HEADER_CONTENT_TYPE,
+    HEADER_COOKIE,
+    HEADER_DATE,
+    HEADER_ETAG,
+    HEADER_HOST,
+    HEADER_IF_MODIFIED_SINCE,
+    HEADER_IF_NONE_MATCH,
+    HEADER_LAST_MODIFIED,
+    HEADER_REQUEST_TIMEOUT, // HTTP2.5: milliseconds the client still waits for the response
+    HEADER_RETRY_AFTER,
+    HEADER_SERVER,
+    HEADER_SET_COOKIE,
+    HEADER_STREAM_ID, // HTTP2.5: matches a response to its request on a shared association
+    HEADER_TRANSFER_ENCODING,
+    HEADER_USER_AGENT,
+    HEADER_VARY,
+    HEADER_ID_COUNT
+};
+
+constexpr size_t HEADERS_INLINE_CAPACITY = 16;
+
+struct Header_View {
+    std::string_view name;
+    std::string_view value;
+};
+
+Header_Id header_id(std::string_view name); // HEADER_OTHER for anything not interned
+std::string_view header_name(Header_Id id); // Canonical spelling
+bool iequals(std::string_view a, std::string_view b);
+
+// Ordered header list. The first HEADERS_INLINE_CAPACITY fields live inside the object and the
+// bytes of added fields share one buffer, so a typical message costs at most one allocation.
+// Fields added with add_view point into a caller-owned buffer instead and are not copied.
+// Interned headers always use their canonical name; all name matching is case-insensitive.
+// Fields keep insertion order, repeated names stay separate entries and get() returns the first.
+class Headers {
+    public:
+        class Iterator {
+            public:
+                Iterator(const Headers* headers, size_t index);
+                Header_View operator*() const;
+                Iterator& operator++();
+                bool operator==(const Iterator& other) const;
+
+            private:
+                const Headers* headers;
+                size_t index;
+        };
+
+        Headers();
+        // Owned bytes and fields past the inline ones come from resource, which must outlive the
+        // object. Copies go back to the default resource, moves keep it.
+        explicit Headers(std::pmr::memory_resource* resource);
+
+        void add(std::string_view name, std::string_view value);
+        void add(Header_Id id, std::string_view value);
+        void set(std::string_view name, std::string_view value); // Drops every field with this name, then adds one at the end
+        void set(Header_Id id, std::string_view value);
+        size_t remove(std::string_view name);
+        size_t remove(Header_Id id);
+        void clear();
+
+        // Zero-copy fields, name and value must lie in the buffer starting at base and id must be
+        // header_id(name)
+        void add_view(Header_Id id, std::string_view name, std::string_view value, const char* base);
+        void set_view_base(const char* base); // The viewed buffer moved, same contents
+        void detach_views(); // Copies viewed fields into owned storage
+
+        std::optional<std::string_view> get(std::string_view name) const;
+        std::optional<std::string_view> get(Header_Id id) const;
+        bool contains(std::string_view name) const;
+        bool contains(Header_Id id) const;
+
+        size_t size() const;
+        bool empty() const;
+        Header_View operator[](size_t index) const;
+        Header_Id id_at(size_t index) const;
+        Iterator begin() const;
+        Iterator end() const;
+
+        size_t serialized_size() const; // Bytes written by serialize_to
+        void serialize_to(std::vector<uint8_t>& out) const; // "Name: value\r\n" per field
+
+    private:
+        struct Field {
+            Header_Id id;
+            bool viewed;
+            uint32_t name_offset; // Unused for interned headers
+            uint32_t name_length;
+            uint32_t value_offset;
+            uint32_t value_length;
+        };
+
+        static constexpr uint16_t NOT_PRESENT = UINT16_MAX;
+
+        std::array<Field, HEADERS_INLINE_CAPACITY> inline_fields;
+        std::pmr::vector<Field> overflow_fields;
+        size_t field_count;
+        std::array<uint16_t, HEADER_ID_COUNT> first_field;
+        std::pmr::string storage;
+        const char* view_base;
+
+        Field& field(size_t index);
+        const Field& field(size_t index) const;
+        void push_field(const Field& new_field);
+        void reserve_storage(size_t bytes);
+        uint32_t store(std::string_view bytes);
+        std::string_view name_of(const Field& f) const;
+        std::string_view value_of(const Field& f) const;
+        size_t remove_if_matches(Header_Id id, std::string_view name);
+        void rebuild_index();
+};
+
+#endif
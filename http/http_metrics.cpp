@@ -0,0 +1,401 @@
+#include "http_metrics.hpp"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <map>
+
+constexpr size_t STATUS_CODES = MAX_STATUS_CODE - MIN_STATUS_CODE + 1;
+
+static std::atomic<uint64_t> next_registry_id{1};
+
+std::string_view phase_name(Request_Phase phase) {
+    static constexpr std::string_view NAMES[PHASE_COUNT] = {"parse", "queue", "handler", "serialize"};
+    return NAMES[phase];
+}
+
+size_t latency_bucket(std::chrono::nanoseconds latency) {
+    if (latency.count() <= 1000) {
+        return 0;
+    }
+    uint64_t micros = (static_cast<uint64_t>(latency.count()) + 999) / 1000;
+    return std::min<size_t>(std::bit_width(micros - 1), LATENCY_BUCKETS - 1);
+}
+
+std::chrono::nanoseconds latency_bucket_bound(size_t bucket) {
+    if (bucket + 1 >= LATENCY_BUCKETS) {
+        return std::chrono::nanoseconds::max();
+    }
+    return std::chrono::nanoseconds(int64_t{1000} << bucket);
+}
+
+// Only the owning thread writes a shard's counters, so a plain add stored back relaxed is
+// enough: no locked instruction, and a scrape reads each counter whole
+static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct Metrics_Registry::Series {
+    std::array<std::array<std::atomic<uint64_t>, LATENCY_BUCKETS>, PHASE_COUNT> buckets{};
+    std::array<std::atomic<uint64_t>, PHASE_COUNT> sum_ns{};
+    std::atomic<uint64_t> requests{};
+    std::atomic<uint64_t> request_bytes{};
+    std::atomic<uint64_t> response_bytes{};
+    std::array<std::atomic<uint64_t>, STATUS_CODES> status_counts{};
+};
+
+// Slot series * METHOD_COUNT + method. Grown by copying into a larger table; the old one stays
+// alive with the shard, a scrape may still be reading it.
+struct Metrics_Registry::Series_Table {
+    explicit Series_Table(size_t size) : size(size), slots(new std::atomic<Series*>[size]()) {}
+
+    size_t size;
+    std::unique_ptr<std::atomic<Series*>[]> slots;
+};
+
+struct Metrics_Registry::Shard {
+    std::atomic<Series_Table*> table{nullptr};
+    std::vector<std::unique_ptr<Series_Table>> tables; // Owning thread only
+    std::vector<std::unique_ptr<Series>> series; // Owning thread only
+
+    Series& series_at(size_t slot) {
+        Series_Table* current = table.load(std::memory_order_relaxed);
+        if (current && slot < current->size) {
+            if (Series* found = current->slots[slot].load(std::memory_order_relaxed)) {
+                return *found;
+            }
+        }
+        if (!current || slot >= current->size) {
+            auto grown = std::make_unique<Series_Table>(std::max(slot + 1, current ? current->size * 2 : size_t{METHOD_COUNT * 8}));
+            for (size_t i{}; current && i < current->size; i++) {
+                grown->slots[i].store(current->slots[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            current = grown.get();
+            tables.push_back(std::move(grown));
+            table.store(current, std::memory_order_release);
+        }
+        series.push_back(std::make_unique<Series>());
+        current->slots[slot].store(series.back().get(), std::memory_order_release);
+        return *series.back();
+    }
+};
+
+Metrics_Registry::Metrics_Registry() : id(next_registry_id.fetch_add(1, std::memory_order_relaxed)) {}
+
+Metrics_Registry::~Metrics_Registry() = default;
+
+// A thread remembers its shards of the last few registries it recorded into. One that fell out
+// of that list gets a second shard on its next sample, which costs memory but counts the same.
+Metrics_Registry::Shard& Metrics_Registry::thread_shard() {
+    thread_local std::vector<std::pair<uint64_t, Shard*>> thread_shards;
+    for (const auto& [registry, shard] : thread_shards) {
+        if (registry == id) {
+            return *shard;
+        }
+    }
+    std::unique_lock<std::mutex> shards_lock(shards_mutex);
+    shards.push_back(std::make_unique<Shard>());
+    Shard* created = shards.back().get();
+    shards_lock.unlock();
+    if (thread_shards.size() >= MAX_THREAD_SHARD_CACHE) {
+        thread_shards.erase(thread_shards.begin());
+    }
+    thread_shards.emplace_back(id, created);
+    return *created;
+}
+
+void Metrics_Registry::record(const Request_Sample& sample) {
+    Series& series = thread_shard().series_at(sample.series * METHOD_COUNT + sample.method);
+    for (size_t phase{}; phase < PHASE_COUNT; phase++) {
+        if (auto latency = sample.phases[phase]) {
+            bump(series.buckets[phase][latency_bucket(*latency)]);
+            bump(series.sum_ns[phase], static_cast<uint64_t>(std::max<int64_t>(latency->count(), 0)));
+        }
+    }
+    bump(series.requests);
+    bump(series.request_bytes, sample.request_bytes);
+    bump(series.response_bytes, sample.response_bytes);
+    if (sample.status >= MIN_STATUS_CODE && sample.status <= MAX_STATUS_CODE) {
+        bump(series.status_counts[sample.status - MIN_STATUS_CODE]);
+    }
+}
+
+std::vector<Series_Snapshot> Metrics_Registry::snapshot() const {
+    std::map<size_t, std::pair<Series_Snapshot, std::array<uint64_t, STATUS_CODES>>> merged;
+    std::unique_lock<std::mutex> shards_lock(shards_mutex);
+    for (const auto& shard : shards) {
+        const Series_Table* current = shard->table.load(std::memory_order_acquire);
+        for (size_t slot{}; current && slot < current->size; slot++) {
+            const Series* series = current->slots[slot].load(std::memory_order_acquire);
+            if (!series) {
+                continue;
+            }
+            auto [entry, inserted] = merged.try_emplace(slot);
+            auto& [total, status_counts] = entry->second;
+            if (inserted) {
+                total.series = slot / METHOD_COUNT;
+                total.method = static_cast<Http_Method>(slot % METHOD_COUNT);
+            }
+            total.requests += series->requests.load(std::memory_order_relaxed);
+            total.request_bytes += series->request_bytes.load(std::memory_order_relaxed);
+            total.response_bytes += series->response_bytes.load(std::memory_order_relaxed);
+            for (size_t phase{}; phase < PHASE_COUNT; phase++) {
+                Latency_Histogram& histogram = total.phases[phase];
+                for (size_t bucket{}; bucket < LATENCY_BUCKETS; bucket++) {
+                    uint64_t n = series->buckets[phase][bucket].load(std::memory_order_relaxed);
+                    histogram.buckets[bucket] += n;
+                    histogram.count += n;
+                }
+                histogram.sum += std::chrono::nanoseconds(series->sum_ns[phase].load(std::memory_order_relaxed));
+            }
+            for (size_t code{}; code < STATUS_CODES; code++) {
+                status_counts[code] += series->status_counts[code].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    shards_lock.unlock();
+
+    std::vector<Series_Snapshot> result;
+    result.reserve(merged.size());
+    for (auto& [slot, entry] : merged) {
+        auto& [total, status_counts] = entry;
+        for (size_t code{}; code < STATUS_CODES; code++) {
+            if (status_counts[code] > 0) {
+                total.status_counts.emplace_back(static_cast<int>(code) + MIN_STATUS_CODE, status_counts[code]);
+            }
+        }
+        result.push_back(std::move(total));
+    }
+    return result;
+}
+
+size_t Metrics_Registry::shard_count() const {
+    std::unique_lock<std::mutex> shards_lock(shards_mutex);
+    return shards.size();
+}
+
+Request_Timer::Request_Timer(Metrics_Registry* registry, std::chrono::steady_clock::time_point received, uint64_t request_bytes)
+    : registry(registry), sample{} {
+    if (!registry) {
+        return;
+    }
+    mark = std::chrono::steady_clock::now();
+    sample.phases[PHASE_QUEUE] = mark - received;
+    sample.request_bytes = request_bytes;
+}
+
+Request_Timer::operator bool() const {
+    return registry != nullptr;
+}
+
+void Request_Timer::begin() {
+    if (registry) {
+        mark = std::chrono::steady_clock::now();
+    }
+}
+
+void Request_Timer::lap(Request_Phase phase) {
+    if (!registry) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    sample.phases[phase] = now - mark;
+    mark = now;
+}
+
+void Request_Timer::record(size_t series, Http_Method method, int status, uint64_t response_bytes) {
+    if (!registry) {
+        return;
+    }
+    sample.series = series;
+    sample.method = method;
+    sample.status = status;
+    sample.response_bytes = response_bytes;
+    registry->record(sample);
+    registry = nullptr;
+}
+
+static void append_number(std::string& out, uint64_t value) {
+    char buffer[24];
+    auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, end);
+}
+
+static void append_number(std::string& out, double value) {
+    char buffer[32];
+    auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, end);
+}
+
+// Backslash, double quote and newline are the only characters a label value escapes
+static void append_label(std::string& out, std::string_view name, std::string_view value) {
+    out += out.back() == '{' ? "" : ",";
+    out += name;
+    out += "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+static void append_family(std::string& out, std::string_view name, std::string_view type, std::string_view help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+// The le="..." label of every bucket, closing the label set
+static const std::array<std::string, LATENCY_BUCKETS>& bucket_labels() {
+    static const std::array<std::string, LATENCY_BUCKETS> labels = [] {
+        std::array<std::string, LATENCY_BUCKETS> result;
+        for (size_t bucket{}; bucket < LATENCY_BUCKETS; bucket++) {
+            result[bucket] = ",le=\"";
+            if (bucket + 1 < LATENCY_BUCKETS) {
+                append_number(result[bucket], std::chrono::duration<double>(latency_bucket_bound(bucket)).count());
+            } else {
+                result[bucket] += "+Inf";
+            }
+            result[bucket] += "\"} ";
+        }
+        return result;
+    }();
+    return labels;
+}
+
+// Samples are rendered from label sets made once per series, there are LATENCY_BUCKETS lines per phase
+std::string render_prometheus(const std::vector<Series_Snapshot>& series, const std::function<std::string(size_t)>& route_label,
+                              const Socket_Stats& transport) {
+    std::vector<std::string> labels; // route="..",method=".."
+    labels.reserve(series.size());
+    for (const Series_Snapshot& entry : series) {
+        std::string label = "{";
+        append_label(label, "route", route_label(entry.series));
+        append_label(label, "method", method_name(entry.method));
+        labels.push_back(std::move(label));
+    }
+    std::array<std::string, PHASE_COUNT> phase_labels;
+    for (size_t phase{}; phase < PHASE_COUNT; phase++) {
+        phase_labels[phase] = ",phase=\"" + std::string(phase_name(static_cast<Request_Phase>(phase))) + "\"";
+    }
+    const auto& bounds = bucket_labels();
+    std::string out;
+    out.reserve(series.size() * PHASE_COUNT * (LATENCY_BUCKETS + 2) * 96 + 4096);
+    // name{route="..",method=".." plus whatever the caller appends
+    auto begin_sample = [&](std::string_view name, size_t i) {
+        out += name;
+        out += labels[i];
+    };
+
+    append_family(out, "http_request_phase_seconds", "histogram", "Time requests spent in each phase of serving them.");
+    for (size_t i{}; i < series.size(); i++) {
+        for (size_t phase{}; phase < PHASE_COUNT; phase++) {
+            const Latency_Histogram& histogram = series[i].phases[phase];
+            if (histogram.count == 0) {
+                continue;
+            }
+            uint64_t cumulative = 0;
+            for (size_t bucket{}; bucket < LATENCY_BUCKETS; bucket++) {
+                cumulative += histogram.buckets[bucket];
+                begin_sample("http_request_phase_seconds_bucket", i);
+                out += phase_labels[phase];
+                out += bounds[bucket];
+                append_number(out, cumulative);
+                out += '\n';
+            }
+            begin_sample("http_request_phase_seconds_sum", i);
+            out += phase_labels[phase];
+            out += "} ";
+            append_number(out, std::chrono::duration<double>(histogram.sum).count());
+            out += '\n';
+            begin_sample("http_request_phase_seconds_count", i);
+            out += phase_labels[phase];
+            out += "} ";
+            append_number(out, histogram.count);
+            out += '\n';
+        }
+    }
+
+    auto counter_family = [&](std::string_view name, std::string_view help, uint64_t Series_Snapshot::*field) {
+        append_family(out, name, "counter", help);
+        for (size_t i{}; i < series.size(); i++) {
+            begin_sample(name, i);
+            out += "} ";
+            append_number(out, series[i].*field);
+            out += '\n';
+        }
+    };
+    counter_family("http_requests_total", "Requests answered.", &Series_Snapshot::requests);
+    counter_family("http_request_bytes_total", "Request bytes received.", &Series_Snapshot::request_bytes);
+    counter_family("http_response_bytes_total", "Response bytes sent.", &Series_Snapshot::response_bytes);
+
+    append_family(out, "http_responses_total", "counter", "Responses by status code.");
+    for (size_t i{}; i < series.size(); i++) {
+        for (const auto& [code, count] : series[i].status_counts) {
+            begin_sample("http_responses_total", i);
+            append_label(out, "code", std::to_string(code));
+            out += "} ";
+            append_number(out, count);
+            out += '\n';
+        }
+    }
+
+    auto transport_value = [&](std::string_view name, std::string_view type, std::string_view help, uint64_t value) {
+        append_family(out, name, type, help);
+        out += name;
+        out += ' ';
+        append_number(out, value);
+        out += '\n';
+    };
+    const Transport_Counters_Snapshot& totals = transport.totals;
+    transport_value("sctp_packets_received_total", "counter", "SCTP packets received.", totals.packets_in);
+    transport_value("sctp_packets_sent_total", "counter", "SCTP packets sent.", totals.packets_out);
+    transport_value("sctp_bytes_received_total", "counter", "SCTP bytes received.", totals.bytes_in);
+    transport_value("sctp_bytes_sent_total", "counter", "SCTP bytes sent.", totals.bytes_out);
+    transport_value("sctp_checksum_drops_total", "counter", "Packets dropped for a bad checksum.", totals.checksum_drops);
+    transport_value("sctp_chunks_reordered_total", "counter", "DATA chunks that arrived out of order.", totals.chunks_reordered);
+    transport_value("sctp_retransmissions_total", "counter", "DATA chunks sent again.", totals.retransmissions);
+    transport_value("sctp_ulp_buffer_depth", "gauge", "Messages delivered but not read yet.", transport.ulp_buffer_depth);
+    transport_value("sctp_ooo_buffer_depth", "gauge", "Chunks waiting for a gap to fill.", transport.ooo_buffer_depth);
+    transport_value("sctp_associations", "gauge", "Associations with counters.", transport.associations.size());
+
+    // Per association, labelled with the peer's address
+    std::vector<std::string> peers;
+    peers.reserve(transport.associations.size());
+    for (const Association_Stats_Snapshot& association : transport.associations) {
+        uint32_t address = ntohl(association.peer_address.sin_addr.s_addr);
+        peers.push_back(std::to_string(address >> 24) + "." + std::to_string((address >> 16) & 0xFF) + "." + std::to_string((address >> 8) & 0xFF) + "." +
+                        std::to_string(address & 0xFF) + ":" + std::to_string(ntohs(association.peer_address.sin_port)));
+    }
+    auto association_gauge = [&](std::string_view name, std::string_view help, auto value) {
+        append_family(out, name, "gauge", help);
+        for (size_t i{}; i < transport.associations.size(); i++) {
+            out += name;
+            out += '{';
+            append_label(out, "peer", peers[i]);
+            out += "} ";
+            append_number(out, value(transport.associations[i]));
+            out += '\n';
+        }
+    };
+    association_gauge("sctp_association_srtt_seconds", "Smoothed round-trip time.",
+                      [](const Association_Stats_Snapshot& a) { return a.srtt_us / 1e6; });
+    association_gauge("sctp_association_rttvar_seconds", "Round-trip time variation.",
+                      [](const Association_Stats_Snapshot& a) { return a.rttvar_us / 1e6; });
+    association_gauge("sctp_association_cwnd_bytes", "Congestion window.",
+                      [](const Association_Stats_Snapshot& a) { return uint64_t{a.cwnd}; });
+    association_gauge("sctp_association_peer_rwnd_bytes", "Receive window the peer advertised.",
+                      [](const Association_Stats_Snapshot& a) { return uint64_t{a.peer_rwnd}; });
+    return out;
+}
@@ -0,0 +1,113 @@
+#ifndef HTTP_METRICS_HPP
+#define HTTP_METRICS_HPP
+
+#include "http_router.hpp"
+#include "../sctp_stack/sctp_stats.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr size_t LATENCY_BUCKETS = 25; // Upper bounds 1 us, 2 us, 4 us ... 2^23 us (about 8.4 s), then +Inf
+constexpr int MIN_STATUS_CODE = 100;
+constexpr int MAX_STATUS_CODE = 599;
+constexpr size_t MAX_THREAD_SHARD_CACHE = 8; // Registries a thread finds its shard of without the lock
+
+enum Request_Phase {
+    PHASE_PARSE, // Message to Request, on the worker
+    PHASE_QUEUE, // Arrival (of the head, for streamed bodies) to a worker picking it up
+    PHASE_HANDLER, // The route handler (and its middlewares)
+    PHASE_SERIALIZE, // Response to bytes handed to the association
+    PHASE_COUNT
+};
+
+std::string_view phase_name(Request_Phase phase);
+size_t latency_bucket(std::chrono::nanoseconds latency);
+std::chrono::nanoseconds latency_bucket_bound(size_t bucket); // nanoseconds::max() for the last
+
+struct Metrics_Config {
+    std::string path = "/metrics"; // GET route serving the Prometheus text, none when empty
+};
+
+// One finished request. A series is a small dense number the caller picks, such as a route id.
+struct Request_Sample {
+    size_t series;
+    Http_Method method;
+    std::array<std::optional<std::chrono::nanoseconds>, PHASE_COUNT> phases; // Unset when the request skipped it
+    int status; // Not counted when unknown (0) or outside 100-599
+    uint64_t request_bytes; // As received; header-compressed requests count their body only
+    uint64_t response_bytes;
+};
+
+struct Latency_Histogram {
+    std::array<uint64_t, LATENCY_BUCKETS> buckets; // Per bucket, not cumulative
+    uint64_t count;
+    std::chrono::nanoseconds sum;
+};
+
+struct Series_Snapshot {
+    size_t series;
+    Http_Method method;
+    uint64_t requests;
+    uint64_t request_bytes;
+    uint64_t response_bytes;
+    std::array<Latency_Histogram, PHASE_COUNT> phases;
+    std::vector<std::pair<int, uint64_t>> status_counts; // Codes seen, ascending
+};
+
+// Request counters cheap enough to leave on. Every recording thread owns a shard and is its only
+// writer, so a sample is a handful of relaxed loads and stores with no lock and no shared cache
+// line; snapshot() sums the shards while they keep counting. Series are allocated on first use.
+class Metrics_Registry {
+    public:
+        Metrics_Registry();
+        ~Metrics_Registry();
+        Metrics_Registry(const Metrics_Registry&) = delete;
+        Metrics_Registry& operator=(const Metrics_Registry&) = delete;
+
+        void record(const Request_Sample& sample);
+        std::vector<Series_Snapshot> snapshot() const; // Ordered by series, then method
+        size_t shard_count() const;
+
+    private:
+        struct Series;
+        struct Series_Table;
+        struct Shard;
+
+        uint64_t id; // Never reused, so a thread's cached shard of a destroyed registry is never matched
+        mutable std::mutex shards_mutex;
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        Shard& thread_shard();
+};
+
+// Times the phases of one request back to back into its sample and records it once it is
+// answered. Without a registry every call does nothing, not even read the clock.
+class Request_Timer {
+    public:
+        Request_Timer(Metrics_Registry* registry, std::chrono::steady_clock::time_point received, uint64_t request_bytes); // Times PHASE_QUEUE up to now
+        explicit operator bool() const; // Whether it records
+
+        void begin(); // The next phase starts now rather than where the last one ended
+        void lap(Request_Phase phase); // From the last begin() or lap() to now
+        void record(size_t series, Http_Method method, int status, uint64_t response_bytes); // Once, later calls do nothing
+
+    private:
+        Metrics_Registry* registry;
+        Request_Sample sample;
+        std::chrono::steady_clock::time_point mark;
+};
+
+// Prometheus text exposition format (version 0.0.4)
+std::string render_prometheus(const std::vector<Series_Snapshot>& series, const std::function<std::string(size_t)>& route_label,
+                              const Socket_Stats& transport);
+
+#endif
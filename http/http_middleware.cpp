@@ -0,0 +1,10 @@
+#include "http_middleware.hpp"
+
+Route_Handler apply_middleware(const std::vector<Middleware>& middlewares, Route_Handler handler) {
+    for (auto middleware = middlewares.rbegin(); middleware != middlewares.rend(); ++middleware) {
+        handler = [step = *middleware, next = std::move(handler)](const Request& req, const Route_Params& params) {
+            return step(req, params, next);
+        };
+    }
+    return handler;
+}
@@ -0,0 +1,59 @@
+#ifndef HTTP_MIDDLEWARE_HPP
+#define HTTP_MIDDLEWARE_HPP
+
+#include "http_request.hpp"
+#include "http_response.hpp"
+#include "http_router.hpp"
+#include <stddef.h>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// A middleware is a callable taking (const Request&, const Route_Params&, next) and returning the
+// Response. It may answer without calling next (auth), call next with a changed copy of the request
+// (normalization) or change the response next returns (CORS). next is called like a route handler.
+
+// Type-erased form, for chains put together at run time (Server::add_middleware)
+using Middleware = std::function<Response(const Request&, const Route_Params&, const Route_Handler& next)>;
+
+// Middlewares known at compile time, outermost first. wrap() turns a handler into one callable in
+// which the steps and the handler inline into each other, so the route still costs a single
+// std::function call however long the chain is. A chain is a middleware itself and nests in others.
+template <typename... Steps>
+class Middleware_Chain {
+    public:
+        explicit Middleware_Chain(Steps... steps) : steps(std::move(steps)...) {}
+
+        template <typename Next>
+        Response operator()(const Request& req, const Route_Params& params, const Next& next) const {
+            return call<0>(req, params, next);
+        }
+
+        // For register_route
+        template <typename Handler>
+        auto wrap(Handler handler) const {
+            return [chain = *this, handler = std::move(handler)](const Request& req, const Route_Params& params) {
+                return chain(req, params, handler);
+            };
+        }
+
+    private:
+        std::tuple<Steps...> steps;
+
+        template <size_t I, typename Next>
+        Response call(const Request& req, const Route_Params& params, const Next& next) const {
+            if constexpr (I == sizeof...(Steps)) {
+                return next(req, params);
+            } else {
+                return std::get<I>(steps)(req, params, [&](const Request& next_req, const Route_Params& next_params) {
+                    return call<I + 1>(next_req, next_params, next);
+                });
+            }
+        }
+};
+
+// Nests the handler in the middlewares, the first one outermost. Without any the handler comes back as it was.
+Route_Handler apply_middleware(const std::vector<Middleware>& middlewares, Route_Handler handler);
+
+#endif
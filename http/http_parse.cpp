@@ -1,13 +1,18 @@
 #include "http_parse.hpp"
 #include "http_request.hpp"
 #include "http_response.hpp"
+#include "http_scan.hpp"
+#include "../sctp_stack/sctp_log.hpp"
 #include <vector>
 #include <string>
-#include <unordered_map>
 #include <cstdint>
-#include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+
+// A malformed request flood must not turn into a log flood
+static Log_Rate_Limit malformed_request_limit{10};
+static Log_Rate_Limit malformed_response_limit{10};
 
 void trim(std::string& str) {
     auto start = std::find_if(str.begin(), str.end(), [](unsigned char ch) {
@@ -20,19 +25,7 @@ void trim(std::string& str) {
 }
 
 bool contains_valid_chars(const std::string& str) {
-    for (char ch : str) {
-        switch (ch) {
-            case '!': case '#': case '$': case '%': case '&': case '\'': case '*':
-            case '+': case '-': case '.': case '^': case '_': case '`': case '|':
-            case '~':
-                break;
-            default:
-                if (!std::isalnum(static_cast<unsigned char>(ch))) {
-                    return false;
-                }
-        }
-    }
-    return true;
+    return scan_is_token(str);
 }
 
 std::optional<Request> parse_http_request(const std::vector<uint8_t>& raw_request) {
@@ -53,11 +46,17 @@ std::optional<Request> parse_http_request(const std::vector<uint8_t>& raw_reques
     request.headers = std::get<0>(*headers_result);
     pos = std::get<1>(*headers_result);
 
-    auto content_length_it = request.headers.find("content-length");
-    if (content_length_it == request.headers.end()) {
+    auto content_length = request.headers.get(HEADER_CONTENT_LENGTH);
+    if (!content_length) {
         request.body = {};
     } else {
-        auto body_result = parse_request_body(raw_str, pos, std::stoul(content_length_it->second));
+        size_t length = 0;
+        auto [end, error] = std::from_chars(content_length->data(), content_length->data() + content_length->size(), length);
+        if (error != std::errc() || end != content_length->data() + content_length->size()) {
+            log_event_limited<Log_Level::Warn>(malformed_request_limit, "malformed Content-Length", *content_length);
+            return std::nullopt;
+        }
+        auto body_result = parse_request_body(raw_str, pos, length);
         if (!body_result) {
             return std::nullopt;
         }
@@ -70,23 +69,23 @@ std::optional<Request> parse_http_request(const std::vector<uint8_t>& raw_reques
 std::optional<std::tuple<Request_Line, size_t>> parse_request_line(std::string_view raw_request) {
     Request_Line request_line;
 
-    size_t raw_request_line_end = raw_request.find(SEPERATOR);
+    size_t raw_request_line_end = scan_find_crlf(raw_request, 0);
     if (raw_request_line_end == std::string_view::npos) {
-        std::cout << "Malformed request (No CRLF found in request)\n";
+        log_event_limited<Log_Level::Warn>(malformed_request_limit, "malformed request (No CRLF found in request)");
         return std::nullopt;
     } 
     std::string raw_request_line(raw_request.substr(0, raw_request_line_end));
     
     size_t method_end = raw_request_line.find(" ");
     if (method_end == std::string_view::npos) {
-        std::cout << "Malformed request line (No space found after method): " << raw_request_line <<"\n";
+        log_event_limited<Log_Level::Warn>(malformed_request_limit, "malformed request line (No space found after method)", raw_request_line);
         return std::nullopt;
     }
     request_line.method = std::string(raw_request_line.substr(0, method_end));
     
     size_t uri_end = raw_request_line.find(" ", method_end + 1);
     if (uri_end == std::string_view::npos) {
-        std::cout << "Malformed request line (No space found after URI): " << raw_request_line << "\n";
+        log_event_limited<Log_Level::Warn>(malformed_request_limit, "malformed request line (No space found after URI)", raw_request_line);
         return std::nullopt;
     }
     request_line.uri = std::string(raw_request_line.substr(method_end + 1, uri_end - method_end - 1));
@@ -94,60 +93,61 @@ std::optional<std::tuple<Request_Line, size_t>> parse_request_line(std::string_v
     request_line.version = std::string(raw_request_line.substr(uri_end + 1, raw_request_line_end - uri_end - 1));
 
     if (request_line.version != "HTTP/2.5") {
-        std::cout << "Unsupported HTTP version: " << request_line.version << "\n";
+        log_event_limited<Log_Level::Warn>(malformed_request_limit, "unsupported HTTP version", request_line.version);
         return std::nullopt;
     }
     
     return std::make_tuple(request_line, raw_request_line_end + SEPERATOR.size());
 }
 
-std::optional<std::tuple<std::unordered_map<std::string, std::string>, size_t>> parse_request_headers(std::string_view raw_request_line, const size_t& start_pos) {
-    std::unordered_map<std::string, std::string> headers;
+std::optional<std::tuple<Headers, size_t>> parse_request_headers(std::string_view raw_request_line, const size_t& start_pos) {
+    Headers headers;
     size_t pos = start_pos;
     
     while (true) {
-        size_t line_end = raw_request_line.find(SEPERATOR, pos);
+        size_t line_end = scan_find_crlf(raw_request_line, pos);
         if (line_end == pos) {
             pos += SEPERATOR.size();
             break;
         }
         std::string header_line(raw_request_line.substr(pos, line_end - pos));
-        size_t colon_pos = header_line.find(':');
+        size_t colon_pos = scan_find_char(header_line, 0, ':');
         if (colon_pos == std::string::npos) {
-            std::cout << "Malformed header line (missing colon): " << header_line << "\n";
+            log_event_limited<Log_Level::Warn>(malformed_request_limit, "malformed header line (missing colon)", header_line);
             return std::nullopt;
         }
         if (header_line.at(colon_pos + 1) != ' ') {
-            std::cout << "Malformed header line (missing space after colon): " << header_line << "\n";
+            log_event_limited<Log_Level::Warn>(malformed_request_limit, "malformed header line (missing space after colon)", header_line);
             return std::nullopt;
         }
 
         if (header_line.at(colon_pos - 1) == ' ') {
-            std::cout << "Malformed header line (cannot have space before colon): " << header_line << "\n";
+            log_event_limited<Log_Level::Warn>(malformed_request_limit, "malformed header line (cannot have space before colon)", header_line);
             return std::nullopt;
         }
 
         std::string header_name = header_line.substr(0, colon_pos);
-        std::transform(header_name.begin(), header_name.end(), header_name.begin(), [](unsigned char c) { return std::tolower(c); });
+        scan_to_lower(header_name.data(), header_name.size());
         trim(header_name);
 
         std::string header_value = header_line.substr(colon_pos + 2);
-        std::transform(header_value.begin(), header_value.end(), header_value.begin(), [](unsigned char c) { return std::tolower(c); });
+        scan_to_lower(header_value.data(), header_value.size());
         trim(header_value);
 
         if (header_name.empty() || header_value.empty()) {
-            std::cout << "Malformed header line (empty name or value): " << header_line << "\n";
+            log_event_limited<Log_Level::Warn>(malformed_request_limit, "malformed header line (empty name or value)", header_line);
             return std::nullopt;
         }
         if (!contains_valid_chars(header_name)) {
-            std::cout << "Malformed header line (invalid characters): " << header_line << "\n";
+            log_event_limited<Log_Level::Warn>(malformed_request_limit, "malformed header line (invalid characters)", header_line);
             return std::nullopt;
         }
 
-        if (headers.find(header_name) != headers.end()) {
-            headers[header_name] += ", " + header_value;
+        auto existing = headers.get(header_name);
+        if (existing) {
+            headers.set(header_name, std::string(*existing) + ", " + header_value);
         } else {
-            headers[header_name] = header_value;
+            headers.add(header_name, header_value);
         }
 
         pos = line_end + SEPERATOR.size();
@@ -176,10 +176,7 @@ std::vector<uint8_t> serialize_request(const Request& request) {
                                request.request_line.version + std::string(SEPERATOR);
     serialized.insert(serialized.end(), request_line.begin(), request_line.end());
 
-    for (const auto& [key, value] : request.headers) {
-        std::string header_line = key + ": " + value + std::string(SEPERATOR);
-        serialized.insert(serialized.end(), header_line.begin(), header_line.end());
-    }
+    request.headers.serialize_to(serialized);
 
     serialized.insert(serialized.end(), SEPERATOR.begin(), SEPERATOR.end());
 
@@ -192,9 +189,9 @@ std::vector<uint8_t> serialize_request(const Request& request) {
 std::optional<Response> parse_http_response(const std::vector<uint8_t>& raw_response) {
     std::string response_str(raw_response.begin(), raw_response.end());
     
-    size_t status_line_end = response_str.find("\r\n");
+    size_t status_line_end = scan_find_crlf(response_str, 0);
     if (status_line_end == std::string::npos) {
-        std::cout << "Malformed response (No CRLF found in status line)\n";
+        log_event_limited<Log_Level::Warn>(malformed_response_limit, "malformed response (No CRLF found in status line)");
         return std::nullopt;
     }
     
@@ -204,35 +201,42 @@ std::optional<Response> parse_http_response(const std::vector<uint8_t>& raw_resp
     size_t second_space = status_line.find(" ", first_space + 1);
     
     if (first_space == std::string::npos || second_space == std::string::npos) {
-        std::cout << "Malformed status line: " << status_line << "\n";
+        log_event_limited<Log_Level::Warn>(malformed_response_limit, "malformed status line", status_line);
         return std::nullopt;
     }
     
     Response response;
     response.response_line.version = status_line.substr(0, first_space);
-    response.response_line.status_code = static_cast<Status_Code>(std::stoi(status_line.substr(first_space + 1, second_space - first_space - 1)));
+    int status_code = 0;
+    std::string_view status_text = std::string_view(status_line).substr(first_space + 1, second_space - first_space - 1);
+    if (std::from_chars(status_text.data(), status_text.data() + status_text.size(), status_code).ptr != status_text.data() + status_text.size() ||
+        status_code < 100 || status_code > 999) {
+        log_event_limited<Log_Level::Warn>(malformed_response_limit, "malformed status code", status_line);
+        return std::nullopt;
+    }
+    response.response_line.status_code = static_cast<Status_Code>(status_code);
     response.response_line.reason_phrase = status_line.substr(second_space + 1);
     
     size_t headers_end = response_str.find("\r\n\r\n", status_line_end);
     if (headers_end == std::string::npos) {
-        std::cout << "Malformed response (No blank line between headers and body)\n";
+        log_event_limited<Log_Level::Warn>(malformed_response_limit, "malformed response (No blank line between headers and body)");
         return std::nullopt;
     }
     
     size_t current_pos = status_line_end + 2;
     while (current_pos < headers_end) {
-        size_t line_end = response_str.find("\r\n", current_pos);
+        size_t line_end = scan_find_crlf(response_str, current_pos);
         if (line_end == std::string::npos || line_end > headers_end) {
             break;
         }
         
         std::string header_line = response_str.substr(current_pos, line_end - current_pos);
-        size_t colon_pos = header_line.find(":");
+        size_t colon_pos = scan_find_char(header_line, 0, ':');
         
         if (colon_pos != std::string::npos) {
             std::string header_name = header_line.substr(0, colon_pos);
             std::string header_value = header_line.substr(colon_pos + 2); 
-            response.headers[header_name] = header_value;
+            response.headers.add(header_name, header_value);
         }
         
         current_pos = line_end + 2;
@@ -1,10 +1,12 @@
 #ifndef HTTP_REQUEST_HPP
 #define HTTP_REQUEST_HPP
 
+#include "http_headers.hpp"
+#include "http_deadline.hpp"
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include <cstdint>
+#include <memory_resource>
 
 struct Request_Line {
     std::string version;
@@ -13,9 +15,13 @@ struct Request_Line {
 };
 
 struct Request {
-    Request_Line request_line;
-    std::unordered_map<std::string, std::string> headers;
-    std::vector<uint8_t> body;
+    Request_Line request_line{};
+    Headers headers{};
+    std::vector<uint8_t> body{};
+    Cancellation_Token cancellation{}; // Set by the server before the handler runs
+    // For the handler's scratch data, only valid until it returns: the server's request arena
+    // when one is configured, the heap otherwise
+    std::pmr::memory_resource* arena = std::pmr::get_default_resource();
 };
 
 
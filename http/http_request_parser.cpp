@@ -0,0 +1,211 @@
+#include "http_request_parser.hpp"
+#include "http_parse.hpp"
+#include "http_scan.hpp"
+#include "../sctp_stack/sctp_log.hpp"
+#include <algorithm>
+
+static Log_Rate_Limit request_parser_limit{10};
+
+static bool is_space(char ch) {
+    return ch == ' ' || ch == '\t';
+}
+
+// Digits only, no sign or whitespace, and no overflow
+static std::optional<size_t> parse_content_length(std::string_view value) {
+    if (value.empty()) {
+        return std::nullopt;
+    }
+    size_t result = 0;
+    for (char ch : value) {
+        if (ch < '0' || ch > '9') {
+            return std::nullopt;
+        }
+        size_t digit = static_cast<size_t>(ch - '0');
+        if (result > (SIZE_MAX - digit) / 10) {
+            return std::nullopt;
+        }
+        result = result * 10 + digit;
+    }
+    return result;
+}
+
+Request_Parser::Request_Parser() {
+    reset();
+}
+
+void Request_Parser::reset() {
+    state = PARSING_REQUEST_LINE;
+    line_start = 0;
+    scan_pos = 0;
+    body_start = 0;
+    content_length = 0;
+    failure = PARSE_ERROR;
+    method = uri = version = Offsets{0, 0};
+    result.headers.clear();
+}
+
+const Request_View& Request_Parser::view() const {
+    return result;
+}
+
+size_t Request_Parser::message_size() const {
+    return state == PARSING_DONE ? body_start + content_length : 0;
+}
+
+Parse_Status Request_Parser::fail() {
+    state = PARSING_FAILED;
+    return failure;
+}
+
+// Headers parsed so far stay readable, so the answer can carry the request's Stream-Id
+Parse_Status Request_Parser::head_too_large(std::string_view buffer) {
+    log_event_limited<Log_Level::Warn>(request_parser_limit, "request head too large", {}, {{"size", buffer.size()}});
+    result.headers.set_view_base(buffer.data());
+    failure = PARSE_HEAD_TOO_LARGE;
+    return fail();
+}
+
+Parse_Status Request_Parser::parse(std::string_view buffer) {
+    while (true) {
+        switch (state) {
+            case PARSING_REQUEST_LINE:
+            case PARSING_HEADERS: {
+                size_t line_end = scan_find_crlf(buffer, scan_pos);
+                if (line_end != std::string_view::npos && line_end + SEPERATOR.size() > MAX_REQUEST_HEAD_SIZE) {
+                    return head_too_large(buffer);
+                }
+                if (line_end == std::string_view::npos) {
+                    if (buffer.size() > MAX_REQUEST_HEAD_SIZE) {
+                        return head_too_large(buffer);
+                    }
+                    // A CR at the very end may be the first half of the separator
+                    scan_pos = std::max(line_start, buffer.empty() ? 0 : buffer.size() - 1);
+                    return PARSE_INCOMPLETE;
+                }
+
+                if (state == PARSING_REQUEST_LINE) {
+                    if (!parse_request_line(buffer, line_end)) {
+                        return fail();
+                    }
+                    state = PARSING_HEADERS;
+                } else if (line_end == line_start) {
+                    body_start = line_end + SEPERATOR.size();
+                    state = PARSING_BODY;
+                } else if (!parse_header_line(buffer, line_end)) {
+                    result.headers.set_view_base(buffer.data());
+                    return fail();
+                }
+                line_start = scan_pos = line_end + SEPERATOR.size();
+                break;
+            }
+            case PARSING_BODY:
+                if (buffer.size() < body_start || buffer.size() - body_start < content_length) {
+                    return PARSE_INCOMPLETE;
+                }
+                state = PARSING_DONE;
+                build_view(buffer);
+                return PARSE_COMPLETE;
+            case PARSING_DONE:
+                build_view(buffer);
+                return PARSE_COMPLETE;
+            case PARSING_FAILED:
+                return failure;
+        }
+    }
+}
+
+bool Request_Parser::parse_request_line(std::string_view buffer, size_t line_end) {
+    std::string_view line = buffer.substr(line_start, line_end - line_start);
+
+    size_t method_end = line.find(' ');
+    if (method_end == std::string_view::npos) {
+        log_event_limited<Log_Level::Warn>(request_parser_limit, "malformed request line (No space found after method)", line);
+        return false;
+    }
+    size_t uri_end = line.find(' ', method_end + 1);
+    if (uri_end == std::string_view::npos) {
+        log_event_limited<Log_Level::Warn>(request_parser_limit, "malformed request line (No space found after URI)", line);
+        return false;
+    }
+    if (line.substr(uri_end + 1) != "HTTP/2.5") {
+        log_event_limited<Log_Level::Warn>(request_parser_limit, "unsupported HTTP version", line.substr(uri_end + 1));
+        return false;
+    }
+
+    method = Offsets{line_start, method_end};
+    uri = Offsets{line_start + method_end + 1, uri_end - method_end - 1};
+    version = Offsets{line_start + uri_end + 1, line.size() - uri_end - 1};
+    return true;
+}
+
+bool Request_Parser::parse_header_line(std::string_view buffer, size_t line_end) {
+    std::string_view line = buffer.substr(line_start, line_end - line_start);
+
+    size_t colon_pos = scan_find_char(line, 0, ':');
+    if (colon_pos == std::string_view::npos) {
+        log_event_limited<Log_Level::Warn>(request_parser_limit, "malformed header line (missing colon)", line);
+        return false;
+    }
+    if (colon_pos + 1 >= line.size() || line[colon_pos + 1] != ' ') {
+        log_event_limited<Log_Level::Warn>(request_parser_limit, "malformed header line (missing space after colon)", line);
+        return false;
+    }
+    if (colon_pos == 0 || line[colon_pos - 1] == ' ') {
+        log_event_limited<Log_Level::Warn>(request_parser_limit, "malformed header line (cannot have space before colon)", line);
+        return false;
+    }
+
+    size_t name_start = 0;
+    while (name_start < colon_pos && is_space(line[name_start])) {
+        name_start++;
+    }
+    size_t value_start = colon_pos + 2;
+    size_t value_end = line.size();
+    while (value_start < value_end && is_space(line[value_start])) {
+        value_start++;
+    }
+    while (value_end > value_start && is_space(line[value_end - 1])) {
+        value_end--;
+    }
+
+    std::string_view name = line.substr(name_start, colon_pos - name_start);
+    std::string_view value = line.substr(value_start, value_end - value_start);
+    if (name.empty() || value.empty()) {
+        log_event_limited<Log_Level::Warn>(request_parser_limit, "malformed header line (empty name or value)", line);
+        return false;
+    }
+    if (!scan_is_token(name)) {
+        log_event_limited<Log_Level::Warn>(request_parser_limit, "malformed header line (invalid characters)", line);
+        return false;
+    }
+    Header_Id id = header_id(name);
+    if (id == HEADER_CONTENT_LENGTH) {
+        auto length = parse_content_length(value);
+        if (!length) {
+            log_event_limited<Log_Level::Warn>(request_parser_limit, "malformed content-length", line);
+            return false;
+        }
+        // Framing by one value while handlers read another would let a request smuggle a second one
+        if (result.headers.contains(HEADER_CONTENT_LENGTH) && *length != content_length) {
+            log_event_limited<Log_Level::Warn>(request_parser_limit, "conflicting content-length", line);
+            failure = PARSE_CONFLICTING_LENGTH;
+            return false;
+        }
+        content_length = *length;
+    }
+
+    result.headers.add_view(id, name, value, buffer.data());
+    return true;
+}
+
+void Request_Parser::build_view(std::string_view buffer) {
+    auto view_of = [&](const Offsets& offsets) {
+        return buffer.substr(offsets.start, offsets.length);
+    };
+
+    result.method = view_of(method);
+    result.uri = view_of(uri);
+    result.version = view_of(version);
+    result.headers.set_view_base(buffer.data());
+    result.body = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(buffer.data()) + body_start, content_length);
+}
@@ -0,0 +1,75 @@
+#ifndef HTTP_REQUEST_PARSER_HPP
+#define HTTP_REQUEST_PARSER_HPP
+
+#include "http_headers.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <span>
+#include <string_view>
+#include <optional>
+
+constexpr size_t MAX_REQUEST_HEAD_SIZE = 16384; // Request line plus headers, which also bounds how many headers there are
+
+// Request whose fields point into the buffer handed to Request_Parser::parse, headers included
+struct Request_View {
+    std::string_view method;
+    std::string_view uri;
+    std::string_view version;
+    Headers headers;
+    std::span<const uint8_t> body;
+};
+
+enum Parse_Status {
+    PARSE_INCOMPLETE,
+    PARSE_COMPLETE,
+    PARSE_ERROR,
+    PARSE_HEAD_TOO_LARGE, // Over MAX_REQUEST_HEAD_SIZE; the view's headers are those parsed before the limit
+    PARSE_CONFLICTING_LENGTH // Content-Length repeated with a different value; the view's headers are those parsed before it
+};
+
+// Resumable request parser. Each call gets every byte received so far for the message (the
+// buffer may grow or move between calls), scanning resumes where the previous call stopped.
+// Up to HEADERS_INLINE_CAPACITY headers nothing is allocated; the view stays valid as long as
+// the buffer is not modified.
+class Request_Parser {
+    public:
+        Request_Parser();
+
+        Parse_Status parse(std::string_view buffer);
+        const Request_View& view() const;
+        size_t message_size() const; // Bytes belonging to the parsed message, anything after it is the next one
+        void reset();
+
+    private:
+        enum State {
+            PARSING_REQUEST_LINE,
+            PARSING_HEADERS,
+            PARSING_BODY,
+            PARSING_DONE,
+            PARSING_FAILED
+        };
+
+        struct Offsets {
+            size_t start;
+            size_t length;
+        };
+
+        State state;
+        size_t line_start;
+        size_t scan_pos;
+        size_t body_start;
+        size_t content_length;
+        Parse_Status failure; // What parse() keeps returning once the state is PARSING_FAILED
+        Offsets method;
+        Offsets uri;
+        Offsets version;
+        Request_View result;
+
+        bool parse_request_line(std::string_view buffer, size_t line_end);
+        bool parse_header_line(std::string_view buffer, size_t line_end);
+        void build_view(std::string_view buffer);
+        Parse_Status fail();
+        Parse_Status head_too_large(std::string_view buffer);
+};
+
+#endif
@@ -11,36 +11,62 @@ Response create_response(Status_Code status_code, const std::vector<uint8_t>& bo
     return response;
 }
 
+std::span<const uint8_t> response_body(const Response& response) {
+    return response.body_owner ? response.body_view : std::span<const uint8_t>(response.body);
+}
+
+struct Status_Text {
+    Status_Code code;
+    std::string_view reason_phrase;
+    std::string_view status_line;
+};
+
+static constexpr Status_Text STATUS_TEXTS[] = {
+    {OK, "OK", "HTTP/2.5 200 OK\r\n"},
+    {NotModified, "Not Modified", "HTTP/2.5 304 Not Modified\r\n"},
+    {BadRequest, "Bad Request", "HTTP/2.5 400 Bad Request\r\n"},
+    {Unauthorized, "Unauthorized", "HTTP/2.5 401 Unauthorized\r\n"},
+    {NotFound, "Not Found", "HTTP/2.5 404 Not Found\r\n"},
+    {MethodNotAllowed, "Method Not Allowed", "HTTP/2.5 405 Method Not Allowed\r\n"},
+    {PayloadTooLarge, "Payload Too Large", "HTTP/2.5 413 Payload Too Large\r\n"},
+    {RequestHeaderFieldsTooLarge, "Request Header Fields Too Large", "HTTP/2.5 431 Request Header Fields Too Large\r\n"},
+    {InternalServerError, "Internal Server Error", "HTTP/2.5 500 Internal Server Error\r\n"},
+    {ServiceUnavailable, "Service Unavailable", "HTTP/2.5 503 Service Unavailable\r\n"}
+};
+
+static const Status_Text* find_status_text(Status_Code code) {
+    for (const auto& text : STATUS_TEXTS) {
+        if (text.code == code) {
+            return &text;
+        }
+    }
+    return nullptr;
+}
+
 Response_Line create_response_line(const Status_Code& code) {
     Response_Line line;
     line.version = "HTTP/2.5"; 
-
-    switch (code) {
-        case OK:
-            line.reason_phrase = "OK";
-            break;
-        case BadRequest:
-            line.reason_phrase = "Bad Request";
-            break;
-        case NotFound:
-            line.reason_phrase = "Not Found";
-            break;
-        case InternalServerError:
-            line.reason_phrase = "Internal Server Error";
-            break;
-        default:
-            line.reason_phrase = "Unknown Status";
-            break;
-    }
+    line.reason_phrase = reason_phrase(code);
     line.status_code = code;
     return line;
 }
 
-std::unordered_map<std::string, std::string> create_standard_headers(const std::vector<uint8_t>& body) {
-    std::unordered_map<std::string, std::string> headers;
-    headers["Content-Length"] = std::to_string(body.size());
-    headers["Content-Type"] = "text/plain";
-    headers["Connection"] = "close";
+std::string_view reason_phrase(Status_Code code) {
+    const Status_Text* text = find_status_text(code);
+    return text ? text->reason_phrase : "Unknown Status";
+}
+
+std::string_view status_line(Status_Code code) {
+    const Status_Text* text = find_status_text(code);
+    return text ? text->status_line : std::string_view{};
+}
+
+// The association outlives the response, requests keep sharing it
+Headers create_standard_headers(const std::vector<uint8_t>& body) {
+    Headers headers;
+    headers.add(HEADER_CONTENT_LENGTH, std::to_string(body.size()));
+    headers.add(HEADER_CONTENT_TYPE, "text/plain");
+    headers.add(HEADER_CONNECTION, "keep-alive");
     return headers;
 }
 
@@ -50,16 +76,15 @@ std::vector<uint8_t> serialize_response(const Response& response) {
     std::string status_line = response.response_line.version + " " +
                               std::to_string(response.response_line.status_code) + " " +
                               response.response_line.reason_phrase + std::string(SEPERATOR);
+    serialized.reserve(status_line.size() + response.headers.serialized_size() + SEPERATOR.size() + response_body(response).size());
     serialized.insert(serialized.end(), status_line.begin(), status_line.end());
 
-    for (const auto& [key, value] : response.headers) {
-        std::string header_line = key + ": " + value + std::string(SEPERATOR);
-        serialized.insert(serialized.end(), header_line.begin(), header_line.end());
-    }
+    response.headers.serialize_to(serialized);
 
     serialized.insert(serialized.end(), SEPERATOR.begin(), SEPERATOR.end());
 
-    serialized.insert(serialized.end(), response.body.begin(), response.body.end());
+    std::span<const uint8_t> body = response_body(response);
+    serialized.insert(serialized.end(), body.begin(), body.end());
 
     return serialized;
 }
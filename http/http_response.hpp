@@ -1,16 +1,25 @@
 #ifndef HTTP_RESPONSE_HPP
 #define HTTP_RESPONSE_HPP
 
+#include "http_headers.hpp"
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
+#include <span>
+#include <memory>
 #include <cstdint>
 
 enum Status_Code {
     OK = 200,
+    NotModified = 304,
     BadRequest = 400,
+    Unauthorized = 401,
     NotFound = 404,
-    InternalServerError = 500
+    MethodNotAllowed = 405,
+    PayloadTooLarge = 413,
+    RequestHeaderFieldsTooLarge = 431,
+    InternalServerError = 500,
+    ServiceUnavailable = 503
 };
 
 struct Response_Line {
@@ -21,13 +30,20 @@ struct Response_Line {
 
 struct Response {
     Response_Line response_line;
-    std::unordered_map<std::string, std::string> headers;
+    Headers headers;
     std::vector<uint8_t> body;
+    // When body_owner is set the body is body_view instead, bytes the owner keeps alive (e.g. a
+    // file mapping), so they go out without a copy into body
+    std::span<const uint8_t> body_view;
+    std::shared_ptr<const void> body_owner;
 };
 
 Response create_response(Status_Code status_code, const std::vector<uint8_t>& body);
+std::span<const uint8_t> response_body(const Response& response);
 Response_Line create_response_line(const Status_Code& code);
-std::unordered_map<std::string, std::string> create_standard_headers(const std::vector<uint8_t>& body);
+std::string_view reason_phrase(Status_Code code);
+std::string_view status_line(Status_Code code); // Pre-rendered "HTTP/2.5 <code> <reason>\r\n", empty if unknown
+Headers create_standard_headers(const std::vector<uint8_t>& body);
 std::vector<uint8_t> serialize_response(const Response& response);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "http_response_cache.hpp"
+#include <algorithm>
+#include <charconv>
+#include <functional>
+
+constexpr size_t SKETCH_SAMPLE_SIZE = 10 * RESPONSE_CACHE_SKETCH_WIDTH; // Lookups between counter halvings
+constexpr uint8_t SKETCH_COUNTER_MAX = 15;
+constexpr uint64_t SKETCH_SEEDS[RESPONSE_CACHE_SKETCH_ROWS] = {0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0xd6e8feb86659fd93ull};
+constexpr size_t ENTRY_OVERHEAD = 128; // Node, map slot and bookkeeping, roughly
+
+static_assert((RESPONSE_CACHE_SKETCH_WIDTH & (RESPONSE_CACHE_SKETCH_WIDTH - 1)) == 0, "sketch width must be a power of two");
+
+struct Transparent_Hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view text) const {
+        return std::hash<std::string_view>{}(text);
+    }
+};
+
+struct Response_Cache::Shard {
+    struct Entry {
+        std::string key; // Primary key, then one line per Vary header value
+        std::string primary; // "METHOD uri"
+        size_t method_length;
+        uint64_t primary_hash;
+        std::shared_ptr<const std::vector<uint8_t>> wire;
+        size_t header_end;
+        std::chrono::steady_clock::time_point stored;
+        std::chrono::steady_clock::time_point expires;
+        size_t bytes;
+    };
+
+    struct Vary_Spec {
+        std::vector<std::string> names;
+        size_t variants;
+    };
+
+    std::mutex shard_mutex;
+    std::list<Entry> lru; // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator, Transparent_Hash, std::equal_to<>> entries;
+    std::unordered_map<std::string, Vary_Spec, Transparent_Hash, std::equal_to<>> varies; // By primary key
+    size_t budget;
+    size_t bytes = 0;
+    std::array<std::array<uint8_t, RESPONSE_CACHE_SKETCH_WIDTH>, RESPONSE_CACHE_SKETCH_ROWS> sketch{};
+    size_t samples = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t rejections = 0;
+    uint64_t evictions = 0;
+    uint64_t expirations = 0;
+    uint64_t invalidations = 0;
+
+    static size_t sketch_slot(uint64_t hash, size_t row) {
+        return static_cast<size_t>((hash * SKETCH_SEEDS[row]) >> 52) & (RESPONSE_CACHE_SKETCH_WIDTH - 1);
+    }
+
+    // Counters age by halving, so the sketch follows what is popular now
+    void record(uint64_t hash) {
+        for (size_t row{}; row < RESPONSE_CACHE_SKETCH_ROWS; row++) {
+            uint8_t& counter = sketch[row][sketch_slot(hash, row)];
+            counter += counter < SKETCH_COUNTER_MAX ? 1 : 0;
+        }
+        if (++samples >= SKETCH_SAMPLE_SIZE) {
+            for (auto& row : sketch) {
+                for (uint8_t& counter : row) {
+                    counter >>= 1;
+                }
+            }
+            samples /= 2;
+        }
+    }
+
+    uint8_t frequency(uint64_t hash) const {
+        uint8_t estimate = SKETCH_COUNTER_MAX;
+        for (size_t row{}; row < RESPONSE_CACHE_SKETCH_ROWS; row++) {
+            estimate = std::min(estimate, sketch[row][sketch_slot(hash, row)]);
+        }
+        return estimate;
+    }
+
+    void erase(std::list<Entry>::iterator entry) {
+        auto spec = varies.find(std::string_view(entry->primary));
+        if (spec != varies.end() && --spec->second.variants == 0) {
+            varies.erase(spec);
+        }
+        bytes -= entry->bytes;
+        entries.erase(entry->key);
+        lru.erase(entry);
+    }
+};
+
+static std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+template <typename Fn>
+static void for_each_list_item(std::string_view list, Fn&& fn) {
+    while (!list.empty()) {
+        size_t end = std::min(list.find(','), list.size());
+        std::string_view item = trim(list.substr(0, end));
+        list.remove_prefix(std::min(end + 1, list.size()));
+        if (!item.empty()) {
+            fn(item);
+        }
+    }
+}
+
+// Freshness lifetime from Cache-Control, nullopt when the response must not be stored
+static std::optional<std::chrono::seconds> cache_lifetime(std::string_view cache_control) {
+    std::optional<std::chrono::seconds> max_age;
+    std::optional<std::chrono::seconds> shared_max_age;
+    bool storable = true;
+    for_each_list_item(cache_control, [&](std::string_view directive) {
+        size_t equals = std::min(directive.find('='), directive.size());
+        std::string_view name = trim(directive.substr(0, equals));
+        std::string_view value = equals < directive.size() ? trim(directive.substr(equals + 1)) : std::string_view{};
+        if (iequals(name, "no-store") || iequals(name, "no-cache") || iequals(name, "private")) {
+            storable = false;
+        } else if (iequals(name, "max-age") || iequals(name, "s-maxage")) {
+            int64_t seconds = 0;
+            if (std::from_chars(value.data(), value.data() + value.size(), seconds).ec != std::errc() || seconds < 0) {
+                storable = false;
+                return;
+            }
+            (iequals(name, "s-maxage") ? shared_max_age : max_age) = std::chrono::seconds(seconds);
+        }
+    });
+    // s-maxage is meant for shared caches like this one and wins over max-age
+    std::optional<std::chrono::seconds> lifetime = shared_max_age ? shared_max_age : max_age;
+    if (!storable || !lifetime || lifetime->count() == 0) {
+        return std::nullopt;
+    }
+    return lifetime;
+}
+
+static void append_primary_key(std::string& key, std::string_view method, std::string_view uri) {
+    key.assign(method);
+    key.push_back(' ');
+    key.append(uri);
+}
+
+// Absent and empty headers are different variants
+static void append_vary_values(std::string& key, const std::vector<std::string>& names, const Headers& request_headers) {
+    for (const auto& name : names) {
+        key.push_back('\n');
+        if (auto value = request_headers.get(name)) {
+            key.push_back('=');
+            key.append(*value);
+        }
+    }
+}
+
+bool request_cacheable(std::string_view method, const Headers& request_headers) {
+    if (method != "GET" || request_headers.contains(HEADER_AUTHORIZATION) || request_headers.contains(HEADER_IF_NONE_MATCH) ||
+        request_headers.contains(HEADER_IF_MODIFIED_SINCE)) {
+        return false;
+    }
+    bool bypass = false;
+    if (auto cache_control = request_headers.get(HEADER_CACHE_CONTROL)) {
+        for_each_list_item(*cache_control, [&](std::string_view directive) {
+            bypass |= iequals(directive, "no-cache") || iequals(directive, "no-store") || iequals(directive, "max-age=0");
+        });
+    }
+    return !bypass;
+}
+
+void write_cached_response(const Cached_Response& cached, std::optional<std::string_view> stream_id, std::vector<uint8_t>& out) {
+    char age_digits[24];
+    std::string_view age(age_digits, std::to_chars(age_digits, age_digits + sizeof(age_digits), cached.age.count()).ptr - age_digits);
+    constexpr std::string_view AGE_PREFIX = "Age: ";
+    std::string_view stream_name = header_name(HEADER_STREAM_ID);
+
+    const std::vector<uint8_t>& wire = *cached.wire;
+    size_t extra = AGE_PREFIX.size() + age.size() + 2 + (stream_id ? stream_name.size() + 2 + stream_id->size() + 2 : 0);
+    size_t start = out.size();
+    out.resize(start + wire.size() + extra);
+    uint8_t* write = std::copy(wire.begin(), wire.begin() + cached.header_end, out.data() + start);
+    write = std::copy(AGE_PREFIX.begin(), AGE_PREFIX.end(), write);
+    write = std::copy(age.begin(), age.end(), write);
+    write = std::copy_n("\r\n", 2, write);
+    if (stream_id) {
+        write = std::copy(stream_name.begin(), stream_name.end(), write);
+        write = std::copy_n(": ", 2, write);
+        write = std::copy(stream_id->begin(), stream_id->end(), write);
+        write = std::copy_n("\r\n", 2, write);
+    }
+    std::copy(wire.begin() + cached.header_end, wire.end(), write);
+}
+
+Response_Cache::Response_Cache(const Response_Cache_Config& config) : config(config) {
+    size_t shard_count = std::max<size_t>(config.shards, 1);
+    for (size_t i{}; i < shard_count; i++) {
+        shards.push_back(std::make_unique<Shard>());
+        shards.back()->budget = config.max_bytes / shard_count;
+    }
+}
+
+Response_Cache::~Response_Cache() = default;
+
+Response_Cache::Shard& Response_Cache::shard_for(uint64_t primary_hash) {
+    // The low bits pick the bucket inside the shard's maps, the high bits pick the shard
+    return *shards[(primary_hash >> 32) % shards.size()];
+}
+
+std::optional<Cached_Response> Response_Cache::lookup(std::string_view method, std::string_view uri, const Headers& request_headers) {
+    thread_local std::string key;
+    append_primary_key(key, method, uri);
+    uint64_t primary_hash = Transparent_Hash{}(key);
+    Shard& shard = shard_for(primary_hash);
+    auto now = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> shard_lock(shard.shard_mutex);
+    shard.record(primary_hash);
+    auto spec = shard.varies.find(std::string_view(key));
+    if (spec == shard.varies.end()) {
+        shard.misses++;
+        return std::nullopt;
+    }
+    append_vary_values(key, spec->second.names, request_headers);
+    auto found = shard.entries.find(std::string_view(key));
+    if (found == shard.entries.end()) {
+        shard.misses++;
+        return std::nullopt;
+    }
+    auto entry = found->second;
+    if (now >= entry->expires) {
+        shard.erase(entry);
+        shard.expirations++;
+        shard.misses++;
+        return std::nullopt;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+    shard.hits++;
+    return Cached_Response{entry->wire, entry->header_end, std::chrono::duration_cast<std::chrono::seconds>(now - entry->stored)};
+}
+
+std::optional<Cached_Response> Response_Cache::store(std::string_view method, std::string_view uri, const Headers& request_headers, Status_Code status,
+                                                     const Headers& response_headers, std::vector<uint8_t> wire) {
+    auto cache_control = response_headers.get(HEADER_CACHE_CONTROL);
+    auto lifetime = status == Status_Code::OK && cache_control ? cache_lifetime(*cache_control) : std::nullopt;
+    if (!lifetime) {
+        return std::nullopt;
+    }
+    std::vector<std::string> vary_names;
+    bool vary_any = false;
+    if (auto vary = response_headers.get(HEADER_VARY)) {
+        for_each_list_item(*vary, [&](std::string_view name) {
+            vary_any |= name == "*";
+            vary_names.emplace_back(name);
+        });
+    }
+    if (vary_any) {
+        return std::nullopt;
+    }
+    std::string_view wire_text(reinterpret_cast<const char*>(wire.data()), wire.size());
+    size_t blank_line = wire_text.find("\r\n\r\n");
+    if (blank_line == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    Shard::Entry entry;
+    append_primary_key(entry.primary, method, uri);
+    entry.method_length = method.size();
+    entry.primary_hash = Transparent_Hash{}(entry.primary);
+    entry.key = entry.primary;
+    append_vary_values(entry.key, vary_names, request_headers);
+    entry.header_end = blank_line + 2;
+    entry.stored = std::chrono::steady_clock::now();
+    entry.expires = entry.stored + std::min(*lifetime, config.max_ttl);
+    entry.bytes = wire.size() + entry.key.size() + entry.primary.size() + ENTRY_OVERHEAD;
+    entry.wire = std::make_shared<const std::vector<uint8_t>>(std::move(wire));
+
+    Shard& shard = shard_for(entry.primary_hash);
+    if (entry.bytes > shard.budget) {
+        return std::nullopt;
+    }
+    std::unique_lock<std::mutex> shard_lock(shard.shard_mutex);
+    // A stored response for the same key is replaced, and variants stored under a different Vary
+    // could no longer be found; both go, but only once the new entry is admitted
+    auto existing = shard.entries.find(std::string_view(entry.key));
+    bool replacing = existing != shard.entries.end();
+    auto spec = shard.varies.find(std::string_view(entry.primary));
+    bool vary_changed = spec != shard.varies.end() && spec->second.names != vary_names;
+    auto superseded = [&](const Shard::Entry& other) {
+        return other.key == entry.key || (vary_changed && other.primary == entry.primary);
+    };
+    size_t freed = 0;
+    if (vary_changed) {
+        for (const auto& other : shard.lru) {
+            freed += superseded(other) ? other.bytes : 0;
+        }
+    } else if (replacing) {
+        freed = existing->second->bytes;
+    }
+
+    // Victims from the cold end until the entry fits. A key already stored was admitted before;
+    // anything else has to be requested more often than every live entry it would displace, or
+    // the shard is left as it was.
+    std::vector<std::list<Shard::Entry>::iterator> victims;
+    size_t needed = shard.bytes - freed + entry.bytes;
+    uint8_t candidate_frequency = shard.frequency(entry.primary_hash);
+    for (auto victim = shard.lru.end(); needed > shard.budget && victim != shard.lru.begin();) {
+        --victim;
+        if (superseded(*victim)) {
+            continue;
+        }
+        if (!replacing && entry.stored < victim->expires && candidate_frequency <= shard.frequency(victim->primary_hash)) {
+            shard.rejections++;
+            return std::nullopt;
+        }
+        victims.push_back(victim);
+        needed -= victim->bytes;
+    }
+
+    for (auto victim : victims) {
+        (entry.stored >= victim->expires ? shard.expirations : shard.evictions)++;
+        shard.erase(victim);
+    }
+    if (vary_changed) {
+        for (auto stale = shard.lru.begin(); stale != shard.lru.end();) {
+            auto next = std::next(stale);
+            if (superseded(*stale)) {
+                shard.erase(stale);
+            }
+            stale = next;
+        }
+    } else if (replacing) {
+        shard.erase(existing->second);
+    }
+
+    auto [vary_spec, created] = shard.varies.try_emplace(entry.primary, Shard::Vary_Spec{std::move(vary_names), 0});
+    vary_spec->second.variants++;
+    shard.bytes += entry.bytes;
+    shard.lru.push_front(std::move(entry));
+    shard.entries.emplace(shard.lru.front().key, shard.lru.begin());
+    shard.insertions++;
+    return Cached_Response{shard.lru.front().wire, shard.lru.front().header_end, std::chrono::seconds(0)};
+}
+
+size_t Response_Cache::invalidate_prefix(std::string_view uri_prefix) {
+    size_t dropped = 0;
+    for (auto& shard : shards) {
+        std::unique_lock<std::mutex> shard_lock(shard->shard_mutex);
+        for (auto entry = shard->lru.begin(); entry != shard->lru.end();) {
+            auto next = std::next(entry);
+            if (std::string_view(entry->primary).substr(entry->method_length + 1).starts_with(uri_prefix)) {
+                shard->erase(entry);
+                shard->invalidations++;
+                dropped++;
+            }
+            entry = next;
+        }
+    }
+    return dropped;
+}
+
+void Response_Cache::clear() {
+    invalidate_prefix("");
+}
+
+Response_Cache_Stats Response_Cache::stats() const {
+    Response_Cache_Stats result{};
+    for (const auto& shard : shards) {
+        std::unique_lock<std::mutex> shard_lock(shard->shard_mutex);
+        result.hits += shard->hits;
+        result.misses += shard->misses;
+        result.insertions += shard->insertions;
+        result.rejections += shard->rejections;
+        result.evictions += shard->evictions;
+        result.expirations += shard->expirations;
+        result.invalidations += shard->invalidations;
+        result.entries += shard->entries.size();
+        result.bytes += shard->bytes;
+    }
+    return result;
+}
@@ -0,0 +1,82 @@
+#ifndef HTTP_RESPONSE_CACHE_HPP
+#define HTTP_RESPONSE_CACHE_HPP
+
+#include "http_headers.hpp"
+#include "http_response.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+constexpr size_t RESPONSE_CACHE_SKETCH_WIDTH = 4096; // Counters per row of a shard's frequency sketch
+constexpr size_t RESPONSE_CACHE_SKETCH_ROWS = 4;
+
+struct Response_Cache_Config {
+    size_t max_bytes = 64 * 1024 * 1024; // Split evenly over the shards
+    size_t shards = 16;
+    std::chrono::seconds max_ttl{3600}; // Caps max-age
+};
+
+struct Response_Cache_Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t rejections; // Not admitted, rarer than what it would have evicted
+    uint64_t evictions;
+    uint64_t expirations;
+    uint64_t invalidations;
+    size_t entries;
+    size_t bytes;
+};
+
+struct Cached_Response {
+    std::shared_ptr<const std::vector<uint8_t>> wire; // Status line through body
+    size_t header_end; // Offset of the blank line ending the headers
+    std::chrono::seconds age;
+};
+
+// Serialized responses keyed by method, URI and the request's values of the headers named in the
+// response's Vary. Only 200 responses carrying Cache-Control max-age or s-maxage (and none of
+// no-store, no-cache or private) are stored, for as long as that allows. Each shard is an LRU with
+// TinyLFU admission: a new entry only evicts entries requested less often than it, judged by a
+// count-min sketch of recent lookups, so a scan of one-off URIs cannot flush the hot set.
+class Response_Cache {
+    public:
+        explicit Response_Cache(const Response_Cache_Config& config = {});
+        ~Response_Cache();
+
+        std::optional<Cached_Response> lookup(std::string_view method, std::string_view uri, const Headers& request_headers);
+        // wire is the response as rendered, without a Stream-Id. Returns the stored entry, nullopt
+        // when the response is not cacheable or was not admitted (wire is consumed either way).
+        std::optional<Cached_Response> store(std::string_view method, std::string_view uri, const Headers& request_headers, Status_Code status,
+                                             const Headers& response_headers, std::vector<uint8_t> wire);
+        size_t invalidate_prefix(std::string_view uri_prefix); // Every method and variant, returns entries dropped
+        void clear();
+        Response_Cache_Stats stats() const;
+
+    private:
+        struct Shard;
+
+        Response_Cache_Config config;
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        Shard& shard_for(uint64_t primary_hash);
+};
+
+// Requests that must reach the handler: not GET, credentials, conditionals, or a client asking
+// to bypass caches
+bool request_cacheable(std::string_view method, const Headers& request_headers);
+
+// Appends the cached bytes with Age, and Stream-Id when the request carried one, spliced in
+// before the blank line
+void write_cached_response(const Cached_Response& cached, std::optional<std::string_view> stream_id, std::vector<uint8_t>& out);
+
+#endif
@@ -0,0 +1,222 @@
+#include "http_response_writer.hpp"
+#include "http_parse.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <time.h>
+
+constexpr size_t DATE_LINE_LENGTH = 37; // "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+constexpr size_t HTTP_DATE_LENGTH = 29;
+
+static uint32_t id_bit(Header_Id id) {
+    return id == HEADER_OTHER ? 0 : 1u << id;
+}
+
+static_assert(HEADER_ID_COUNT <= 32, "Header_Block::id_mask needs a bit per Header_Id");
+
+// Content-Length always comes from the body, so a block never carries one
+Header_Block make_header_block(const Headers& headers) {
+    Header_Block block{{}, 0, {}};
+    for (size_t i{}; i < headers.size(); i++) {
+        if (headers.id_at(i) == HEADER_CONTENT_LENGTH) {
+            continue;
+        }
+        Header_View field = headers[i];
+        block.bytes.append(field.name).append(": ").append(field.value).append(SEPERATOR);
+        block.id_mask |= id_bit(headers.id_at(i));
+        if (headers.id_at(i) == HEADER_OTHER) {
+            block.other_names.emplace_back(field.name);
+        }
+    }
+    return block;
+}
+
+bool skip_response_header(const Header_Block* header_block, Header_Id id, std::string_view name) {
+    if (id == HEADER_CONTENT_LENGTH) {
+        return true;
+    }
+    if (!header_block) {
+        return false;
+    }
+    if (id != HEADER_OTHER) {
+        return header_block->id_mask & id_bit(id);
+    }
+    return std::any_of(header_block->other_names.begin(), header_block->other_names.end(),
+                       [&](const std::string& other) { return iequals(other, name); });
+}
+
+// The status alone says there is no body, so a Content-Length would describe nothing
+static bool status_has_body(Status_Code status_code) {
+    return status_code >= 200 && status_code != 204 && status_code != NotModified;
+}
+
+// The Date header only needs whole seconds, a coarse clock read is several times cheaper
+static std::chrono::sys_seconds current_second() {
+#ifdef CLOCK_REALTIME_COARSE
+    timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    return std::chrono::sys_seconds(std::chrono::seconds(now.tv_sec));
+#else
+    return std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+#endif
+}
+
+static void write_two_digits(char* out, unsigned value) {
+    out[0] = static_cast<char>('0' + value / 10);
+    out[1] = static_cast<char>('0' + value % 10);
+}
+
+static constexpr const char* DAY_NAMES[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static constexpr const char* MONTH_NAMES[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// Writes the HTTP_DATE_LENGTH characters of "Sun, 06 Nov 1994 08:49:37 GMT"
+static void render_http_date(char* out, std::chrono::sys_seconds time_point) {
+    auto day = std::chrono::floor<std::chrono::days>(time_point);
+    std::chrono::year_month_day date{day};
+    std::chrono::hh_mm_ss time{time_point - day};
+    std::chrono::weekday weekday{day};
+
+    std::memcpy(out, DAY_NAMES[weekday.c_encoding()], 3);
+    std::memcpy(out + 3, ", ", 2);
+    write_two_digits(out + 5, static_cast<unsigned>(date.day()));
+    out[7] = ' ';
+    std::memcpy(out + 8, MONTH_NAMES[static_cast<unsigned>(date.month()) - 1], 3);
+    out[11] = ' ';
+    int year = static_cast<int>(date.year());
+    write_two_digits(out + 12, static_cast<unsigned>(year / 100));
+    write_two_digits(out + 14, static_cast<unsigned>(year % 100));
+    out[16] = ' ';
+    write_two_digits(out + 17, static_cast<unsigned>(time.hours().count()));
+    out[19] = ':';
+    write_two_digits(out + 20, static_cast<unsigned>(time.minutes().count()));
+    out[22] = ':';
+    write_two_digits(out + 23, static_cast<unsigned>(time.seconds().count()));
+    std::memcpy(out + 25, " GMT", 4);
+}
+
+std::string_view date_header_line() {
+    thread_local int64_t rendered_second = -1;
+    thread_local char line[DATE_LINE_LENGTH + 1];
+
+    std::chrono::sys_seconds now = current_second();
+    int64_t second = now.time_since_epoch().count();
+    if (second != rendered_second) {
+        std::memcpy(line, "Date: ", 6);
+        render_http_date(line + 6, now);
+        std::memcpy(line + 6 + HTTP_DATE_LENGTH, "\r\n", 2);
+        rendered_second = second;
+    }
+    return std::string_view(line, DATE_LINE_LENGTH);
+}
+
+std::string format_http_date(std::chrono::sys_seconds time_point) {
+    std::string date(HTTP_DATE_LENGTH, ' ');
+    render_http_date(date.data(), time_point);
+    return date;
+}
+
+static bool parse_digits(std::string_view text, int& value) {
+    return std::from_chars(text.data(), text.data() + text.size(), value).ptr == text.data() + text.size();
+}
+
+// Only the IMF-fixdate form; the obsolete RFC 850 and asctime forms are treated as absent
+std::optional<std::chrono::sys_seconds> parse_http_date(std::string_view text) {
+    if (text.size() != HTTP_DATE_LENGTH || text.substr(3, 2) != ", " || text.substr(25) != " GMT") {
+        return std::nullopt;
+    }
+    auto month = std::find_if(std::begin(MONTH_NAMES), std::end(MONTH_NAMES), [&](const char* name) { return text.substr(8, 3) == name; });
+    int day = 0, year = 0, hours = 0, minutes = 0, seconds = 0;
+    if (month == std::end(MONTH_NAMES) || !parse_digits(text.substr(5, 2), day) || !parse_digits(text.substr(12, 4), year) ||
+        !parse_digits(text.substr(17, 2), hours) || !parse_digits(text.substr(20, 2), minutes) || !parse_digits(text.substr(23, 2), seconds)) {
+        return std::nullopt;
+    }
+    std::chrono::year_month_day date{std::chrono::year(year), std::chrono::month(static_cast<unsigned>(month - std::begin(MONTH_NAMES) + 1)),
+                                     std::chrono::day(static_cast<unsigned>(day))};
+    if (!date.ok() || hours > 23 || minutes > 59 || seconds > 60) {
+        return std::nullopt;
+    }
+    return std::chrono::sys_days(date) + std::chrono::hours(hours) + std::chrono::minutes(minutes) + std::chrono::seconds(seconds);
+}
+
+static uint8_t* append(uint8_t* write, std::string_view bytes) {
+    return std::copy(bytes.begin(), bytes.end(), write);
+}
+
+// Without a length the head ends the message, the body follows in stream frames
+static void write_message(Status_Code status_code, const Header_Block* header_block, const Headers* headers,
+                          std::span<const std::span<const uint8_t>> body, bool with_length, std::vector<uint8_t>& out) {
+    with_length = with_length && status_has_body(status_code);
+    bool has_date = (headers && headers->contains(HEADER_DATE)) || (header_block && (header_block->id_mask & id_bit(HEADER_DATE)));
+    std::string_view date = has_date ? std::string_view{} : date_header_line();
+
+    char status_buffer[48] = "HTTP/2.5 ";
+    std::string_view status = status_line(status_code);
+    if (status.empty()) {
+        char* end = std::to_chars(status_buffer + 9, status_buffer + 20, static_cast<int>(status_code)).ptr;
+        std::memcpy(end, " Unknown Status\r\n", 17);
+        status = std::string_view(status_buffer, end + 17 - status_buffer);
+    }
+
+    size_t body_size = 0;
+    for (const auto& segment : body) {
+        body_size += segment.size();
+    }
+    char length_digits[24];
+    std::string_view content_length(length_digits, std::to_chars(length_digits, length_digits + sizeof(length_digits), body_size).ptr - length_digits);
+
+    constexpr std::string_view CONTENT_LENGTH_PREFIX = "Content-Length: ";
+    size_t length_line = with_length ? CONTENT_LENGTH_PREFIX.size() + content_length.size() + SEPERATOR.size() : 0;
+    size_t total = status.size() + date.size() + length_line + (header_block ? header_block->bytes.size() : 0) + SEPERATOR.size() + body_size;
+    if (headers) {
+        for (size_t i{}; i < headers->size(); i++) {
+            Header_View field = (*headers)[i];
+            if (!skip_response_header(header_block, headers->id_at(i), field.name)) {
+                total += field.name.size() + 2 + field.value.size() + 2;
+            }
+        }
+    }
+
+    size_t start = out.size();
+    out.resize(start + total);
+    uint8_t* write = out.data() + start;
+    write = append(write, status);
+    write = append(write, date);
+    if (with_length) {
+        write = append(write, CONTENT_LENGTH_PREFIX);
+        write = append(write, content_length);
+        write = append(write, SEPERATOR);
+    }
+    if (header_block) {
+        write = append(write, header_block->bytes);
+    }
+    if (headers) {
+        for (size_t i{}; i < headers->size(); i++) {
+            Header_View field = (*headers)[i];
+            if (!skip_response_header(header_block, headers->id_at(i), field.name)) {
+                write = append(write, field.name);
+                write = append(write, ": ");
+                write = append(write, field.value);
+                write = append(write, SEPERATOR);
+            }
+        }
+    }
+    write = append(write, SEPERATOR);
+    for (const auto& segment : body) {
+        write = std::copy(segment.begin(), segment.end(), write);
+    }
+}
+
+void write_response(Status_Code status_code, const Header_Block* header_block, const Headers* headers,
+                    std::span<const std::span<const uint8_t>> body, std::vector<uint8_t>& out) {
+    write_message(status_code, header_block, headers, body, true, out);
+}
+
+void write_response_head(Status_Code status_code, const Header_Block* header_block, const Headers* headers, std::vector<uint8_t>& out) {
+    write_message(status_code, header_block, headers, {}, false, out);
+}
+
+void write_response(const Response& response, const Header_Block* header_block, std::vector<uint8_t>& out) {
+    std::span<const uint8_t> body_segments[] = {response_body(response)};
+    write_response(response.response_line.status_code, header_block, &response.headers, body_segments, out);
+}
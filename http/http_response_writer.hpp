@@ -0,0 +1,39 @@
+#ifndef HTTP_RESPONSE_WRITER_HPP
+#define HTTP_RESPONSE_WRITER_HPP
+
+#include "http_response.hpp"
+#include "http_headers.hpp"
+#include <stdint.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <optional>
+
+// Headers encoded once, e.g. per route, and copied verbatim into every response
+struct Header_Block {
+    std::string bytes;
+    uint32_t id_mask; // Bit per interned Header_Id present in bytes
+    std::vector<std::string> other_names; // Fields in bytes without a Header_Id
+};
+
+Header_Block make_header_block(const Headers& headers);
+// Per-response headers that are left out: Content-Length, which comes from the body, and any field
+// the block sets too, matched by id or, for HEADER_OTHER, by case-insensitive name
+bool skip_response_header(const Header_Block* header_block, Header_Id id, std::string_view name);
+std::string_view date_header_line(); // "Date: <IMF-fixdate>\r\n", re-rendered at most once per second per thread
+std::string format_http_date(std::chrono::sys_seconds time_point); // IMF-fixdate, as Last-Modified carries it
+std::optional<std::chrono::sys_seconds> parse_http_date(std::string_view text);
+
+// Append a complete response to out, which is only grown, so a reused buffer allocates nothing.
+// The status line comes from the status code, Content-Length from the body (left out for 1xx, 204
+// and 304) and Date from the cache; header block fields win over same-named response headers. The body is gathered from any
+// number of segments.
+void write_response(Status_Code status_code, const Header_Block* header_block, const Headers* headers,
+                    std::span<const std::span<const uint8_t>> body, std::vector<uint8_t>& out);
+void write_response(const Response& response, const Header_Block* header_block, std::vector<uint8_t>& out);
+// Status line and headers of a response whose body is streamed, without Content-Length
+void write_response_head(Status_Code status_code, const Header_Block* header_block, const Headers* headers, std::vector<uint8_t>& out);
+
+#endif
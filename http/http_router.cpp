@@ -0,0 +1,224 @@
+#include "http_router.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+struct Router::Node {
+    std::string prefix;
+    std::vector<std::unique_ptr<Node>> children; // Static text, no two share a first byte
+    std::unique_ptr<Node> param_child;
+    std::unique_ptr<Node> wildcard_child;
+    std::array<const Route*, METHOD_COUNT> handlers{};
+    bool has_handlers = false;
+};
+
+Http_Method http_method(std::string_view method) {
+    static constexpr std::pair<std::string_view, Http_Method> METHODS[] = {
+        {"GET", METHOD_GET},
+        {"HEAD", METHOD_HEAD},
+        {"POST", METHOD_POST},
+        {"PUT", METHOD_PUT},
+        {"DELETE", METHOD_DELETE},
+        {"PATCH", METHOD_PATCH},
+        {"OPTIONS", METHOD_OPTIONS}
+    };
+    for (const auto& [name, value] : METHODS) {
+        if (name == method) {
+            return value;
+        }
+    }
+    return METHOD_OTHER;
+}
+
+std::string_view method_name(Http_Method method) {
+    static constexpr std::string_view NAMES[METHOD_COUNT] = {"GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS", "OTHER", "ANY"};
+    return NAMES[method];
+}
+
+Route_Params::Route_Params() : params{}, count(0) {}
+
+std::optional<std::string_view> Route_Params::get(std::string_view name) const {
+    for (size_t i{}; i < count; i++) {
+        if (params[i].name == name) {
+            return params[i].value;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view Route_Params::operator[](std::string_view name) const {
+    return get(name).value_or(std::string_view{});
+}
+
+size_t Route_Params::size() const {
+    return count;
+}
+
+const Route_Param* Route_Params::begin() const {
+    return params.data();
+}
+
+const Route_Param* Route_Params::end() const {
+    return params.data() + count;
+}
+
+Router::Router() : root(std::make_unique<Node>()) {}
+
+Router::~Router() = default;
+
+Router::Node* Router::insert_static(Node* node, std::string_view text) {
+    while (!text.empty()) {
+        auto child = std::find_if(node->children.begin(), node->children.end(), [&](const std::unique_ptr<Node>& c) {
+            return c->prefix[0] == text[0];
+        });
+        if (child == node->children.end()) {
+            node->children.push_back(std::make_unique<Node>());
+            node->children.back()->prefix = std::string(text);
+            return node->children.back().get();
+        }
+
+        std::string_view prefix = (*child)->prefix;
+        size_t common = std::mismatch(prefix.begin(), prefix.end(), text.begin(), text.end()).first - prefix.begin();
+        if (common < prefix.size()) {
+            // Split the child so the shared part becomes its own node
+            auto shared = std::make_unique<Node>();
+            shared->prefix = std::string(prefix.substr(0, common));
+            (*child)->prefix.erase(0, common);
+            shared->children.push_back(std::move(*child));
+            *child = std::move(shared);
+        }
+        node = child->get();
+        text.remove_prefix(common);
+    }
+    return node;
+}
+
+void Router::add(Http_Method method, std::string_view pattern, Route_Handler handler, const Headers& route_headers, const Compression_Config& compression,
+                 Route_Priority priority) {
+    auto route = std::make_unique<Route>();
+    route->pattern = std::string(pattern);
+    route->method = method;
+    route->handler = std::move(handler);
+    Headers block_headers;
+    for (size_t i{}; i < route_headers.size(); i++) {
+        Header_Id id = route_headers.id_at(i);
+        (id == HEADER_VARY || id == HEADER_CACHE_CONTROL ? route->cache_headers : block_headers).add(route_headers[i].name, route_headers[i].value);
+    }
+    route->header_block = make_header_block(block_headers);
+    route->compression = compression;
+    route->priority = priority;
+    insert(std::move(route));
+}
+
+void Router::add(Http_Method method, std::string_view pattern, Stream_Handler handler, const Headers& route_headers) {
+    auto route = std::make_unique<Route>();
+    route->pattern = std::string(pattern);
+    route->method = method;
+    route->stream_handler = std::move(handler);
+    route->header_block = make_header_block(route_headers);
+    insert(std::move(route));
+}
+
+void Router::insert(std::unique_ptr<Route> route) {
+    std::string_view pattern = route->pattern;
+    if (pattern.empty() || pattern[0] != '/') {
+        throw std::invalid_argument("route pattern must start with '/': " + std::string(pattern));
+    }
+
+    Node* node = root.get();
+    size_t pos = 0;
+    while (pos < pattern.size()) {
+        char marker = pattern[pos];
+        if (marker != ':' && marker != '*') {
+            size_t next = pattern.find_first_of(":*", pos);
+            if (next == std::string_view::npos) {
+                next = pattern.size();
+            }
+            node = insert_static(node, pattern.substr(pos, next - pos));
+            pos = next;
+            continue;
+        }
+
+        size_t name_end = marker == '*' ? pattern.size() : std::min(pattern.find('/', pos), pattern.size());
+        std::string name(pattern.substr(pos + 1, name_end - pos - 1));
+        if (name.empty() || (pos > 0 && pattern[pos - 1] != '/')) {
+            throw std::invalid_argument("route parameter must be a whole named segment: " + std::string(pattern));
+        }
+        if (route->params.size() == MAX_ROUTE_PARAMS) {
+            throw std::invalid_argument("too many route parameters: " + std::string(pattern));
+        }
+        route->params.push_back(name);
+
+        std::unique_ptr<Node>& child = marker == '*' ? node->wildcard_child : node->param_child;
+        if (!child) {
+            child = std::make_unique<Node>();
+        }
+        node = child.get();
+        pos = name_end;
+    }
+
+    if (node->handlers[route->method]) {
+        throw std::invalid_argument("route already registered: " + std::string(pattern));
+    }
+    node->handlers[route->method] = route.get();
+    node->has_handlers = true;
+    route->id = routes.size();
+    routes.push_back(std::move(route));
+}
+
+const Router::Node* Router::find_node(const Node* node, std::string_view path, Route_Params& params) {
+    if (path.empty() && node->has_handlers) {
+        return node;
+    }
+
+    if (!path.empty()) {
+        for (const auto& child : node->children) {
+            if (child->prefix[0] == path[0] && path.starts_with(child->prefix)) {
+                if (const Node* found = find_node(child.get(), path.substr(child->prefix.size()), params)) {
+                    return found;
+                }
+                break;
+            }
+        }
+
+        size_t segment_end = std::min(path.find('/'), path.size());
+        if (node->param_child && segment_end > 0 && params.count < MAX_ROUTE_PARAMS) {
+            params.params[params.count++].value = path.substr(0, segment_end);
+            if (const Node* found = find_node(node->param_child.get(), path.substr(segment_end), params)) {
+                return found;
+            }
+            params.count--;
+        }
+    }
+
+    if (node->wildcard_child && node->wildcard_child->has_handlers && params.count < MAX_ROUTE_PARAMS) {
+        params.params[params.count++].value = path;
+        return node->wildcard_child.get();
+    }
+    return nullptr;
+}
+
+std::optional<Route_Match> Router::match(Http_Method method, std::string_view uri) const {
+    std::string_view path = uri.substr(0, std::min(uri.find('?'), uri.size()));
+
+    Route_Match result{nullptr, Route_Params()};
+    const Node* node = find_node(root.get(), path, result.params);
+    if (!node) {
+        return std::nullopt;
+    }
+
+    result.route = node->handlers[method] ? node->handlers[method] : node->handlers[METHOD_ANY];
+    if (result.route) {
+        for (size_t i{}; i < result.params.count; i++) {
+            result.params.params[i].name = result.route->params[i];
+        }
+    }
+    return result;
+}
+
+size_t Router::size() const {
+    return routes.size();
+}
+
+const Route& Router::route(size_t id) const {
+    return *routes.at(id);
+}
@@ -0,0 +1,110 @@
+#ifndef HTTP_ROUTER_HPP
+#define HTTP_ROUTER_HPP
+
+#include "http_request.hpp"
+#include "http_response.hpp"
+#include "http_response_writer.hpp"
+#include "http_compression.hpp"
+#include "http_admission.hpp"
+#include "http_stream.hpp"
+#include <stddef.h>
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <functional>
+
+constexpr size_t MAX_ROUTE_PARAMS = 8;
+
+enum Http_Method {
+    METHOD_GET,
+    METHOD_HEAD,
+    METHOD_POST,
+    METHOD_PUT,
+    METHOD_DELETE,
+    METHOD_PATCH,
+    METHOD_OPTIONS,
+    METHOD_OTHER, // Anything else a client sends, only METHOD_ANY routes accept it
+    METHOD_ANY, // Registration only: the route answers every method without its own handler
+    METHOD_COUNT
+};
+
+Http_Method http_method(std::string_view method);
+std::string_view method_name(Http_Method method); // "OTHER" and "ANY" for the pseudo-methods
+
+struct Route_Param {
+    std::string_view name;
+    std::string_view value; // Points into the request URI
+};
+
+class Route_Params {
+    public:
+        Route_Params();
+
+        std::optional<std::string_view> get(std::string_view name) const;
+        std::string_view operator[](std::string_view name) const; // Empty when missing
+        size_t size() const;
+        const Route_Param* begin() const;
+        const Route_Param* end() const;
+
+    private:
+        friend class Router;
+
+        std::array<Route_Param, MAX_ROUTE_PARAMS> params;
+        size_t count;
+};
+
+using Route_Handler = std::function<Response(const Request&, const Route_Params&)>;
+// Reads the request body as it arrives and writes the response body as it is produced, on a worker
+using Stream_Handler = std::function<void(const Request&, const Route_Params&, Body_Reader&, Body_Writer&)>;
+
+struct Route {
+    std::string pattern;
+    Http_Method method;
+    std::vector<std::string> params; // Parameter names in pattern order
+    Route_Handler handler;
+    Stream_Handler stream_handler; // Set instead of handler on streaming routes
+    Header_Block header_block; // Pre-encoded headers added to every response of this route
+    // Vary and Cache-Control of a plain route's headers, kept out of header_block and set on each
+    // response instead, so compression and the response cache see what goes out
+    Headers cache_headers;
+    Compression_Config compression;
+    Route_Priority priority = PRIORITY_NORMAL;
+    size_t id = 0; // Registration order, from 0
+};
+
+struct Route_Match {
+    const Route* route; // nullptr when the path exists but not for this method
+    Route_Params params;
+};
+
+// Radix tree over route patterns. Static text is compressed into shared prefixes, ":name" captures
+// one non-empty segment and a trailing "*name" captures the rest of the path. Static text wins over
+// a capture, a capture over a wildcard, and matching backtracks when a branch dead-ends, so lookup
+// cost follows the path length rather than the number of routes.
+class Router {
+    public:
+        Router();
+        ~Router();
+
+        void add(Http_Method method, std::string_view pattern, Route_Handler handler, const Headers& route_headers,
+                 const Compression_Config& compression = Compression_Config(), Route_Priority priority = PRIORITY_NORMAL); // Throws std::invalid_argument
+        void add(Http_Method method, std::string_view pattern, Stream_Handler handler, const Headers& route_headers);
+        std::optional<Route_Match> match(Http_Method method, std::string_view uri) const; // Query string is ignored
+        size_t size() const;
+        const Route& route(size_t id) const;
+
+    private:
+        struct Node;
+
+        std::unique_ptr<Node> root;
+        std::vector<std::unique_ptr<Route>> routes;
+
+        void insert(std::unique_ptr<Route> route);
+        static Node* insert_static(Node* node, std::string_view text);
+        static const Node* find_node(const Node* node, std::string_view path, Route_Params& params);
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include "http_scan.hpp"
+#include <stdint.h>
+#include <array>
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SCAN_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// The AVX2 kernels are compiled per function, so the rest of the build needs no -mavx2
+#if defined(SCAN_HAS_SSE2) && defined(__GNUC__)
+#define SCAN_HAS_AVX2 1
+#define SCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+static constexpr bool is_tchar(unsigned char ch) {
+    switch (ch) {
+        case '!': case '#': case '$': case '%': case '&': case '\'': case '*':
+        case '+': case '-': case '.': case '^': case '_': case '`': case '|':
+        case '~':
+            return true;
+        default:
+            return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+    }
+}
+
+static constexpr std::array<bool, 256> TOKEN_TABLE = [] {
+    std::array<bool, 256> table{};
+    for (size_t i{}; i < table.size(); i++) {
+        table[i] = is_tchar(static_cast<unsigned char>(i));
+    }
+    return table;
+}();
+
+// memchr beats the SSE2 and AVX2 searches on every input we measured, short header lines
+// included, so searching stays scalar at every level
+static size_t find_char_scalar(std::string_view data, size_t from, char ch) {
+    return data.find(ch, from);
+}
+
+// Almost every CR in a message starts a CRLF, so the search only looks for CR
+static size_t find_crlf_scalar(std::string_view data, size_t from) {
+    while (true) {
+        size_t cr = find_char_scalar(data, from, '\r');
+        if (cr == std::string_view::npos || cr + 1 == data.size()) {
+            return std::string_view::npos;
+        }
+        if (data[cr + 1] == '\n') {
+            return cr;
+        }
+        from = cr + 1;
+    }
+}
+
+static bool is_token_scalar(std::string_view data) {
+    for (char ch : data) {
+        if (!TOKEN_TABLE[static_cast<unsigned char>(ch)]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void to_lower_scalar(char* data, size_t len) {
+    for (size_t i{}; i < len; i++) {
+        if (data[i] >= 'A' && data[i] <= 'Z') {
+            data[i] = static_cast<char>(data[i] - 'A' + 'a');
+        }
+    }
+}
+
+#ifdef SCAN_HAS_SSE2
+// 'A'..'Z' shifted to the bottom of the signed range, so one signed compare finds them
+static void to_lower_sse2(char* data, size_t len) {
+    const __m128i shift = _mm_set1_epi8(static_cast<char>(0x80 - 'A'));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(-128 + 26));
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    size_t pos = 0;
+    while (pos + 16 <= len) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i upper = _mm_cmplt_epi8(_mm_add_epi8(block, shift), limit);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + pos), _mm_or_si128(block, _mm_and_si128(upper, case_bit)));
+        pos += 16;
+    }
+    to_lower_scalar(data + pos, len - pos);
+}
+#endif
+
+#ifdef SCAN_HAS_AVX2
+// Bit h of TOKEN_NIBBLE_MAP[l] is set when byte 0xhl is a tchar; high nibbles 8-15 never are
+static constexpr std::array<uint8_t, 16> TOKEN_NIBBLE_MAP = [] {
+    std::array<uint8_t, 16> map{};
+    for (size_t high{}; high < 8; high++) {
+        for (size_t low{}; low < 16; low++) {
+            if (TOKEN_TABLE[high << 4 | low]) {
+                map[low] |= static_cast<uint8_t>(1 << high);
+            }
+        }
+    }
+    return map;
+}();
+
+// Looks up the low nibble's allowed high nibbles and the high nibble's bit with two shuffles
+SCAN_TARGET_AVX2 static bool is_token_avx2(std::string_view data) {
+    const char* bytes = data.data();
+    const __m256i low_map = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(TOKEN_NIBBLE_MAP.data())));
+    const __m256i high_bit = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+                                              1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    size_t pos = 0;
+    while (pos + 32 <= data.size()) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + pos));
+        __m256i low = _mm256_and_si256(block, nibble);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+        __m256i allowed = _mm256_and_si256(_mm256_shuffle_epi8(low_map, low), _mm256_shuffle_epi8(high_bit, high));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(allowed, _mm256_setzero_si256())) != 0) {
+            return false;
+        }
+        pos += 32;
+    }
+    return is_token_scalar(data.substr(pos));
+}
+
+SCAN_TARGET_AVX2 static void to_lower_avx2(char* data, size_t len) {
+    const __m256i shift = _mm256_set1_epi8(static_cast<char>(0x80 - 'A'));
+    const __m256i limit = _mm256_set1_epi8(static_cast<char>(-128 + 26));
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    size_t pos = 0;
+    while (pos + 32 <= len) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i upper = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(block, shift));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + pos), _mm256_or_si256(block, _mm256_and_si256(upper, case_bit)));
+        pos += 32;
+    }
+    to_lower_sse2(data + pos, len - pos);
+}
+#endif
+
+struct Scan_Kernels {
+    Scan_Level level;
+    size_t (*find_crlf)(std::string_view, size_t);
+    size_t (*find_char)(std::string_view, size_t, char);
+    bool (*is_token)(std::string_view);
+    void (*to_lower)(char*, size_t);
+};
+
+static const Scan_Kernels SCALAR_KERNELS{SCAN_SCALAR, find_crlf_scalar, find_char_scalar, is_token_scalar, to_lower_scalar};
+#ifdef SCAN_HAS_SSE2
+// SSE2 has no byte shuffle, token validation keeps the table lookup
+static const Scan_Kernels SSE2_KERNELS{SCAN_SSE2, find_crlf_scalar, find_char_scalar, is_token_scalar, to_lower_sse2};
+#endif
+#ifdef SCAN_HAS_AVX2
+static const Scan_Kernels AVX2_KERNELS{SCAN_AVX2, find_crlf_scalar, find_char_scalar, is_token_avx2, to_lower_avx2};
+#endif
+
+static std::atomic<const Scan_Kernels*> active_kernels{nullptr};
+
+static Scan_Level detect_scan_level() {
+#ifdef SCAN_HAS_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SCAN_AVX2;
+    }
+#endif
+#ifdef SCAN_HAS_SSE2
+    return SCAN_SSE2;
+#else
+    return SCAN_SCALAR;
+#endif
+}
+
+static const Scan_Kernels* kernels_for(Scan_Level level) {
+    switch (level) {
+#ifdef SCAN_HAS_AVX2
+        case SCAN_AVX2:
+            return &AVX2_KERNELS;
+#endif
+#ifdef SCAN_HAS_SSE2
+        case SCAN_SSE2:
+            return &SSE2_KERNELS;
+#endif
+        default:
+            return &SCALAR_KERNELS;
+    }
+}
+
+static const Scan_Kernels* kernels() {
+    const Scan_Kernels* current = active_kernels.load(std::memory_order_acquire);
+    if (!current) {
+        current = kernels_for(scan_supported_level());
+        active_kernels.store(current, std::memory_order_release);
+    }
+    return current;
+}
+
+Scan_Level scan_supported_level() {
+    static const Scan_Level supported = detect_scan_level();
+    return supported;
+}
+
+Scan_Level scan_level() {
+    return kernels()->level;
+}
+
+Scan_Level scan_set_level(Scan_Level level) {
+    const Scan_Kernels* selected = kernels_for(level > scan_supported_level() ? scan_supported_level() : level);
+    active_kernels.store(selected, std::memory_order_release);
+    return selected->level;
+}
+
+size_t scan_find_crlf(std::string_view data, size_t from) {
+    return kernels()->find_crlf(data, from);
+}
+
+size_t scan_find_char(std::string_view data, size_t from, char ch) {
+    return kernels()->find_char(data, from, ch);
+}
+
+bool scan_is_token(std::string_view data) {
+    return kernels()->is_token(data);
+}
+
+void scan_to_lower(char* data, size_t len) {
+    kernels()->to_lower(data, len);
+}
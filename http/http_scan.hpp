@@ -0,0 +1,25 @@
+#ifndef HTTP_SCAN_HPP
+#define HTTP_SCAN_HPP
+
+#include <stddef.h>
+#include <string_view>
+
+// Byte scanning kernels used by the request and response parsers. The widest implementation
+// the CPU supports is picked on first use; every level returns exactly what the scalar one does.
+// Searches are memchr at every level, only token checks and lowercasing are vectorized.
+enum Scan_Level {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2
+};
+
+Scan_Level scan_level();
+Scan_Level scan_supported_level();
+Scan_Level scan_set_level(Scan_Level level); // Clamped to scan_supported_level(), returns the level in use
+
+size_t scan_find_crlf(std::string_view data, size_t from); // Position of the next "\r\n", npos if none
+size_t scan_find_char(std::string_view data, size_t from, char ch);
+bool scan_is_token(std::string_view data); // Every byte is an RFC 9110 tchar
+void scan_to_lower(char* data, size_t len); // ASCII only, other bytes are left alone
+
+#endif
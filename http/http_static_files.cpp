@@ -0,0 +1,399 @@
+#include "http_static_files.hpp"
+#include "http_response_writer.hpp"
+#include "../sctp_stack/sctp_log.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <filesystem>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+static Log_Rate_Limit watch_limit{10};
+
+struct Static_Files::Mapped_File {
+    std::string path;
+    const uint8_t* data;
+    size_t size;
+    int64_t mtime_ns;
+    std::chrono::sys_seconds modified;
+    std::string etag;
+    std::string last_modified;
+    std::string_view content_type;
+#ifdef _WIN32
+    std::vector<uint8_t> contents; // No mmap here, the file is read once instead
+#endif
+
+    ~Mapped_File() {
+#ifndef _WIN32
+        if (data && size > 0) {
+            munmap(const_cast<uint8_t*>(data), size);
+        }
+#endif
+    }
+};
+
+struct Content_Type {
+    std::string_view extension;
+    std::string_view type;
+};
+
+static constexpr Content_Type CONTENT_TYPES[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "text/javascript; charset=utf-8"},
+    {"mjs", "text/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"ico", "image/x-icon"},
+    {"wasm", "application/wasm"},
+    {"pdf", "application/pdf"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"}
+};
+
+static std::string_view content_type_for(std::string_view path) {
+    size_t dot = path.rfind('.');
+    if (dot == std::string_view::npos || path.find('/', dot) != std::string_view::npos) {
+        return "application/octet-stream";
+    }
+    std::string_view extension = path.substr(dot + 1);
+    for (const auto& entry : CONTENT_TYPES) {
+        if (iequals(entry.extension, extension)) {
+            return entry.type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+// Anything that could step outside the root is refused rather than normalized
+static bool safe_relative_path(std::string_view path) {
+    if (path.find('\0') != std::string_view::npos || path.find('\\') != std::string_view::npos) {
+        return false;
+    }
+    while (!path.empty()) {
+        size_t end = std::min(path.find('/'), path.size());
+        if (path.substr(0, end) == "..") {
+            return false;
+        }
+        path.remove_prefix(std::min(end + 1, path.size()));
+    }
+    return true;
+}
+
+static std::string_view parent_directory(std::string_view path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string_view::npos ? std::string_view(".") : path.substr(0, slash);
+}
+
+static int64_t stat_mtime_ns(const struct stat& info) {
+#if defined(__APPLE__)
+    return static_cast<int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return static_cast<int64_t>(info.st_mtime) * 1000000000;
+#else
+    return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+}
+
+// If-None-Match lists entity tags, weak ones compare equal to our strong tag by value
+static bool etag_matches(std::string_view if_none_match, std::string_view etag) {
+    while (!if_none_match.empty()) {
+        size_t end = std::min(if_none_match.find(','), if_none_match.size());
+        std::string_view candidate = if_none_match.substr(0, end);
+        if_none_match.remove_prefix(std::min(end + 1, if_none_match.size()));
+        while (!candidate.empty() && candidate.front() == ' ') {
+            candidate.remove_prefix(1);
+        }
+        while (!candidate.empty() && candidate.back() == ' ') {
+            candidate.remove_suffix(1);
+        }
+        if (candidate.starts_with("W/")) {
+            candidate.remove_prefix(2);
+        }
+        if (candidate == "*" || candidate == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Static_Files::Static_Files(std::string root, const Static_Files_Config& config)
+    : root(std::move(root)), config(config), mapped_bytes(0), watch_fd(-1), hits(0), misses(0), not_modified(0), invalidations(0), evictions(0) {
+    while (this->root.size() > 1 && this->root.back() == '/') {
+        this->root.pop_back();
+    }
+#ifdef __linux__
+    if (config.watch) {
+        watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watch_fd < 0) {
+            log_event_limited<Log_Level::Warn>(watch_limit, "inotify unavailable, static files re-checked per hit", this->root, {});
+        }
+    }
+#endif
+}
+
+Static_Files::~Static_Files() {
+#ifdef __linux__
+    if (watch_fd >= 0) {
+        close(watch_fd);
+    }
+#endif
+}
+
+Route_Handler Static_Files::handler(std::string_view param_name) {
+    return [this, name = std::string(param_name)](const Request& request, const Route_Params& params) {
+        return serve(request, params[name]);
+    };
+}
+
+std::shared_ptr<const Static_Files::Mapped_File> Static_Files::open_file(const std::string& full_path) {
+    auto file = std::make_shared<Mapped_File>();
+    file->path = full_path;
+    file->data = nullptr;
+    file->size = 0;
+
+#ifdef _WIN32
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(full_path, error)) {
+        return nullptr;
+    }
+    struct stat info;
+    if (stat(full_path.c_str(), &info) != 0) {
+        return nullptr;
+    }
+    std::ifstream in(full_path, std::ios::binary);
+    file->contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    file->data = file->contents.data();
+    file->size = file->contents.size();
+#else
+    int fd = open(full_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+    file->size = static_cast<size_t>(info.st_size);
+    if (file->size > 0) {
+        void* mapping = mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+        file->data = static_cast<const uint8_t*>(mapping);
+    }
+    // The mapping stays valid without the descriptor, so no fd is held per cached file
+    close(fd);
+#endif
+
+    file->mtime_ns = stat_mtime_ns(info);
+    file->modified = std::chrono::sys_seconds(std::chrono::seconds(file->mtime_ns / 1000000000));
+    char etag[48];
+    int length = std::snprintf(etag, sizeof(etag), "\"%llx-%llx\"", static_cast<unsigned long long>(file->size),
+                               static_cast<unsigned long long>(file->mtime_ns));
+    file->etag.assign(etag, length);
+    file->last_modified = format_http_date(file->modified);
+    file->content_type = content_type_for(full_path);
+    return file;
+}
+
+bool Static_Files::still_current(const Mapped_File& file) const {
+    struct stat info;
+    return stat(file.path.c_str(), &info) == 0 && static_cast<size_t>(info.st_size) == file.size && stat_mtime_ns(info) == file.mtime_ns;
+}
+
+void Static_Files::watch_directory(const std::string& full_path) {
+#ifdef __linux__
+    if (watch_fd < 0) {
+        return;
+    }
+    std::string directory(parent_directory(full_path));
+    if (directory_watches.contains(directory)) {
+        return;
+    }
+    int wd = inotify_add_watch(watch_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO |
+                                                            IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF);
+    if (wd < 0) {
+        log_event_limited<Log_Level::Warn>(watch_limit, "inotify watch failed, falling back to re-checking files", directory, {});
+        close(watch_fd);
+        watch_fd = -1;
+        return;
+    }
+    watched_directories[wd] = directory;
+    directory_watches[directory] = wd;
+#endif
+}
+
+void Static_Files::drain_events() {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    while (watch_fd >= 0) {
+        ssize_t length = read(watch_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return;
+        }
+        for (char* at = buffer; at < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(at);
+            at += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost, nothing cached can be trusted
+                invalidations += files.size();
+                for (auto& [path, entry] : files) {
+                    mapped_bytes -= (*entry)->size;
+                }
+                files.clear();
+                lru.clear();
+                continue;
+            }
+            auto directory = watched_directories.find(event->wd);
+            if (directory == watched_directories.end()) {
+                continue;
+            }
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                std::string removed = directory->second;
+                directory_watches.erase(removed);
+                watched_directories.erase(directory);
+                forget_directory(removed);
+            } else if (event->len > 0) {
+                forget(directory->second + "/" + event->name);
+            }
+        }
+    }
+#endif
+}
+
+void Static_Files::forget(const std::string& full_path) {
+    auto entry = files.find(full_path);
+    if (entry == files.end()) {
+        return;
+    }
+    mapped_bytes -= (*entry->second)->size;
+    lru.erase(entry->second);
+    files.erase(entry);
+    invalidations++;
+}
+
+void Static_Files::forget_directory(const std::string& directory) {
+    for (auto entry = files.begin(); entry != files.end();) {
+        if (parent_directory(entry->first) != directory) {
+            ++entry;
+            continue;
+        }
+        mapped_bytes -= (*entry->second)->size;
+        lru.erase(entry->second);
+        entry = files.erase(entry);
+        invalidations++;
+    }
+}
+
+void Static_Files::insert(std::shared_ptr<const Mapped_File> file) {
+    if (file->size > config.max_mapped_bytes) {
+        return; // Served once from its own mapping, never kept
+    }
+    // A concurrent miss may have inserted the same file already
+    auto existing = files.find(file->path);
+    if (existing != files.end()) {
+        mapped_bytes -= (*existing->second)->size;
+        lru.erase(existing->second);
+        files.erase(existing);
+    }
+    while (!lru.empty() && (files.size() >= config.max_files || mapped_bytes + file->size > config.max_mapped_bytes)) {
+        // In-flight responses keep their own reference, the unmap waits for them
+        mapped_bytes -= lru.back()->size;
+        files.erase(lru.back()->path);
+        lru.pop_back();
+        evictions++;
+    }
+    mapped_bytes += file->size;
+    lru.push_front(file);
+    files[file->path] = lru.begin();
+}
+
+Response Static_Files::serve(const Request& request, std::string_view path) {
+    while (!path.empty() && path.front() == '/') {
+        path.remove_prefix(1);
+    }
+    if (!safe_relative_path(path)) {
+        return create_response(Status_Code::NotFound, std::vector<uint8_t>{});
+    }
+    std::string full_path = root + "/" + std::string(path);
+    if (path.empty() || path.back() == '/') {
+        full_path += config.index_file;
+    }
+
+    std::shared_ptr<const Mapped_File> file;
+    std::unique_lock<std::mutex> files_lock(files_mutex);
+    drain_events();
+    auto cached = files.find(full_path);
+    if (cached != files.end() && (watch_fd >= 0 || still_current(**cached->second))) {
+        file = *cached->second;
+        lru.splice(lru.begin(), lru, cached->second);
+        hits++;
+    } else {
+        if (cached != files.end()) {
+            forget(full_path);
+        }
+        // Watched before it is read, so a change right after the read still invalidates it
+        watch_directory(full_path);
+        files_lock.unlock();
+        file = open_file(full_path);
+        files_lock.lock();
+        misses++;
+        if (file) {
+            insert(file);
+        }
+    }
+
+    bool unchanged = false;
+    if (file) {
+        if (auto if_none_match = request.headers.get(HEADER_IF_NONE_MATCH)) {
+            unchanged = etag_matches(*if_none_match, file->etag);
+        } else if (auto if_modified_since = request.headers.get(HEADER_IF_MODIFIED_SINCE)) {
+            auto since = parse_http_date(*if_modified_since);
+            unchanged = since && file->modified <= *since;
+        }
+        not_modified += unchanged ? 1 : 0;
+    }
+    files_lock.unlock();
+
+    if (!file) {
+        return create_response(Status_Code::NotFound, std::vector<uint8_t>{});
+    }
+    Response response;
+    response.response_line = create_response_line(unchanged ? Status_Code::NotModified : Status_Code::OK);
+    response.headers.add(HEADER_ETAG, file->etag);
+    response.headers.add(HEADER_LAST_MODIFIED, file->last_modified);
+    if (!unchanged) {
+        response.headers.add(HEADER_CONTENT_TYPE, file->content_type);
+        response.body_view = std::span<const uint8_t>(file->data, file->size);
+        response.body_owner = file;
+    }
+    return response;
+}
+
+Static_Files_Stats Static_Files::stats() const {
+    std::unique_lock<std::mutex> files_lock(files_mutex);
+    return Static_Files_Stats{hits, misses, not_modified, invalidations, evictions, files.size(), mapped_bytes, watch_fd >= 0};
+}
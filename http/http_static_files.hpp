@@ -0,0 +1,77 @@
+#ifndef HTTP_STATIC_FILES_HPP
+#define HTTP_STATIC_FILES_HPP
+
+#include "http_request.hpp"
+#include "http_response.hpp"
+#include "http_router.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct Static_Files_Config {
+    size_t max_files = 256; // Mappings kept open, least recently used unmapped first
+    size_t max_mapped_bytes = 256 * 1024 * 1024;
+    std::string index_file = "index.html"; // Served for paths ending in '/'
+    bool watch = true; // inotify invalidation on Linux, otherwise every hit re-checks the file's size and mtime
+};
+
+struct Static_Files_Stats {
+    uint64_t hits;
+    uint64_t misses; // Files opened and mapped
+    uint64_t not_modified; // 304s sent
+    uint64_t invalidations; // Cached files dropped because they changed on disk
+    uint64_t evictions;
+    size_t files;
+    size_t mapped_bytes;
+    bool watching; // inotify is active
+};
+
+// Serves files under a root directory from read-only mappings. Responses point into the mapping
+// (Response::body_owner keeps it alive past eviction), so the body is only copied once, into the
+// DATA chunk payload, or into stream frames for files too large for one message. Every file gets a strong ETag from size and mtime plus Last-Modified, and
+// matching If-None-Match / If-Modified-Since requests get a 304 without the body being touched.
+// Update files by writing a new one and renaming it over the old, truncating a mapped file in
+// place faults the readers still sending it.
+class Static_Files {
+    public:
+        explicit Static_Files(std::string root, const Static_Files_Config& config = {});
+        ~Static_Files();
+
+        Response serve(const Request& request, std::string_view path); // path relative to the root
+        // For a "/prefix/*name" route, the Static_Files must outlive the server it is registered on
+        Route_Handler handler(std::string_view param_name = "path");
+        Static_Files_Stats stats() const;
+
+    private:
+        struct Mapped_File;
+
+        std::string root;
+        Static_Files_Config config;
+        mutable std::mutex files_mutex;
+        std::list<std::shared_ptr<const Mapped_File>> lru; // Most recently used first
+        std::unordered_map<std::string, std::list<std::shared_ptr<const Mapped_File>>::iterator> files; // By full path
+        size_t mapped_bytes;
+        int watch_fd; // -1 without inotify
+        std::unordered_map<int, std::string> watched_directories; // By watch descriptor
+        std::unordered_map<std::string, int> directory_watches;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t not_modified;
+        uint64_t invalidations;
+        uint64_t evictions;
+
+        std::shared_ptr<const Mapped_File> open_file(const std::string& full_path);
+        bool still_current(const Mapped_File& file) const;
+        void watch_directory(const std::string& full_path);
+        void drain_events();
+        void forget(const std::string& full_path);
+        void forget_directory(const std::string& directory);
+        void insert(std::shared_ptr<const Mapped_File> file);
+};
+
+#endif
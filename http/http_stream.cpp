@@ -0,0 +1,308 @@
+#include "http_stream.hpp"
+#include <algorithm>
+
+bool is_stream_frame(std::span<const uint8_t> message) {
+    return !message.empty() && message[0] == STREAM_FRAME_MARKER;
+}
+
+std::optional<Stream_Frame> parse_stream_frame(std::span<const uint8_t> message) {
+    if (message.size() < STREAM_FRAME_HEADER_SIZE || message[0] != STREAM_FRAME_MARKER ||
+        message[1] < FRAME_HEAD || message[1] > FRAME_RESET) {
+        return std::nullopt;
+    }
+    Stream_Frame frame{static_cast<Stream_Frame_Type>(message[1]), 0, message.subspan(STREAM_FRAME_HEADER_SIZE), 0};
+    for (size_t i = 2; i < STREAM_FRAME_HEADER_SIZE; i++) {
+        frame.stream_id = (frame.stream_id << 8) | message[i];
+    }
+    if (frame.type == FRAME_CREDIT) {
+        if (frame.payload.size() != 4) {
+            return std::nullopt;
+        }
+        frame.credit = (uint32_t(frame.payload[0]) << 24) | (uint32_t(frame.payload[1]) << 16) | (uint32_t(frame.payload[2]) << 8) | frame.payload[3];
+    }
+    return frame;
+}
+
+void write_stream_frame(Stream_Frame_Type type, uint64_t stream_id, std::span<const uint8_t> payload, std::vector<uint8_t>& out) {
+    size_t start = out.size();
+    out.resize(start + STREAM_FRAME_HEADER_SIZE + payload.size());
+    uint8_t* write = out.data() + start;
+    write[0] = STREAM_FRAME_MARKER;
+    write[1] = type;
+    for (size_t i{}; i < 8; i++) {
+        write[2 + i] = static_cast<uint8_t>(stream_id >> (56 - 8 * i));
+    }
+    std::copy(payload.begin(), payload.end(), write + STREAM_FRAME_HEADER_SIZE);
+}
+
+void write_credit_frame(uint64_t stream_id, uint32_t credit, std::vector<uint8_t>& out) {
+    uint8_t bytes[4] = {static_cast<uint8_t>(credit >> 24), static_cast<uint8_t>(credit >> 16), static_cast<uint8_t>(credit >> 8), static_cast<uint8_t>(credit)};
+    write_stream_frame(FRAME_CREDIT, stream_id, bytes, out);
+}
+
+static std::vector<uint8_t> control_frame(Stream_Frame_Type type, uint64_t stream_id) {
+    std::vector<uint8_t> frame;
+    write_stream_frame(type, stream_id, {}, frame);
+    return frame;
+}
+
+Body_Reader::Body_Reader(uint64_t stream_id, Message_Sender send) : stream_id(stream_id), send(std::move(send)), buffered_bytes(0),
+                                                                   allowed(STREAM_WINDOW), unacknowledged(0), ended(false), cancelled(false) {}
+
+std::optional<std::vector<uint8_t>> Body_Reader::read(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> reader_lock(reader_mutex);
+    if (!reader_condition.wait_for(reader_lock, timeout, [&] { return !chunks.empty() || ended || cancelled; }) || chunks.empty()) {
+        return std::nullopt;
+    }
+    std::vector<uint8_t> chunk = std::move(chunks.front());
+    chunks.pop_front();
+    buffered_bytes -= chunk.size();
+
+    // Credit in half-window steps keeps the sender busy without a frame per chunk
+    uint32_t grant = 0;
+    unacknowledged += static_cast<uint32_t>(chunk.size());
+    if (!ended && !cancelled && unacknowledged >= STREAM_WINDOW / 2) {
+        grant = unacknowledged;
+        allowed += grant;
+        unacknowledged = 0;
+    }
+    reader_lock.unlock();
+
+    if (grant) {
+        std::vector<uint8_t> frame;
+        write_credit_frame(stream_id, grant, frame);
+        send(std::move(frame));
+    }
+    return chunk;
+}
+
+bool Body_Reader::finished() const {
+    std::unique_lock<std::mutex> reader_lock(reader_mutex);
+    return ended && chunks.empty();
+}
+
+bool Body_Reader::was_reset() const {
+    std::unique_lock<std::mutex> reader_lock(reader_mutex);
+    return cancelled;
+}
+
+size_t Body_Reader::buffered() const {
+    std::unique_lock<std::mutex> reader_lock(reader_mutex);
+    return buffered_bytes;
+}
+
+void Body_Reader::reset() {
+    std::unique_lock<std::mutex> reader_lock(reader_mutex);
+    bool notify_sender = !ended && !cancelled;
+    cancelled = true;
+    chunks.clear();
+    buffered_bytes = 0;
+    reader_lock.unlock();
+    reader_condition.notify_all();
+    if (notify_sender) {
+        send(control_frame(FRAME_RESET, stream_id));
+    }
+}
+
+bool Body_Reader::push(std::span<const uint8_t> data) {
+    std::unique_lock<std::mutex> reader_lock(reader_mutex);
+    if (cancelled) {
+        return true; // In flight when the stream was given up
+    }
+    if (ended) {
+        return false;
+    }
+    if (data.size() > allowed) {
+        reader_lock.unlock();
+        reset();
+        return false;
+    }
+    allowed -= static_cast<uint32_t>(data.size());
+    if (!data.empty()) {
+        chunks.emplace_back(data.begin(), data.end());
+        buffered_bytes += data.size();
+    }
+    reader_lock.unlock();
+    reader_condition.notify_all();
+    return true;
+}
+
+void Body_Reader::end() {
+    std::unique_lock<std::mutex> reader_lock(reader_mutex);
+    ended = true;
+    reader_lock.unlock();
+    reader_condition.notify_all();
+}
+
+void Body_Reader::cancel() {
+    std::unique_lock<std::mutex> reader_lock(reader_mutex);
+    cancelled = true;
+    chunks.clear();
+    buffered_bytes = 0;
+    reader_lock.unlock();
+    reader_condition.notify_all();
+}
+
+Body_Writer::Body_Writer(uint64_t stream_id, Message_Sender send) : stream_id(stream_id), send(std::move(send)), available(STREAM_WINDOW),
+                                                                   head_pending(false), header_block(nullptr), finished(false), cancelled(false), pumping(false) {}
+
+void Body_Writer::expect_head(const Header_Block* block) {
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    head_pending = true;
+    header_block = block;
+}
+
+void Body_Writer::send_head(Status_Code status, const Headers& headers) {
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    flush_head(writer_lock, status, headers);
+}
+
+// Frames are sent with the lock released; only the one writing thread sends, so they stay in order
+void Body_Writer::flush_head(std::unique_lock<std::mutex>& writer_lock, Status_Code status, const Headers& headers) {
+    if (!head_pending || cancelled) {
+        return;
+    }
+    head_pending = false;
+    std::vector<uint8_t> head;
+    write_response_head(status, header_block, &headers, head);
+    std::vector<uint8_t> frame;
+    frame.reserve(STREAM_FRAME_HEADER_SIZE + head.size());
+    write_stream_frame(FRAME_HEAD, stream_id, head, frame);
+    writer_lock.unlock();
+    send(std::move(frame));
+    writer_lock.lock();
+}
+
+size_t Body_Writer::send_data(std::span<const uint8_t> data, std::unique_lock<std::mutex>& writer_lock) {
+    flush_head(writer_lock, Status_Code::OK, Headers());
+    size_t sent = 0;
+    while (sent < data.size() && available > 0 && !cancelled && !finished) {
+        size_t n = std::min({data.size() - sent, available, STREAM_FRAME_MAX_PAYLOAD});
+        available -= n;
+        writer_lock.unlock();
+        // Rendered straight into the buffer that becomes the DATA chunk payload
+        std::vector<uint8_t> frame;
+        frame.reserve(STREAM_FRAME_HEADER_SIZE + n);
+        write_stream_frame(FRAME_DATA, stream_id, data.subspan(sent, n), frame);
+        send(std::move(frame));
+        sent += n;
+        writer_lock.lock();
+    }
+    return sent;
+}
+
+bool Body_Writer::write(std::span<const uint8_t> data, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    while (!data.empty()) {
+        if (!writer_condition.wait_until(writer_lock, deadline, [&] { return available > 0 || cancelled || finished; })) {
+            writer_lock.unlock();
+            reset(); // A receiver that stopped reading holds the handler no longer
+            return false;
+        }
+        if (cancelled || finished) {
+            return false;
+        }
+        data = data.subspan(send_data(data, writer_lock));
+    }
+    return true;
+}
+
+size_t Body_Writer::try_write(std::span<const uint8_t> data) {
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    return send_data(data, writer_lock);
+}
+
+void Body_Writer::send_body(std::span<const uint8_t> body, std::shared_ptr<const void> owner) {
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    if (finished || cancelled || queued_owner) {
+        return;
+    }
+    queued = body;
+    queued_owner = std::move(owner);
+    pump(writer_lock);
+}
+
+// Credit arriving while the pumping thread has the lock released is picked up by its loop
+void Body_Writer::pump(std::unique_lock<std::mutex>& writer_lock) {
+    if (pumping || !queued_owner) {
+        return;
+    }
+    pumping = true;
+    queued = queued.subspan(send_data(queued, writer_lock));
+    pumping = false;
+    if (cancelled || finished) {
+        queued = {};
+        queued_owner.reset();
+        return;
+    }
+    if (!queued.empty()) {
+        return;
+    }
+    queued_owner.reset();
+    finished = true;
+    writer_lock.unlock();
+    writer_condition.notify_all();
+    send(control_frame(FRAME_END, stream_id));
+}
+
+// A pumping thread may be copying out of the queued bytes with the lock released, it lets go of
+// them itself once it relocks
+void Body_Writer::release_queued() {
+    if (!pumping) {
+        queued = {};
+        queued_owner.reset();
+    }
+}
+
+void Body_Writer::finish() {
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    flush_head(writer_lock, Status_Code::OK, Headers());
+    if (finished || cancelled) {
+        return;
+    }
+    finished = true;
+    writer_lock.unlock();
+    writer_condition.notify_all();
+    send(control_frame(FRAME_END, stream_id));
+}
+
+void Body_Writer::reset() {
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    if (finished || cancelled) {
+        return;
+    }
+    cancelled = true;
+    release_queued();
+    writer_lock.unlock();
+    writer_condition.notify_all();
+    send(control_frame(FRAME_RESET, stream_id));
+}
+
+size_t Body_Writer::credit() const {
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    return available;
+}
+
+bool Body_Writer::closed() const {
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    return finished || cancelled;
+}
+
+void Body_Writer::add_credit(uint32_t bytes) {
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    available += bytes;
+    pump(writer_lock);
+    if (writer_lock.owns_lock()) {
+        writer_lock.unlock();
+    }
+    writer_condition.notify_all();
+}
+
+void Body_Writer::cancel() {
+    std::unique_lock<std::mutex> writer_lock(writer_mutex);
+    cancelled = true;
+    release_queued();
+    writer_lock.unlock();
+    writer_condition.notify_all();
+}
@@ -0,0 +1,132 @@
+#ifndef HTTP_STREAM_HPP
+#define HTTP_STREAM_HPP
+
+#include "http_headers.hpp"
+#include "http_response.hpp"
+#include "http_response_writer.hpp"
+#include "../sctp_stack/sctp.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+// A streamed body travels as SCTP messages of its own, each a frame: STREAM_FRAME_MARKER, the
+// frame type, the stream id (8 bytes, big-endian) and the payload. No request or status line
+// starts with NUL, so frames and whole messages share an association.
+constexpr uint8_t STREAM_FRAME_MARKER = 0x00;
+constexpr size_t STREAM_FRAME_HEADER_SIZE = 10;
+constexpr size_t STREAM_FRAME_MAX_PAYLOAD = 16 * 1024; // Body bytes per DATA frame, well inside a DATA chunk
+constexpr uint32_t STREAM_WINDOW = 64 * 1024; // Body bytes a sender may have unread at the receiver, per stream
+constexpr std::chrono::milliseconds DEFAULT_BODY_TIMEOUT{30000};
+// Larger bodies of plain requests and responses go out in frames as well, the rest of a message
+// (over 15 KiB) is left for the head
+constexpr size_t MAX_INLINE_BODY = 48 * 1024;
+static_assert(MAX_INLINE_BODY + 15 * 1024 <= SCTP_MAX_MESSAGE_SIZE);
+
+enum Stream_Frame_Type : uint8_t {
+    FRAME_HEAD = 1, // Request or response head, the body follows in DATA frames
+    FRAME_DATA = 2,
+    FRAME_END = 3, // Body complete
+    FRAME_CREDIT = 4, // The receiver read this many more bytes (4 bytes, big-endian), the sender may send as many again
+    FRAME_RESET = 5 // The sender of the frame abandoned the stream and ignores anything more for it
+};
+
+struct Stream_Frame {
+    Stream_Frame_Type type;
+    uint64_t stream_id;
+    std::span<const uint8_t> payload; // Points into the message
+    uint32_t credit; // FRAME_CREDIT only
+};
+
+bool is_stream_frame(std::span<const uint8_t> message);
+std::optional<Stream_Frame> parse_stream_frame(std::span<const uint8_t> message);
+void write_stream_frame(Stream_Frame_Type type, uint64_t stream_id, std::span<const uint8_t> payload, std::vector<uint8_t>& out);
+void write_credit_frame(uint64_t stream_id, uint32_t credit, std::vector<uint8_t>& out);
+
+using Message_Sender = std::function<void(std::vector<uint8_t>&&)>; // Queues one SCTP message on the stream's association
+
+// Receiving end of a streamed body. The receive path pushes DATA payloads and the consumer reads
+// them in order; credit goes back to the sender once half the window has been read, so no more
+// than STREAM_WINDOW bytes are ever buffered, however large the body.
+class Body_Reader {
+    public:
+        Body_Reader(uint64_t stream_id, Message_Sender send);
+
+        // Next chunk in arrival order, nullopt at the end of the body, after a reset or on timeout
+        std::optional<std::vector<uint8_t>> read(std::chrono::milliseconds timeout = DEFAULT_BODY_TIMEOUT);
+        bool finished() const; // END arrived and every chunk was read
+        bool was_reset() const;
+        size_t buffered() const; // Bytes received, not yet read
+        void reset(); // The consumer gives up: RESET to the sender unless the body already ended
+
+        // Receive path
+        bool push(std::span<const uint8_t> data); // False when the sender overran its credit, the stream is then reset
+        void end();
+        void cancel(); // The sender reset the stream
+
+    private:
+        uint64_t stream_id;
+        Message_Sender send;
+        mutable std::mutex reader_mutex;
+        std::condition_variable reader_condition;
+        std::deque<std::vector<uint8_t>> chunks;
+        size_t buffered_bytes;
+        uint32_t allowed; // Bytes the sender may still send without more credit
+        uint32_t unacknowledged; // Read since the last credit went out
+        bool ended;
+        bool cancelled;
+};
+
+// Sending end of a streamed body. Bytes go out in DATA frames of at most STREAM_FRAME_MAX_PAYLOAD
+// while the receiver's credit lasts; write() waits for more once it is used up.
+class Body_Writer {
+    public:
+        Body_Writer(uint64_t stream_id, Message_Sender send);
+
+        // Response bodies only: the status and headers go out in a HEAD frame before the first
+        // DATA frame, a 200 with the route's headers when the handler writes first
+        void expect_head(const Header_Block* header_block); // Set by the server before the handler runs
+        void send_head(Status_Code status, const Headers& headers = Headers());
+
+        bool write(std::span<const uint8_t> data, std::chrono::milliseconds timeout = DEFAULT_BODY_TIMEOUT); // False after a reset or on timeout
+        size_t try_write(std::span<const uint8_t> data); // Never waits, bytes sent within the current credit
+        // Never waits: the whole body then END, as much as the credit allows now and the rest from
+        // add_credit. owner keeps the bytes alive until they went out or the stream was reset.
+        void send_body(std::span<const uint8_t> body, std::shared_ptr<const void> owner);
+        void finish(); // END, once
+        void reset(); // RESET to the receiver, later writes fail
+        size_t credit() const;
+        bool closed() const; // Finished or reset
+
+        // Receive path
+        void add_credit(uint32_t bytes);
+        void cancel(); // The receiver reset the stream
+
+    private:
+        uint64_t stream_id;
+        Message_Sender send;
+        mutable std::mutex writer_mutex;
+        std::condition_variable writer_condition;
+        size_t available; // Credit left
+        bool head_pending;
+        const Header_Block* header_block;
+        bool finished;
+        bool cancelled;
+        std::span<const uint8_t> queued; // Of send_body, not sent yet
+        std::shared_ptr<const void> queued_owner; // Set while a send_body is in progress
+        bool pumping; // A thread is sending queued bytes, the others leave it to that one
+
+        size_t send_data(std::span<const uint8_t> data, std::unique_lock<std::mutex>& writer_lock);
+        void pump(std::unique_lock<std::mutex>& writer_lock);
+        void release_queued();
+        void flush_head(std::unique_lock<std::mutex>& writer_lock, Status_Code status, const Headers& headers);
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "http_worker_pool.hpp"
+#include "../sctp_stack/sctp_log.hpp"
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static thread_local const Worker_Pool* current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+static void pin_thread(std::thread& thread, int cpu) {
+#ifdef _WIN32
+    bool pinned = SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu) != 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    bool pinned = pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) == 0;
+#endif
+    if (!pinned) {
+        log_event<Log_Level::Warn>("worker thread could not be pinned", {}, {{"cpu", static_cast<uint64_t>(cpu)}});
+    }
+}
+
+Worker_Pool::Worker_Pool(const Worker_Pool_Config& config) : next_worker(0), queued(0), max_queued(0), running(true) {
+    size_t threads = config.threads > 0 ? config.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    for (size_t i{}; i < threads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    // Every deque exists before the first worker starts stealing
+    for (size_t i{}; i < threads; i++) {
+        workers[i]->thread = std::thread(&Worker_Pool::worker_loop, this, i);
+        if (!config.cpu_affinity.empty()) {
+            pin_thread(workers[i]->thread, config.cpu_affinity[i % config.cpu_affinity.size()]);
+        }
+    }
+}
+
+Worker_Pool::~Worker_Pool() {
+    stop();
+}
+
+void Worker_Pool::submit(Task task) {
+    size_t index = current_pool == this ? current_worker : next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    Worker& worker = *workers[index];
+
+    // Counted before it is visible, so a worker that takes it never drives queued below zero
+    uint64_t depth = queued.fetch_add(1) + 1;
+    uint64_t high_water = max_queued.load(std::memory_order_relaxed);
+    while (depth > high_water && !max_queued.compare_exchange_weak(high_water, depth, std::memory_order_relaxed)) {}
+
+    std::unique_lock<std::mutex> tasks_lock(worker.tasks_mutex);
+    worker.tasks.push_back(std::move(task));
+    tasks_lock.unlock();
+
+    // Taking the lock orders the increment against a worker that is about to sleep
+    std::unique_lock<std::mutex> idle_lock(idle_mutex);
+    idle_lock.unlock();
+    idle_condition.notify_one();
+}
+
+void Worker_Pool::stop() {
+    std::unique_lock<std::mutex> idle_lock(idle_mutex);
+    running = false;
+    idle_lock.unlock();
+    idle_condition.notify_all();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+size_t Worker_Pool::size() const {
+    return workers.size();
+}
+
+Worker_Pool_Stats Worker_Pool::stats() const {
+    Worker_Pool_Stats result{};
+    result.threads = workers.size();
+    result.queued = queued.load(std::memory_order_relaxed);
+    result.max_queued = max_queued.load(std::memory_order_relaxed);
+    for (const auto& worker : workers) {
+        std::unique_lock<std::mutex> tasks_lock(worker->tasks_mutex);
+        result.queue_depths.push_back(worker->tasks.size());
+        tasks_lock.unlock();
+        result.executed += worker->executed.load(std::memory_order_relaxed);
+        result.stolen += worker->stolen.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+bool Worker_Pool::take_task(size_t index, Task& task) {
+    Worker& own = *workers[index];
+    std::unique_lock<std::mutex> own_lock(own.tasks_mutex);
+    if (!own.tasks.empty()) {
+        task = std::move(own.tasks.front());
+        own.tasks.pop_front();
+        return true;
+    }
+    own_lock.unlock();
+
+    for (size_t offset = 1; offset < workers.size(); offset++) {
+        Worker& victim = *workers[(index + offset) % workers.size()];
+        std::unique_lock<std::mutex> victim_lock(victim.tasks_mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            own.stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Worker_Pool::worker_loop(size_t index) {
+    current_pool = this;
+    current_worker = index;
+    Worker& worker = *workers[index];
+
+    while (true) {
+        Task task;
+        if (take_task(index, task)) {
+            queued.fetch_sub(1);
+            task();
+            worker.executed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> idle_lock(idle_mutex);
+        idle_condition.wait(idle_lock, [&] { return queued.load() > 0 || !running; });
+        if (!running && queued.load() == 0) {
+            return;
+        }
+    }
+}
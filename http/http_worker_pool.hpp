@@ -0,0 +1,66 @@
+#ifndef HTTP_WORKER_POOL_HPP
+#define HTTP_WORKER_POOL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Worker_Pool_Config {
+    size_t threads = 0; // 0 picks std::thread::hardware_concurrency()
+    std::vector<int> cpu_affinity; // Worker i is pinned to cpu_affinity[i % size], empty leaves placement to the OS
+};
+
+struct Worker_Pool_Stats {
+    size_t threads;
+    uint64_t queued; // Tasks waiting right now, across all workers
+    uint64_t max_queued; // High-water mark of queued
+    uint64_t executed;
+    uint64_t stolen; // Tasks a worker took from another worker's deque
+    std::vector<uint64_t> queue_depths; // Per worker
+};
+
+// Fixed set of threads, each with its own task deque. Submissions from outside the pool are
+// spread round-robin, a task submitted from a worker stays on that worker. Owners take from
+// the front of their deque and idle workers steal from the back of the others, so one long
+// task only delays what was queued behind it on the same worker until someone steals it.
+class Worker_Pool {
+    public:
+        using Task = std::function<void()>;
+
+        explicit Worker_Pool(const Worker_Pool_Config& config = {});
+        ~Worker_Pool();
+
+        void submit(Task task);
+        void stop(); // Runs every queued task, then joins the workers
+        size_t size() const;
+        Worker_Pool_Stats stats() const;
+
+    private:
+        struct Worker {
+            std::deque<Task> tasks;
+            mutable std::mutex tasks_mutex;
+            std::thread thread;
+            std::atomic<uint64_t> executed{0};
+            std::atomic<uint64_t> stolen{0};
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<size_t> next_worker;
+        std::atomic<uint64_t> queued;
+        std::atomic<uint64_t> max_queued;
+        std::mutex idle_mutex;
+        std::condition_variable idle_condition;
+        bool running;
+
+        void worker_loop(size_t index);
+        bool take_task(size_t index, Task& task);
+};
+
+#endif
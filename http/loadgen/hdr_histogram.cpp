@@ -0,0 +1,112 @@
+#include "hdr_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+static int floor_log2(uint64_t value) {
+    int result = 0;
+    while (value >>= 1) {
+        result++;
+    }
+    return result;
+}
+
+Hdr_Histogram::Hdr_Histogram(uint64_t highest_value, int significant_digits)
+    : highest_trackable(highest_value), total_count(0), max_value(0), min_value(UINT64_MAX) {
+    uint64_t largest_single_unit = 2 * static_cast<uint64_t>(std::pow(10, significant_digits));
+    int sub_bucket_count_magnitude = floor_log2(largest_single_unit - 1) + 1;
+    sub_bucket_half_count_magnitude = std::max(sub_bucket_count_magnitude, 1) - 1;
+    sub_bucket_count = 1ull << (sub_bucket_half_count_magnitude + 1);
+    sub_bucket_half_count = sub_bucket_count / 2;
+    sub_bucket_mask = sub_bucket_count - 1;
+
+    size_t bucket_count = 1;
+    uint64_t smallest_untrackable = sub_bucket_count;
+    while (smallest_untrackable <= highest_value && smallest_untrackable <= UINT64_MAX / 2) {
+        smallest_untrackable <<= 1;
+        bucket_count++;
+    }
+    counts.assign((bucket_count + 1) * sub_bucket_half_count, 0);
+}
+
+int Hdr_Histogram::bucket_index(uint64_t value) const {
+    return floor_log2(value | sub_bucket_mask) - sub_bucket_half_count_magnitude;
+}
+
+size_t Hdr_Histogram::counts_index(uint64_t value) const {
+    int bucket = bucket_index(value);
+    uint64_t sub_bucket = value >> bucket;
+    return ((static_cast<size_t>(bucket) + 1) << sub_bucket_half_count_magnitude) + (sub_bucket - sub_bucket_half_count);
+}
+
+uint64_t Hdr_Histogram::value_at_index(size_t index) const {
+    int bucket = static_cast<int>(index >> sub_bucket_half_count_magnitude) - 1;
+    uint64_t sub_bucket = (index & (sub_bucket_half_count - 1)) + sub_bucket_half_count;
+    if (bucket < 0) {
+        sub_bucket -= sub_bucket_half_count;
+        bucket = 0;
+    }
+    return sub_bucket << bucket;
+}
+
+uint64_t Hdr_Histogram::highest_equivalent_value(uint64_t value) const {
+    int bucket = bucket_index(value);
+    uint64_t sub_bucket = value >> bucket;
+    int adjusted_bucket = sub_bucket >= sub_bucket_count ? bucket + 1 : bucket;
+    uint64_t lowest = sub_bucket << bucket;
+    return lowest + (1ull << adjusted_bucket) - 1;
+}
+
+void Hdr_Histogram::record(uint64_t value) {
+    value = std::min(value, highest_trackable);
+    counts[counts_index(value)]++;
+    total_count++;
+    max_value = std::max(max_value, value);
+    min_value = std::min(min_value, value);
+}
+
+void Hdr_Histogram::merge(const Hdr_Histogram& other) {
+    if (other.counts.size() == counts.size()) {
+        for (size_t i{}; i < counts.size(); i++) {
+            counts[i] += other.counts[i];
+        }
+    } else {
+        for (size_t i{}; i < other.counts.size(); i++) {
+            if (other.counts[i] > 0) {
+                uint64_t value = std::min(other.value_at_index(i), highest_trackable);
+                counts[counts_index(value)] += other.counts[i];
+            }
+        }
+    }
+    total_count += other.total_count;
+    max_value = std::max(max_value, other.max_value);
+    min_value = std::min(min_value, other.min_value);
+}
+
+uint64_t Hdr_Histogram::value_at_percentile(double percentile) const {
+    if (total_count == 0) {
+        return 0;
+    }
+    double fraction = std::min(percentile, 100.0) / 100.0;
+    uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * total_count)), 1);
+
+    uint64_t running = 0;
+    for (size_t i{}; i < counts.size(); i++) {
+        running += counts[i];
+        if (running >= target) {
+            return std::min(highest_equivalent_value(value_at_index(i)), max_value);
+        }
+    }
+    return max_value;
+}
+
+uint64_t Hdr_Histogram::count() const {
+    return total_count;
+}
+
+uint64_t Hdr_Histogram::max() const {
+    return max_value;
+}
+
+uint64_t Hdr_Histogram::min() const {
+    return total_count == 0 ? 0 : min_value;
+}
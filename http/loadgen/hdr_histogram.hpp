@@ -0,0 +1,38 @@
+#ifndef HDR_HISTOGRAM_HPP
+#define HDR_HISTOGRAM_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// High dynamic range histogram (same bucketing as HdrHistogram): values up to highest_value
+// are recorded with significant_digits of precision in O(1), whatever their magnitude.
+class Hdr_Histogram {
+    public:
+        Hdr_Histogram(uint64_t highest_value, int significant_digits);
+
+        void record(uint64_t value);
+        void merge(const Hdr_Histogram& other);
+        uint64_t value_at_percentile(double percentile) const;
+        uint64_t count() const;
+        uint64_t max() const;
+        uint64_t min() const;
+
+    private:
+        uint64_t highest_trackable;
+        int sub_bucket_half_count_magnitude;
+        uint64_t sub_bucket_count;
+        uint64_t sub_bucket_half_count;
+        uint64_t sub_bucket_mask;
+        std::vector<uint64_t> counts;
+        uint64_t total_count;
+        uint64_t max_value;
+        uint64_t min_value;
+
+        int bucket_index(uint64_t value) const;
+        size_t counts_index(uint64_t value) const;
+        uint64_t value_at_index(size_t index) const;
+        uint64_t highest_equivalent_value(uint64_t value) const;
+};
+
+#endif
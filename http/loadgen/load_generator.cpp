@@ -0,0 +1,249 @@
+#include "load_generator.hpp"
+#include "../client.hpp"
+#include <algorithm>
+#include <thread>
+#include <memory>
+#include <random>
+#include <deque>
+#include <iomanip>
+
+struct Outstanding_Request {
+    uint64_t stream_id;
+    size_t route;
+    std::chrono::steady_clock::time_point intended_start;
+    std::chrono::steady_clock::time_point sent;
+};
+
+struct Load_Connection {
+    std::unique_ptr<Client> client;
+    bool connected = false;
+    std::vector<Outstanding_Request> outstanding; // Matched to responses by stream id, in any order
+};
+
+struct Pending_Arrival {
+    size_t route;
+    std::chrono::steady_clock::time_point intended_start;
+};
+
+struct Worker_Result {
+    std::vector<Route_Result> routes;
+    size_t connected = 0;
+};
+
+void Route_Result::merge(const Route_Result& other) {
+    latency_us.merge(other.latency_us);
+    completed += other.completed;
+    errors += other.errors;
+    timeouts += other.timeouts;
+    unsent += other.unsent;
+}
+
+static std::vector<Route_Result> make_route_results(const std::vector<Mix_Entry>& mix) {
+    std::vector<Route_Result> routes(mix.size());
+    for (size_t i{}; i < mix.size(); i++) {
+        routes[i].name = mix[i].method + " " + mix[i].uri;
+    }
+    return routes;
+}
+
+// Every connection of a worker runs in EVENT_LOOP_MANUAL mode and is polled from the worker
+// thread, so the number of associations is not tied to the number of threads. A request that
+// times out is cancelled and its stream forgotten, so the connection keeps carrying load.
+static void run_worker(const Load_Config& config, const std::vector<Mix_Entry>& mix, size_t first_connection,
+                       size_t connection_count, std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point end, Worker_Result& result) {
+    using clock = std::chrono::steady_clock;
+    result.routes = make_route_results(mix);
+
+    std::vector<Load_Connection> connections(connection_count);
+    std::vector<Request> requests;
+    for (size_t i{}; i < connection_count; i++) {
+        int local_port = config.local_port_base + static_cast<int>(first_connection + i);
+        connections[i].client = std::make_unique<Client>(config.local_ip, local_port);
+        connections[i].client->start(EVENT_LOOP_MANUAL);
+        connections[i].client->begin_connect(config.server_ip, config.server_port);
+        if (i == 0) {
+            for (const auto& entry : mix) {
+                requests.push_back(connections[i].client->build_request(entry.method, entry.uri, entry.body));
+            }
+        }
+    }
+
+    auto connect_deadline = clock::now() + std::chrono::seconds(5);
+    size_t connected = 0;
+    while (connected < connection_count && clock::now() < connect_deadline) {
+        for (auto& connection : connections) {
+            connection.client->poll();
+            if (!connection.connected && connection.client->poll_connected()) {
+                connection.connected = true;
+                connected++;
+            }
+        }
+    }
+    result.connected = connected;
+    std::this_thread::sleep_until(start);
+
+    std::mt19937_64 rng(config.seed + first_connection);
+    std::vector<uint32_t> weights;
+    for (const auto& entry : mix) {
+        weights.push_back(entry.weight);
+    }
+    std::discrete_distribution<size_t> pick_route(weights.begin(), weights.end());
+
+    bool open_loop = config.arrivals != ARRIVALS_CLOSED_LOOP && config.rate > 0.0;
+    double worker_rate = config.rate * connection_count / std::max<size_t>(config.connections, 1);
+    std::exponential_distribution<double> poisson_gap(std::max(worker_rate, 1e-9));
+    auto constant_gap = std::chrono::duration<double>(1.0 / std::max(worker_rate, 1e-9));
+    clock::time_point next_arrival = start;
+    std::deque<Pending_Arrival> backlog;
+
+    while (true) {
+        clock::time_point now = clock::now();
+        bool accepting = now < end;
+
+        if (open_loop && accepting) {
+            while (next_arrival <= now) {
+                backlog.push_back(Pending_Arrival{pick_route(rng), next_arrival});
+                auto gap = config.arrivals == ARRIVALS_POISSON ? std::chrono::duration<double>(poisson_gap(rng)) : constant_gap;
+                next_arrival += std::chrono::duration_cast<clock::duration>(gap);
+            }
+        }
+
+        bool in_flight = false;
+        bool did_work = false;
+        for (auto& connection : connections) {
+            if (!connection.connected) {
+                continue;
+            }
+            did_work = connection.client->poll() || did_work;
+
+            for (size_t i{}; i < connection.outstanding.size();) {
+                Outstanding_Request& request = connection.outstanding[i];
+                Route_Result& route = result.routes[request.route];
+                if (auto response = connection.client->poll_response(request.stream_id)) {
+                    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - request.intended_start);
+                    route.latency_us.record(static_cast<uint64_t>(latency.count()));
+                    route.completed++;
+                    if (response->response_line.status_code >= 400) {
+                        route.errors++;
+                    }
+                } else if (now - request.sent > config.request_timeout) {
+                    route.timeouts++;
+                    connection.client->cancel(request.stream_id);
+                } else {
+                    i++;
+                    continue;
+                }
+                did_work = true;
+                request = connection.outstanding.back();
+                connection.outstanding.pop_back();
+            }
+
+            while (accepting && connection.outstanding.size() < config.depth) {
+                Outstanding_Request request{0, 0, now, now};
+                if (open_loop) {
+                    if (backlog.empty()) {
+                        break;
+                    }
+                    request.route = backlog.front().route;
+                    request.intended_start = backlog.front().intended_start;
+                    backlog.pop_front();
+                } else {
+                    request.route = pick_route(rng);
+                }
+                request.stream_id = connection.client->begin_request(requests[request.route]);
+                if (request.stream_id == 0) {
+                    if (open_loop) {
+                        backlog.push_front(Pending_Arrival{request.route, request.intended_start});
+                    }
+                    break;
+                }
+                connection.outstanding.push_back(request);
+                did_work = true;
+            }
+            in_flight = in_flight || !connection.outstanding.empty();
+        }
+
+        if (!accepting && !in_flight) {
+            break;
+        }
+        // A spinning worker takes a core from the server it measures. With nothing in flight only
+        // the next arrival can bring work; otherwise a response may come any moment, so just yield.
+        if (!did_work) {
+            if (open_loop && accepting && !in_flight && backlog.empty()) {
+                std::this_thread::sleep_until(std::min(next_arrival, end));
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    for (const auto& arrival : backlog) {
+        result.routes[arrival.route].unsent++;
+    }
+    for (auto& connection : connections) {
+        connection.client->stop();
+    }
+}
+
+Load_Result run_load(const Load_Config& config, const std::vector<Mix_Entry>& mix) {
+    Load_Result result;
+    result.routes = make_route_results(mix);
+
+    size_t threads = std::max<size_t>(std::min(config.threads, config.connections), 1);
+    std::vector<Worker_Result> worker_results(threads);
+    std::vector<std::thread> workers;
+
+    // Connection setup happens before start so handshakes are not part of the measurement
+    auto start = std::chrono::steady_clock::now() + std::chrono::seconds(6);
+    auto end = start + config.duration;
+
+    size_t first_connection = 0;
+    for (size_t i{}; i < threads; i++) {
+        size_t count = config.connections / threads + (i < config.connections % threads ? 1 : 0);
+        workers.emplace_back(run_worker, std::cref(config), std::cref(mix), first_connection, count, start, end, std::ref(worker_results[i]));
+        first_connection += count;
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    result.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const auto& worker_result : worker_results) {
+        result.connected += worker_result.connected;
+        for (size_t i{}; i < mix.size(); i++) {
+            result.routes[i].merge(worker_result.routes[i]);
+        }
+    }
+    return result;
+}
+
+static void print_route(const Route_Result& route, double elapsed_seconds, std::ostream& out) {
+    auto ms = [](uint64_t us) { return us / 1000.0; };
+    out << std::left << std::setw(32) << route.name << std::right << std::fixed << std::setprecision(2)
+        << std::setw(10) << route.completed
+        << std::setw(9) << route.errors
+        << std::setw(9) << route.timeouts
+        << std::setw(9) << route.unsent
+        << std::setw(11) << route.completed / elapsed_seconds
+        << std::setw(10) << ms(route.latency_us.value_at_percentile(50.0))
+        << std::setw(10) << ms(route.latency_us.value_at_percentile(99.0))
+        << std::setw(10) << ms(route.latency_us.value_at_percentile(99.9))
+        << std::setw(10) << ms(route.latency_us.max()) << "\n";
+}
+
+void print_load_result(const Load_Result& result, std::ostream& out) {
+    out << "connections established: " << result.connected << "\n";
+    out << std::left << std::setw(32) << "route" << std::right
+        << std::setw(10) << "requests" << std::setw(9) << "errors" << std::setw(9) << "timeouts"
+        << std::setw(9) << "unsent" << std::setw(11) << "req/s"
+        << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "p99.9 ms" << std::setw(10) << "max ms" << "\n";
+
+    Route_Result total;
+    total.name = "total";
+    for (const auto& route : result.routes) {
+        print_route(route, result.elapsed_seconds, out);
+        total.merge(route);
+    }
+    print_route(total, result.elapsed_seconds, out);
+}
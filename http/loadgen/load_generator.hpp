@@ -0,0 +1,60 @@
+#ifndef LOAD_GENERATOR_HPP
+#define LOAD_GENERATOR_HPP
+
+#include "hdr_histogram.hpp"
+#include "request_mix.hpp"
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+
+// Closed loop sends the next request on a connection as soon as the previous one completes.
+// The open loop modes schedule arrivals independently of completions and measure latency from
+// the scheduled time, so a stalled server shows up in the tail instead of being hidden by
+// coordinated omission.
+enum Arrival_Mode {
+    ARRIVALS_CLOSED_LOOP,
+    ARRIVALS_CONSTANT,
+    ARRIVALS_POISSON
+};
+
+struct Load_Config {
+    std::string server_ip = "127.0.0.1";
+    int server_port = 8080;
+    std::string local_ip = "127.0.0.1";
+    int local_port_base = 20000; // Connection i binds local_port_base + i
+    size_t connections = 16;
+    size_t depth = 1; // Requests in flight per connection
+    size_t threads = 2;
+    std::chrono::seconds duration{10};
+    std::chrono::milliseconds request_timeout{2000};
+    Arrival_Mode arrivals = ARRIVALS_CLOSED_LOOP;
+    double rate = 0.0; // Requests per second across all threads, open loop only
+    uint64_t seed = 1;
+};
+
+constexpr uint64_t LOAD_HIGHEST_LATENCY_US = 60 * 1000 * 1000;
+constexpr int LOAD_LATENCY_DIGITS = 3;
+
+struct Route_Result {
+    std::string name;
+    Hdr_Histogram latency_us{LOAD_HIGHEST_LATENCY_US, LOAD_LATENCY_DIGITS};
+    uint64_t completed = 0;
+    uint64_t errors = 0;   // Responses with a 4xx/5xx status
+    uint64_t timeouts = 0;
+    uint64_t unsent = 0;   // Open loop arrivals still queued when the run ended
+
+    void merge(const Route_Result& other);
+};
+
+struct Load_Result {
+    std::vector<Route_Result> routes;
+    double elapsed_seconds = 0.0;
+    size_t connected = 0;
+};
+
+Load_Result run_load(const Load_Config& config, const std::vector<Mix_Entry>& mix);
+void print_load_result(const Load_Result& result, std::ostream& out);
+
+#endif
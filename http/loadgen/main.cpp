@@ -0,0 +1,80 @@
+#include "load_generator.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+static void print_usage() {
+    std::cout << "Usage: loadgen --mix <file> [--server ip:port] [--local ip:base_port]\n"
+                 "               [--connections n] [--depth n] [--threads n] [--duration seconds] [--timeout-ms ms]\n"
+                 "               [--rate requests_per_second --arrivals constant|poisson] [--seed n]\n";
+}
+
+static bool split_address(const std::string& value, std::string& ip, int& port) {
+    size_t colon = value.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    ip = value.substr(0, colon);
+    port = std::stoi(value.substr(colon + 1));
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Load_Config config;
+    std::string mix_path;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                print_usage();
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--mix") {
+                mix_path = value;
+            } else if (arg == "--server" && split_address(value, config.server_ip, config.server_port)) {
+            } else if (arg == "--local" && split_address(value, config.local_ip, config.local_port_base)) {
+            } else if (arg == "--connections") {
+                config.connections = std::stoul(value);
+            } else if (arg == "--depth") {
+                config.depth = std::max<size_t>(std::stoul(value), 1);
+            } else if (arg == "--threads") {
+                config.threads = std::stoul(value);
+            } else if (arg == "--duration") {
+                config.duration = std::chrono::seconds(std::stoul(value));
+            } else if (arg == "--timeout-ms") {
+                config.request_timeout = std::chrono::milliseconds(std::stoul(value));
+            } else if (arg == "--rate") {
+                config.rate = std::stod(value);
+            } else if (arg == "--arrivals" && (value == "constant" || value == "poisson")) {
+                config.arrivals = value == "constant" ? ARRIVALS_CONSTANT : ARRIVALS_POISSON;
+            } else if (arg == "--seed") {
+                config.seed = std::stoull(value);
+            } else {
+                print_usage();
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        print_usage();
+        return 1;
+    }
+
+    if (mix_path.empty()) {
+        print_usage();
+        return 1;
+    }
+    if (config.rate > 0.0 && config.arrivals == ARRIVALS_CLOSED_LOOP) {
+        config.arrivals = ARRIVALS_CONSTANT;
+    }
+
+    auto mix = load_request_mix(mix_path);
+    if (!mix) {
+        return 1;
+    }
+
+    Load_Result result = run_load(config, *mix);
+    print_load_result(result, std::cout);
+    return 0;
+}
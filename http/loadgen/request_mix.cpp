@@ -0,0 +1,48 @@
+#include "request_mix.hpp"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+std::optional<std::vector<Mix_Entry>> parse_request_mix(const std::string& text) {
+    std::vector<Mix_Entry> mix;
+    std::istringstream lines(text);
+    std::string line;
+    size_t line_number = 0;
+
+    while (std::getline(lines, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        Mix_Entry entry;
+        if (!(fields >> entry.weight >> entry.method >> entry.uri) || entry.weight == 0) {
+            std::cout << "Malformed request mix line " << line_number << ": " << line << "\n";
+            return std::nullopt;
+        }
+        std::getline(fields >> std::ws, entry.body);
+        mix.push_back(entry);
+    }
+
+    if (mix.empty()) {
+        std::cout << "Request mix is empty\n";
+        return std::nullopt;
+    }
+    return mix;
+}
+
+std::optional<std::vector<Mix_Entry>> load_request_mix(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "Cannot open request mix: " << path << "\n";
+        return std::nullopt;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return parse_request_mix(contents.str());
+}
@@ -0,0 +1,20 @@
+#ifndef REQUEST_MIX_HPP
+#define REQUEST_MIX_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <optional>
+
+struct Mix_Entry {
+    uint32_t weight;
+    std::string method;
+    std::string uri;
+    std::string body;
+};
+
+// One request per line: <weight> <METHOD> <uri> [body...], blank lines and '#' comments are skipped
+std::optional<std::vector<Mix_Entry>> parse_request_mix(const std::string& text);
+std::optional<std::vector<Mix_Entry>> load_request_mix(const std::string& path);
+
+#endif
@@ -5,7 +5,7 @@
 
 int main() {
     Server server("127.0.0.1", 8080);
-    server.register_route("/hello", [](const Request& req, const std::unordered_map<std::string, std::string>& params) {
+    server.register_route("/hello", [](const Request& req, const Route_Params& params) {
         std::string body = "Hello, World!";
         return create_response(Status_Code::OK, std::vector<uint8_t>(body.begin(), body.end()));
     });
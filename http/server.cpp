@@ -2,11 +2,41 @@
 #include "../sctp_stack/sctp_socket.hpp"
 #include "http_response.hpp"
 #include "http_parse.hpp"
+#include "http_request_parser.hpp"
+#include "../sctp_stack/sctp_log.hpp"
 #include <string_view>
 #include <stdexcept>
 #include <iostream>
+#include <charconv>
 
-Server::Server(std::string_view ip, int p) : ip_address(ip), port(p), running(false), socket() {
+static Log_Rate_Limit stray_frame_limit{10};
+static Log_Rate_Limit undecodable_request_limit{10};
+static Log_Rate_Limit malformed_binary_limit{10};
+static Log_Rate_Limit unframed_response_limit{10};
+
+constexpr size_t UNMATCHED_SERIES = 0; // Metrics of 404 and 405 answers
+
+// Heads the parser refused for a reason worth telling the client, other malformed requests are dropped
+static std::optional<Status_Code> rejection_status(Parse_Status parsed) {
+    switch (parsed) {
+        case PARSE_HEAD_TOO_LARGE:
+            return Status_Code::RequestHeaderFieldsTooLarge;
+        case PARSE_CONFLICTING_LENGTH:
+            return Status_Code::BadRequest;
+        default:
+            return std::nullopt;
+    }
+}
+
+Server::Server(std::string_view ip, int p) : ip_address(ip), port(p), running(false), socket(), pending_requests(0), compression_cache(std::make_unique<Compression_Cache>()),
+                                                                                       stream_routes(false), max_buffered_body(DEFAULT_MAX_BUFFERED_BODY), compressed_requests(0), wire_format(WIRE_TEXT), binary_requests(0),
+                                                                                       expired_requests(0), cancelled_requests(0), arena_requests(0), arena_overflows(0) {
+    socket.sctp_bind(ip, port);
+}
+
+Server::Server(std::string_view ip, int p, std::unique_ptr<Datagram_Transport> transport) : socket(std::move(transport)), ip_address(ip), port(p), running(false), pending_requests(0), compression_cache(std::make_unique<Compression_Cache>()),
+                                                                                       stream_routes(false), max_buffered_body(DEFAULT_MAX_BUFFERED_BODY), compressed_requests(0), wire_format(WIRE_TEXT), binary_requests(0),
+                                                                                       expired_requests(0), cancelled_requests(0), arena_requests(0), arena_overflows(0) {
     socket.sctp_bind(ip, port);
 }
 
@@ -14,98 +44,886 @@ Server::~Server() {
     stop();
 }
 
-void Server::start() {
-    if (!socket.sctp_run()) {
+void Server::configure_workers(const Worker_Pool_Config& config) {
+    worker_config = config;
+}
+
+void Server::configure_compression_cache(size_t max_bytes) {
+    compression_cache = std::make_unique<Compression_Cache>(max_bytes);
+}
+
+void Server::configure_response_cache(const Response_Cache_Config& config) {
+    response_cache = std::make_unique<Response_Cache>(config);
+}
+
+size_t Server::invalidate_cached(std::string_view uri_prefix) {
+    return response_cache ? response_cache->invalidate_prefix(uri_prefix) : 0;
+}
+
+void Server::configure_buffered_body_limit(size_t max_bytes) {
+    max_buffered_body = max_bytes;
+}
+
+void Server::configure_header_compression(const Header_Compression_Config& config) {
+    header_compression = config;
+}
+
+void Server::configure_wire_format(Wire_Format format) {
+    wire_format = format;
+}
+
+void Server::configure_admission(const Admission_Config& config) {
+    admission = std::make_unique<Concurrency_Limiter>(config);
+    admission_config = config;
+}
+
+void Server::configure_request_arena(const Arena_Config& config) {
+    request_arena = config;
+}
+
+void Server::configure_metrics(const Metrics_Config& config) {
+    request_metrics = std::make_unique<Metrics_Registry>();
+    if (config.path.empty()) {
+        return;
+    }
+    register_route(METHOD_GET, config.path, [this](const Request&, const Route_Params&) {
+        std::string text = render_prometheus(request_metrics->snapshot(), [this](size_t series) {
+            return series == UNMATCHED_SERIES ? std::string("unmatched") : router.route(series - 1).pattern;
+        }, socket.stats());
+        Response response = create_response(Status_Code::OK, std::vector<uint8_t>(text.begin(), text.end()));
+        response.headers.set(HEADER_CONTENT_TYPE, "text/plain; version=0.0.4");
+        return response;
+    });
+}
+
+std::vector<Series_Snapshot> Server::metrics() const {
+    return request_metrics ? request_metrics->snapshot() : std::vector<Series_Snapshot>{};
+}
+
+void Server::start(Event_Loop_Mode mode) {
+    socket.sctp_set_close_hook([this](const Association_Key& key) { forget_association(key); });
+    if (!socket.sctp_run(mode)) {
         socket.sctp_close();
         throw std::runtime_error("Failed to start SCTP socket");
     }
+    // A stream handler waits on its client, it must not hold up poll()
+    if (mode == EVENT_LOOP_THREADED || worker_config || stream_routes) {
+        workers = std::make_unique<Worker_Pool>(worker_config.value_or(Worker_Pool_Config{}));
+    }
     running = true;
-    processor_thread = std::thread(&Server::process_requests, this);
+    if (mode == EVENT_LOOP_THREADED) {
+        processor_thread = std::thread(&Server::process_requests, this);
+    }
+}
+
+bool Server::poll() {
+    // Sampled first: a handler that finishes after the socket poll has queued its response by the
+    // time it stops counting, so that response is still polled on the next call
+    bool handling = pending_requests.load() > 0;
+    bool socket_work = socket.sctp_poll();
+    bool request_work = process_next_request();
+    return socket_work || request_work || handling;
+}
+
+Server_Stats Server::stats() const {
+    Server_Stats result{};
+    result.pending_requests = pending_requests.load(std::memory_order_relaxed);
+    if (workers) {
+        result.workers = workers->stats();
+    }
+    result.compression_cache = compression_cache->stats();
+    if (response_cache) {
+        result.response_cache = response_cache->stats();
+    }
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    result.open_streams = request_streams.size() + response_streams.size();
+    streams_lock.unlock();
+    result.compressed_requests = compressed_requests.load(std::memory_order_relaxed);
+    std::unique_lock<std::mutex> codecs_lock(header_codecs_mutex);
+    result.header_codecs = header_codecs.size();
+    codecs_lock.unlock();
+    result.binary_requests = binary_requests.load(std::memory_order_relaxed);
+    if (admission) {
+        result.admission = admission->stats();
+    }
+    result.expired_requests = expired_requests.load(std::memory_order_relaxed);
+    result.cancelled_requests = cancelled_requests.load(std::memory_order_relaxed);
+    result.arena_requests = arena_requests.load(std::memory_order_relaxed);
+    result.arena_overflows = arena_overflows.load(std::memory_order_relaxed);
+    result.transport = socket.stats();
+    return result;
 }
 
 void Server::process_requests() {
     while(running) {
-        std::vector<uint8_t> recv_buffer(8192);
-        Association_Key key;
-        size_t received = socket.sctp_recv_data(recv_buffer, &key);
-        if (received > 0) {
-            recv_buffer.resize(received);
-            auto request_opt = parse_http_request(recv_buffer);
-            if (!request_opt) {
-                received = 0;
-                recv_buffer.clear();
-                continue; 
+        // Workers need the core more than an idle dispatcher does
+        if (!process_next_request()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool Server::process_next_request() {
+    std::vector<uint8_t> message;
+    Association_Key key;
+    if (!socket.sctp_recv_message(message, &key)) {
+        return false;
+    }
+    if (is_stream_frame(message)) {
+        handle_frame(key, message);
+    } else if (is_header_block_message(message)) {
+        decode_request(key, message);
+    } else {
+        dispatch_request(key, Queued_Request{.message = std::move(message)});
+    }
+    return true;
+}
+
+void Server::dispatch_request(const Association_Key& key, Queued_Request&& request) {
+    // Unless set when a streamed head arrived
+    if (request.received == std::chrono::steady_clock::time_point{}) {
+        request.received = std::chrono::steady_clock::now();
+    }
+    // Shed before queueing: a rejected request costs a 503, not a place in the line. A stream
+    // handler holds its slot for as long as the client sends, so those are not counted.
+    if (admission && !request.body_reader && !admit(key, request)) {
+        return;
+    }
+    if (!workers) {
+        auto started = std::chrono::steady_clock::now();
+        handle_request(key, request);
+        finish_request(request, started);
+        return;
+    }
+
+    // Requests of one association run one at a time and in arrival order, so its responses go
+    // out in order; different associations run in parallel
+    pending_requests.fetch_add(1);
+    std::unique_lock<std::mutex> queues_lock(association_queues_mutex);
+    auto [queue, idle] = association_queues.try_emplace(key);
+    queue->second.push_back(std::move(request));
+    queues_lock.unlock();
+    if (idle) {
+        workers->submit([this, key] { run_association(key); });
+    }
+}
+
+// Runs on the dispatcher. While even sheddable requests fit nothing is parsed; past that the
+// route decides. Requests handle_request would drop anyway are let through uncounted.
+bool Server::admit(const Association_Key& key, Queued_Request& request) {
+    Route_Priority priority = PRIORITY_SHEDDABLE;
+    std::optional<std::string> stream_id;
+    if (!admission->has_room(PRIORITY_SHEDDABLE)) {
+        if (!request.decoded && is_binary_message(request.message) && wire_format == WIRE_BINARY) {
+            request.decoded = decode_binary_request(request.message);
+        }
+        std::optional<Route_Match> route_match;
+        if (request.decoded) {
+            route_match = match_route(request.decoded->request_line.method, request.decoded->request_line.uri);
+            if (auto id = request.decoded->headers.get(HEADER_STREAM_ID)) {
+                stream_id.emplace(*id);
+            }
+        } else if (!is_binary_message(request.message)) {
+            Request_Parser parser;
+            if (parser.parse(std::string_view(reinterpret_cast<const char*>(request.message.data()), request.message.size())) != PARSE_COMPLETE) {
+                return true;
             }
-            Request request = *request_opt;
-
-            auto route_match = match_route(request.request_line.uri);
-            Response response;
-            if (route_match) {
-                Route* route = route_match->first;
-                auto& params = route_match->second;
-                response = route->handler(request, params);
-            } else {
-                response = create_response(Status_Code::NotFound, std::vector<uint8_t>{});
+            route_match = match_route(parser.view().method, parser.view().uri);
+            if (auto id = parser.view().headers.get(HEADER_STREAM_ID)) {
+                stream_id.emplace(*id);
             }
+        } else {
+            return true;
+        }
+        priority = route_match && route_match->route ? route_match->route->priority : PRIORITY_NORMAL;
+    }
+
+    if (admission->try_acquire(priority)) {
+        request.admitted = std::chrono::steady_clock::now();
+        return true;
+    }
+    if (request.stream_id) {
+        stream_id = std::to_string(*request.stream_id);
+    }
+    Response response = create_response(Status_Code::ServiceUnavailable, std::vector<uint8_t>{});
+    response.headers.set(HEADER_RETRY_AFTER, std::to_string(admission_config.retry_after_seconds));
+    if (stream_id) {
+        response.headers.set(HEADER_STREAM_ID, *stream_id);
+    }
+    std::vector<uint8_t> serialized_response;
+    write_response(response, nullptr, serialized_response);
+    socket.sctp_send_data(key, std::move(serialized_response));
+    return false;
+}
 
-            std::vector<uint8_t> serialized_response = serialize_response(response);
-            socket.sctp_send_data(key, serialized_response);
-            received = 0;
-            recv_buffer.clear();
+// Latency from admission to the response going out, against the part of it spent in handle_request
+void Server::finish_request(Queued_Request& request, std::chrono::steady_clock::time_point started) {
+    if (request.admitted) {
+        auto now = std::chrono::steady_clock::now();
+        admission->release(now - *request.admitted, now - started);
+    }
+}
+
+void Server::run_association(const Association_Key& key) {
+    for (size_t i{}; i < MAX_REQUESTS_PER_TURN; i++) {
+        std::unique_lock<std::mutex> queues_lock(association_queues_mutex);
+        auto queue = association_queues.find(key);
+        if (queue->second.empty()) {
+            association_queues.erase(queue);
+            return;
         }
+        Queued_Request request = std::move(queue->second.front());
+        queue->second.pop_front();
+        queues_lock.unlock();
+
+        auto started = std::chrono::steady_clock::now();
+        handle_request(key, request);
+        finish_request(request, started);
+        pending_requests.fetch_sub(1);
     }
+
+    // Back of the line, a busy association cannot hold a worker forever
+    workers->submit([this, key] { run_association(key); });
 }
 
-void Server::stop() {
-    socket.sctp_close();
-    running = false;
-    if (processor_thread.joinable()) {
-        processor_thread.join();
+// The decoder's table must see blocks in the order they were sent, so this runs on the dispatcher
+void Server::decode_request(const Association_Key& key, const std::vector<uint8_t>& message) {
+    std::shared_ptr<Header_Codec> codec = header_compression ? header_codec(key, true) : nullptr;
+    std::optional<Request> request = codec ? codec->decoder.decode_request(message) : std::nullopt;
+    if (!request) {
+        log_event_limited<Log_Level::Warn>(undecodable_request_limit, "undecodable header block dropped", {}, {{"bytes", message.size()}});
+        return;
+    }
+    compressed_requests.fetch_add(1, std::memory_order_relaxed);
+    dispatch_request(key, Queued_Request{.decoded = std::move(request)});
+}
+
+std::shared_ptr<Server::Header_Codec> Server::header_codec(const Association_Key& key, bool create) {
+    std::unique_lock<std::mutex> codecs_lock(header_codecs_mutex);
+    auto codec = header_codecs.find(key);
+    if (codec != header_codecs.end()) {
+        return codec->second;
+    }
+    if (!create) {
+        return nullptr;
     }
+    auto created = std::make_shared<Header_Codec>(header_compression->table_size);
+    header_codecs.emplace(key, created);
+    return created;
 }
 
-void Server::register_route(const std::string& pattern, std::function<Response(const Request&, const std::unordered_map<std::string, std::string>&)> handler) {
-    Route new_route;
-    new_route.pattern = pattern;
-    new_route.handler = handler;
+// A restarted peer negotiates compression again from empty tables, and its open streams never complete
+void Server::forget_association(const Association_Key& key) {
+    std::unique_lock<std::mutex> codecs_lock(header_codecs_mutex);
+    header_codecs.erase(key);
+    codecs_lock.unlock();
 
-    std::string regex_pattern;
-    std::vector<std::string> params;
-    size_t pos = 0;
-    while (pos < pattern.size()) {
-        if (pattern[pos] == ':') {
-            size_t end_pos = pattern.find('/', pos);
-            if (end_pos == std::string::npos) {
-                end_pos = pattern.size();
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    std::erase_if(request_streams, [&](auto& stream) {
+        if (stream.first.association != key) {
+            return false;
+        }
+        stream.second.reader->cancel();
+        return true;
+    });
+    std::erase_if(response_streams, [&](auto& stream) {
+        if (stream.first.association != key) {
+            return false;
+        }
+        stream.second->cancel();
+        return true;
+    });
+}
+
+bool Server::send_cached(const Association_Key& key, std::string_view method, std::string_view uri, const Headers& request_headers, Request_Timer& timer) {
+    auto cached = response_cache->lookup(method, uri, request_headers);
+    if (!cached) {
+        return false;
+    }
+    timer.lap(PHASE_PARSE);
+    std::vector<uint8_t> serialized_response;
+    write_cached_response(*cached, request_headers.get(HEADER_STREAM_ID), serialized_response);
+    size_t bytes = serialized_response.size();
+    socket.sctp_send_data(key, std::move(serialized_response));
+    timer.lap(PHASE_SERIALIZE);
+    // Only 200s are stored; the route is looked up for the label alone, hits skip routing otherwise
+    if (timer) {
+        timer.record(metrics_series(match_route(method, uri)), http_method(method), Status_Code::OK, bytes);
+    }
+    return true;
+}
+
+size_t Server::metrics_series(const std::optional<Route_Match>& route_match) {
+    return route_match && route_match->route ? route_match->route->id + 1 : UNMATCHED_SERIES;
+}
+
+uint64_t Server::request_stream_id(const Queued_Request& queued, const Request& request) {
+    uint64_t stream_id = 0;
+    if (queued.stream_id) {
+        stream_id = *queued.stream_id;
+    } else if (auto echoed = request.headers.get(HEADER_STREAM_ID)) {
+        std::from_chars(echoed->data(), echoed->data() + echoed->size(), stream_id);
+    }
+    return stream_id;
+}
+
+void Server::handle_request(const Association_Key& key, Queued_Request& queued) {
+    if (!request_arena) {
+        serve_request(key, queued, std::pmr::get_default_resource());
+        return;
+    }
+    Arena_Lease arena(*request_arena);
+    serve_request(key, queued, arena.resource());
+    arena_requests.fetch_add(1, std::memory_order_relaxed);
+    if (arena.overflowed()) {
+        arena_overflows.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Server::serve_request(const Association_Key& key, Queued_Request& queued, std::pmr::memory_resource* resource) {
+    Request_Timer timer(request_metrics.get(), queued.received, queued.message.size() + queued.body.size());
+    // Binary requests need no state of the association, so they are decoded here on the worker,
+    // unless admission already had to look inside
+    bool binary_request = is_binary_message(queued.message);
+    if (binary_request) {
+        if (!queued.decoded && wire_format == WIRE_BINARY) {
+            queued.decoded = decode_binary_request(queued.message);
+        }
+        if (!queued.decoded) {
+            log_event_limited<Log_Level::Warn>(malformed_binary_limit, "malformed binary request dropped", {}, {{"bytes", queued.message.size()}});
+            return;
+        }
+        binary_requests.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Decoded requests keep their heap headers, a parsed one copies its headers into the arena
+    Request request = queued.decoded ? std::move(*queued.decoded) : Request{.headers = Headers(resource)};
+    request.arena = resource;
+    bool cacheable = false;
+    if (queued.decoded) {
+        cacheable = response_cache && request_cacheable(request.request_line.method, request.headers);
+        if (cacheable && send_cached(key, request.request_line.method, request.request_line.uri, request.headers, timer)) {
+            return;
+        }
+    } else {
+        // Each SCTP message carries a whole request (or a whole head), anything short of complete is malformed
+        Request_Parser parser;
+        Parse_Status parsed = parser.parse(std::string_view(reinterpret_cast<const char*>(queued.message.data()), queued.message.size()));
+        if (auto status = rejection_status(parsed)) {
+            std::optional<std::string> stream_id;
+            if (auto echoed = parser.view().headers.get(HEADER_STREAM_ID)) {
+                stream_id.emplace(*echoed);
             }
-            std::string param_name = pattern.substr(pos + 1, end_pos - pos - 1);
-            params.push_back(param_name);
-            regex_pattern += "([^/]+)";
-            pos = end_pos;
+            send_rejected_head(key, *status, std::move(stream_id));
+            return;
+        }
+        if (parsed != PARSE_COMPLETE) {
+            return;
+        }
+        const Request_View& view = parser.view();
+
+        // A hit is answered from the stored bytes, before the request is even copied out of the buffer
+        cacheable = response_cache && !queued.stream_id && request_cacheable(view.method, view.headers);
+        if (cacheable && send_cached(key, view.method, view.uri, view.headers, timer)) {
+            return;
+        }
+
+        request.request_line = Request_Line{std::string(view.version), std::string(view.uri), std::string(view.method)};
+        request.headers = view.headers;
+        request.headers.detach_views();
+        if (queued.stream_id) {
+            request.body = std::move(queued.body);
         } else {
-            if (std::ispunct(pattern[pos])) {
-                regex_pattern += '\\';
+            request.body.assign(view.body.begin(), view.body.end());
+        }
+    }
+
+    timer.lap(PHASE_PARSE);
+
+    Stream_Key stream_key{key, request_stream_id(queued, request)};
+    if (!begin_cancellable(stream_key, queued.received, request)) {
+        return;
+    }
+    run_route(key, queued, request, cacheable, binary_request, timer);
+    end_cancellable(stream_key);
+}
+
+void Server::run_route(const Association_Key& key, Queued_Request& queued, Request& request, bool cacheable, bool binary_request, Request_Timer& timer) {
+    // Parameters are views into request.request_line.uri, which outlives the handler call
+    auto route_match = match_route(request.request_line.method, request.request_line.uri);
+    if (route_match && route_match->route && route_match->route->stream_handler) {
+        run_stream_handler(key, queued, request, *route_match, timer);
+        return;
+    }
+    timer.begin();
+    Response response;
+    const Header_Block* header_block = nullptr;
+    if (!route_match) {
+        response = create_response(Status_Code::NotFound, std::vector<uint8_t>{});
+    } else if (!route_match->route) {
+        response = create_response(Status_Code::MethodNotAllowed, std::vector<uint8_t>{});
+    } else {
+        response = route_match->route->handler(request, route_match->params);
+        timer.lap(PHASE_HANDLER);
+        if (abandoned(request)) {
+            return;
+        }
+        header_block = &route_match->route->header_block;
+        apply_cache_headers(*route_match->route, response);
+        compress_response(request, *route_match->route, response);
+    }
+
+    // Stored as rendered without the Stream-Id, which write_cached_response adds per request. A
+    // hit goes out as one message, so bodies that need frames are not stored.
+    if (cacheable && route_match && route_match->route && response.headers.contains(HEADER_CACHE_CONTROL) &&
+        response_body(response).size() <= MAX_INLINE_BODY) {
+        std::vector<uint8_t> wire;
+        write_response(response, header_block, wire);
+        if (auto stored = response_cache->store(request.request_line.method, request.request_line.uri, request.headers,
+                                                response.response_line.status_code, response.headers, std::move(wire))) {
+            std::vector<uint8_t> serialized_response;
+            write_cached_response(*stored, request.headers.get(HEADER_STREAM_ID), serialized_response);
+            size_t bytes = serialized_response.size();
+            socket.sctp_send_data(key, std::move(serialized_response));
+            timer.lap(PHASE_SERIALIZE);
+            timer.record(metrics_series(route_match), http_method(request.request_line.method), response.response_line.status_code, bytes);
+            return;
+        }
+    }
+
+    size_t bytes = send_response(key, request, response, header_block, binary_request);
+    timer.lap(PHASE_SERIALIZE);
+    timer.record(metrics_series(route_match), http_method(request.request_line.method), response.response_line.status_code, bytes);
+}
+
+// A request whose client gave up already, or will have by the time it is answered, is dropped
+// before its handler runs. The rest get a token that a RESET for their stream cancels.
+bool Server::begin_cancellable(const Stream_Key& stream_key, std::chrono::steady_clock::time_point received, Request& request) {
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    if (auto timeout = request.headers.get(HEADER_REQUEST_TIMEOUT)) {
+        if (auto parsed = parse_request_timeout(*timeout)) {
+            deadline = received + *parsed;
+        }
+    }
+    if (deadline && std::chrono::steady_clock::now() >= *deadline) {
+        expired_requests.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    request.cancellation = Cancellation_Token::with_deadline(deadline);
+    if (stream_key.stream_id == 0) {
+        return true;
+    }
+    std::unique_lock<std::mutex> cancellation_lock(cancellation_mutex);
+    if (cancelled_streams.erase(stream_key)) {
+        cancelled_requests.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    running_requests.insert_or_assign(stream_key, request.cancellation);
+    return true;
+}
+
+void Server::end_cancellable(const Stream_Key& stream_key) {
+    if (stream_key.stream_id == 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> cancellation_lock(cancellation_mutex);
+    running_requests.erase(stream_key);
+}
+
+// A RESET for a request already answered is remembered too, until newer ones push it out
+void Server::cancel_request(const Stream_Key& stream_key) {
+    std::unique_lock<std::mutex> cancellation_lock(cancellation_mutex);
+    auto running = running_requests.find(stream_key);
+    if (running != running_requests.end()) {
+        running->second.cancel();
+        return;
+    }
+    if (cancelled_streams.insert(stream_key).second) {
+        cancelled_order.push_back(stream_key);
+        if (cancelled_order.size() > MAX_CANCELLED_STREAMS) {
+            cancelled_streams.erase(cancelled_order.front());
+            cancelled_order.pop_front();
+        }
+    }
+}
+
+// Nobody reads the answer to a request given up on while its handler ran
+bool Server::abandoned(const Request& request) {
+    if (!request.cancellation.cancelled()) {
+        return false;
+    }
+    if (request.cancellation.cancel_requested()) {
+        cancelled_requests.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        expired_requests.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+size_t Server::send_response(const Association_Key& key, const Request& request, Response& response, const Header_Block* header_block, bool binary_request) {
+    // Echoed so a client with many requests in flight can tell which one this answers
+    if (auto stream_id = request.headers.get(HEADER_STREAM_ID)) {
+        response.headers.set(HEADER_STREAM_ID, *stream_id);
+    }
+
+    // An offer is accepted by echoing our own, and this response already goes out compressed
+    std::shared_ptr<Header_Codec> codec;
+    if (header_compression) {
+        auto offer = request.headers.get(HEADER_COMPRESSION);
+        std::optional<size_t> peer_table_size = offer ? parse_header_compression_offer(*offer) : std::nullopt;
+        codec = header_codec(key, peer_table_size.has_value());
+        if (codec && peer_table_size) {
+            std::unique_lock<std::mutex> encoder_lock(codec->encoder_mutex);
+            if (!codec->encoder) {
+                codec->encoder.emplace(std::min(header_compression->table_size, *peer_table_size), header_compression->huffman);
             }
-            regex_pattern += pattern[pos];
-            pos++;
+            response.headers.set(HEADER_COMPRESSION, header_compression_offer(header_compression->table_size));
         }
     }
-    new_route.regex = std::regex("^" + regex_pattern + "$");
-    new_route.params = params;
 
-    routes.push_back(new_route);
+    // Binary answers binary, and accepts a text request's offer right away
+    bool binary = binary_request;
+    if (!binary && wire_format == WIRE_BINARY) {
+        auto offer = request.headers.get(WIRE_FORMAT);
+        if (offer && iequals(*offer, WIRE_FORMAT_BINARY)) {
+            response.headers.set(WIRE_FORMAT, WIRE_FORMAT_BINARY);
+            binary = true;
+        }
+    }
+    if (response_body(response).size() > MAX_INLINE_BODY) {
+        return send_framed_response(key, response, header_block);
+    }
+    if (binary) {
+        std::vector<uint8_t> serialized_response;
+        encode_binary_response(response, header_block, serialized_response);
+        size_t bytes = serialized_response.size();
+        socket.sctp_send_data(key, std::move(serialized_response));
+        return bytes;
+    }
+    if (codec) {
+        std::unique_lock<std::mutex> encoder_lock(codec->encoder_mutex);
+        if (codec->encoder) {
+            std::vector<uint8_t> serialized_response;
+            codec->encoder->encode_response(response, header_block, serialized_response);
+            size_t bytes = serialized_response.size();
+            socket.sctp_send_data(key, std::move(serialized_response));
+            return bytes;
+        }
+    }
+
+    // Rendered straight into the buffer that becomes the DATA chunk payload
+    std::vector<uint8_t> serialized_response;
+    write_response(response, header_block, serialized_response);
+    size_t bytes = serialized_response.size();
+    socket.sctp_send_data(key, std::move(serialized_response));
+    return bytes;
+}
+
+// Messages are not fragmented, so a body too large for one goes out in stream frames under the
+// request's Stream-Id, paced by the client's credit; the head is text whatever the wire format
+size_t Server::send_framed_response(const Association_Key& key, Response& response, const Header_Block* header_block) {
+    std::span<const uint8_t> body = response_body(response);
+    uint64_t stream_id = 0;
+    auto echoed = response.headers.get(HEADER_STREAM_ID);
+    if (!echoed || std::from_chars(echoed->data(), echoed->data() + echoed->size(), stream_id).ec != std::errc() || stream_id == 0) {
+        log_event_limited<Log_Level::Error>(unframed_response_limit, "response body too large for a client without stream ids", {}, {{"bytes", body.size()}});
+        Response error = create_response(Status_Code::InternalServerError, std::vector<uint8_t>{});
+        std::vector<uint8_t> serialized_response;
+        write_response(error, nullptr, serialized_response);
+        size_t bytes = serialized_response.size();
+        socket.sctp_send_data(key, std::move(serialized_response));
+        return bytes;
+    }
+
+    std::shared_ptr<const void> owner = response.body_owner;
+    if (!owner) {
+        auto moved = std::make_shared<const std::vector<uint8_t>>(std::move(response.body));
+        body = *moved;
+        owner = std::move(moved);
+    }
+    Stream_Key stream_key{key, stream_id};
+    auto writer = std::make_shared<Body_Writer>(stream_id, stream_sender(key));
+    writer->expect_head(header_block);
+    // Registered first, so the client's credit finds it
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    response_streams[stream_key] = writer;
+    streams_lock.unlock();
+
+    writer->send_head(response.response_line.status_code, response.headers);
+    writer->send_body(body, std::move(owner));
+    if (writer->closed()) {
+        streams_lock.lock();
+        response_streams.erase(stream_key);
+    }
+    return body.size();
 }
 
-std::optional<std::pair<Route*, std::unordered_map<std::string, std::string>>> Server::match_route(const std::string& uri) {
-    for (auto& route : routes) {
-        std::smatch match;
-        if (std::regex_match(uri, match, route.regex)) {
-            std::unordered_map<std::string, std::string> param_map;
-            for (size_t i = 0; i < route.params.size(); i++) {
-                param_map[route.params[i]] = match[i + 1];
+Message_Sender Server::stream_sender(const Association_Key& key) {
+    return [this, key](std::vector<uint8_t>&& message) { socket.sctp_send_data(key, std::move(message)); };
+}
+
+// Timed as one handler phase from the head to the END; the status and bytes went out in frames the
+// handler wrote, they are not counted
+void Server::run_stream_handler(const Association_Key& key, Queued_Request& queued, Request& request, const Route_Match& match, Request_Timer& timer) {
+    // A whole request's body is all there already, the response still streams under its Stream-Id
+    uint64_t stream_id = request_stream_id(queued, request);
+    std::shared_ptr<Body_Reader> reader = queued.body_reader;
+    if (!reader) {
+        reader = std::make_shared<Body_Reader>(stream_id, stream_sender(key));
+        reader->push(request.body);
+        reader->end();
+        request.body.clear();
+    }
+
+    Stream_Key stream_key{key, stream_id};
+    auto writer = std::make_shared<Body_Writer>(stream_id, stream_sender(key));
+    writer->expect_head(&match.route->header_block);
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    response_streams[stream_key] = writer;
+    streams_lock.unlock();
+
+    timer.begin();
+    match.route->stream_handler(request, match.params, *reader, *writer);
+    writer->finish();
+    timer.lap(PHASE_HANDLER);
+    timer.record(match.route->id + 1, http_method(request.request_line.method), 0, 0);
+
+    // A handler that stopped reading early tells the client to stop sending
+    if (queued.body_reader && !reader->finished()) {
+        reader->reset();
+    }
+    streams_lock.lock();
+    request_streams.erase(stream_key);
+    response_streams.erase(stream_key);
+}
+
+void Server::handle_frame(const Association_Key& key, const std::vector<uint8_t>& message) {
+    auto frame = parse_stream_frame(message);
+    if (!frame) {
+        log_event_limited<Log_Level::Warn>(stray_frame_limit, "malformed stream frame dropped", {}, {{"bytes", message.size()}});
+        return;
+    }
+    Stream_Key stream_key{key, frame->stream_id};
+    switch (frame->type) {
+        case FRAME_HEAD:
+            begin_request_stream(stream_key, frame->payload);
+            return;
+        case FRAME_DATA:
+        case FRAME_END:
+            receive_body(stream_key, *frame);
+            return;
+        case FRAME_CREDIT: {
+            // Taken out first, add_credit sends what a framed response had waiting
+            std::unique_lock<std::mutex> streams_lock(streams_mutex);
+            auto found = response_streams.find(stream_key);
+            if (found == response_streams.end()) {
+                return;
+            }
+            std::shared_ptr<Body_Writer> writer = found->second;
+            streams_lock.unlock();
+            writer->add_credit(frame->credit);
+            // A stream handler's writer is erased when the handler returns, a framed response's here
+            if (writer->closed()) {
+                streams_lock.lock();
+                response_streams.erase(stream_key);
+            }
+            return;
+        }
+        case FRAME_RESET: {
+            // The client gave up, e.g. timed out: the handler's reads and writes fail from here on
+            std::unique_lock<std::mutex> streams_lock(streams_mutex);
+            bool collecting = false;
+            auto stream = request_streams.find(stream_key);
+            if (stream != request_streams.end()) {
+                collecting = stream->second.collecting.has_value();
+                stream->second.reader->cancel();
+                request_streams.erase(stream);
+            }
+            auto writer = response_streams.find(stream_key);
+            if (writer != response_streams.end()) {
+                writer->second->cancel();
+                response_streams.erase(writer);
             }
-            return std::make_pair(&route, param_map);
+            streams_lock.unlock();
+            // A body still being collected is gone with its stream; anything else is queued or running
+            if (!collecting) {
+                cancel_request(stream_key);
+            }
+            return;
+        }
+    }
+}
+
+void Server::begin_request_stream(const Stream_Key& stream_key, std::span<const uint8_t> head) {
+    auto reader = std::make_shared<Body_Reader>(stream_key.stream_id, stream_sender(stream_key.association));
+    Request_Parser parser;
+    Parse_Status parsed = parser.parse(std::string_view(reinterpret_cast<const char*>(head.data()), head.size()));
+    if (parsed != PARSE_COMPLETE) {
+        reader->reset();
+        if (auto status = rejection_status(parsed)) {
+            send_rejected_head(stream_key.association, *status, std::to_string(stream_key.stream_id));
         }
+        return;
+    }
+    auto route_match = match_route(parser.view().method, parser.view().uri);
+    bool streaming = route_match && route_match->route && route_match->route->stream_handler;
+
+    Queued_Request request{.message = std::vector<uint8_t>(head.begin(), head.end()), .stream_id = stream_key.stream_id, .received = std::chrono::steady_clock::now()};
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    auto [stream, inserted] = request_streams.try_emplace(stream_key, Request_Stream{reader, std::nullopt});
+    if (!inserted) {
+        log_event_limited<Log_Level::Warn>(stray_frame_limit, "stream head repeated", {}, {{"stream_id", stream_key.stream_id}});
+        return;
+    }
+    if (!streaming) {
+        stream->second.collecting = std::move(request);
+        return;
+    }
+    streams_lock.unlock();
+
+    // Handled while the body is still on its way
+    request.body_reader = std::move(reader);
+    dispatch_request(stream_key.association, std::move(request));
+}
+
+// Answered rather than dropped, so the client is not left waiting for its timeout
+void Server::send_rejected_head(const Association_Key& key, Status_Code status, std::optional<std::string> stream_id) {
+    Response response = create_response(status, std::vector<uint8_t>{});
+    if (stream_id) {
+        response.headers.set(HEADER_STREAM_ID, *stream_id);
+    }
+    std::vector<uint8_t> serialized_response;
+    write_response(response, nullptr, serialized_response);
+    socket.sctp_send_data(key, std::move(serialized_response));
+}
+
+void Server::receive_body(const Stream_Key& stream_key, const Stream_Frame& frame) {
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    auto stream = request_streams.find(stream_key);
+    if (stream == request_streams.end()) {
+        log_event_limited<Log_Level::Warn>(stray_frame_limit, "body frame for unknown stream dropped", {}, {{"stream_id", stream_key.stream_id}});
+        return;
     }
-    return std::nullopt;
-}
\ No newline at end of file
+    Body_Reader& reader = *stream->second.reader;
+    if (frame.type == FRAME_DATA && !reader.push(frame.payload)) {
+        reader.cancel();
+        request_streams.erase(stream);
+        return;
+    }
+    if (frame.type == FRAME_END) {
+        reader.end();
+    }
+    if (!stream->second.collecting) {
+        if (frame.type == FRAME_END) {
+            request_streams.erase(stream);
+        }
+        return;
+    }
+
+    // Collected here for a plain handler; taking the chunks out of the reader returns the credit
+    Queued_Request& request = *stream->second.collecting;
+    while (auto chunk = reader.read(std::chrono::milliseconds(0))) {
+        request.body.insert(request.body.end(), chunk->begin(), chunk->end());
+    }
+    if (request.body.size() > max_buffered_body) {
+        reader.reset();
+        request_streams.erase(stream);
+        streams_lock.unlock();
+        Response response = create_response(Status_Code::PayloadTooLarge, std::vector<uint8_t>{});
+        response.headers.set(HEADER_STREAM_ID, std::to_string(stream_key.stream_id));
+        std::vector<uint8_t> serialized_response;
+        write_response(response, nullptr, serialized_response);
+        socket.sctp_send_data(stream_key.association, std::move(serialized_response));
+        return;
+    }
+    if (frame.type == FRAME_END) {
+        Queued_Request complete = std::move(request);
+        request_streams.erase(stream);
+        streams_lock.unlock();
+        dispatch_request(stream_key.association, std::move(complete));
+    }
+}
+
+// Route headers win over the handler's, as they do in the header block
+void Server::apply_cache_headers(const Route& route, Response& response) {
+    for (Header_Id id : {HEADER_VARY, HEADER_CACHE_CONTROL}) {
+        if (route.cache_headers.contains(id)) {
+            response.headers.remove(id);
+        }
+    }
+    for (size_t i{}; i < route.cache_headers.size(); i++) {
+        response.headers.add(route.cache_headers.id_at(i), route.cache_headers[i].value);
+    }
+}
+
+void Server::compress_response(const Request& request, const Route& route, Response& response) {
+    const Compression_Config& config = route.compression;
+    std::span<const uint8_t> body = response_body(response);
+    if (!config.enabled || body.size() < config.min_size || response.headers.contains(HEADER_CONTENT_ENCODING)) {
+        return;
+    }
+    // Caches in front of us must keep the variants apart, even when this client gets identity
+    add_vary(response.headers, header_name(HEADER_ACCEPT_ENCODING));
+    auto accept_encoding = request.headers.get(HEADER_ACCEPT_ENCODING);
+    Content_Coding coding = accept_encoding ? negotiate_coding(*accept_encoding, config.codings) : CODING_IDENTITY;
+    if (coding == CODING_IDENTITY) {
+        return;
+    }
+
+    std::vector<uint8_t> compressed;
+    if (config.cache) {
+        compressed = compression_cache->compress(coding, config.level, body);
+    } else if (!compress_body(coding, config.level, body, compressed) || compressed.size() >= body.size()) {
+        return;
+    }
+    if (compressed.empty()) {
+        return;
+    }
+    response.body = std::move(compressed);
+    response.body_owner.reset();
+    response.headers.set(HEADER_CONTENT_ENCODING, coding_name(coding));
+}
+
+void Server::stop() {
+    running = false;
+    if (processor_thread.joinable()) {
+        processor_thread.join();
+    }
+    // Stream handlers waiting on a client return instead of holding up the pool
+    std::unique_lock<std::mutex> streams_lock(streams_mutex);
+    for (auto& [stream_key, stream] : request_streams) {
+        stream.reader->cancel();
+    }
+    for (auto& [stream_key, writer] : response_streams) {
+        writer->cancel();
+    }
+    streams_lock.unlock();
+    // Requests already handed to the pool still get their responses queued
+    if (workers) {
+        workers->stop();
+    }
+    socket.sctp_close();
+}
+
+void Server::add_middleware(Middleware middleware) {
+    middlewares.push_back(std::move(middleware));
+}
+
+void Server::register_route(std::string_view pattern, Route_Handler handler, const Headers& route_headers, const Compression_Config& compression,
+                            Route_Priority priority) {
+    router.add(METHOD_ANY, pattern, apply_middleware(middlewares, std::move(handler)), route_headers, compression, priority);
+}
+
+void Server::register_route(Http_Method method, std::string_view pattern, Route_Handler handler, const Headers& route_headers, const Compression_Config& compression,
+                            Route_Priority priority) {
+    router.add(method, pattern, apply_middleware(middlewares, std::move(handler)), route_headers, compression, priority);
+}
+
+void Server::register_stream_route(Http_Method method, std::string_view pattern, Stream_Handler handler, const Headers& route_headers) {
+    router.add(method, pattern, std::move(handler), route_headers);
+    stream_routes = true;
+}
+
+std::optional<Route_Match> Server::match_route(std::string_view method, std::string_view uri) const {
+    return router.match(http_method(method), uri);
+}
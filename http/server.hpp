@@ -4,37 +4,210 @@
 #include "../sctp_stack/sctp_socket.hpp"
 #include "http_response.hpp"
 #include "http_request.hpp"
+#include "http_router.hpp"
+#include "http_worker_pool.hpp"
+#include "http_compression.hpp"
+#include "http_response_cache.hpp"
+#include "http_stream.hpp"
+#include "http_header_codec.hpp"
+#include "http_binary_codec.hpp"
+#include "http_admission.hpp"
+#include "http_deadline.hpp"
+#include "http_arena.hpp"
+#include "http_middleware.hpp"
+#include "http_metrics.hpp"
 #include <string_view>
-#include <unordered_map>
-#include <vector>
-#include <functional>
-#include <regex>
+#include <string>
 #include <optional>
+#include <deque>
+#include <span>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+
+constexpr size_t MAX_REQUESTS_PER_TURN = 16; // Requests one association runs before yielding its worker
+constexpr size_t DEFAULT_MAX_BUFFERED_BODY = 8 * 1024 * 1024; // Streamed request bodies collected for routes without a stream handler
+constexpr size_t MAX_CANCELLED_STREAMS = 1024; // RESETs remembered for requests not started yet, oldest forgotten first
 
-struct Route {
-    std::string pattern;
-    std::regex regex;
-    std::vector<std::string> params;
-    std::function<Response(const Request&, const std::unordered_map<std::string, std::string>&)> handler;
+struct Server_Stats {
+    uint64_t pending_requests; // Received, response not sent yet
+    Worker_Pool_Stats workers;
+    Compression_Cache_Stats compression_cache;
+    Response_Cache_Stats response_cache; // Zero when the cache is off
+    size_t open_streams; // Request and response bodies being streamed
+    uint64_t compressed_requests; // Arrived with a compressed header block
+    size_t header_codecs; // Associations with header compression negotiated
+    uint64_t binary_requests; // Arrived in the binary wire format
+    Admission_Stats admission; // Zero when admission control is off
+    uint64_t expired_requests; // Dropped, or left unanswered, once their Request-Timeout passed
+    uint64_t cancelled_requests; // Dropped, or left unanswered, after the client reset the stream
+    uint64_t arena_requests; // Served with the request arena
+    uint64_t arena_overflows; // Of those, outgrew the worker's arena block and went to the heap
+    Socket_Stats transport;
 };
 
 class Server {
     public:
         Server(std::string_view ip, int p);
+        Server(std::string_view ip, int p, std::unique_ptr<Datagram_Transport> transport);
         ~Server();
-        void start();
+        // Must come before start(). EVENT_LOOP_THREADED always runs handlers on a pool, default sized
+        // to the hardware; EVENT_LOOP_MANUAL runs them inside poll() unless a pool is configured.
+        void configure_workers(const Worker_Pool_Config& config);
+        void configure_compression_cache(size_t max_bytes); // Shared by routes with Compression_Config::cache, before start()
+        // Off unless configured, before start(). Handlers opt responses in with Cache-Control max-age.
+        void configure_response_cache(const Response_Cache_Config& config);
+        size_t invalidate_cached(std::string_view uri_prefix); // Entries dropped
+        // A streamed request body for a route without a stream handler is collected before the
+        // handler runs, up to this many bytes; larger ones are answered 413
+        void configure_buffered_body_limit(size_t max_bytes);
+        // Off unless configured, before start(). Clients offering it get header-compressed responses
+        // and may send compressed requests; others are served as before.
+        void configure_header_compression(const Header_Compression_Config& config);
+        // WIRE_TEXT unless configured, before start(). With WIRE_BINARY, clients offering it get binary
+        // responses and may send binary requests; everyone else is still served text.
+        void configure_wire_format(Wire_Format format);
+        // Off unless configured, before start(). Requests beyond an adaptive concurrency limit are
+        // answered 503 with Retry-After as they arrive instead of queueing; routes registered with
+        // a lower priority are shed first. Stream routes are not limited.
+        void configure_admission(const Admission_Config& config);
+        // Off unless configured, before start(). Each worker thread keeps an arena it recycles from
+        // one request to the next: the request's headers live there, and Request::arena hands it
+        // to the handler for scratch data.
+        void configure_request_arena(const Arena_Config& config = {});
+        // Off unless configured, before start(). Every answered request is timed per route and method,
+        // phase by phase, into per-thread counters, and config.path serves them with the transport's
+        // as Prometheus text. That route is registered here, inside the middlewares added so far.
+        void configure_metrics(const Metrics_Config& config = {});
+        std::vector<Series_Snapshot> metrics() const; // Series 0 are requests without a route, route id + 1 the rest
+        void start(Event_Loop_Mode mode = EVENT_LOOP_THREADED);
         void stop();
-        void register_route(const std::string& pattern, std::function<Response(const Request&, const std::unordered_map<std::string, std::string>&)> handler);
+        bool poll(); // Drives the server in EVENT_LOOP_MANUAL mode, returns whether any work was done or is still running on the pool
+        Server_Stats stats() const;
+        // Runs around the handlers of routes registered after this call, the first added outermost.
+        // Stream routes and 404/405 answers skip it. Chains known at compile time cost less as
+        // Middleware_Chain::wrap around the handler.
+        void add_middleware(Middleware middleware);
+        // Responses are compressed when the client's Accept-Encoding allows it, per the route's config
+        void register_route(std::string_view pattern, Route_Handler handler, const Headers& route_headers = Headers(),
+                            const Compression_Config& compression = Compression_Config(), Route_Priority priority = PRIORITY_NORMAL); // Any method
+        void register_route(Http_Method method, std::string_view pattern, Route_Handler handler, const Headers& route_headers = Headers(),
+                            const Compression_Config& compression = Compression_Config(), Route_Priority priority = PRIORITY_NORMAL);
+        // The handler runs on a worker as soon as the head arrives and reads the body through the
+        // Body_Reader while the client sends it; the response body goes out as it is written. A
+        // server with stream routes always runs handlers on a pool, in EVENT_LOOP_MANUAL too.
+        void register_stream_route(Http_Method method, std::string_view pattern, Stream_Handler handler, const Headers& route_headers = Headers());
+        std::optional<Route_Match> match_route(std::string_view method, std::string_view uri) const;
     private:
+        struct Queued_Request {
+            std::vector<uint8_t> message{}; // Whole request, or the head of one whose body is streamed
+            std::vector<uint8_t> body{}; // Streamed body, collected for a route without a stream handler
+            std::shared_ptr<Body_Reader> body_reader{}; // Streamed body, read by a stream handler
+            std::optional<uint64_t> stream_id{}; // Set when the body is streamed
+            std::optional<Request> decoded{}; // Arrived header-compressed, decoded in arrival order, or binary
+            std::optional<std::chrono::steady_clock::time_point> admitted{}; // Counted by the limiter since then
+            std::chrono::steady_clock::time_point received{}; // Request-Timeout counts from here
+        };
+
+        // Compression state of one association. The dispatcher decodes requests in arrival order;
+        // workers encode and send responses under encoder_mutex, so they are decoded in that order.
+        struct Header_Codec {
+            explicit Header_Codec(size_t table_size) : decoder(table_size) {}
+
+            Header_Decoder decoder;
+            std::mutex encoder_mutex;
+            std::optional<Header_Encoder> encoder; // Once the client offered compression
+        };
+
+        struct Stream_Key {
+            Association_Key association;
+            uint64_t stream_id;
+
+            bool operator==(const Stream_Key& other) const {
+                return association == other.association && stream_id == other.stream_id;
+            }
+        };
+
+        struct Stream_Key_Hash {
+            size_t operator()(const Stream_Key& key) const {
+                return Association_Hash()(key.association) ^ std::hash<uint64_t>()(key.stream_id);
+            }
+        };
+
+        struct Request_Stream {
+            std::shared_ptr<Body_Reader> reader;
+            std::optional<Queued_Request> collecting; // Set while the body is collected for a plain route
+        };
+
         SCTP_Socket socket;
         std::string ip_address;
-        std::vector<Route> routes;
+        Router router;
         int port;
         bool running;
         std::thread processor_thread;
+        std::optional<Worker_Pool_Config> worker_config;
+        std::unique_ptr<Worker_Pool> workers;
+        std::unordered_map<Association_Key, std::deque<Queued_Request>, Association_Hash> association_queues; // Only associations with queued or running requests
+        std::mutex association_queues_mutex;
+        std::atomic<uint64_t> pending_requests;
+        std::unique_ptr<Compression_Cache> compression_cache;
+        std::unique_ptr<Response_Cache> response_cache;
+        bool stream_routes;
+        size_t max_buffered_body;
+        std::unordered_map<Stream_Key, Request_Stream, Stream_Key_Hash> request_streams; // Until END, the handler's end or a reset
+        std::unordered_map<Stream_Key, std::shared_ptr<Body_Writer>, Stream_Key_Hash> response_streams; // While the stream handler runs or a framed body goes out
+        mutable std::mutex streams_mutex;
+        std::optional<Header_Compression_Config> header_compression;
+        std::unordered_map<Association_Key, std::shared_ptr<Header_Codec>, Association_Hash> header_codecs;
+        mutable std::mutex header_codecs_mutex;
+        std::atomic<uint64_t> compressed_requests;
+        Wire_Format wire_format;
+        std::atomic<uint64_t> binary_requests;
+        std::unique_ptr<Concurrency_Limiter> admission;
+        Admission_Config admission_config;
+        // Plain requests from parse to response, so a RESET reaches the handler's token, and RESETs
+        // that came before their request was taken off the queue
+        std::unordered_map<Stream_Key, Cancellation_Token, Stream_Key_Hash> running_requests;
+        std::unordered_set<Stream_Key, Stream_Key_Hash> cancelled_streams;
+        std::deque<Stream_Key> cancelled_order;
+        std::mutex cancellation_mutex;
+        std::atomic<uint64_t> expired_requests;
+        std::atomic<uint64_t> cancelled_requests;
+        std::optional<Arena_Config> request_arena;
+        std::vector<Middleware> middlewares;
+        std::atomic<uint64_t> arena_requests;
+        std::atomic<uint64_t> arena_overflows;
+        std::unique_ptr<Metrics_Registry> request_metrics;
         
-        std::optional<std::pair<Route*, std::unordered_map<std::string, std::string>>> match_route(const std::string& uri);
         void process_requests();
+        bool process_next_request();
+        void run_association(const Association_Key& key);
+        void dispatch_request(const Association_Key& key, Queued_Request&& request);
+        bool admit(const Association_Key& key, Queued_Request& request);
+        void finish_request(Queued_Request& request, std::chrono::steady_clock::time_point started);
+        void handle_request(const Association_Key& key, Queued_Request& queued);
+        void serve_request(const Association_Key& key, Queued_Request& queued, std::pmr::memory_resource* resource);
+        void run_route(const Association_Key& key, Queued_Request& queued, Request& request, bool cacheable, bool binary_request, Request_Timer& timer);
+        static uint64_t request_stream_id(const Queued_Request& queued, const Request& request); // 0 without one
+        bool begin_cancellable(const Stream_Key& stream_key, std::chrono::steady_clock::time_point received, Request& request);
+        void end_cancellable(const Stream_Key& stream_key);
+        void cancel_request(const Stream_Key& stream_key);
+        bool abandoned(const Request& request);
+        bool send_cached(const Association_Key& key, std::string_view method, std::string_view uri, const Headers& request_headers, Request_Timer& timer);
+        std::shared_ptr<Header_Codec> header_codec(const Association_Key& key, bool create);
+        void forget_association(const Association_Key& key); // The socket dropped it, a new one starts from scratch
+        void decode_request(const Association_Key& key, const std::vector<uint8_t>& message);
+        size_t send_response(const Association_Key& key, const Request& request, Response& response, const Header_Block* header_block, bool binary_request); // Bytes sent
+        size_t send_framed_response(const Association_Key& key, Response& response, const Header_Block* header_block);
+        void run_stream_handler(const Association_Key& key, Queued_Request& queued, Request& request, const Route_Match& match, Request_Timer& timer);
+        static size_t metrics_series(const std::optional<Route_Match>& route_match);
+        void handle_frame(const Association_Key& key, const std::vector<uint8_t>& message);
+        void begin_request_stream(const Stream_Key& stream_key, std::span<const uint8_t> head);
+        void receive_body(const Stream_Key& stream_key, const Stream_Frame& frame);
+        void send_rejected_head(const Association_Key& key, Status_Code status, std::optional<std::string> stream_id);
+        Message_Sender stream_sender(const Association_Key& key);
+        void apply_cache_headers(const Route& route, Response& response);
+        void compress_response(const Request& request, const Route& route, Response& response);
 };
 
 #endif
\ No newline at end of file
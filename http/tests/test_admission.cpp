@@ -0,0 +1,140 @@
+#include "tests.hpp"
+#include "../http_admission.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fills the limiter as far as it admits, then releases every request with the same latency and
+// a handler time of 1 ms, so anything beyond that was spent queueing
+static size_t run_round(Concurrency_Limiter& limiter, std::chrono::nanoseconds latency) {
+    size_t admitted = 0;
+    while (limiter.try_acquire(PRIORITY_CRITICAL)) {
+        admitted++;
+    }
+    for (size_t i{}; i < admitted; i++) {
+        limiter.release(latency, std::chrono::milliseconds(1));
+    }
+    return admitted;
+}
+
+void test_admission_limiter() {
+    std::cout << "Testing the concurrency limiter:" << std::endl;
+    Admission_Config config;
+    config.initial_limit = 20;
+    config.min_limit = 4;
+    config.max_limit = 200;
+    Concurrency_Limiter limiter(config);
+
+    for (int i{}; i < 50; i++) {
+        run_round(limiter, std::chrono::milliseconds(1));
+    }
+    size_t steady = limiter.limit();
+    run_round(limiter, std::chrono::milliseconds(10));
+    size_t slowed = limiter.limit();
+    for (int i{}; i < 50; i++) {
+        run_round(limiter, std::chrono::milliseconds(10));
+    }
+    size_t settled = limiter.limit();
+    std::cout << "Limit starts at 20, under steady full use grows: " << (steady > 20 ? "yes" : "no")
+              << ", after latency rose tenfold shrinks: " << (slowed < steady ? "yes" : "no")
+              << ", while requests keep queueing settles at: " << settled << ", never above " << config.max_limit << ": " << (steady <= config.max_limit ? "yes" : "no") << "\n";
+
+    // One request at a time says nothing about capacity
+    Concurrency_Limiter idle(config);
+    for (int i{}; i < 200; i++) {
+        idle.try_acquire(PRIORITY_NORMAL);
+        idle.release(std::chrono::milliseconds(1), std::chrono::milliseconds(1));
+    }
+    std::cout << "Limit after 200 requests one at a time: " << idle.limit() << "\n";
+
+    config.initial_limit = 10;
+    Concurrency_Limiter shares(config);
+    size_t in_flight = 0;
+    for (Route_Priority priority : {PRIORITY_SHEDDABLE, PRIORITY_NORMAL, PRIORITY_CRITICAL}) {
+        while (shares.try_acquire(priority)) {
+            in_flight++;
+        }
+        std::cout << "Priority " << priority << " admitted up to " << in_flight << " in flight\n";
+    }
+    Admission_Stats stats = shares.stats();
+    std::cout << "Shed per priority: " << stats.shed[PRIORITY_CRITICAL] << " " << stats.shed[PRIORITY_NORMAL] << " " << stats.shed[PRIORITY_SHEDDABLE]
+              << ", room for critical after one release: " << (shares.release(std::chrono::milliseconds(1), std::chrono::milliseconds(1)), shares.has_room(PRIORITY_CRITICAL) ? "yes" : "no")
+              << ", for sheddable: " << (shares.has_room(PRIORITY_SHEDDABLE) ? "yes" : "no") << "\n";
+    std::cout << std::endl;
+}
+
+void test_admission_exchange() {
+    std::cout << "Testing admission control through the server:" << std::endl;
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    auto slow = [](const Request& req, const Route_Params& params) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return create_response(Status_Code::OK, std::vector<uint8_t>{'d', 'o', 'n', 'e'});
+    };
+    server.register_route("/report", slow, Headers(), Compression_Config(), PRIORITY_SHEDDABLE);
+    server.register_route("/health", slow, Headers(), Compression_Config(), PRIORITY_CRITICAL);
+    Admission_Config config;
+    config.initial_limit = 8;
+    config.retry_after_seconds = 2;
+    server.configure_admission(config);
+    server.configure_workers(Worker_Pool_Config{.threads = 1});
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        server.stop();
+        return;
+    }
+
+    // Every request arrives long before the first one finishes, with a single worker to run them
+    std::vector<std::future<std::optional<Response>>> reports;
+    std::vector<std::future<std::optional<Response>>> checks;
+    for (int i{}; i < 8; i++) {
+        reports.push_back(client.send_request_async(client.build_request("GET", "/report")));
+    }
+    for (int i{}; i < 4; i++) {
+        checks.push_back(client.send_request_async(client.build_request("GET", "/health")));
+    }
+    simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(10));
+
+    auto count = [](std::vector<std::future<std::optional<Response>>>& futures, Status_Code status, std::string& retry_after) {
+        size_t matching = 0;
+        for (auto& future : futures) {
+            auto response = future.get();
+            if (response && response->response_line.status_code == status) {
+                matching++;
+                retry_after = std::string(response->headers.get(HEADER_RETRY_AFTER).value_or(""));
+            }
+        }
+        return matching;
+    };
+    std::string retry_after;
+    size_t reports_shed = count(reports, Status_Code::ServiceUnavailable, retry_after);
+    std::string no_retry_after;
+    size_t checks_ok = count(checks, Status_Code::OK, no_retry_after);
+    std::cout << "Sheddable requests answered 503: " << reports_shed << " of 8, Retry-After: " << retry_after << "\n";
+    std::cout << "Critical requests answered 200: " << checks_ok << " of 4\n";
+
+    Admission_Stats stats = server.stats().admission;
+    std::cout << "Server admitted " << stats.admitted << ", shed sheddable " << stats.shed[PRIORITY_SHEDDABLE]
+              << ", shed critical " << stats.shed[PRIORITY_CRITICAL] << ", in flight afterwards " << stats.in_flight << "\n";
+
+    server.stop();
+    std::cout << std::endl;
+}
+
+void test_admission() {
+    test_admission_limiter();
+    test_admission_exchange();
+}
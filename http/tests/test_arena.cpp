@@ -0,0 +1,134 @@
+#include "tests.hpp"
+#include "../http_arena.hpp"
+#include "../http_headers.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Heap allocations through it are counted
+class Counting_Resource : public std::pmr::memory_resource {
+    public:
+        size_t allocations = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            allocations++;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+};
+
+void test_arena_resource() {
+    std::cout << "Testing the request arena:" << std::endl;
+    Request_Arena arena(Arena_Config{.initial_bytes = 1024, .max_bytes = 4096});
+    (void)arena.resource()->allocate(512);
+    bool small_overflowed = arena.overflowed();
+    (void)arena.resource()->allocate(2048);
+    std::cout << "512 bytes in a 1024 byte block overflowed: " << (small_overflowed ? "yes" : "no")
+              << ", 2048 more overflowed: " << (arena.overflowed() ? "yes" : "no") << "\n";
+    arena.reset();
+    std::cout << "After the reset the block holds " << arena.capacity() << " bytes, overflowed: " << (arena.overflowed() ? "yes" : "no") << "\n";
+    void* again = arena.resource()->allocate(16);
+    arena.reset();
+    std::cout << "Block reused after a reset: " << (arena.resource()->allocate(16) == again ? "yes" : "no") << "\n";
+    for (int i{}; i < 4; i++) {
+        (void)arena.resource()->allocate(8192);
+        arena.reset();
+    }
+    std::cout << "Block after repeated 8 KiB requests: " << arena.capacity() << " bytes\n";
+
+    std::pmr::memory_resource* outer_resource;
+    bool inner_on_heap;
+    {
+        Arena_Lease outer(Arena_Config{});
+        Arena_Lease inner(Arena_Config{});
+        outer_resource = outer.resource();
+        inner_on_heap = inner.resource() == std::pmr::get_default_resource();
+    }
+    Arena_Lease later(Arena_Config{});
+    std::cout << "Outer lease uses the thread's arena: " << (outer_resource != std::pmr::get_default_resource() ? "yes" : "no")
+              << ", nested lease falls back to the heap: " << (inner_on_heap ? "yes" : "no")
+              << ", next lease gets the same arena: " << (later.resource() == outer_resource ? "yes" : "no") << "\n";
+
+    Counting_Resource counting;
+    Headers headers(&counting);
+    for (int i{}; i < 20; i++) {
+        headers.add("X-Field-" + std::to_string(i), "value " + std::to_string(i));
+    }
+    size_t from_resource = counting.allocations;
+    Headers copy = headers;
+    copy.add("X-Copied", "yes");
+    Headers moved = std::move(copy);
+    std::cout << "Headers storage from the given resource: " << (from_resource > 0 ? "yes" : "no")
+              << ", copy allocates elsewhere: " << (counting.allocations == from_resource ? "yes" : "no")
+              << ", fields after copy and move: " << moved.size() << ", last: " << moved[20].name << "\n";
+    std::cout << std::endl;
+}
+
+void test_arena_exchange() {
+    std::cout << "Testing the request arena through the server:" << std::endl;
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    Server plain_server("10.0.0.3", 8080, network.create_transport());
+    auto echo = [](const Request& req, const Route_Params& params) {
+        std::pmr::string body(req.arena);
+        body.append(req.arena == std::pmr::get_default_resource() ? "heap" : "arena");
+        body.append(" ").append(std::to_string(req.headers.get(HEADER_COOKIE).value_or("").size()));
+        return create_response(Status_Code::OK, std::vector<uint8_t>(body.begin(), body.end()));
+    };
+    server.register_route("/echo", echo);
+    plain_server.register_route("/echo", echo);
+    server.configure_request_arena(Arena_Config{.initial_bytes = 512, .max_bytes = 512});
+    server.start(EVENT_LOOP_MANUAL);
+    plain_server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+    Client plain("10.0.0.4", 5000, network.create_transport());
+    plain.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return plain_server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    simulation.add_poller([&] { return plain.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    plain.begin_connect("10.0.0.3", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected() && plain.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        server.stop();
+        plain_server.stop();
+        return;
+    }
+
+    auto fetch = [&](Client& from, const std::string& cookie) {
+        Request request = from.build_request("GET", "/echo");
+        request.headers.set(HEADER_COOKIE, cookie);
+        uint64_t stream_id = from.begin_request(request);
+        simulation.run_until([&] { return from.in_flight() == 0; }, std::chrono::seconds(5));
+        auto response = from.poll_response(stream_id);
+        return response ? std::string(response->body.begin(), response->body.end()) : std::string("no response");
+    };
+    std::cout << "Small request: " << fetch(client, "theme=dark") << ", request larger than the block: " << fetch(client, std::string(2000, 'c'))
+              << ", small again: " << fetch(client, "theme=light") << ", without an arena: " << fetch(plain, "theme=dark") << "\n";
+    Server_Stats stats = server.stats();
+    std::cout << "Served with the arena: " << stats.arena_requests << ", overflowed: " << stats.arena_overflows
+              << ", on the server without one: " << plain_server.stats().arena_requests << "\n";
+
+    server.stop();
+    plain_server.stop();
+    std::cout << std::endl;
+}
+
+void test_arena() {
+    test_arena_resource();
+    test_arena_exchange();
+}
@@ -0,0 +1,218 @@
+#include "tests.hpp"
+#include "../http_binary_codec.hpp"
+#include "../http_parse.hpp"
+#include "../http_response_writer.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <string>
+#include <vector>
+
+static std::string hex(const std::vector<uint8_t>& bytes) {
+    std::ostringstream out;
+    for (size_t i{}; i < bytes.size(); i++) {
+        out << (i ? " " : "") << std::hex << std::setw(2) << std::setfill('0') << int(bytes[i]);
+    }
+    return out.str();
+}
+
+static Request sample_request(const std::string& method, const std::string& uri, const std::string& body = "") {
+    Request request;
+    request.request_line = Request_Line{"HTTP/2.5", uri, method};
+    request.headers.add(HEADER_HOST, "10.0.0.1:8080");
+    request.headers.add(HEADER_USER_AGENT, "HTTP2.5-Client/1.0");
+    request.headers.add("X-Trace", "a1b2c3d4e5f6");
+    if (!body.empty()) {
+        request.headers.add(HEADER_CONTENT_LENGTH, std::to_string(body.size()));
+        request.headers.add(HEADER_CONTENT_TYPE, "application/json");
+        request.body.assign(body.begin(), body.end());
+    }
+    return request;
+}
+
+void test_binary_codec_messages() {
+    std::cout << "Testing binary wire format:" << std::endl;
+    for (uint64_t value : {uint64_t(0), uint64_t(127), uint64_t(300), UINT64_MAX}) {
+        std::vector<uint8_t> encoded;
+        encode_varint(value, encoded);
+        size_t position = 0;
+        auto decoded = decode_varint(encoded, position);
+        std::cout << "Varint " << value << ": " << encoded.size() << " bytes" << (value == 300 ? " (" + hex(encoded) + ")" : "")
+                  << ", round trip: " << (decoded == value && position == encoded.size() ? "yes" : "no") << "\n";
+    }
+    std::vector<uint8_t> overflow(9, 0xff);
+    overflow.push_back(0x02);
+    std::vector<uint8_t> endless(12, 0x80);
+    size_t position = 0;
+    bool overflow_decodes = decode_varint(overflow, position).has_value();
+    position = 0;
+    std::cout << "Varint past 64 bits decodes: " << (overflow_decodes ? "yes" : "no") << ", without an end: " << (decode_varint(endless, position) ? "yes" : "no") << "\n";
+
+    Request request = sample_request("POST", "/users/42", "{\"name\": \"Jane Doe\"}");
+    std::vector<uint8_t> text = serialize_request(request);
+    std::vector<uint8_t> binary;
+    encode_binary_request(request, 7, binary);
+    auto decoded = decode_binary_request(binary);
+    std::cout << "Request: " << text.size() << " bytes as text, " << (binary.size() < text.size() ? "smaller" : "not smaller") << " in binary"
+              << ", decoded: " << (decoded ? decoded->request_line.method + " " + decoded->request_line.uri + " " + decoded->request_line.version : "nothing")
+              << ", body: " << (decoded ? std::string(decoded->body.begin(), decoded->body.end()) : "none")
+              << ", Content-Length: " << (decoded ? decoded->headers.get(HEADER_CONTENT_LENGTH).value_or("none") : "none")
+              << ", Stream-Id: " << (decoded ? decoded->headers.get(HEADER_STREAM_ID).value_or("none") : "none")
+              << ", X-Trace: " << (decoded ? decoded->headers.get("X-Trace").value_or("none") : "none") << "\n";
+
+    std::vector<uint8_t> custom;
+    encode_binary_request(sample_request("PURGE", "/cache"), 0, custom);
+    auto custom_decoded = decode_binary_request(custom);
+    std::cout << "Unlisted method: " << (custom_decoded ? custom_decoded->request_line.method : "undecodable")
+              << ", Stream-Id without one: " << (custom_decoded && custom_decoded->headers.contains(HEADER_STREAM_ID) ? "yes" : "no") << "\n";
+
+    Headers block_headers;
+    block_headers.add(HEADER_SERVER, "HTTP2.5-Server/1.0");
+    block_headers.add(HEADER_CONTENT_TYPE, "text/plain");
+    block_headers.add("X-Route", "block");
+    Header_Block block = make_header_block(block_headers);
+    Response response = create_response(Status_Code::NotFound, std::vector<uint8_t>{'n', 'o'});
+    response.headers.set(HEADER_CONTENT_TYPE, "application/json");
+    response.headers.add("x-route", "handler");
+    response.headers.set(HEADER_STREAM_ID, "12");
+    std::vector<uint8_t> response_bytes;
+    encode_binary_response(response, &block, response_bytes);
+    // Unlisted names are matched against the block without regard to case, like interned ones
+    auto route_fields = [](const std::optional<Response>& decoded) {
+        std::string fields;
+        for (size_t i{}; decoded && i < decoded->headers.size(); i++) {
+            if (iequals(decoded->headers[i].name, "X-Route")) {
+                fields += (fields.empty() ? "" : ", ") + std::string(decoded->headers[i].value);
+            }
+        }
+        return fields.empty() ? std::string("none") : fields;
+    };
+    auto decoded_response = decode_binary_response(response_bytes);
+    std::cout << "Response: " << (decoded_response ? std::to_string(decoded_response->response_line.status_code) + " " + decoded_response->response_line.reason_phrase : "undecodable")
+              << ", block Content-Type wins: " << (decoded_response ? decoded_response->headers.get(HEADER_CONTENT_TYPE).value_or("none") : "none")
+              << ", X-Route fields: " << route_fields(decoded_response)
+              << ", Date: " << (decoded_response && decoded_response->headers.contains(HEADER_DATE) ? "yes" : "no")
+              << ", Content-Length: " << (decoded_response ? decoded_response->headers.get(HEADER_CONTENT_LENGTH).value_or("none") : "none") << "\n";
+
+    // Every cut of a valid message is rejected, as are lengths that do not add up
+    bool truncations_rejected = true;
+    for (size_t size{}; size < binary.size(); size++) {
+        truncations_rejected = truncations_rejected && !decode_binary_request(std::span<const uint8_t>(binary).subspan(0, size));
+    }
+    std::vector<uint8_t> trailing = binary;
+    trailing.push_back(0);
+    std::vector<uint8_t> many_fields = {BINARY_MESSAGE_MARKER, BINARY_REQUEST, METHOD_GET, 1, '/', 0xff, 0xff, 0x03, 0};
+    std::vector<uint8_t> unknown_id = {BINARY_MESSAGE_MARKER, BINARY_REQUEST, METHOD_GET, 1, '/', 1, HEADER_ID_COUNT, 1, 'x', 0};
+    std::vector<uint8_t> spelled_out = {BINARY_MESSAGE_MARKER, BINARY_REQUEST, METHOD_GET, 1, '/', 1, HEADER_OTHER, 4, 'H', 'o', 's', 't', 1, 'x', 0};
+    std::vector<uint8_t> bad_name = {BINARY_MESSAGE_MARKER, BINARY_REQUEST, METHOD_GET, 1, '/', 1, HEADER_OTHER, 2, 'a', '\n', 1, 'x', 0};
+    std::cout << "Truncated anywhere decodes: " << (truncations_rejected ? "no" : "yes")
+              << ", trailing byte: " << (decode_binary_request(trailing) ? "yes" : "no")
+              << ", field count past the message: " << (decode_binary_request(many_fields) ? "yes" : "no")
+              << ", unknown header id: " << (decode_binary_request(unknown_id) ? "yes" : "no")
+              << ", interned name spelled out: " << (decode_binary_request(spelled_out) ? "yes" : "no")
+              << ", name with a line break: " << (decode_binary_request(bad_name) ? "yes" : "no")
+              << ", response as a request: " << (decode_binary_request(response_bytes) ? "yes" : "no") << "\n";
+
+    // The text parsers turn malformed numbers away instead of throwing
+    std::string bad_length = "POST /users HTTP/2.5\r\nContent-Length: twelve\r\n\r\nhello";
+    std::string bad_status = "HTTP/2.5 OK Fine\r\nContent-Length: 0\r\n\r\n";
+    std::cout << "Text request with Content-Length twelve parses: " << (parse_http_request(std::vector<uint8_t>(bad_length.begin(), bad_length.end())) ? "yes" : "no")
+              << ", text response with status OK: " << (parse_http_response(std::vector<uint8_t>(bad_status.begin(), bad_status.end())) ? "yes" : "no") << "\n";
+    std::cout << std::endl;
+}
+
+void test_binary_codec_exchange() {
+    std::cout << "Testing the binary wire format through the server:" << std::endl;
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    server.register_route("/echo/:word", [](const Request& req, const Route_Params& params) {
+        std::string word(params["word"]);
+        Response response = create_response(Status_Code::OK, std::vector<uint8_t>(word.begin(), word.end()));
+        response.headers.set(HEADER_CONTENT_TYPE, "text/plain");
+        return response;
+    });
+    server.register_route(METHOD_POST, "/length", [](const Request& req, const Route_Params& params) {
+        std::string size = std::to_string(req.body.size()) + " " + std::string(req.headers.get(HEADER_CONTENT_LENGTH).value_or("none"));
+        return create_response(Status_Code::OK, std::vector<uint8_t>(size.begin(), size.end()));
+    });
+    server.configure_wire_format(WIRE_BINARY);
+    server.start(EVENT_LOOP_MANUAL);
+    Server text_server("10.0.0.4", 8080, network.create_transport());
+    text_server.register_route("/echo/:word", [](const Request& req, const Route_Params& params) {
+        std::string word(params["word"]);
+        return create_response(Status_Code::OK, std::vector<uint8_t>(word.begin(), word.end()));
+    });
+    text_server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.configure_wire_format(WIRE_BINARY);
+    client.start(EVENT_LOOP_MANUAL);
+    Client plain("10.0.0.3", 5000, network.create_transport());
+    plain.start(EVENT_LOOP_MANUAL);
+    Client hopeful("10.0.0.5", 5000, network.create_transport());
+    hopeful.configure_wire_format(WIRE_BINARY);
+    hopeful.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return text_server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    simulation.add_poller([&] { return plain.poll(); });
+    simulation.add_poller([&] { return hopeful.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    plain.begin_connect("10.0.0.1", 8080);
+    hopeful.begin_connect("10.0.0.4", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected() && plain.poll_connected() && hopeful.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        return;
+    }
+
+    auto fetch = [&](Client& from, Request request) {
+        auto future = from.send_request_async(request);
+        simulation.run_until([&] { return from.in_flight() == 0; }, std::chrono::seconds(5));
+        return future.get();
+    };
+    auto text = [](const std::optional<Response>& response) {
+        return response ? std::to_string(response->response_line.status_code) + " " + std::string(response->body.begin(), response->body.end()) : std::string("no response");
+    };
+
+    auto first = fetch(client, client.build_request("GET", "/echo/first"));
+    std::cout << "First request: " << text(first) << ", binary active afterwards: " << (client.binary_wire_active() ? "yes" : "no") << "\n";
+
+    std::vector<std::future<std::optional<Response>>> futures;
+    for (int i{}; i < 8; i++) {
+        futures.push_back(client.send_request_async(client.build_request("GET", "/echo/word" + std::to_string(i))));
+    }
+    simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(5));
+    bool matched = true;
+    for (int i{}; i < 8; i++) {
+        auto response = futures[i].get();
+        matched = matched && text(response) == "200 word" + std::to_string(i) && response->headers.get(HEADER_CONTENT_TYPE) == "text/plain";
+    }
+    std::cout << "Eight pipelined binary requests matched: " << (matched ? "yes" : "no") << "\n";
+
+    auto posted = fetch(client, client.build_request("POST", "/length", "{\"name\": \"Jane Doe\"}"));
+    auto missing = fetch(client, client.build_request("GET", "/nowhere"));
+    std::cout << "Binary POST: " << text(posted) << ", unknown route: " << text(missing) << "\n";
+
+    auto plain_response = fetch(plain, plain.build_request("GET", "/echo/plain"));
+    std::cout << "Client without the format: " << text(plain_response) << ", offered nothing back: "
+              << (plain_response && !plain_response->headers.contains(WIRE_FORMAT) ? "yes" : "no") << "\n";
+    auto declined = fetch(hopeful, hopeful.build_request("GET", "/echo/declined"));
+    auto still_text = fetch(hopeful, hopeful.build_request("GET", "/echo/again"));
+    std::cout << "Server without the format: " << text(declined) << ", " << text(still_text)
+              << ", binary active: " << (hopeful.binary_wire_active() ? "yes" : "no") << "\n";
+    std::cout << "Binary requests at the server: " << server.stats().binary_requests << ", at the text server: " << text_server.stats().binary_requests << "\n";
+
+    server.stop();
+    text_server.stop();
+    std::cout << std::endl;
+}
+
+void test_binary_codec() {
+    test_binary_codec_messages();
+    test_binary_codec_exchange();
+}
@@ -0,0 +1,172 @@
+#include "tests.hpp"
+#include "../client_pool.hpp"
+#include "../server.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const char* BACKEND_STATE_NAMES[] = {"connecting", "healthy", "ejected"};
+
+static std::unique_ptr<Server> make_backend(Emulated_Network& network, const char* ip, Status_Code status) {
+    auto server = std::make_unique<Server>(ip, 8080, network.create_transport());
+    server->register_route("/work", [status](const Request& req, const Route_Params& params) {
+        return create_response(status, std::vector<uint8_t>{});
+    });
+    server->start(EVENT_LOOP_MANUAL);
+    return server;
+}
+
+// Two good backends, one answering 500 and one address nobody listens on
+static void run_pool_exchange(const char* name, Balance_Policy policy) {
+    std::cout << "Testing client pool (" << name << "):" << std::endl;
+
+    Emulated_Network network;
+    std::vector<std::unique_ptr<Server>> servers;
+    servers.push_back(make_backend(network, "10.0.0.1", OK));
+    servers.push_back(make_backend(network, "10.0.0.2", OK));
+    servers.push_back(make_backend(network, "10.0.0.3", InternalServerError));
+
+    Client_Pool_Config config;
+    config.local_ip = "10.0.1.1";
+    config.policy = policy;
+    config.max_in_flight_per_backend = 2;
+    config.connect_timeout = std::chrono::milliseconds(20);
+    config.ejection_time = std::chrono::seconds(60);
+    config.transport_factory = [&] { return network.create_transport(); };
+    Client_Pool pool(config);
+    pool.add_backend("10.0.0.1", 8080);
+    pool.add_backend("10.0.0.2", 8080);
+    pool.add_backend("10.0.0.3", 8080);
+    pool.add_backend("10.0.0.4", 8080);
+    pool.start(EVENT_LOOP_MANUAL);
+
+    Network_Simulation simulation(network);
+    for (auto& server : servers) {
+        simulation.add_poller([&server] { return server->poll(); });
+    }
+    simulation.add_poller([&] { return pool.poll(); });
+
+    auto run_for = [&](const std::function<bool()>& done) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!done() && std::chrono::steady_clock::now() < deadline) {
+            simulation.run_until(done, std::chrono::seconds(5));
+        }
+    };
+    auto healthy_count = [&] {
+        size_t healthy = 0;
+        for (const auto& backend : pool.stats()) {
+            healthy += backend.state == BACKEND_HEALTHY ? 1 : 0;
+        }
+        return healthy;
+    };
+    run_for([&] { return healthy_count() == 3; });
+
+    // Batches of 6 fill every healthy backend up to its in-flight limit
+    constexpr int POOL_REQUESTS = 60;
+    Request request;
+    request.request_line = Request_Line{"HTTP/2.5", "/work", "GET"};
+    int ok = 0, server_errors = 0, failed = 0;
+    size_t most_in_flight = 0;
+    for (int sent = 0; sent < POOL_REQUESTS; sent += 6) {
+        int answered = 0;
+        for (int i{}; i < 6; i++) {
+            pool.send_request(request, [&](std::optional<Response> response) {
+                answered++;
+                if (!response) {
+                    failed++;
+                } else if (response->response_line.status_code == OK) {
+                    ok++;
+                } else {
+                    server_errors++;
+                }
+            });
+        }
+        run_for([&] {
+            for (const auto& backend : pool.stats()) {
+                most_in_flight = std::max(most_in_flight, backend.in_flight);
+            }
+            return answered == 6;
+        });
+    }
+    run_for([&] { return pool.stats()[3].reconnects > 0; });
+
+    std::cout << "OK: " << ok << ", 5xx: " << server_errors << ", failed: " << failed << ", most in flight on a backend: " << most_in_flight << "\n";
+    for (const auto& backend : pool.stats()) {
+        std::cout << backend.address << " " << BACKEND_STATE_NAMES[backend.state] << ", completed: " << (backend.completed > 0 ? "yes" : "no")
+                  << ", failures: " << backend.failures << ", reconnecting: " << (backend.reconnects > 0 ? "yes" : "no") << "\n";
+    }
+    pool.stop();
+
+    std::cout << std::endl;
+}
+
+// A backend ejected for 500s comes back on a fresh association once it answers again
+static void run_pool_recovery() {
+    std::cout << "Testing client pool (recovery after ejection):" << std::endl;
+
+    Emulated_Network network;
+    Status_Code status = InternalServerError;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    server.register_route("/work", [&status](const Request& req, const Route_Params& params) {
+        return create_response(status, std::vector<uint8_t>{});
+    });
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client_Pool_Config config;
+    config.local_ip = "10.0.1.1";
+    config.connect_timeout = std::chrono::milliseconds(20);
+    config.ejection_time = std::chrono::milliseconds(50);
+    config.transport_factory = [&] { return network.create_transport(); };
+    Client_Pool pool(config);
+    pool.add_backend("10.0.0.1", 8080);
+    pool.start(EVENT_LOOP_MANUAL);
+
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return pool.poll(); });
+
+    auto run_for = [&](const std::function<bool()>& done) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!done() && std::chrono::steady_clock::now() < deadline) {
+            simulation.run_until(done, std::chrono::seconds(5));
+        }
+    };
+    auto state = [&] { return pool.stats()[0].state; };
+    Request request;
+    request.request_line = Request_Line{"HTTP/2.5", "/work", "GET"};
+    auto send_batch = [&](int count) {
+        int answered = 0, ok = 0;
+        for (int i{}; i < count; i++) {
+            pool.send_request(request, [&](std::optional<Response> response) {
+                answered++;
+                ok += response && response->response_line.status_code == OK ? 1 : 0;
+            });
+        }
+        run_for([&] { return answered == count; });
+        return ok;
+    };
+
+    run_for([&] { return state() == BACKEND_HEALTHY; });
+    send_batch(static_cast<int>(config.failures_to_eject));
+    bool ejected = state() == BACKEND_EJECTED;
+
+    status = OK;
+    run_for([&] { return state() == BACKEND_HEALTHY; });
+    int ok = send_batch(5);
+
+    const Backend_Stats backend = pool.stats()[0];
+    std::cout << "Ejected after failures: " << (ejected ? "yes" : "no") << ", state after ejection time: " << BACKEND_STATE_NAMES[backend.state]
+              << ", reconnects: " << backend.reconnects << ", OK after recovery: " << ok << "/5\n";
+    pool.stop();
+
+    std::cout << std::endl;
+}
+
+void test_client_pool() {
+    run_pool_exchange("least outstanding", BALANCE_LEAST_OUTSTANDING);
+    run_pool_exchange("power of two choices", BALANCE_POWER_OF_TWO);
+    run_pool_recovery();
+}
@@ -0,0 +1,154 @@
+#include "tests.hpp"
+#include "../http_compression.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+
+static std::vector<uint8_t> json_body(size_t items) {
+    std::string body = "[";
+    for (size_t i{}; i < items; i++) {
+        body += (i ? "," : "") + std::string("{\"id\":") + std::to_string(i) + ",\"name\":\"user" + std::to_string(i) + "\",\"active\":true}";
+    }
+    body += "]";
+    return std::vector<uint8_t>(body.begin(), body.end());
+}
+
+void test_compression_negotiation() {
+    std::cout << "Testing Accept-Encoding negotiation:" << std::endl;
+    uint32_t both = coding_bit(CODING_GZIP) | coding_bit(CODING_DEFLATE);
+    for (const char* accept : {"", "gzip, deflate", "deflate", "deflate, gzip;q=0.5", "gzip;q=0", "*", "br, *;q=0.1",
+                               "gzip;q=0.5, identity", "identity;q=0, *;q=0", "GZIP ; Q=0.8"}) {
+        std::cout << "\"" << accept << "\" -> " << coding_name(negotiate_coding(accept, both)) << "\n";
+    }
+    std::cout << "\"gzip, deflate\" with deflate only -> " << coding_name(negotiate_coding("gzip, deflate", coding_bit(CODING_DEFLATE))) << "\n";
+
+    std::vector<uint8_t> body = json_body(200);
+    for (Content_Coding coding : {CODING_GZIP, CODING_DEFLATE}) {
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> restored;
+        bool ok = compress_body(coding, COMPRESSION_LEVEL_DEFAULT, body, compressed) && decompress_body(coding, compressed, restored);
+        std::cout << coding_name(coding) << " round trip: " << (ok && restored == body ? "ok" : "mismatch")
+                  << ", smaller: " << (compressed.size() * 4 < body.size() ? "yes" : "no") << "\n";
+    }
+    std::vector<uint8_t> compressed;
+    compress_body(CODING_GZIP, COMPRESSION_LEVEL_FAST, body, compressed);
+    std::vector<uint8_t> restored;
+    compressed.resize(compressed.size() / 2);
+    std::cout << "Truncated gzip rejected: " << (decompress_body(CODING_GZIP, compressed, restored) ? "no" : "yes")
+              << ", inflate bounded: " << (decompress_body(CODING_DEFLATE, std::vector<uint8_t>{}, restored, 16) ? "no" : "yes") << "\n";
+
+    for (const char* vary : {"", "Cookie", "cookie, accept-encoding", "*"}) {
+        Headers headers;
+        if (*vary) {
+            headers.add(HEADER_VARY, vary);
+        }
+        add_vary(headers, "Accept-Encoding");
+        std::cout << "Vary \"" << vary << "\" -> \"" << headers.get(HEADER_VARY).value_or("") << "\"\n";
+    }
+    Headers repeated;
+    repeated.add(HEADER_VARY, "Cookie");
+    repeated.add(HEADER_VARY, "Accept-Language");
+    add_vary(repeated, "Accept-Encoding");
+    std::cout << "Two Vary fields -> \"" << repeated.get(HEADER_VARY).value_or("") << "\"\n";
+    std::cout << std::endl;
+}
+
+void test_compression_cache() {
+    std::cout << "Testing compression cache:" << std::endl;
+    std::vector<uint8_t> first = json_body(100);
+    std::vector<uint8_t> second = json_body(101);
+    size_t budget = 2 * first.size() + second.size();
+    Compression_Cache cache(budget);
+
+    std::vector<uint8_t> compressed = cache.compress(CODING_GZIP, COMPRESSION_LEVEL_DEFAULT, first);
+    bool same = cache.compress(CODING_GZIP, COMPRESSION_LEVEL_DEFAULT, first) == compressed;
+    cache.compress(CODING_DEFLATE, COMPRESSION_LEVEL_DEFAULT, first);
+    Compression_Cache_Stats stats = cache.stats();
+    std::cout << "Hits: " << stats.hits << ", misses: " << stats.misses << ", entries: " << stats.entries << ", same bytes on hit: " << (same ? "yes" : "no") << "\n";
+
+    // The budget cannot hold a third original, the least recently used entry goes
+    cache.compress(CODING_GZIP, COMPRESSION_LEVEL_DEFAULT, second);
+    cache.compress(CODING_GZIP, COMPRESSION_LEVEL_DEFAULT, second);
+    stats = cache.stats();
+    std::cout << "After a second body, entries: " << stats.entries << ", evictions: " << stats.evictions
+              << ", within budget: " << (stats.bytes <= budget ? "yes" : "no") << "\n";
+    bool incompressible = cache.compress(CODING_GZIP, COMPRESSION_LEVEL_DEFAULT, std::vector<uint8_t>{'x'}).empty();
+    std::cout << "Incompressible body left alone: " << (incompressible ? "yes" : "no") << "\n";
+    std::cout << std::endl;
+}
+
+void test_compression_exchange() {
+    std::cout << "Testing compressed responses end to end:" << std::endl;
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    std::vector<uint8_t> users = json_body(200);
+    server.register_route("/users", [&](const Request& req, const Route_Params& params) {
+        return create_response(Status_Code::OK, users);
+    }, Headers(), Compression_Config{.cache = true});
+    server.register_route("/small", [](const Request& req, const Route_Params& params) {
+        return create_response(Status_Code::OK, std::vector<uint8_t>(100, 'a'));
+    });
+    server.register_route("/raw", [&](const Request& req, const Route_Params& params) {
+        return create_response(Status_Code::OK, users);
+    }, Headers(), Compression_Config{.enabled = false});
+    // Per-user variants, Accept-Encoding joins the handler's Vary
+    server.register_route("/profile", [&](const Request& req, const Route_Params& params) {
+        Response response = create_response(Status_Code::OK, users);
+        response.headers.set(HEADER_VARY, "Cookie");
+        response.headers.set(HEADER_CACHE_CONTROL, "max-age=60");
+        return response;
+    });
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        return;
+    }
+
+    auto fetch = [&](Request request) {
+        auto future = client.send_request_async(request);
+        simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(5));
+        return future.get();
+    };
+    auto describe = [&](const char* label, const std::optional<Response>& response, const std::vector<uint8_t>& expected) {
+        std::cout << label << ": ";
+        if (!response) {
+            std::cout << "no response\n";
+            return;
+        }
+        std::cout << "body " << (response->body == expected ? "intact" : "corrupted")
+                  << ", Content-Encoding left: " << (response->headers.contains(HEADER_CONTENT_ENCODING) ? "yes" : "no")
+                  << ", Vary: " << response->headers.get(HEADER_VARY).value_or("none") << "\n";
+    };
+
+    describe("Compressed route", fetch(client.build_request("GET", "/users")), users);
+    describe("Compressed route again", fetch(client.build_request("GET", "/users")), users);
+    describe("Below threshold", fetch(client.build_request("GET", "/small")), std::vector<uint8_t>(100, 'a'));
+    describe("Compression disabled", fetch(client.build_request("GET", "/raw")), users);
+    describe("Handler setting Vary", fetch(client.build_request("GET", "/profile")), users);
+
+    // Not compressed at all, so the cache sees no lookup for it
+    Request identity_request = client.build_request("GET", "/users");
+    identity_request.headers.set(HEADER_ACCEPT_ENCODING, "identity");
+    describe("Client refusing codings", fetch(identity_request), users);
+
+    Compression_Cache_Stats stats = server.stats().compression_cache;
+    std::cout << "Cache hits: " << stats.hits << ", misses: " << stats.misses << "\n";
+    std::cout << std::endl;
+}
+
+void test_compression() {
+    test_compression_negotiation();
+    test_compression_cache();
+    test_compression_exchange();
+}
@@ -0,0 +1,173 @@
+#include "tests.hpp"
+#include "../http_deadline.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+void test_deadline_token() {
+    std::cout << "Testing request timeouts and cancellation tokens:" << std::endl;
+    auto shown = [](std::optional<std::chrono::milliseconds> timeout) {
+        return timeout ? std::to_string(timeout->count()) : std::string("rejected");
+    };
+    std::cout << "Parsed: 250 -> " << shown(parse_request_timeout("250")) << ", 0 -> " << shown(parse_request_timeout("0"))
+              << ", empty -> " << shown(parse_request_timeout("")) << ", 12ms -> " << shown(parse_request_timeout("12ms"))
+              << ", -5 -> " << shown(parse_request_timeout("-5")) << ", 10^15 -> " << shown(parse_request_timeout("1000000000000000")) << "\n";
+
+    Cancellation_Token none;
+    none.cancel();
+    std::cout << "Default token cancelled after cancel(): " << (none.cancelled() ? "yes" : "no")
+              << ", remaining is unbounded: " << (none.remaining() == std::chrono::nanoseconds::max() ? "yes" : "no") << "\n";
+
+    auto now = std::chrono::steady_clock::now();
+    Cancellation_Token later = Cancellation_Token::with_deadline(now + std::chrono::seconds(10));
+    Cancellation_Token past = Cancellation_Token::with_deadline(now - std::chrono::milliseconds(1));
+    std::cout << "Deadline in 10 s cancelled: " << (later.cancelled() ? "yes" : "no")
+              << ", remaining within 10 s: " << (later.remaining() > std::chrono::seconds(9) && later.remaining() <= std::chrono::seconds(10) ? "yes" : "no")
+              << ", passed deadline cancelled: " << (past.cancelled() ? "yes" : "no")
+              << ", by request: " << (past.cancel_requested() ? "yes" : "no") << "\n";
+
+    Cancellation_Token copy = later;
+    copy.cancel();
+    std::cout << "Cancelling a copy cancels the original: " << (later.cancelled() && later.cancel_requested() ? "yes" : "no")
+              << ", remaining then: " << later.remaining().count() << "\n";
+    std::cout << std::endl;
+}
+
+void test_deadline_exchange() {
+    std::cout << "Testing deadlines and cancellation through the server:" << std::endl;
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    std::atomic<int> counted{0};
+    std::atomic<int64_t> loop_ran_ms{0};
+    std::atomic<int64_t> loop_remaining_ms{-1};
+    std::atomic<bool> loop_saw_cancel{false};
+    server.register_route("/block", [](const Request& req, const Route_Params& params) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        return create_response(Status_Code::OK, std::vector<uint8_t>{});
+    });
+    server.register_route("/count", [&](const Request& req, const Route_Params& params) {
+        counted++;
+        return create_response(Status_Code::OK, std::vector<uint8_t>{});
+    });
+    // Long work that checks its token between steps
+    server.register_route("/loop", [&](const Request& req, const Route_Params& params) {
+        auto started = std::chrono::steady_clock::now();
+        loop_remaining_ms = std::chrono::duration_cast<std::chrono::milliseconds>(req.cancellation.remaining()).count();
+        while (!req.cancellation.cancelled() && std::chrono::steady_clock::now() - started < std::chrono::seconds(2)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        loop_saw_cancel = req.cancellation.cancel_requested();
+        loop_ran_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+        return create_response(Status_Code::OK, std::vector<uint8_t>{});
+    });
+    server.register_route("/timeout", [](const Request& req, const Route_Params& params) {
+        std::string timeout(req.headers.get(HEADER_REQUEST_TIMEOUT).value_or("none"));
+        return create_response(Status_Code::OK, std::vector<uint8_t>(timeout.begin(), timeout.end()));
+    });
+    server.configure_workers(Worker_Pool_Config{.threads = 1});
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.configure_deadlines(std::chrono::milliseconds(2000));
+    client.start(EVENT_LOOP_MANUAL);
+    Client plain("10.0.0.3", 5000, network.create_transport());
+    plain.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    simulation.add_poller([&] { return plain.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    plain.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected() && plain.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        server.stop();
+        return;
+    }
+
+    // Handlers and client timeouts run on the real clock, the network on virtual time
+    auto wait_for = [&](const std::function<bool()>& done, std::chrono::milliseconds limit) {
+        auto end = std::chrono::steady_clock::now() + limit;
+        auto done_or_late = [&] { return done() || std::chrono::steady_clock::now() >= end; };
+        while (!done_or_late()) {
+            simulation.run_until(done_or_late, std::chrono::seconds(1));
+            std::this_thread::yield();
+        }
+        return done();
+    };
+    auto settle = [&](std::chrono::milliseconds duration) {
+        wait_for([] { return false; }, duration);
+    };
+
+    auto fetch = [&](Client& from, Request request, std::chrono::milliseconds timeout = DEFAULT_REQUEST_TIMEOUT) {
+        auto future = from.send_request_async(request, timeout);
+        wait_for([&] { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }, std::chrono::seconds(10));
+        auto response = future.get();
+        return response ? std::string(response->body.begin(), response->body.end()) : std::string("no response");
+    };
+    Request preset = client.build_request("GET", "/timeout");
+    preset.headers.set(HEADER_REQUEST_TIMEOUT, "777");
+    std::string from_begin;
+    uint64_t begun = client.begin_request(client.build_request("GET", "/timeout"));
+    wait_for([&] { return client.in_flight() == 0; }, std::chrono::seconds(5));
+    if (auto response = client.poll_response(begun)) {
+        from_begin.assign(response->body.begin(), response->body.end());
+    }
+    std::cout << "Request-Timeout seen by the handler: per request " << fetch(client, client.build_request("GET", "/timeout"), std::chrono::milliseconds(1500))
+              << ", begin_request " << from_begin << ", set by the caller " << fetch(client, preset)
+              << ", client without deadlines " << fetch(plain, plain.build_request("GET", "/timeout")) << "\n";
+
+    // Its deadline passes while it waits behind /block, the client itself would wait longer
+    Request short_deadline = client.build_request("GET", "/count");
+    short_deadline.headers.set(HEADER_REQUEST_TIMEOUT, "50");
+    auto blocking = client.send_request_async(client.build_request("GET", "/block"));
+    std::optional<Response> late;
+    bool late_done = false;
+    uint64_t late_id = client.send_request(short_deadline, [&](std::optional<Response> response) { late = std::move(response); late_done = true; });
+    wait_for([&] { return blocking.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }, std::chrono::seconds(5));
+    settle(std::chrono::milliseconds(50));
+    std::cout << "Expired in the queue: handler ran " << counted << " times, answered: " << (late_done ? "yes" : "no")
+              << ", expired at the server: " << server.stats().expired_requests << "\n";
+    client.cancel(late_id);
+
+    // Cancelled while still queued
+    auto blocking_again = client.send_request_async(client.build_request("GET", "/block"));
+    bool cancelled_done = false;
+    std::optional<Response> cancelled_response;
+    uint64_t queued_id = client.send_request(client.build_request("GET", "/count"), [&](std::optional<Response> response) {
+        cancelled_response = std::move(response);
+        cancelled_done = true;
+    });
+    bool cancelled = client.cancel(queued_id);
+    wait_for([&] { return blocking_again.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }, std::chrono::seconds(5));
+    settle(std::chrono::milliseconds(50));
+    std::cout << "Cancelled while queued: cancel() " << (cancelled ? "yes" : "no") << ", completed with nothing: " << (cancelled_done && !cancelled_response ? "yes" : "no")
+              << ", handler ran " << counted << " times, cancelled at the server: " << server.stats().cancelled_requests
+              << ", cancel() again: " << (client.cancel(queued_id) ? "yes" : "no") << "\n";
+
+    // A running handler sees its deadline, then the client's cancel
+    auto timed_out = fetch(client, client.build_request("GET", "/loop"), std::chrono::milliseconds(100));
+    wait_for([&] { return loop_ran_ms > 0; }, std::chrono::seconds(3));
+    std::cout << "Handler with 100 ms left: saw " << (loop_remaining_ms > 0 && loop_remaining_ms <= 100 ? "at most 100 ms" : std::to_string(loop_remaining_ms) + " ms")
+              << " at the start, stopped early: " << (loop_ran_ms < 1000 ? "yes" : "no") << ", client got: " << timed_out << "\n";
+    loop_ran_ms = 0;
+    uint64_t loop_id = client.send_request(client.build_request("GET", "/loop"), [](std::optional<Response> response) {});
+    settle(std::chrono::milliseconds(30));
+    client.cancel(loop_id);
+    wait_for([&] { return loop_ran_ms > 0; }, std::chrono::seconds(3));
+    std::cout << "Handler cancelled by the client: stopped early: " << (loop_ran_ms < 1000 ? "yes" : "no")
+              << ", by request: " << (loop_saw_cancel ? "yes" : "no") << "\n";
+
+    server.stop();
+    std::cout << std::endl;
+}
+
+void test_deadline() {
+    test_deadline_token();
+    test_deadline_exchange();
+}
@@ -0,0 +1,253 @@
+#include "tests.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../http_request_parser.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <chrono>
+
+constexpr int EMULATED_REQUESTS = 100;
+
+static sockaddr_in emulated_address(const char* ip, int port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr(ip);
+    address.sin_port = htons(port);
+    return address;
+}
+
+static void run_emulated_exchange(const char* name, const Link_Conditions& conditions) {
+    std::cout << "Testing emulated network (" << name << "):" << std::endl;
+
+    Emulated_Network network(42, conditions);
+    Server server("10.0.0.1", 8080, network.create_transport());
+    server.register_route("/hello", [](const Request& req, const Route_Params& params) {
+        std::string body = "Hello, World!";
+        return create_response(Status_Code::OK, std::vector<uint8_t>(body.begin(), body.end()));
+    });
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+
+    auto wall_start = std::chrono::steady_clock::now();
+    auto virtual_start = network.now();
+
+    client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        return;
+    }
+
+    int completed = 0;
+    Request request;
+    request.request_line = Request_Line{"HTTP/2.5", "/hello", "GET"};
+    for (int i{}; i < EMULATED_REQUESTS; i++) {
+        client.begin_request(request);
+        std::optional<Response> response;
+        simulation.run_until([&] { return (response = client.poll_response()).has_value(); }, std::chrono::seconds(5));
+        if (response && response->response_line.status_code == OK) {
+            completed++;
+        }
+    }
+
+    auto virtual_ms = std::chrono::duration<double, std::milli>(network.now() - virtual_start).count();
+    auto wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+    Emulated_Network_Stats net = network.stats();
+
+    std::cout << "Completed: " << completed << "/" << EMULATED_REQUESTS << "\n";
+    std::cout << "Virtual time: " << virtual_ms << " ms, wall time: " << wall_ms << " ms\n";
+    std::cout << "Datagrams sent: " << net.sent << ", delivered: " << net.delivered << ", duplicated: " << net.duplicated
+              << ", reordered: " << net.reordered << ", lost: " << net.lost << "\n";
+    std::cout << std::endl;
+}
+
+// Many requests in flight on one association, collected newest first by stream id
+static void run_pipelined_exchange() {
+    std::cout << "Testing pipelined requests on one association:" << std::endl;
+
+    Link_Conditions conditions;
+    conditions.delay = std::chrono::milliseconds(20);
+    Emulated_Network network(7, conditions);
+    Server server("10.0.0.1", 8080, network.create_transport());
+    server.register_route("/echo/:n", [](const Request& req, const Route_Params& params) {
+        std::string body(params["n"]);
+        return create_response(Status_Code::OK, std::vector<uint8_t>(body.begin(), body.end()));
+    });
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+
+    client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        return;
+    }
+
+    constexpr int PIPELINED_REQUESTS = 20;
+    std::vector<uint64_t> stream_ids;
+    for (int i{}; i < PIPELINED_REQUESTS; i++) {
+        stream_ids.push_back(client.begin_request(client.build_request("GET", "/echo/" + std::to_string(i))));
+    }
+    std::cout << "In flight after sending: " << client.in_flight() << "\n";
+
+    auto virtual_start = network.now();
+    simulation.run_until([&] { return client.in_flight() == 0 && !client.poll(); }, std::chrono::seconds(5));
+    auto virtual_ms = std::chrono::duration<double, std::milli>(network.now() - virtual_start).count();
+
+    int matched = 0;
+    bool server_keep_alive = true;
+    for (int i = PIPELINED_REQUESTS - 1; i >= 0; i--) {
+        auto response = client.poll_response(stream_ids[i]);
+        if (response && std::string(response->body.begin(), response->body.end()) == std::to_string(i) &&
+            response->headers.get(HEADER_STREAM_ID) == std::to_string(stream_ids[i])) {
+            matched++;
+        }
+        server_keep_alive = server_keep_alive && response && response->headers.get(HEADER_CONNECTION) == "keep-alive";
+    }
+    bool keep_alive = client.build_request("GET", "/").headers.get(HEADER_CONNECTION) == "keep-alive";
+    std::cout << "Matched by stream id: " << matched << "/" << PIPELINED_REQUESTS << ", left over: " << (client.poll_response() ? "yes" : "no") << "\n";
+    std::cout << "All answered within one round trip: " << (virtual_ms < 60 ? "yes" : "no") << ", keep-alive by default: " << (keep_alive ? "yes" : "no")
+              << ", server keeps it: " << (server_keep_alive ? "yes" : "no") << "\n";
+    std::cout << std::endl;
+}
+
+static void run_completion_exchange() {
+    std::cout << "Testing request completions:" << std::endl;
+
+    Link_Conditions conditions;
+    conditions.delay = std::chrono::milliseconds(20);
+    Emulated_Network network(7, conditions);
+    Server server("10.0.0.1", 8080, network.create_transport());
+    server.register_route("/echo/:n", [](const Request& req, const Route_Params& params) {
+        std::string body(params["n"]);
+        return create_response(Status_Code::OK, std::vector<uint8_t>(body.begin(), body.end()));
+    });
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+
+    bool server_up = true;
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server_up && server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+
+    client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        return;
+    }
+
+    std::string callback_body;
+    client.send_request(client.build_request("GET", "/echo/1"), [&](std::optional<Response> response) {
+        callback_body = response ? std::string(response->body.begin(), response->body.end()) : "timeout";
+    });
+    auto future = client.send_request_async(client.build_request("GET", "/echo/2"));
+    simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(5));
+    std::optional<Response> future_response = future.wait_for(std::chrono::seconds(0)) == std::future_status::ready ? future.get() : std::nullopt;
+    std::cout << "Callback body: " << callback_body << ", future body: "
+              << (future_response ? std::string(future_response->body.begin(), future_response->body.end()) : "none")
+              << ", left for poll_response: " << (client.poll_response() ? "yes" : "no") << "\n";
+
+    // More headers than fit inline are served; a head over the limit is answered 431 and conflicting lengths 400, not dropped
+    Request many_headers = client.build_request("GET", "/echo/5");
+    for (int i{}; i < 40; i++) {
+        many_headers.headers.add("X-Field-" + std::to_string(i), std::to_string(i));
+    }
+    auto many_future = client.send_request_async(many_headers);
+    Request large_head = client.build_request("GET", "/echo/6");
+    large_head.headers.add("X-Large", std::string(MAX_REQUEST_HEAD_SIZE, 'x'));
+    auto large_future = client.send_request_async(large_head);
+    Request conflicting_length = client.build_request("POST", "/echo/7");
+    conflicting_length.headers.add(HEADER_CONTENT_LENGTH, "0");
+    conflicting_length.headers.add(HEADER_CONTENT_LENGTH, "50");
+    auto conflicting_future = client.send_request_async(conflicting_length);
+    simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(5));
+    auto status_of = [](std::future<std::optional<Response>>& pending) {
+        auto response = pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready ? pending.get() : std::nullopt;
+        return response ? std::to_string(response->response_line.status_code) : std::string("no response");
+    };
+    std::cout << "40 extra headers: " << status_of(many_future) << ", head over the limit: " << status_of(large_future)
+              << ", conflicting Content-Length: " << status_of(conflicting_future) << "\n";
+
+    // With the server gone quiet the deadline completes the request, a late response is dropped
+    server_up = false;
+    bool timed_out = false;
+    client.send_request(client.build_request("GET", "/echo/3"), [&](std::optional<Response> response) {
+        timed_out = !response;
+    }, std::chrono::milliseconds(50));
+    auto limit = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!timed_out && std::chrono::steady_clock::now() < limit) {
+        client.poll();
+    }
+    std::cout << "Timed out: " << (timed_out ? "yes" : "no") << ", in flight after timeout: " << client.in_flight() << "\n";
+
+    bool failed_on_disconnect = false;
+    client.send_request(client.build_request("GET", "/echo/4"), [&](std::optional<Response> response) {
+        failed_on_disconnect = !response;
+    });
+    client.disconnect();
+    std::cout << "Pending request failed on disconnect: " << (failed_on_disconnect ? "yes" : "no") << "\n";
+    std::cout << std::endl;
+}
+
+// The INIT_ACK never arrives, so both ends give the handshake up and drop its stats
+static void run_abandoned_handshake() {
+    std::cout << "Testing abandoned handshake:" << std::endl;
+
+    Emulated_Network network(3);
+    Link_Conditions lossy;
+    lossy.loss_rate = 1.0;
+    network.set_link_conditions(emulated_address("10.0.0.1", 8080), emulated_address("10.0.0.2", 5000), lossy);
+
+    SCTP_Socket server(network.create_transport());
+    server.sctp_bind("10.0.0.1", 8080);
+    server.sctp_run(EVENT_LOOP_MANUAL);
+    SCTP_Socket client(network.create_transport());
+    client.sctp_bind("10.0.0.2", 5000);
+    client.sctp_run(EVENT_LOOP_MANUAL);
+
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.sctp_poll(); });
+    simulation.add_poller([&] { return client.sctp_poll(); });
+    simulation.add_timer([&] { return server.sctp_next_timer(); });
+    simulation.add_timer([&] { return client.sctp_next_timer(); });
+    client.sctp_associate("10.0.0.1", 8080);
+    simulation.run_until([&] { return !server.stats().associations.empty(); }, std::chrono::seconds(5));
+    std::cout << "Half-open associations: server " << server.stats().associations.size() << ", client " << client.stats().associations.size() << "\n";
+
+    // The sweep timers alone carry the clock past the timeout
+    auto started = network.now();
+    simulation.run_until([&] { return server.stats().associations.empty() && client.stats().associations.empty(); }, 2 * HANDSHAKE_TIMEOUT);
+    auto waited = std::chrono::duration_cast<std::chrono::seconds>(network.now() - started);
+    std::cout << "After the handshake timeout: server " << server.stats().associations.size() << ", client " << client.stats().associations.size()
+              << ", within a second of it: " << (waited >= HANDSHAKE_TIMEOUT - std::chrono::seconds(1) && waited <= HANDSHAKE_TIMEOUT + std::chrono::seconds(1) ? "yes" : "no") << "\n";
+    std::cout << std::endl;
+}
+
+void test_emulated_network() {
+    Link_Conditions clean;
+    clean.delay = std::chrono::milliseconds(20);
+    clean.bandwidth_bps = 10000000;
+    run_emulated_exchange("20 ms, 10 Mbit/s", clean);
+
+    Link_Conditions noisy = clean;
+    noisy.jitter = std::chrono::milliseconds(5);
+    noisy.duplicate_rate = 0.05;
+    noisy.reorder_rate = 0.1;
+    run_emulated_exchange("20 ms +5 ms jitter, 5% duplication, 10% reordering", noisy);
+
+    run_pipelined_exchange();
+    run_completion_exchange();
+    run_abandoned_handshake();
+}
@@ -0,0 +1,264 @@
+#include "tests.hpp"
+#include "../http_header_codec.hpp"
+#include "../http_response_writer.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+static std::string hex(const std::vector<uint8_t>& bytes) {
+    std::ostringstream out;
+    for (size_t i{}; i < bytes.size(); i++) {
+        out << (i ? " " : "") << std::hex << std::setw(2) << std::setfill('0') << int(bytes[i]);
+    }
+    return out.str();
+}
+
+static Request sample_request(const std::string& method, const std::string& uri, const std::string& body = "") {
+    Request request;
+    request.request_line = Request_Line{"HTTP/2.5", uri, method};
+    request.headers.add(HEADER_HOST, "10.0.0.1:8080");
+    request.headers.add(HEADER_CONNECTION, "keep-alive");
+    request.headers.add(HEADER_USER_AGENT, "HTTP2.5-Client/1.0");
+    request.headers.add(HEADER_ACCEPT_ENCODING, "gzip, deflate");
+    request.headers.add("X-Trace", "a1b2c3d4e5f6");
+    if (!body.empty()) {
+        request.headers.add(HEADER_CONTENT_TYPE, "application/json");
+        request.body.assign(body.begin(), body.end());
+    }
+    return request;
+}
+
+void test_header_codec_primitives() {
+    std::cout << "Testing header codec primitives:" << std::endl;
+    // RFC 7541 C.1: 10 and 1337 with a 5-bit prefix, 42 with an 8-bit one
+    for (auto [value, prefix] : {std::pair<uint64_t, uint8_t>{10, 5}, {1337, 5}, {42, 8}}) {
+        std::vector<uint8_t> encoded;
+        encode_header_integer(value, prefix, 0, encoded);
+        size_t position = 0;
+        auto decoded = decode_header_integer(encoded, position, prefix);
+        std::cout << "Integer " << value << " with a " << int(prefix) << "-bit prefix: " << hex(encoded)
+                  << ", decodes to " << (decoded ? std::to_string(*decoded) : "nothing") << "\n";
+    }
+    std::vector<uint8_t> endless(12, 0xff);
+    size_t position = 0;
+    std::cout << "Integer without an end decodes: " << (decode_header_integer(endless, position, 7) ? "yes" : "no") << "\n";
+
+    std::string every_byte;
+    for (int i{}; i < 256; i++) {
+        every_byte.push_back(static_cast<char>(i));
+    }
+    for (std::string text : {std::string("application/json"), std::string("Mon, 06 Nov 2026 08:49:37 GMT"), std::string(), every_byte}) {
+        std::vector<uint8_t> coded;
+        huffman_encode(text, coded);
+        std::string decoded;
+        bool ok = huffman_decode(coded, decoded);
+        std::cout << "Huffman " << text.size() << " bytes -> " << (coded.size() < text.size() ? "shorter" : "not shorter")
+                  << ", size matches estimate: " << (coded.size() == huffman_encoded_size(text) ? "yes" : "no")
+                  << ", round trip: " << (ok && decoded == text ? "yes" : "no") << "\n";
+    }
+    std::vector<uint8_t> coded;
+    huffman_encode("gzip", coded);
+    coded.push_back(0xff); // A whole byte of padding
+    std::string decoded;
+    std::cout << "Huffman with 8 bits of padding decodes: " << (huffman_decode(coded, decoded) ? "yes" : "no") << "\n";
+    coded.pop_back();
+    coded.back() &= 0xfe;
+    decoded.clear();
+    std::cout << "Huffman with zero padding decodes: " << (huffman_decode(coded, decoded) ? "yes" : "no") << "\n";
+
+    std::cout << "Offer: " << header_compression_offer(4096) << ", parsed: " << parse_header_compression_offer("hpack; table=2048").value_or(0)
+              << ", bare: " << parse_header_compression_offer("hpack").value_or(0)
+              << ", unknown scheme accepted: " << (parse_header_compression_offer("qpack; table=1") ? "yes" : "no") << "\n";
+    std::cout << std::endl;
+}
+
+void test_header_codec_tables() {
+    std::cout << "Testing header codec tables:" << std::endl;
+    Header_Encoder encoder(DEFAULT_HEADER_TABLE_SIZE);
+    Header_Decoder decoder(DEFAULT_HEADER_TABLE_SIZE);
+    std::vector<uint8_t> text = serialize_request(sample_request("GET", "/users/42"));
+
+    std::vector<size_t> sizes;
+    bool intact = true;
+    for (const char* uri : {"/users/42", "/users/42", "/users/43"}) {
+        Request request = sample_request("GET", uri);
+        std::vector<uint8_t> encoded;
+        encoder.encode_request(request, 7, encoded);
+        sizes.push_back(encoded.size());
+        auto decoded = decoder.decode_request(encoded);
+        intact = intact && decoded && decoded->request_line.uri == uri && decoded->request_line.method == "GET" &&
+                 decoded->headers.get("X-Trace").value_or("") == "a1b2c3d4e5f6" && decoded->headers.get(HEADER_STREAM_ID).value_or("") == "7";
+    }
+    std::cout << "Plain request: " << text.size() << " bytes, compressed first: " << (sizes[0] < text.size() / 2 ? "under half" : std::to_string(sizes[0]))
+              << ", repeated: " << (sizes[1] < 16 ? "under 16 bytes" : std::to_string(sizes[1]))
+              << ", new path: " << (sizes[2] < sizes[0] ? "smaller than the first" : std::to_string(sizes[2]))
+              << ", decoded intact: " << (intact ? "yes" : "no") << "\n";
+
+    Request upload = sample_request("POST", "/users", "{\"name\": \"Jane Doe\"}");
+    upload.headers.add(HEADER_AUTHORIZATION, "Bearer secret-token");
+    std::vector<uint8_t> encoded;
+    encoder.encode_request(upload, 8, encoded);
+    decoder.decode_request(encoded);
+    encoded.clear();
+    encoder.encode_request(upload, 9, encoded);
+    auto decoded = decoder.decode_request(encoded);
+    std::string body = decoded ? std::string(decoded->body.begin(), decoded->body.end()) : "";
+    std::vector<uint8_t> token;
+    huffman_encode("Bearer secret-token", token);
+    bool token_repeated = std::search(encoded.begin(), encoded.end(), token.begin(), token.end()) != encoded.end();
+    std::cout << "Body: " << body << ", Content-Length: " << (decoded ? decoded->headers.get(HEADER_CONTENT_LENGTH).value_or("none") : "none")
+              << ", Authorization: " << (decoded ? decoded->headers.get(HEADER_AUTHORIZATION).value_or("none") : "none")
+              << ", token literal again on the second request: " << (token_repeated ? "yes" : "no") << "\n";
+
+    Header_Encoder response_encoder(DEFAULT_HEADER_TABLE_SIZE);
+    Header_Decoder response_decoder(DEFAULT_HEADER_TABLE_SIZE);
+    Headers block_headers;
+    block_headers.add(HEADER_SERVER, "HTTP2.5-Server/1.0");
+    block_headers.add(HEADER_CONTENT_TYPE, "text/plain");
+    block_headers.add("X-Route", "block");
+    Header_Block block = make_header_block(block_headers);
+    Response response = create_response(Status_Code::NotFound, std::vector<uint8_t>{'n', 'o'});
+    response.headers.set(HEADER_CONTENT_TYPE, "application/json");
+    response.headers.add("x-route", "handler");
+    response.headers.set(HEADER_STREAM_ID, "12");
+    std::vector<uint8_t> response_bytes;
+    response_encoder.encode_response(response, &block, response_bytes);
+    // Unlisted names are matched against the block without regard to case, like interned ones
+    auto route_fields = [](const std::optional<Response>& decoded) {
+        std::string fields;
+        for (size_t i{}; decoded && i < decoded->headers.size(); i++) {
+            if (iequals(decoded->headers[i].name, "X-Route")) {
+                fields += (fields.empty() ? "" : ", ") + std::string(decoded->headers[i].value);
+            }
+        }
+        return fields.empty() ? std::string("none") : fields;
+    };
+    auto decoded_response = response_decoder.decode_response(response_bytes);
+    std::cout << "Response: " << (decoded_response ? std::to_string(decoded_response->response_line.status_code) + " " + decoded_response->response_line.reason_phrase : "undecodable")
+              << ", block Content-Type wins: " << (decoded_response ? decoded_response->headers.get(HEADER_CONTENT_TYPE).value_or("none") : "none")
+              << ", X-Route fields: " << route_fields(decoded_response)
+              << ", Date: " << (decoded_response && decoded_response->headers.contains(HEADER_DATE) ? "yes" : "no")
+              << ", Stream-Id: " << (decoded_response ? decoded_response->headers.get(HEADER_STREAM_ID).value_or("none") : "none") << "\n";
+
+    // A small table evicts as it goes and both sides keep agreeing
+    Header_Encoder small_encoder(128);
+    Header_Decoder small_decoder(128);
+    bool agree = true;
+    for (int i{}; i < 50; i++) {
+        Request request = sample_request("GET", "/items/" + std::to_string(i % 7));
+        request.headers.add("X-Request", std::to_string(i % 5));
+        std::vector<uint8_t> bytes;
+        small_encoder.encode_request(request, i + 1, bytes);
+        auto result = small_decoder.decode_request(bytes);
+        agree = agree && result && result->request_line.uri == request.request_line.uri && result->headers.get("X-Request") == request.headers.get("X-Request");
+    }
+    std::cout << "Small table stays in sync over 50 requests: " << (agree ? "yes" : "no") << ", within its size: " << (small_encoder.table_size() <= 128 ? "yes" : "no") << "\n";
+
+    // An index the decoder never inserted and a block longer than the message
+    Header_Decoder fresh(DEFAULT_HEADER_TABLE_SIZE);
+    std::vector<uint8_t> bad_index = {HEADER_BLOCK_MARKER, 1, 0x80 | 60};
+    std::vector<uint8_t> truncated = {HEADER_BLOCK_MARKER, 40, 0x82};
+    std::vector<uint8_t> too_large_update = {HEADER_BLOCK_MARKER, 4, 0x3f, 0xe1, 0xff, 0x03};
+    std::cout << "Unknown index decodes: " << (fresh.decode_request(bad_index) ? "yes" : "no")
+              << ", truncated block: " << (fresh.decode_request(truncated) ? "yes" : "no")
+              << ", table size over the limit: " << (fresh.decode_request(too_large_update) ? "yes" : "no") << "\n";
+    std::cout << std::endl;
+}
+
+void test_header_codec_exchange() {
+    std::cout << "Testing header compression through the server:" << std::endl;
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    server.register_route("/echo/:word", [](const Request& req, const Route_Params& params) {
+        std::string word(params["word"]);
+        Response response = create_response(Status_Code::OK, std::vector<uint8_t>(word.begin(), word.end()));
+        response.headers.set(HEADER_CONTENT_TYPE, "text/plain");
+        return response;
+    });
+    server.register_route(METHOD_POST, "/length", [](const Request& req, const Route_Params& params) {
+        std::string size = std::to_string(req.body.size()) + " " + std::string(req.headers.get(HEADER_CONTENT_LENGTH).value_or("none"));
+        return create_response(Status_Code::OK, std::vector<uint8_t>(size.begin(), size.end()));
+    });
+    server.configure_header_compression(Header_Compression_Config{});
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.configure_header_compression(Header_Compression_Config{});
+    client.start(EVENT_LOOP_MANUAL);
+    Client plain("10.0.0.3", 5000, network.create_transport());
+    plain.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    simulation.add_poller([&] { return plain.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    plain.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected() && plain.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        return;
+    }
+
+    auto fetch = [&](Client& from, Request request) {
+        auto future = from.send_request_async(request);
+        simulation.run_until([&] { return from.in_flight() == 0; }, std::chrono::seconds(5));
+        return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready ? future.get() : std::nullopt;
+    };
+    auto text = [](const std::optional<Response>& response) {
+        return response ? std::to_string(response->response_line.status_code) + " " + std::string(response->body.begin(), response->body.end()) : std::string("no response");
+    };
+
+    auto first = fetch(client, client.build_request("GET", "/echo/first"));
+    std::cout << "First request: " << text(first) << ", compression active afterwards: " << (client.header_compression_active() ? "yes" : "no") << "\n";
+
+    // Pipelined, so the tables must advance in wire order on both sides
+    std::vector<std::future<std::optional<Response>>> futures;
+    for (int i{}; i < 8; i++) {
+        futures.push_back(client.send_request_async(client.build_request("GET", "/echo/word" + std::to_string(i))));
+    }
+    simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(5));
+    bool matched = true;
+    for (int i{}; i < 8; i++) {
+        auto response = futures[i].get();
+        matched = matched && text(response) == "200 word" + std::to_string(i) && response->headers.get(HEADER_CONTENT_TYPE) == "text/plain";
+    }
+    std::cout << "Eight pipelined compressed requests matched: " << (matched ? "yes" : "no") << "\n";
+
+    auto posted = fetch(client, client.build_request("POST", "/length", "{\"name\": \"Jane Doe\"}"));
+    auto missing = fetch(client, client.build_request("GET", "/nowhere"));
+    std::cout << "Compressed POST: " << text(posted) << ", unknown route: " << text(missing) << "\n";
+
+    auto plain_response = fetch(plain, plain.build_request("GET", "/echo/plain"));
+    std::cout << "Client without compression: " << text(plain_response) << ", offered nothing back: "
+              << (plain_response && !plain_response->headers.contains(HEADER_COMPRESSION) ? "yes" : "no") << "\n";
+    std::cout << "Compressed requests at the server: " << server.stats().compressed_requests << "\n";
+
+    // A client restarted on the same address starts from empty tables, the server must forget the old ones
+    client.disconnect();
+    Client restarted("10.0.0.2", 5000, network.create_transport());
+    restarted.configure_header_compression(Header_Compression_Config{});
+    restarted.start(EVENT_LOOP_MANUAL);
+    simulation.add_poller([&] { return restarted.poll(); });
+    restarted.begin_connect("10.0.0.1", 8080);
+    simulation.run_until([&] { return restarted.poll_connected(); }, std::chrono::seconds(5));
+    size_t codecs_after_restart = server.stats().header_codecs;
+    auto again = fetch(restarted, restarted.build_request("GET", "/echo/again"));
+    auto compressed_again = fetch(restarted, restarted.build_request("GET", "/echo/compressed"));
+    std::cout << "After a restart: codecs kept " << codecs_after_restart << ", " << text(again) << ", then " << text(compressed_again)
+              << ", compression active: " << (restarted.header_compression_active() ? "yes" : "no") << ", codecs: " << server.stats().header_codecs << "\n";
+
+    server.stop();
+    std::cout << std::endl;
+}
+
+void test_header_codec() {
+    test_header_codec_primitives();
+    test_header_codec_tables();
+    test_header_codec_exchange();
+}
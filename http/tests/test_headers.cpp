@@ -0,0 +1,65 @@
+#include "tests.hpp"
+#include "../http_headers.hpp"
+#include <iostream>
+#include <string>
+
+static void print_headers(const Headers& headers) {
+    for (const auto& [name, value] : headers) {
+        std::cout << name << ": " << value << "\n";
+    }
+}
+
+void test_headers_lookup() {
+    std::cout << "Testing Headers lookup and order:" << std::endl;
+    Headers headers;
+    headers.add("content-type", "text/plain");
+    headers.add("X-Request-Id", "abc123");
+    headers.add(HEADER_SET_COOKIE, "a=1");
+    headers.add("Set-Cookie", "b=2");
+    headers.set("CONTENT-TYPE", "application/json");
+    print_headers(headers);
+    std::cout << "x-request-id: " << headers.get("x-request-id").value_or("missing") << "\n";
+    std::cout << "first Set-Cookie: " << headers.get(HEADER_SET_COOKIE).value_or("missing") << "\n";
+    std::cout << "Removed Set-Cookie fields: " << headers.remove("set-cookie") << "\n";
+    std::cout << "Has Host: " << (headers.contains(HEADER_HOST) ? "yes" : "no") << "\n";
+
+    std::cout << std::endl;
+}
+
+void test_headers_overflow() {
+    std::cout << "Testing Headers beyond the inline capacity:" << std::endl;
+    Headers headers;
+    for (size_t i{}; i < HEADERS_INLINE_CAPACITY + 4; i++) {
+        headers.add("X-Field-" + std::to_string(i), std::to_string(i));
+    }
+    headers.add(HEADER_HOST, "example.com");
+    std::cout << "Fields: " << headers.size() << ", last: " << headers[headers.size() - 1].name << "\n";
+    std::cout << "X-Field-18: " << headers.get("x-field-18").value_or("missing") << "\n";
+    std::cout << "Host: " << headers.get("host").value_or("missing") << "\n";
+
+    std::cout << std::endl;
+}
+
+void test_headers_views() {
+    std::cout << "Testing Headers views into a caller buffer:" << std::endl;
+    std::string buffer = "Host: example.com\r\nX-Trace: on\r\n";
+    std::string_view raw = buffer;
+    Headers headers;
+    headers.add_view(header_id("Host"), raw.substr(0, 4), raw.substr(6, 11), buffer.data());
+    headers.add_view(header_id("X-Trace"), raw.substr(19, 7), raw.substr(28, 2), buffer.data());
+
+    // Same bytes at a new address, then the original is overwritten
+    std::string moved = buffer;
+    headers.set_view_base(moved.data());
+    headers.detach_views();
+    moved.assign(moved.size(), '?');
+    print_headers(headers);
+
+    std::cout << std::endl;
+}
+
+void test_headers() {
+    test_headers_lookup();
+    test_headers_overflow();
+    test_headers_views();
+}
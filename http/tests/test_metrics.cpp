@@ -0,0 +1,117 @@
+#include "tests.hpp"
+#include "../http_metrics.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+void test_metrics_registry() {
+    std::cout << "Testing metrics registry:" << std::endl;
+    using std::chrono::microseconds;
+    std::cout << "Buckets of 0, 1, 1.001, 2, 3, 1000 us and an hour: " << latency_bucket(microseconds(0)) << " " << latency_bucket(microseconds(1)) << " "
+              << latency_bucket(std::chrono::nanoseconds(1001)) << " " << latency_bucket(microseconds(2)) << " " << latency_bucket(microseconds(3)) << " "
+              << latency_bucket(microseconds(1000)) << " " << latency_bucket(std::chrono::hours(1)) << "\n";
+
+    // Four threads, each with its own shard, summed on snapshot
+    Metrics_Registry registry;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&registry, t] {
+            for (int i = 0; i < 1000; i++) {
+                Request_Sample sample{static_cast<size_t>(i % 2), METHOD_GET, {}, i % 10 == 0 ? 404 : 200, 100, 1000};
+                sample.phases[PHASE_HANDLER] = microseconds(t + 1);
+                registry.record(sample);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::cout << "Shards: " << registry.shard_count() << "\n";
+    for (const Series_Snapshot& series : registry.snapshot()) {
+        std::cout << "Series " << series.series << " " << method_name(series.method) << ": " << series.requests << " requests, "
+                  << series.request_bytes << " bytes in, " << series.response_bytes << " out, handler count " << series.phases[PHASE_HANDLER].count
+                  << " sum " << std::chrono::duration_cast<microseconds>(series.phases[PHASE_HANDLER].sum).count() << " us, parse count "
+                  << series.phases[PHASE_PARSE].count << ", codes";
+        for (const auto& [code, count] : series.status_counts) {
+            std::cout << " " << code << "x" << count;
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::endl;
+}
+
+void test_metrics_server() {
+    std::cout << "Testing metrics endpoint:" << std::endl;
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    server.configure_metrics();
+    server.register_route(METHOD_GET, "/users/:id", [](const Request& req, const Route_Params& params) {
+        return create_response(Status_Code::OK, std::vector<uint8_t>(16, 'x'));
+    });
+    server.register_route(METHOD_POST, "/users/:id", [](const Request& req, const Route_Params& params) {
+        return create_response(Status_Code::BadRequest, std::vector<uint8_t>{});
+    });
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        server.stop();
+        return;
+    }
+
+    auto fetch = [&](const std::string& method, const std::string& uri) {
+        uint64_t stream_id = client.begin_request(client.build_request(method, uri));
+        simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(5));
+        return client.poll_response(stream_id);
+    };
+    for (int i = 0; i < 3; i++) {
+        fetch("GET", "/users/" + std::to_string(i));
+    }
+    fetch("POST", "/users/1");
+    fetch("GET", "/missing");
+    fetch("DELETE", "/users/1");
+
+    auto response = fetch("GET", "/metrics");
+    if (!response) {
+        std::cout << "No response from /metrics\n" << std::endl;
+        server.stop();
+        return;
+    }
+    std::cout << "Status: " << response->response_line.status_code << ", Content-Type: " << response->headers.get(HEADER_CONTENT_TYPE).value_or("-") << "\n";
+    std::span<const uint8_t> body = response_body(*response);
+    std::istringstream text(std::string(body.begin(), body.end()));
+    std::string line;
+    size_t buckets = 0;
+    while (std::getline(text, line)) {
+        if (line.starts_with("http_requests_total") || line.starts_with("http_responses_total") || line.starts_with("http_response_bytes_total")) {
+            std::cout << line << "\n";
+        } else if (line.starts_with("http_request_phase_seconds_bucket{route=\"/users/:id\",method=\"GET\",phase=\"handler\"")) {
+            buckets++;
+        } else if (line.starts_with("sctp_packets_received_total ") || line.starts_with("sctp_association_cwnd_bytes{")) {
+            std::cout << line.substr(0, line.find(' ')) << " present\n";
+        }
+    }
+    std::cout << "Handler buckets of GET /users/:id: " << buckets << "\n";
+
+    // The scrape itself is recorded once it is answered
+    size_t series_count = server.metrics().size();
+    std::cout << "Series after the scrape: " << series_count << ", transport packets in: " << (server.stats().transport.totals.packets_in > 0 ? "counted" : "none") << "\n";
+    server.stop();
+    std::cout << std::endl;
+}
+
+void test_metrics() {
+    test_metrics_registry();
+    test_metrics_server();
+}
@@ -0,0 +1,107 @@
+#include "tests.hpp"
+#include "../http_middleware.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Appends its name to X-Trace on the way in and on the way out
+static auto trace_step(std::string name) {
+    return [name](const Request& req, const Route_Params& params, const auto& next) {
+        Request traced = req;
+        traced.headers.set("X-Trace", std::string(req.headers.get("X-Trace").value_or("")) + name + ">");
+        Response response = next(traced, params);
+        response.headers.set("X-Trace", std::string(response.headers.get("X-Trace").value_or("")) + "<" + name);
+        return response;
+    };
+}
+
+static Response trace_handler(const Request& req, const Route_Params& params) {
+    Response response = create_response(Status_Code::OK, std::vector<uint8_t>{});
+    response.headers.set("X-Trace", std::string(req.headers.get("X-Trace").value_or("")) + "handler");
+    return response;
+}
+
+static auto require_auth = [](const Request& req, const Route_Params& params, const auto& next) {
+    if (!req.headers.contains(HEADER_AUTHORIZATION)) {
+        return create_response(Status_Code::Unauthorized, std::vector<uint8_t>{});
+    }
+    return next(req, params);
+};
+
+static std::string trace_of(const Response& response) {
+    return std::to_string(response.response_line.status_code) + " " + std::string(response.headers.get("X-Trace").value_or("-"));
+}
+
+void test_middleware_chains() {
+    std::cout << "Testing middleware chains:" << std::endl;
+    Request request;
+    request.request_line = Request_Line{"HTTP/2.5", "/", "GET"};
+    Route_Params params;
+
+    Route_Handler chained = Middleware_Chain(trace_step("a"), trace_step("b")).wrap(trace_handler);
+    std::cout << "Compile-time chain: " << trace_of(chained(request, params)) << "\n";
+
+    Middleware_Chain inner(trace_step("b"), trace_step("c"));
+    Route_Handler nested = Middleware_Chain(trace_step("a"), inner).wrap(trace_handler);
+    std::cout << "Nested chain: " << trace_of(nested(request, params)) << "\n";
+
+    std::vector<Middleware> middlewares{trace_step("a"), trace_step("b")};
+    std::cout << "Run-time chain: " << trace_of(apply_middleware(middlewares, trace_handler)(request, params))
+              << ", without middlewares: " << trace_of(apply_middleware({}, trace_handler)(request, params)) << "\n";
+
+    Route_Handler guarded = Middleware_Chain(trace_step("a"), require_auth, trace_step("b")).wrap(trace_handler);
+    Request authorized = request;
+    authorized.headers.set(HEADER_AUTHORIZATION, "Bearer token");
+    std::cout << "Auth without credentials: " << trace_of(guarded(request, params)) << ", with: " << trace_of(guarded(authorized, params)) << "\n";
+    std::cout << std::endl;
+}
+
+void test_middleware_server() {
+    std::cout << "Testing middleware in the server:" << std::endl;
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    server.register_route("/before", trace_handler);
+    server.add_middleware(trace_step("outer"));
+    server.add_middleware(Middleware_Chain(require_auth, trace_step("inner")));
+    server.register_route("/after", trace_handler);
+    server.register_route("/static", Middleware_Chain(trace_step("route")).wrap(trace_handler));
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        server.stop();
+        return;
+    }
+
+    auto fetch = [&](const std::string& uri, bool authorized) {
+        Request request = client.build_request("GET", uri);
+        if (authorized) {
+            request.headers.set(HEADER_AUTHORIZATION, "Bearer token");
+        }
+        uint64_t stream_id = client.begin_request(request);
+        simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(5));
+        auto response = client.poll_response(stream_id);
+        return response ? trace_of(*response) : std::string("no response");
+    };
+    std::cout << "Registered before add_middleware: " << fetch("/before", false) << "\n";
+    std::cout << "Registered after: " << fetch("/after", true) << ", without credentials: " << fetch("/after", false) << "\n";
+    std::cout << "With its own chain inside: " << fetch("/static", true) << "\n";
+    std::cout << "Unknown path: " << fetch("/missing", false) << "\n";
+
+    server.stop();
+    std::cout << std::endl;
+}
+
+void test_middleware() {
+    test_middleware_chains();
+    test_middleware_server();
+}
@@ -0,0 +1,107 @@
+#include "tests.hpp"
+#include "../http_request_parser.hpp"
+#include <iostream>
+#include <string>
+#include <utility>
+
+static const std::string PARSER_TEST_REQUEST =
+    "POST /users/42 HTTP/2.5\r\n"
+    "Host: example.com\r\n"
+    "User-Agent: TestAgent\r\n"
+    "Content-Length: 32\r\n"
+    "\r\n"
+    "This is the body of the request.";
+
+static void print_request_view(const Request_View& view) {
+    std::cout << "Method: " << view.method << "\n";
+    std::cout << "URI: " << view.uri << "\n";
+    std::cout << "Version: " << view.version << "\n";
+    for (const auto& [name, value] : view.headers) {
+        std::cout << name << ": " << value << "\n";
+    }
+    std::cout << "Body: " << std::string(view.body.begin(), view.body.end()) << "\n";
+}
+
+void test_request_parser_complete() {
+    std::cout << "Testing Request_Parser with a complete request:" << std::endl;
+    Request_Parser parser;
+    if (parser.parse(PARSER_TEST_REQUEST) == PARSE_COMPLETE) {
+        print_request_view(parser.view());
+        std::cout << "content-length lookup: " << parser.view().headers.get("content-length").value_or("missing") << "\n";
+    } else {
+        std::cout << "Failed to parse request.\n";
+    }
+
+    std::cout << std::endl;
+}
+
+void test_request_parser_fragmented() {
+    std::cout << "Testing Request_Parser fed one byte at a time:" << std::endl;
+    Request_Parser parser;
+    Parse_Status status = PARSE_INCOMPLETE;
+    size_t incomplete_calls = 0;
+    for (size_t received = 1; received <= PARSER_TEST_REQUEST.size() && status == PARSE_INCOMPLETE; received++) {
+        status = parser.parse(std::string_view(PARSER_TEST_REQUEST).substr(0, received));
+        incomplete_calls += status == PARSE_INCOMPLETE;
+    }
+    if (status == PARSE_COMPLETE) {
+        std::cout << "Incomplete calls before completion: " << incomplete_calls << "\n";
+        print_request_view(parser.view());
+    } else {
+        std::cout << "Failed to parse fragmented request.\n";
+    }
+
+    std::cout << std::endl;
+}
+
+void test_request_parser_malformed() {
+    std::cout << "Testing Request_Parser with malformed requests:" << std::endl;
+    const std::string malformed[] = {
+        "GET /index.html HTTP/1.1\r\n\r\n",
+        "GET /index.html HTTP/2.5\r\nHost example.com\r\n\r\n",
+        "GET /index.html HTTP/2.5\r\nContent-Length: 12abc\r\n\r\n",
+    };
+    for (const auto& raw : malformed) {
+        Request_Parser parser;
+        std::cout << (parser.parse(raw) == PARSE_ERROR ? "Rejected" : "Accepted") << "\n";
+    }
+
+    // A repeated Content-Length must agree, or the body framing and what handlers read could differ
+    const std::pair<const char*, std::string> repeated_lengths[] = {
+        {"same", "POST /upload HTTP/2.5\r\nStream-Id: 9\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\nhello"},
+        {"different", "POST /upload HTTP/2.5\r\nStream-Id: 9\r\nContent-Length: 5\r\ncontent-length: 50\r\n\r\nhello"},
+    };
+    for (const auto& [name, raw] : repeated_lengths) {
+        Request_Parser parser;
+        Parse_Status status = parser.parse(raw);
+        std::cout << "Repeated Content-Length, " << name << ": "
+                  << (status == PARSE_COMPLETE ? "parsed, body " + std::to_string(parser.view().body.size()) + " bytes" :
+                      status == PARSE_CONFLICTING_LENGTH ? "conflicting" : "other error")
+                  << ", Stream-Id: " << parser.view().headers.get(HEADER_STREAM_ID).value_or("none") << "\n";
+    }
+
+    // The head size is the only limit on the number of headers
+    std::string many_headers = "GET / HTTP/2.5\r\nStream-Id: 7\r\n";
+    for (int i{}; i < 100; i++) {
+        many_headers += "X-Field-" + std::to_string(i) + ": " + std::to_string(i) + "\r\n";
+    }
+    Request_Parser many_parser;
+    bool many_parsed = many_parser.parse(many_headers + "\r\n") == PARSE_COMPLETE;
+    std::cout << "101 headers: " << (many_parsed ? "parsed, " + std::to_string(many_parser.view().headers.size()) + " kept" : "rejected") << "\n";
+
+    std::string large_head = "GET / HTTP/2.5\r\nStream-Id: 7\r\nX-Large: " + std::string(MAX_REQUEST_HEAD_SIZE, 'x') + "\r\n\r\n";
+    for (size_t size : {large_head.size(), MAX_REQUEST_HEAD_SIZE + 1}) {
+        Request_Parser parser;
+        Parse_Status status = parser.parse(std::string_view(large_head).substr(0, size));
+        std::cout << "Head over the limit, " << (size == large_head.size() ? "whole" : "no line end yet") << ": "
+                  << (status == PARSE_HEAD_TOO_LARGE ? "too large" : "not flagged") << ", Stream-Id: " << parser.view().headers.get(HEADER_STREAM_ID).value_or("none") << "\n";
+    }
+
+    std::cout << std::endl;
+}
+
+void test_request_parser() {
+    test_request_parser_complete();
+    test_request_parser_fragmented();
+    test_request_parser_malformed();
+}
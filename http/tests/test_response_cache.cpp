@@ -0,0 +1,222 @@
+#include "tests.hpp"
+#include "../http_response_cache.hpp"
+#include "../http_response_writer.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <algorithm>
+
+static bool store(Response_Cache& cache, const std::string& uri, const Headers& request_headers, const std::string& body,
+                  const std::string& cache_control, const std::string& vary = "") {
+    Headers response_headers;
+    response_headers.set(HEADER_CACHE_CONTROL, cache_control);
+    if (!vary.empty()) {
+        response_headers.set(HEADER_VARY, vary);
+    }
+    Response response = create_response(Status_Code::OK, std::vector<uint8_t>(body.begin(), body.end()));
+    response.headers = response_headers;
+    std::vector<uint8_t> wire;
+    write_response(response, nullptr, wire);
+    return cache.store("GET", uri, request_headers, Status_Code::OK, response_headers, std::move(wire)).has_value();
+}
+
+static std::string cached_body(Response_Cache& cache, const std::string& uri, const Headers& request_headers) {
+    auto cached = cache.lookup("GET", uri, request_headers);
+    if (!cached) {
+        return "miss";
+    }
+    std::vector<uint8_t> out;
+    write_cached_response(*cached, std::nullopt, out);
+    auto response = parse_http_response(out);
+    return response ? std::string(response->body.begin(), response->body.end()) : "unparsable";
+}
+
+void test_response_cache_policy() {
+    std::cout << "Testing response cache policy:" << std::endl;
+    Response_Cache cache(Response_Cache_Config{.shards = 4});
+    Headers plain;
+
+    for (const char* cache_control : {"max-age=60", "public, s-maxage=60, max-age=0", "no-store, max-age=60", "private, max-age=60", "max-age=0", "no-cache", "max-age=abc"}) {
+        std::cout << "Cache-Control \"" << cache_control << "\" stored: " << (store(cache, std::string("/policy/") + cache_control, plain, "x", cache_control) ? "yes" : "no") << "\n";
+    }
+
+    Headers gzip;
+    gzip.add(HEADER_ACCEPT_ENCODING, "gzip");
+    store(cache, "/vary", plain, "identity body", "max-age=60", "Accept-Encoding");
+    store(cache, "/vary", gzip, "gzip body", "max-age=60", "Accept-Encoding");
+    std::cout << "Vary plain: " << cached_body(cache, "/vary", plain) << ", gzip: " << cached_body(cache, "/vary", gzip) << "\n";
+    std::cout << "Vary *: " << (store(cache, "/star", plain, "x", "max-age=60", "*") ? "stored" : "not stored") << "\n";
+
+    Headers with_auth;
+    with_auth.add(HEADER_AUTHORIZATION, "Bearer x");
+    Headers no_cache;
+    no_cache.add(HEADER_CACHE_CONTROL, "no-cache");
+    Headers conditional;
+    conditional.add(HEADER_IF_NONE_MATCH, "\"x\"");
+    std::cout << "Cacheable requests: GET " << request_cacheable("GET", plain) << ", POST " << request_cacheable("POST", plain)
+              << ", Authorization " << request_cacheable("GET", with_auth) << ", no-cache " << request_cacheable("GET", no_cache)
+              << ", If-None-Match " << request_cacheable("GET", conditional) << "\n";
+
+    auto cached = cache.lookup("GET", "/vary", plain);
+    std::vector<uint8_t> out;
+    write_cached_response(*cached, "42", out);
+    auto response = parse_http_response(out);
+    std::cout << "Spliced Stream-Id: " << response->headers.get(HEADER_STREAM_ID).value_or("none")
+              << ", Age: " << response->headers.get("Age").value_or("none") << "\n";
+
+    store(cache, "/users/1", plain, "one", "max-age=60");
+    store(cache, "/users/2", plain, "two", "max-age=60");
+    store(cache, "/usersettings", plain, "settings", "max-age=60");
+    size_t dropped = cache.invalidate_prefix("/users/");
+    std::cout << "Invalidated /users/: " << dropped << ", /users/1: " << cached_body(cache, "/users/1", plain)
+              << ", /usersettings: " << cached_body(cache, "/usersettings", plain) << "\n";
+
+    store(cache, "/short", plain, "short lived", "max-age=1");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    std::cout << "After max-age: " << cached_body(cache, "/short", plain) << ", expirations: " << cache.stats().expirations << "\n";
+    std::cout << std::endl;
+}
+
+void test_response_cache_admission() {
+    std::cout << "Testing response cache admission:" << std::endl;
+    // One shard with room for a handful of entries
+    Response_Cache cache(Response_Cache_Config{.max_bytes = 2000, .shards = 1});
+    Headers plain;
+    std::string body(200, 'b');
+
+    for (int i{}; i < 20; i++) {
+        cache.lookup("GET", "/hot", plain);
+    }
+    store(cache, "/hot", plain, body, "max-age=60");
+    for (int i{}; i < 50; i++) {
+        std::string uri = "/scan/" + std::to_string(i);
+        if (cache.lookup("GET", uri, plain)) {
+            continue;
+        }
+        store(cache, uri, plain, body, "max-age=60");
+        cache.lookup("GET", "/hot", plain);
+    }
+    Response_Cache_Stats stats = cache.stats();
+    std::cout << "Hot entry survived the scan: " << (cache.lookup("GET", "/hot", plain) ? "yes" : "no")
+              << ", rejections: " << (stats.rejections > 0 ? "yes" : "no") << ", within budget: " << (stats.bytes <= 2000 ? "yes" : "no") << "\n";
+
+    // The newcomer only fits by displacing a cold entry and a hot one; it is rejected before either goes
+    Response_Cache full(Response_Cache_Config{.max_bytes = 2000, .shards = 1});
+    store(full, "/cold", plain, body, "max-age=60");
+    for (int i{}; i < 5; i++) {
+        full.lookup("GET", "/hot", plain);
+    }
+    store(full, "/hot", plain, body, "max-age=60");
+    full.lookup("GET", "/big", plain);
+    bool admitted = store(full, "/big", plain, std::string(1400, 'g'), "max-age=60");
+    stats = full.stats();
+    std::cout << "Large newcomer admitted: " << (admitted ? "yes" : "no") << ", /cold kept: " << (cached_body(full, "/cold", plain) == body ? "yes" : "no")
+              << ", /hot kept: " << (cached_body(full, "/hot", plain) == body ? "yes" : "no") << ", evictions: " << stats.evictions << "\n";
+    bool replaced = store(full, "/cold", plain, "fresh", "max-age=60");
+    std::cout << "Replacing a stored key in a full shard: " << (replaced ? "stored" : "rejected") << ", /cold: " << cached_body(full, "/cold", plain)
+              << ", entries: " << full.stats().entries << "\n";
+    std::cout << std::endl;
+}
+
+void test_response_cache_exchange() {
+    std::cout << "Testing response cache through the server:" << std::endl;
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    int handler_runs = 0;
+    server.register_route("/report/:id", [&](const Request& req, const Route_Params& params) {
+        handler_runs++;
+        Response response = create_response(Status_Code::OK, std::vector<uint8_t>(2048, 'r'));
+        response.headers.set(HEADER_CACHE_CONTROL, "max-age=60");
+        return response;
+    });
+    server.register_route("/live", [&](const Request& req, const Route_Params& params) {
+        handler_runs++;
+        return create_response(Status_Code::OK, std::vector<uint8_t>{'l'});
+    });
+    // Per-user bodies, large enough to be compressed; Vary from the handler and from the route headers
+    auto per_user = [&](const Request& req, const Route_Params& params) {
+        handler_runs++;
+        std::string user(req.headers.get(HEADER_COOKIE).value_or("anonymous"));
+        std::string body;
+        while (body.size() < 2048) {
+            body += user + ";";
+        }
+        Response response = create_response(Status_Code::OK, std::vector<uint8_t>(body.begin(), body.end()));
+        if (params.get("handler")) {
+            response.headers.set(HEADER_VARY, "Cookie");
+            response.headers.set(HEADER_CACHE_CONTROL, "max-age=60");
+        }
+        return response;
+    };
+    server.register_route("/profile/:handler", per_user);
+    Headers vary_on_cookie;
+    vary_on_cookie.add(HEADER_VARY, "Cookie");
+    vary_on_cookie.add(HEADER_CACHE_CONTROL, "max-age=60");
+    server.register_route("/account", per_user, vary_on_cookie);
+    server.configure_response_cache(Response_Cache_Config{});
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        return;
+    }
+
+    auto fetch = [&](Request request) {
+        auto future = client.send_request_async(request);
+        simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(5));
+        return future.get();
+    };
+    auto first = fetch(client.build_request("GET", "/report/7"));
+    auto second = fetch(client.build_request("GET", "/report/7"));
+    std::cout << "Handler runs for two GETs: " << handler_runs << ", same body: " << (first && second && first->body == second->body ? "yes" : "no")
+              << ", hit carries Age: " << (second && second->headers.contains("Age") ? "yes" : "no") << "\n";
+
+    Request identity = client.build_request("GET", "/report/7");
+    identity.headers.set(HEADER_ACCEPT_ENCODING, "identity");
+    fetch(identity);
+    fetch(identity);
+    std::cout << "Handler runs after an identity variant: " << handler_runs << "\n";
+
+    fetch(client.build_request("GET", "/live"));
+    fetch(client.build_request("GET", "/live"));
+    fetch(client.build_request("POST", "/report/7"));
+    std::cout << "Handler runs after uncacheable requests: " << handler_runs << "\n";
+
+    for (const char* uri : {"/profile/handler", "/account"}) {
+        int runs_before = handler_runs;
+        std::string bodies;
+        std::string vary;
+        for (const char* cookie : {"alice", "bob", "alice"}) {
+            Request request = client.build_request("GET", uri);
+            request.headers.set(HEADER_COOKIE, cookie);
+            auto response = fetch(request);
+            bodies += response ? std::string(response->body.begin(), std::find(response->body.begin(), response->body.end(), ';')) : std::string("none");
+            bodies += " ";
+            vary = response ? std::string(response->headers.get(HEADER_VARY).value_or("none")) : "none";
+        }
+        std::cout << "Vary: Cookie set by the " << (uri[1] == 'p' ? "handler" : "route headers") << ": bodies " << bodies << "handler runs " << handler_runs - runs_before
+                  << ", Vary: " << vary << "\n";
+    }
+
+    std::cout << "Invalidated: " << server.invalidate_cached("/report/") << "\n";
+    fetch(client.build_request("GET", "/report/7"));
+    Response_Cache_Stats stats = server.stats().response_cache;
+    std::cout << "Handler runs after invalidation: " << handler_runs << ", hits: " << stats.hits << ", insertions: " << stats.insertions << "\n";
+    std::cout << std::endl;
+}
+
+void test_response_cache() {
+    test_response_cache_policy();
+    test_response_cache_admission();
+    test_response_cache_exchange();
+}
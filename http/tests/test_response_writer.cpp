@@ -0,0 +1,69 @@
+#include "tests.hpp"
+#include "../http_response_writer.hpp"
+#include <iostream>
+#include <string>
+
+void test_response_writer_fixed() {
+    std::cout << "Testing write_response with a route header block:" << std::endl;
+    Headers route_headers;
+    route_headers.add(HEADER_CONTENT_TYPE, "application/json");
+    route_headers.add(HEADER_CONTENT_LENGTH, "999");
+    route_headers.add("X-Route", "users");
+    Header_Block block = make_header_block(route_headers);
+
+    // Content-Type and X-Route (matched by name, whatever its case) from the handler lose to the block,
+    // the body arrives in two segments
+    Headers headers;
+    headers.add(HEADER_CONTENT_TYPE, "text/plain");
+    headers.add("x-route", "handler");
+    headers.add("X-Request-Id", "42");
+    std::string first = "{\"hello\": ";
+    std::string second = "\"world\"}";
+    std::span<const uint8_t> body[] = {
+        std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(first.data()), first.size()),
+        std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(second.data()), second.size())
+    };
+    std::vector<uint8_t> out;
+    write_response(Status_Code::OK, &block, &headers, body, out);
+
+    auto response = parse_http_response(out);
+    if (response) {
+        std::cout << "Status: " << response->response_line.status_code << " " << response->response_line.reason_phrase << "\n";
+        for (const auto& [name, value] : response->headers) {
+            std::cout << name << ": " << (name == "Date" ? "<present>" : value) << "\n";
+        }
+        std::cout << "Body: " << std::string(response->body.begin(), response->body.end()) << "\n";
+    } else {
+        std::cout << "Failed to parse written response.\n";
+    }
+
+    std::cout << std::endl;
+}
+
+void test_response_writer_bodiless() {
+    std::cout << "Testing Content-Length on statuses without a body:" << std::endl;
+    for (int code : {100, 200, 204, 304, 404}) {
+        std::vector<uint8_t> out;
+        write_response(static_cast<Status_Code>(code), nullptr, nullptr, {}, out);
+        auto response = parse_http_response(out);
+        std::cout << code << " Content-Length: " << (response ? response->headers.get(HEADER_CONTENT_LENGTH).value_or("none") : "unparsable") << "\n";
+    }
+
+    std::cout << std::endl;
+}
+
+void test_response_writer_date() {
+    std::cout << "Testing the cached Date header:" << std::endl;
+    std::string_view first = date_header_line();
+    std::string_view second = date_header_line();
+    std::cout << "Length: " << first.size() << ", reused buffer: " << (first.data() == second.data() ? "yes" : "no")
+              << ", ends with GMT: " << (first.substr(first.size() - 6) == " GMT\r\n" ? "yes" : "no") << "\n";
+
+    std::cout << std::endl;
+}
+
+void test_response_writer() {
+    test_response_writer_fixed();
+    test_response_writer_bodiless();
+    test_response_writer_date();
+}
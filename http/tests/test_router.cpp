@@ -0,0 +1,76 @@
+#include "tests.hpp"
+#include "../http_router.hpp"
+#include <iostream>
+#include <string>
+#include <stdexcept>
+
+static Response empty_handler(const Request& req, const Route_Params& params) {
+    return create_response(Status_Code::OK, std::vector<uint8_t>{});
+}
+
+static void print_match(const Router& router, std::string_view method, std::string_view uri) {
+    auto match = router.match(http_method(method), uri);
+    std::cout << method << " " << uri << " -> ";
+    if (!match) {
+        std::cout << "not found\n";
+        return;
+    }
+    if (!match->route) {
+        std::cout << "method not allowed\n";
+        return;
+    }
+    std::cout << match->route->pattern;
+    for (const auto& [name, value] : match->params) {
+        std::cout << " " << name << "=" << value;
+    }
+    std::cout << "\n";
+}
+
+void test_router_matching() {
+    std::cout << "Testing router matching:" << std::endl;
+    Router router;
+    router.add(METHOD_GET, "/users", empty_handler, Headers());
+    router.add(METHOD_GET, "/users/new", empty_handler, Headers());
+    router.add(METHOD_GET, "/users/:id", empty_handler, Headers());
+    router.add(METHOD_DELETE, "/users/:user_id", empty_handler, Headers());
+    router.add(METHOD_GET, "/users/:id/orders/:order", empty_handler, Headers());
+    router.add(METHOD_GET, "/users/new/orders/recent", empty_handler, Headers());
+    router.add(METHOD_ANY, "/static/*path", empty_handler, Headers());
+    router.add(METHOD_GET, "/uploads", empty_handler, Headers());
+
+    print_match(router, "GET", "/users");
+    print_match(router, "GET", "/users/new");
+    print_match(router, "GET", "/users/42?verbose=1");
+    print_match(router, "DELETE", "/users/42");
+    print_match(router, "POST", "/users/42");
+    print_match(router, "GET", "/users/new/orders/7"); // Static "new" dead-ends, backtracks to :id
+    print_match(router, "GET", "/users/new/orders/recent");
+    print_match(router, "PUT", "/static/css/site.css");
+    print_match(router, "GET", "/static/");
+    print_match(router, "GET", "/users/");
+    print_match(router, "GET", "/upload");
+
+    std::cout << std::endl;
+}
+
+void test_router_invalid_patterns() {
+    std::cout << "Testing router pattern errors:" << std::endl;
+    const char* patterns[] = {"users", "/users/:", "/users/x:id", "/users/:id"};
+    Router router;
+    router.add(METHOD_GET, "/users/:id", empty_handler, Headers());
+    for (const char* pattern : patterns) {
+        try {
+            router.add(METHOD_GET, pattern, empty_handler, Headers());
+            std::cout << pattern << ": accepted\n";
+        } catch (const std::invalid_argument& e) {
+            std::cout << pattern << ": rejected (" << e.what() << ")\n";
+        }
+    }
+
+    std::cout << std::endl;
+}
+
+void test_router() {
+    test_router_matching();
+    test_router_invalid_patterns();
+}
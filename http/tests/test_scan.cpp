@@ -0,0 +1,58 @@
+#include "tests.hpp"
+#include "../http_scan.hpp"
+#include <iostream>
+#include <random>
+#include <string>
+
+static const char* SCAN_TEST_LEVEL_NAMES[] = {"scalar", "sse2", "avx2"};
+
+// Random buffers rich in CR, LF, ':' and case changes, checked at every offset and length
+// against the scalar kernels
+static bool scan_level_matches_scalar(Scan_Level level) {
+    const std::string alphabet = "\r\n:aZ-_!\"(\x80\xff 09";
+    std::mt19937 rng(7);
+    for (size_t len{}; len < 160; len++) {
+        std::string data(len, ' ');
+        for (char& ch : data) {
+            ch = alphabet[rng() % alphabet.size()];
+        }
+        std::string token(len, 'a');
+        if (len > 0) {
+            token[rng() % len] = alphabet[rng() % alphabet.size()];
+        }
+
+        for (size_t from{}; from <= len; from++) {
+            scan_set_level(SCAN_SCALAR);
+            size_t crlf = scan_find_crlf(data, from);
+            size_t colon = scan_find_char(data, from, ':');
+            scan_set_level(level);
+            if (scan_find_crlf(data, from) != crlf || scan_find_char(data, from, ':') != colon) {
+                return false;
+            }
+        }
+
+        scan_set_level(SCAN_SCALAR);
+        bool data_is_token = scan_is_token(data);
+        bool token_is_token = scan_is_token(token);
+        std::string lowered = data;
+        scan_to_lower(lowered.data(), lowered.size());
+        scan_set_level(level);
+        std::string lowered_at_level = data;
+        scan_to_lower(lowered_at_level.data(), lowered_at_level.size());
+        if (scan_is_token(data) != data_is_token || scan_is_token(token) != token_is_token || lowered_at_level != lowered) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_scan() {
+    std::cout << "Testing scan kernels (supported level: " << SCAN_TEST_LEVEL_NAMES[scan_supported_level()] << "):" << std::endl;
+    for (int level = SCAN_SSE2; level <= scan_supported_level(); level++) {
+        bool matches = scan_level_matches_scalar(static_cast<Scan_Level>(level));
+        std::cout << SCAN_TEST_LEVEL_NAMES[level] << " matches scalar: " << (matches ? "yes" : "no") << "\n";
+    }
+    scan_set_level(scan_supported_level());
+
+    std::cout << std::endl;
+}
@@ -0,0 +1,146 @@
+#include "tests.hpp"
+#include "../http_static_files.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <string>
+
+static void write_file(const std::filesystem::path& path, const std::string& contents) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << contents;
+}
+
+// Written next to the target and renamed over it, as a deploy would
+static void replace_file(const std::filesystem::path& path, const std::string& contents) {
+    std::filesystem::path staged = path;
+    staged += ".tmp";
+    write_file(staged, contents);
+    std::filesystem::rename(staged, path);
+}
+
+static std::string body_of(const Response& response) {
+    std::span<const uint8_t> body = response_body(response);
+    return std::string(body.begin(), body.end());
+}
+
+static Request get_request(const std::string& uri) {
+    Request request;
+    request.request_line = Request_Line{"HTTP/2.5", uri, "GET"};
+    return request;
+}
+
+void test_static_files_serving() {
+    std::cout << "Testing static files:" << std::endl;
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "http25_static_test";
+    std::filesystem::remove_all(root);
+    write_file(root / "index.html", "<h1>home</h1>");
+    write_file(root / "app.js", "console.log(1);");
+    write_file(root / "css" / "site.css", "body{}");
+    write_file(root / "empty.txt", "");
+    write_file(root.parent_path() / "http25_secret.txt", "secret");
+
+    Static_Files files(root.string(), Static_Files_Config{.max_files = 2});
+    Request request = get_request("/");
+    Response response = files.serve(request, "app.js");
+    std::cout << "app.js: " << response.response_line.status_code << " " << body_of(response)
+              << ", type: " << response.headers.get(HEADER_CONTENT_TYPE).value_or("none")
+              << ", ETag: " << (response.headers.contains(HEADER_ETAG) ? "yes" : "no")
+              << ", Last-Modified: " << (response.headers.contains(HEADER_LAST_MODIFIED) ? "yes" : "no")
+              << ", body in mapping: " << (response.body_owner && response.body.empty() ? "yes" : "no") << "\n";
+    std::string etag(response.headers.get(HEADER_ETAG).value_or(""));
+    std::string last_modified(response.headers.get(HEADER_LAST_MODIFIED).value_or(""));
+
+    std::cout << "Directory index: " << body_of(files.serve(request, "")) << ", nested: " << body_of(files.serve(request, "css/site.css"))
+              << ", empty file: " << files.serve(request, "empty.txt").response_line.status_code << "\n";
+    std::cout << "Missing: " << files.serve(request, "nope.js").response_line.status_code
+              << ", traversal: " << files.serve(request, "../http25_secret.txt").response_line.status_code
+              << ", directory: " << files.serve(request, "css").response_line.status_code << "\n";
+
+    Request conditional = get_request("/app.js");
+    conditional.headers.add(HEADER_IF_NONE_MATCH, "\"other\", " + etag);
+    Response unchanged = files.serve(conditional, "app.js");
+    std::cout << "If-None-Match current: " << unchanged.response_line.status_code << ", body: " << response_body(unchanged).size() << " bytes\n";
+    conditional.headers.set(HEADER_IF_NONE_MATCH, "\"other\"");
+    std::cout << "If-None-Match stale: " << files.serve(conditional, "app.js").response_line.status_code << "\n";
+    conditional.headers.remove(HEADER_IF_NONE_MATCH);
+    conditional.headers.set(HEADER_IF_MODIFIED_SINCE, last_modified);
+    std::cout << "If-Modified-Since current: " << files.serve(conditional, "app.js").response_line.status_code << "\n";
+    conditional.headers.set(HEADER_IF_MODIFIED_SINCE, "Thu, 01 Jan 1970 00:00:00 GMT");
+    std::cout << "If-Modified-Since older: " << files.serve(conditional, "app.js").response_line.status_code << "\n";
+
+    // The evicted mapping lives on in the response still holding it
+    Static_Files_Stats stats = files.stats();
+    std::cout << "Cached files: " << stats.files << ", evictions: " << (stats.evictions > 0 ? "yes" : "no")
+              << ", earlier response still readable: " << body_of(response) << "\n";
+
+    replace_file(root / "app.js", "console.log(2); // changed");
+    Response changed = files.serve(request, "app.js");
+    std::cout << "After replacing app.js: " << body_of(changed) << ", new ETag: " << (changed.headers.get(HEADER_ETAG) != etag ? "yes" : "no")
+              << ", invalidated: " << (files.stats().invalidations > 0 || !files.stats().watching ? "yes" : "no") << "\n";
+
+    std::filesystem::remove_all(root);
+    std::filesystem::remove(root.parent_path() / "http25_secret.txt");
+    std::cout << std::endl;
+}
+
+void test_static_files_exchange() {
+    std::cout << "Testing static files through the server:" << std::endl;
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "http25_static_exchange";
+    std::filesystem::remove_all(root);
+    write_file(root / "data.json", "{\"static\":true}");
+    std::string large(300 * 1024, '\0');
+    for (size_t i{}; i < large.size(); i++) {
+        large[i] = static_cast<char>('a' + i % 23);
+    }
+    write_file(root / "large.bin", large);
+
+    Static_Files files(root.string());
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    server.register_route(METHOD_GET, "/assets/*path", files.handler());
+    server.start(EVENT_LOOP_MANUAL);
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        std::filesystem::remove_all(root);
+        return;
+    }
+
+    auto fetch = [&](const Request& request) {
+        auto future = client.send_request_async(request);
+        simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(5));
+        return future.get();
+    };
+    auto first = fetch(client.build_request("GET", "/assets/data.json"));
+    std::cout << "GET: " << (first ? std::to_string(first->response_line.status_code) + " " + std::string(first->body.begin(), first->body.end()) : "no response") << "\n";
+
+    Request revalidate = client.build_request("GET", "/assets/data.json");
+    revalidate.headers.add(HEADER_IF_NONE_MATCH, first ? std::string(first->headers.get(HEADER_ETAG).value_or("")) : "");
+    auto second = fetch(revalidate);
+    std::cout << "Revalidation: " << (second ? std::to_string(second->response_line.status_code) + ", " + std::to_string(second->body.size()) + " body bytes" : "no response") << "\n";
+    std::cout << "Hits: " << files.stats().hits << ", 304s: " << files.stats().not_modified << "\n";
+
+    // Several times the single message limit, straight from the mapping into stream frames
+    auto large_response = fetch(client.build_request("GET", "/assets/large.bin"));
+    std::cout << "Large file: " << (large_response ? std::to_string(large_response->response_line.status_code) + ", " + std::to_string(large_response->body.size()) + " bytes" +
+                                    (std::string(large_response->body.begin(), large_response->body.end()) == large ? " intact" : " damaged") +
+                                    (large_response->headers.contains(HEADER_ETAG) ? ", with ETag" : ", no ETag") : "no response") << "\n";
+
+    server.stop();
+    std::filesystem::remove_all(root);
+    std::cout << std::endl;
+}
+
+void test_static_files() {
+    test_static_files_serving();
+    test_static_files_exchange();
+}
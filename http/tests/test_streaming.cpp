@@ -0,0 +1,243 @@
+#include "tests.hpp"
+#include "../http_stream.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Byte i of every test body, so corruption or reordering shows up anywhere in it
+static uint8_t pattern_byte(size_t i) {
+    return static_cast<uint8_t>(i % 251);
+}
+
+static std::vector<uint8_t> pattern_body(size_t offset, size_t size) {
+    std::vector<uint8_t> body(size);
+    for (size_t i{}; i < size; i++) {
+        body[i] = pattern_byte(offset + i);
+    }
+    return body;
+}
+
+void test_stream_flow_control() {
+    std::cout << "Testing stream flow control:" << std::endl;
+    std::vector<std::vector<uint8_t>> to_reader;
+    std::vector<std::vector<uint8_t>> to_writer;
+    Body_Writer writer(7, [&](std::vector<uint8_t>&& frame) { to_reader.push_back(std::move(frame)); });
+    Body_Reader reader(7, [&](std::vector<uint8_t>&& frame) { to_writer.push_back(std::move(frame)); });
+
+    std::vector<uint8_t> body = pattern_body(0, 200 * 1024);
+    size_t sent = writer.try_write(body);
+    size_t largest_frame = 0;
+    for (const auto& message : to_reader) {
+        auto frame = parse_stream_frame(message);
+        largest_frame = std::max(largest_frame, frame->payload.size());
+        reader.push(frame->payload);
+    }
+    to_reader.clear();
+    std::cout << "Sent before any credit: " << sent << " of " << body.size() << ", largest frame: " << largest_frame
+              << ", buffered at the reader: " << reader.buffered() << ", writer credit left: " << writer.credit() << "\n";
+
+    // Half the window read returns that much credit in a single frame
+    size_t read = 0;
+    while (read < STREAM_WINDOW / 2) {
+        read += reader.read(std::chrono::milliseconds(0))->size();
+    }
+    std::cout << "Credit frames after reading " << read << " bytes: " << to_writer.size();
+    for (const auto& message : to_writer) {
+        auto frame = parse_stream_frame(message);
+        std::cout << ", type " << int(frame->type) << " for stream " << frame->stream_id << " granting " << frame->credit;
+        writer.add_credit(frame->credit);
+    }
+    to_writer.clear();
+    std::cout << "\n";
+    size_t more = writer.try_write(std::span<const uint8_t>(body).subspan(sent));
+    std::cout << "Sent after the credit: " << more << "\n";
+
+    // A sender ignoring its credit is cut off
+    Body_Reader strict(9, [&](std::vector<uint8_t>&& frame) { to_writer.push_back(std::move(frame)); });
+    bool accepted = strict.push(std::span<const uint8_t>(body).subspan(0, STREAM_WINDOW + 1));
+    auto reset = parse_stream_frame(to_writer.back());
+    std::cout << "Overrun accepted: " << (accepted ? "yes" : "no") << ", answered with RESET: " << (reset && reset->type == FRAME_RESET ? "yes" : "no")
+              << ", reader reset: " << (strict.was_reset() ? "yes" : "no") << "\n";
+
+    writer.finish();
+    auto end = parse_stream_frame(to_reader.back());
+    std::cout << "Finish sends END: " << (end && end->type == FRAME_END ? "yes" : "no") << ", writes after it: " << writer.try_write(body) << "\n";
+    std::cout << "Whole request is no frame: " << (is_stream_frame(std::vector<uint8_t>{'G', 'E', 'T'}) ? "yes" : "no")
+              << ", truncated frame parses: " << (parse_stream_frame(std::vector<uint8_t>{0, FRAME_DATA, 0}) ? "yes" : "no") << "\n";
+    std::cout << std::endl;
+}
+
+// The dispatcher handles a RESET while a worker is between DATA frames of a framed body
+void test_stream_reset_while_pumping() {
+    std::cout << "Testing a reset while a body is pumped:" << std::endl;
+    for (bool from_receiver : {true, false}) {
+        auto body = std::make_shared<std::vector<uint8_t>>(pattern_body(0, 200 * 1024));
+        std::weak_ptr<std::vector<uint8_t>> watched = body;
+        Body_Writer* target = nullptr;
+        size_t data_frames = 0;
+        bool alive_during_send = true;
+        Body_Writer writer(11, [&](std::vector<uint8_t>&& frame) {
+            auto parsed = parse_stream_frame(frame);
+            if (!parsed || parsed->type != FRAME_DATA || ++data_frames != 2) {
+                return;
+            }
+            std::thread dispatcher([&] { from_receiver ? target->cancel() : target->reset(); });
+            dispatcher.join();
+            alive_during_send = !watched.expired();
+        });
+        target = &writer;
+        std::span<const uint8_t> bytes(*body);
+        writer.send_body(bytes, std::move(body));
+        std::cout << (from_receiver ? "Cancelled by the receiver" : "Reset by the sender") << ": body alive while pumped: " << (alive_during_send ? "yes" : "no")
+                  << ", DATA frames: " << data_frames << ", released afterwards: " << (watched.expired() ? "yes" : "no")
+                  << ", closed: " << (writer.closed() ? "yes" : "no") << "\n";
+    }
+    std::cout << std::endl;
+}
+
+void test_stream_exchange() {
+    std::cout << "Testing streamed bodies through the server:" << std::endl;
+    constexpr size_t BODY_SIZE = 1024 * 1024;
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    size_t max_buffered = 0;
+    server.register_stream_route(METHOD_POST, "/upload", [&](const Request& req, const Route_Params& params, Body_Reader& body, Body_Writer& out) {
+        size_t received = 0;
+        bool intact = true;
+        while (auto chunk = body.read()) {
+            for (size_t i{}; i < chunk->size(); i++) {
+                intact = intact && (*chunk)[i] == pattern_byte(received + i);
+            }
+            received += chunk->size();
+            max_buffered = std::max(max_buffered, body.buffered() + chunk->size());
+        }
+        std::string summary = std::to_string(received) + (intact && body.finished() ? " intact" : " damaged");
+        out.send_head(Status_Code::OK);
+        out.write(std::vector<uint8_t>(summary.begin(), summary.end()));
+    });
+    server.register_stream_route(METHOD_GET, "/download/:size", [&](const Request& req, const Route_Params& params, Body_Reader& body, Body_Writer& out) {
+        size_t size = std::stoul(std::string(params["size"]));
+        Headers headers;
+        headers.add(HEADER_CONTENT_TYPE, "application/octet-stream");
+        out.send_head(Status_Code::OK, headers);
+        for (size_t offset = 0; offset < size; offset += 8192) {
+            if (!out.write(pattern_body(offset, std::min<size_t>(8192, size - offset)))) {
+                return;
+            }
+        }
+    });
+    // Stops after the first chunk, the client's upload is cut short
+    server.register_stream_route(METHOD_POST, "/peek", [&](const Request& req, const Route_Params& params, Body_Reader& body, Body_Writer& out) {
+        body.read();
+        out.write(std::vector<uint8_t>{'o', 'k'});
+    });
+    server.register_route(METHOD_POST, "/plain", [&](const Request& req, const Route_Params& params) {
+        std::string size = std::to_string(req.body.size());
+        return create_response(Status_Code::OK, std::vector<uint8_t>(size.begin(), size.end()));
+    });
+    // Too large for one message, goes out in frames without the handler streaming it
+    server.register_route(METHOD_GET, "/large/:n", [&](const Request& req, const Route_Params& params) {
+        return create_response(Status_Code::OK, pattern_body(0, std::stoul(std::string(params["n"]))));
+    });
+    server.configure_buffered_body_limit(512 * 1024);
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client client("10.0.0.2", 5000, network.create_transport());
+    client.start(EVENT_LOOP_MANUAL);
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return client.poll(); });
+    client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish association.\n" << std::endl;
+        return;
+    }
+
+    // Pushes the body as credit allows, finishing once all of it went out
+    auto upload = [&](const std::string& uri, size_t size) {
+        std::optional<Response> result;
+        bool done = false;
+        auto writer = client.begin_upload(client.build_request("POST", uri), [&](std::optional<Response> response) {
+            result = std::move(response);
+            done = true;
+        });
+        std::vector<uint8_t> body = pattern_body(0, size);
+        size_t sent = 0;
+        simulation.run_until([&] {
+            if (sent < size && !writer->closed()) {
+                sent += writer->try_write(std::span<const uint8_t>(body).subspan(sent));
+                if (sent == size) {
+                    writer->finish();
+                }
+            }
+            return done;
+        }, std::chrono::seconds(30));
+        return std::make_pair(std::move(result), sent);
+    };
+    auto text = [](const std::optional<Response>& response) {
+        return response ? std::to_string(response->response_line.status_code) + " " + std::string(response->body.begin(), response->body.end()) : std::string("no response");
+    };
+
+    auto [uploaded, upload_sent] = upload("/upload", BODY_SIZE);
+    std::cout << "Streamed upload: " << text(uploaded) << ", most buffered at the server: " << (max_buffered <= STREAM_WINDOW ? "within the window" : std::to_string(max_buffered)) << "\n";
+
+    size_t downloaded = 0;
+    bool intact = true;
+    size_t chunks = 0;
+    std::optional<Response> head;
+    bool done = false;
+    client.send_request(client.build_request("GET", "/download/" + std::to_string(BODY_SIZE)), [&](std::span<const uint8_t> chunk) {
+        for (size_t i{}; i < chunk.size(); i++) {
+            intact = intact && chunk[i] == pattern_byte(downloaded + i);
+        }
+        downloaded += chunk.size();
+        chunks++;
+    }, [&](std::optional<Response> response) {
+        head = std::move(response);
+        done = true;
+    });
+    simulation.run_until([&] { return done; }, std::chrono::seconds(30));
+    std::cout << "Streamed download: " << (head ? std::to_string(head->response_line.status_code) : "no response") << ", " << downloaded << " bytes"
+              << (intact ? " intact" : " damaged") << " in " << (chunks > 1 ? "several chunks" : "one chunk")
+              << ", type: " << (head ? head->headers.get(HEADER_CONTENT_TYPE).value_or("none") : "none") << "\n";
+
+    auto collected = client.send_request_async(client.build_request("GET", "/download/100000"));
+    simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(30));
+    auto whole = collected.get();
+    std::cout << "Collected download: " << (whole ? std::to_string(whole->body.size()) + " bytes" + (whole->body == pattern_body(0, 100000) ? " intact" : " damaged") : "no response") << "\n";
+
+    auto [peeked, peek_sent] = upload("/peek", BODY_SIZE);
+    std::cout << "Handler reading one chunk: " << text(peeked) << ", upload cut short: " << (peek_sent < BODY_SIZE ? "yes" : "no") << "\n";
+
+    auto [plain, plain_sent] = upload("/plain", 300 * 1024);
+    std::cout << "Streamed into a plain route: " << text(plain) << "\n";
+    auto [too_large, too_large_sent] = upload("/plain", BODY_SIZE);
+    std::cout << "Over the buffered body limit: " << (too_large ? std::to_string(too_large->response_line.status_code) : "no response") << "\n";
+
+    auto large = client.send_request_async(client.build_request("GET", "/large/200000"));
+    simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(30));
+    auto large_response = large.get();
+    std::cout << "Plain route, 200000 byte body: " << (large_response ? std::to_string(large_response->body.size()) + " bytes" + (large_response->body == pattern_body(0, 200000) ? " intact" : " damaged") : "no response") << "\n";
+    std::vector<uint8_t> large_body = pattern_body(0, 200000);
+    auto large_post = client.send_request_async(client.build_request("POST", "/plain", std::string(large_body.begin(), large_body.end())));
+    simulation.run_until([&] { return client.in_flight() == 0; }, std::chrono::seconds(30));
+    std::cout << "Plain request, 200000 byte body: " << text(large_post.get()) << "\n";
+
+    simulation.run_until([&] { return server.stats().open_streams == 0; }, std::chrono::seconds(5));
+    std::cout << "Open streams afterwards: " << server.stats().open_streams << "\n";
+
+    server.stop();
+    std::cout << std::endl;
+}
+
+void test_streaming() {
+    test_stream_flow_control();
+    test_stream_reset_while_pumping();
+    test_stream_exchange();
+}
@@ -0,0 +1,108 @@
+#include "tests.hpp"
+#include "../http_worker_pool.hpp"
+#include "../server.hpp"
+#include "../client.hpp"
+#include "../../sctp_stack/sctp_emulator.hpp"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <vector>
+
+void test_worker_pool_stealing() {
+    std::cout << "Testing worker pool stealing:" << std::endl;
+    Worker_Pool pool(Worker_Pool_Config{.threads = 2});
+
+    // Round-robin puts every other task behind the blocked one, the idle worker has to steal them
+    std::atomic<bool> release{false};
+    std::atomic<int> quick_done{0};
+    pool.submit([&] {
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+    });
+    for (int i{}; i < 10; i++) {
+        pool.submit([&] { quick_done.fetch_add(1); });
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (quick_done.load() < 10 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    Worker_Pool_Stats stats = pool.stats();
+    std::cout << "Quick tasks done while a worker is blocked: " << quick_done.load() << "/10, stolen: " << (stats.stolen > 0 ? "yes" : "no") << "\n";
+    release = true;
+    pool.stop();
+    stats = pool.stats();
+    std::cout << "Executed: " << stats.executed << ", queued after stop: " << stats.queued << ", max queued: " << (stats.max_queued >= 6 ? ">= 6" : "< 6") << "\n";
+
+    std::cout << std::endl;
+}
+
+void test_worker_pool_ordering() {
+    std::cout << "Testing per-association ordering on the worker pool:" << std::endl;
+
+    Emulated_Network network;
+    Server server("10.0.0.1", 8080, network.create_transport());
+    server.register_route("/sleep/:ms", [](const Request& req, const Route_Params& params) {
+        std::string ms(params["ms"]);
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::stoi(ms)));
+        return create_response(Status_Code::OK, std::vector<uint8_t>(ms.begin(), ms.end()));
+    });
+    server.configure_workers(Worker_Pool_Config{.threads = 4});
+    server.start(EVENT_LOOP_MANUAL);
+
+    Client slow_client("10.0.0.2", 5000, network.create_transport());
+    Client fast_client("10.0.0.3", 5000, network.create_transport());
+    slow_client.start(EVENT_LOOP_MANUAL);
+    fast_client.start(EVENT_LOOP_MANUAL);
+
+    Network_Simulation simulation(network);
+    simulation.add_poller([&] { return server.poll(); });
+    simulation.add_poller([&] { return slow_client.poll(); });
+    simulation.add_poller([&] { return fast_client.poll(); });
+
+    slow_client.begin_connect("10.0.0.1", 8080);
+    fast_client.begin_connect("10.0.0.1", 8080);
+    if (!simulation.run_until([&] { return slow_client.poll_connected() && fast_client.poll_connected(); }, std::chrono::seconds(5))) {
+        std::cout << "Failed to establish associations.\n" << std::endl;
+        return;
+    }
+
+    // The slow association's responses must keep request order, the fast one must not wait for it
+    std::vector<std::string> order;
+    for (const char* uri : {"/sleep/100", "/sleep/0", "/sleep/20"}) {
+        slow_client.begin_request(slow_client.build_request("GET", uri));
+    }
+    fast_client.begin_request(fast_client.build_request("GET", "/sleep/0"));
+
+    auto collect = [&] {
+        while (auto response = slow_client.poll_response()) {
+            order.push_back("slow:" + std::string(response->body.begin(), response->body.end()));
+        }
+        while (auto response = fast_client.poll_response()) {
+            order.push_back("fast:" + std::string(response->body.begin(), response->body.end()));
+        }
+        return order.size() == 4;
+    };
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!collect() && std::chrono::steady_clock::now() < deadline) {
+        simulation.run_until(collect, std::chrono::seconds(5));
+    }
+
+    std::cout << "Response order:";
+    for (const auto& entry : order) {
+        std::cout << " " << entry;
+    }
+    server.stop();
+    Server_Stats stats = server.stats();
+    std::cout << "\nWorkers: " << stats.workers.threads << ", pending after stop: " << stats.pending_requests << "\n";
+
+    std::cout << std::endl;
+}
+
+void test_worker_pool() {
+    test_worker_pool_stealing();
+    test_worker_pool_ordering();
+}
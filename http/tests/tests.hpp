@@ -4,5 +4,24 @@
 #include "../http_parse.hpp"
 
 void test_parsing();
+void test_emulated_network();
+void test_request_parser();
+void test_scan();
+void test_headers();
+void test_response_writer();
+void test_router();
+void test_worker_pool();
+void test_client_pool();
+void test_compression();
+void test_static_files();
+void test_response_cache();
+void test_streaming();
+void test_header_codec();
+void test_binary_codec();
+void test_admission();
+void test_deadline();
+void test_arena();
+void test_middleware();
+void test_metrics();
 
 #endif
\ No newline at end of file
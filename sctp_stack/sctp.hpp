@@ -3,8 +3,7 @@
 
 #include <stdint.h>
 #include <vector>
-#include <winsock2.h>
-#include <ws2def.h> 
+#include "sctp_platform.hpp"
 #include <variant>
 
 struct SCTP_Common_Header {
@@ -72,6 +71,9 @@ struct SCTP_Packet {
 };
 
 constexpr int RWND = 65535;
+// Largest user data of a message: messages are not fragmented, so one DATA chunk (16 byte header)
+// has to fit in one UDP datagram (65507 bytes) after the 12 byte common header
+constexpr size_t SCTP_MAX_MESSAGE_SIZE = 65507 - 12 - 16;
 
 const SCTP_Packet INIT_PACKET = {
     .header = {
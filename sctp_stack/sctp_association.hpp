@@ -5,10 +5,13 @@
 #include <vector>
 #include <utility>
 #include <string>
-#include <winsock2.h>
+#include "sctp_platform.hpp"
 #include <map>
 #include <queue>
+#include <memory>
+#include <chrono>
 #include "sctp.hpp"
+#include "sctp_stats.hpp"
 
 enum Association_State {
     COOKIE_WAIT, 
@@ -36,9 +39,23 @@ struct Association {
     uint16_t in_streams;
     uint16_t out_streams;
     std::queue<std::vector<uint8_t>> ulp_buffer;
+    uint32_t cwnd;
+    uint32_t srtt_us;
+    uint32_t rttvar_us;
+    bool rtt_probe_pending;
+    std::chrono::steady_clock::time_point rtt_probe_sent;
+    std::chrono::steady_clock::time_point handshake_started;
+    std::shared_ptr<Association_Stats> stats; // Also in the socket's registry until the association is removed
     // Include reassembly buffer
 };
 
+// RFC 4960 7.2.1 initial cwnd for a 1500 byte path MTU
+constexpr uint32_t INITIAL_CWND = 4380;
+
+// Nothing retransmits a lost handshake packet, so an association that is not established by then
+// never will be; this also bounds what spoofed INITs can leave behind
+constexpr std::chrono::seconds HANDSHAKE_TIMEOUT{30};
+
 struct Association_Key {
     sockaddr_in address;
 
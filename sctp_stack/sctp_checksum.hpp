@@ -2,6 +2,7 @@
 #define SCTP_CHECKSUM_HPP
 
 #include <stdint.h>
+#include <stddef.h>
 #include <vector>
 
 uint32_t calculate_sctp_checksum(const uint8_t* data, size_t len);
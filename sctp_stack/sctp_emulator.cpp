@@ -0,0 +1,212 @@
+#include "sctp_emulator.hpp"
+#include <algorithm>
+#include <cstring>
+
+static uint64_t address_id(const sockaddr_in& address) {
+    return (static_cast<uint64_t>(address.sin_addr.s_addr) << 16) | address.sin_port;
+}
+
+Emulated_Transport::Emulated_Transport(Emulated_Network& emulated_network) : network(emulated_network) {}
+
+Emulated_Transport::~Emulated_Transport() {
+    close();
+}
+
+bool Emulated_Transport::bind(const sockaddr_in& address) {
+    if (bound_address || !network.bind(address)) {
+        return false;
+    }
+    bound_address = address;
+    return true;
+}
+
+bool Emulated_Transport::set_non_blocking() {
+    return true;
+}
+
+int Emulated_Transport::send_to(const uint8_t* data, size_t len, const sockaddr_in& to) {
+    if (!bound_address) {
+        return -1;
+    }
+    network.send(*bound_address, to, data, len);
+    return static_cast<int>(len);
+}
+
+int Emulated_Transport::recv_from(uint8_t* buffer, size_t len, sockaddr_in& from) {
+    if (!bound_address) {
+        return -1;
+    }
+    return network.receive(*bound_address, buffer, len, from);
+}
+
+void Emulated_Transport::close() {
+    if (bound_address) {
+        network.unbind(*bound_address);
+        bound_address.reset();
+    }
+}
+
+std::chrono::steady_clock::time_point Emulated_Transport::now() const {
+    return network.now();
+}
+
+Emulated_Network::Emulated_Network(uint64_t seed, const Link_Conditions& default_conditions)
+    : clock(), rng(seed), next_sequence(0), default_link_conditions(default_conditions), counters{} {}
+
+std::unique_ptr<Emulated_Transport> Emulated_Network::create_transport() {
+    return std::make_unique<Emulated_Transport>(*this);
+}
+
+void Emulated_Network::set_link_conditions(const sockaddr_in& from, const sockaddr_in& to, const Link_Conditions& conditions) {
+    std::unique_lock<std::mutex> network_lock(network_mutex);
+    link_between(from, to).conditions = conditions;
+}
+
+std::chrono::steady_clock::time_point Emulated_Network::now() const {
+    std::unique_lock<std::mutex> network_lock(network_mutex);
+    return clock;
+}
+
+void Emulated_Network::advance_to(std::chrono::steady_clock::time_point time) {
+    std::unique_lock<std::mutex> network_lock(network_mutex);
+    clock = std::max(clock, time);
+}
+
+std::optional<std::chrono::steady_clock::time_point> Emulated_Network::next_delivery_time() const {
+    std::unique_lock<std::mutex> network_lock(network_mutex);
+    std::optional<std::chrono::steady_clock::time_point> next;
+    for (const auto& [key, inbox] : endpoints) {
+        if (!inbox.empty() && (!next || inbox.top().arrival < *next)) {
+            next = inbox.top().arrival;
+        }
+    }
+    return next;
+}
+
+Emulated_Network_Stats Emulated_Network::stats() const {
+    std::unique_lock<std::mutex> network_lock(network_mutex);
+    return counters;
+}
+
+bool Emulated_Network::bind(const sockaddr_in& address) {
+    std::unique_lock<std::mutex> network_lock(network_mutex);
+    return endpoints.try_emplace(Association_Key{address}).second;
+}
+
+void Emulated_Network::unbind(const sockaddr_in& address) {
+    std::unique_lock<std::mutex> network_lock(network_mutex);
+    endpoints.erase(Association_Key{address});
+}
+
+Emulated_Network::Link& Emulated_Network::link_between(const sockaddr_in& from, const sockaddr_in& to) {
+    auto [it, inserted] = links.try_emplace({address_id(from), address_id(to)});
+    if (inserted) {
+        it->second.conditions = default_link_conditions;
+        it->second.busy_until = clock;
+    }
+    return it->second;
+}
+
+void Emulated_Network::send(const sockaddr_in& from, const sockaddr_in& to, const uint8_t* data, size_t len) {
+    std::unique_lock<std::mutex> network_lock(network_mutex);
+    counters.sent++;
+
+    auto endpoint = endpoints.find(Association_Key{to});
+    if (endpoint == endpoints.end()) {
+        counters.unreachable++;
+        return;
+    }
+
+    Link& link = link_between(from, to);
+    const Link_Conditions& conditions = link.conditions;
+
+    // Datagrams queue behind each other on a bandwidth limited link, lost ones included
+    std::chrono::steady_clock::time_point departure = clock;
+    if (conditions.bandwidth_bps > 0) {
+        std::chrono::microseconds transmit_time{len * 8 * 1000000 / conditions.bandwidth_bps};
+        departure = std::max(clock, link.busy_until) + transmit_time;
+        link.busy_until = departure;
+    }
+
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    if (chance(rng) < conditions.loss_rate) {
+        counters.lost++;
+        return;
+    }
+
+    int copies = 1;
+    if (chance(rng) < conditions.duplicate_rate) {
+        counters.duplicated++;
+        copies = 2;
+    }
+
+    std::uniform_int_distribution<int64_t> jitter(0, conditions.jitter.count());
+    for (int i{}; i < copies; i++) {
+        auto arrival = departure + conditions.delay + std::chrono::microseconds(jitter(rng));
+        if (chance(rng) < conditions.reorder_rate) {
+            arrival += conditions.reorder_delay;
+            counters.reordered++;
+        }
+        endpoint->second.push(In_Flight{arrival, next_sequence++, from, std::vector<uint8_t>(data, data + len)});
+    }
+}
+
+int Emulated_Network::receive(const sockaddr_in& at, uint8_t* buffer, size_t len, sockaddr_in& from) {
+    std::unique_lock<std::mutex> network_lock(network_mutex);
+    auto endpoint = endpoints.find(Association_Key{at});
+    if (endpoint == endpoints.end() || endpoint->second.empty() || endpoint->second.top().arrival > clock) {
+        return 0;
+    }
+
+    const In_Flight& datagram = endpoint->second.top();
+    size_t to_copy = std::min(len, datagram.data.size());
+    std::memcpy(buffer, datagram.data.data(), to_copy);
+    from = datagram.from;
+    endpoint->second.pop();
+    counters.delivered++;
+    return static_cast<int>(to_copy);
+}
+
+Network_Simulation::Network_Simulation(Emulated_Network& emulated_network) : network(emulated_network) {}
+
+void Network_Simulation::add_poller(std::function<bool()> poller) {
+    pollers.push_back(std::move(poller));
+}
+
+void Network_Simulation::add_timer(std::function<std::optional<std::chrono::steady_clock::time_point>()> next_timer) {
+    timers.push_back(std::move(next_timer));
+}
+
+bool Network_Simulation::run_until(const std::function<bool()>& done, std::chrono::microseconds virtual_timeout) {
+    auto deadline = network.now() + virtual_timeout;
+    while (!done()) {
+        bool progress = false;
+        for (auto& poller : pollers) {
+            if (poller()) {
+                progress = true;
+            }
+        }
+        // Timers change state without counting as progress, so look again before time moves on
+        if (progress || done()) {
+            continue;
+        }
+
+        // Nothing left to do at this instant, jump straight to the next arrival or timer
+        auto now = network.now();
+        auto wake = deadline;
+        if (auto next = network.next_delivery_time()) {
+            wake = std::min(wake, *next);
+        }
+        for (auto& timer : timers) {
+            // A timer that is already due was handled by the poll that just ran
+            if (auto next = timer(); next && *next > now) {
+                wake = std::min(wake, *next);
+            }
+        }
+        if (wake <= now) {
+            return done();
+        }
+        network.advance_to(wake);
+    }
+    return true;
+}
@@ -0,0 +1,128 @@
+#ifndef SCTP_EMULATOR_HPP
+#define SCTP_EMULATOR_HPP
+
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+#include <queue>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <optional>
+#include <functional>
+#include "sctp_transport.hpp"
+#include "sctp_association.hpp"
+
+struct Link_Conditions {
+    std::chrono::microseconds delay{0};
+    std::chrono::microseconds jitter{0}; // Uniform in [0, jitter] on top of delay
+    double loss_rate = 0.0;
+    double duplicate_rate = 0.0;
+    double reorder_rate = 0.0;
+    std::chrono::microseconds reorder_delay{1000}; // Extra hold back for reordered datagrams
+    uint64_t bandwidth_bps = 0; // 0 means unlimited
+};
+
+struct Emulated_Network_Stats {
+    uint64_t sent;
+    uint64_t delivered;
+    uint64_t lost;
+    uint64_t duplicated;
+    uint64_t reordered;
+    uint64_t unreachable;
+};
+
+class Emulated_Network;
+
+// Endpoint of an Emulated_Network, the network must outlive every transport it created
+class Emulated_Transport : public Datagram_Transport {
+    public:
+        explicit Emulated_Transport(Emulated_Network& emulated_network);
+        ~Emulated_Transport() override;
+
+        bool bind(const sockaddr_in& address) override;
+        bool set_non_blocking() override;
+        int send_to(const uint8_t* data, size_t len, const sockaddr_in& to) override;
+        int recv_from(uint8_t* buffer, size_t len, sockaddr_in& from) override;
+        void close() override;
+        std::chrono::steady_clock::time_point now() const override;
+
+    private:
+        Emulated_Network& network;
+        std::optional<sockaddr_in> bound_address;
+};
+
+// In-memory datagram network on a virtual clock. Every decision (loss, jitter, reordering,
+// duplication) comes from a seeded generator, so a run only depends on the seed and on the
+// order datagrams are sent in. Time only moves through advance_to().
+class Emulated_Network {
+    public:
+        explicit Emulated_Network(uint64_t seed = 1, const Link_Conditions& default_conditions = {});
+
+        std::unique_ptr<Emulated_Transport> create_transport();
+        void set_link_conditions(const sockaddr_in& from, const sockaddr_in& to, const Link_Conditions& conditions);
+
+        std::chrono::steady_clock::time_point now() const;
+        void advance_to(std::chrono::steady_clock::time_point time);
+        std::optional<std::chrono::steady_clock::time_point> next_delivery_time() const;
+        Emulated_Network_Stats stats() const;
+
+    private:
+        friend class Emulated_Transport;
+
+        struct In_Flight {
+            std::chrono::steady_clock::time_point arrival;
+            uint64_t sequence;
+            sockaddr_in from;
+            std::vector<uint8_t> data;
+
+            bool operator>(const In_Flight& other) const {
+                return arrival != other.arrival ? arrival > other.arrival : sequence > other.sequence;
+            }
+        };
+
+        struct Link {
+            Link_Conditions conditions;
+            std::chrono::steady_clock::time_point busy_until;
+        };
+
+        using Inbox = std::priority_queue<In_Flight, std::vector<In_Flight>, std::greater<In_Flight>>;
+
+        mutable std::mutex network_mutex;
+        std::chrono::steady_clock::time_point clock;
+        std::mt19937_64 rng;
+        uint64_t next_sequence;
+        Link_Conditions default_link_conditions;
+        std::map<std::pair<uint64_t, uint64_t>, Link> links;
+        std::unordered_map<Association_Key, Inbox, Association_Hash> endpoints;
+        Emulated_Network_Stats counters;
+
+        bool bind(const sockaddr_in& address);
+        void unbind(const sockaddr_in& address);
+        void send(const sockaddr_in& from, const sockaddr_in& to, const uint8_t* data, size_t len);
+        int receive(const sockaddr_in& at, uint8_t* buffer, size_t len, sockaddr_in& from);
+        Link& link_between(const sockaddr_in& from, const sockaddr_in& to);
+};
+
+// Drives pollers (SCTP_Socket::sctp_poll, Server::poll, Client::poll, ...) in manual event
+// loop mode on the calling thread. Whenever no poller makes progress, the virtual clock
+// jumps to the next datagram arrival or timer, at most to the deadline of the run, so runs
+// are deterministic and faster than real time.
+class Network_Simulation {
+    public:
+        explicit Network_Simulation(Emulated_Network& emulated_network);
+
+        void add_poller(std::function<bool()> poller);
+        // When a poller next has work that only time triggers, e.g. SCTP_Socket::sctp_next_timer
+        void add_timer(std::function<std::optional<std::chrono::steady_clock::time_point>()> next_timer);
+        bool run_until(const std::function<bool()>& done, std::chrono::microseconds virtual_timeout);
+
+    private:
+        Emulated_Network& network;
+        std::vector<std::function<bool()>> pollers;
+        std::vector<std::function<std::optional<std::chrono::steady_clock::time_point>()>> timers;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include "sctp_log.hpp"
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+constexpr size_t LOG_RING_CAPACITY = 1024;
+constexpr auto LOG_DRAIN_INTERVAL = std::chrono::milliseconds(5);
+
+// Single producer (the owning thread), single consumer (whoever holds drain_mutex)
+struct Log_Ring {
+    Log_Record records[LOG_RING_CAPACITY];
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::atomic<bool> abandoned{false};
+};
+
+class Logger {
+    public:
+        Logger();
+        ~Logger();
+
+        Log_Ring* thread_ring();
+        void drain();
+        void set_output(std::FILE* out);
+
+        std::atomic<uint8_t> level;
+        std::atomic<std::FILE*> output;
+        std::atomic<uint64_t> dropped;
+
+    private:
+        std::vector<std::shared_ptr<Log_Ring>> rings;
+        std::mutex rings_mutex;
+        std::mutex drain_mutex;
+        std::atomic<bool> running;
+        std::thread drain_thread;
+
+        void drain_loop();
+        void write_record(std::FILE* out, const Log_Record& record);
+};
+
+struct Thread_Log_Ring {
+    std::shared_ptr<Log_Ring> ring;
+
+    ~Thread_Log_Ring() {
+        if (ring) {
+            ring->abandoned.store(true, std::memory_order_release);
+        }
+    }
+};
+
+static Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+static int64_t now_us() {
+    auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(since_epoch).count();
+}
+
+static const char* level_name(Log_Level level) {
+    switch (level) {
+        case Log_Level::Trace: return "TRACE";
+        case Log_Level::Debug: return "DEBUG";
+        case Log_Level::Info: return "INFO";
+        case Log_Level::Warn: return "WARN";
+        case Log_Level::Error: return "ERROR";
+        default: return "?";
+    }
+}
+
+Logger::Logger() : level(0), output(stdout), dropped(0), running(true) {
+    drain_thread = std::thread(&Logger::drain_loop, this);
+}
+
+Logger::~Logger() {
+    running = false;
+    if (drain_thread.joinable()) {
+        drain_thread.join();
+    }
+    drain();
+}
+
+Log_Ring* Logger::thread_ring() {
+    thread_local Thread_Log_Ring local;
+    if (!local.ring) {
+        local.ring = std::make_shared<Log_Ring>();
+        std::unique_lock<std::mutex> rings_lock(rings_mutex);
+        rings.push_back(local.ring);
+    }
+    return local.ring.get();
+}
+
+void Logger::drain_loop() {
+    while (running) {
+        drain();
+        std::this_thread::sleep_for(LOG_DRAIN_INTERVAL);
+    }
+}
+
+void Logger::drain() {
+    std::unique_lock<std::mutex> drain_lock(drain_mutex);
+
+    std::unique_lock<std::mutex> rings_lock(rings_mutex);
+    std::vector<std::shared_ptr<Log_Ring>> to_drain = rings;
+    rings_lock.unlock();
+
+    std::FILE* out = output.load(std::memory_order_relaxed);
+    bool wrote = false;
+    for (auto& ring : to_drain) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        while (tail < head) {
+            write_record(out, ring->records[tail % LOG_RING_CAPACITY]);
+            tail++;
+            wrote = true;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    if (wrote) {
+        std::fflush(out);
+    }
+
+    // Rings of exited threads are dropped once everything they logged has been written
+    rings_lock.lock();
+    rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<Log_Ring>& ring) {
+        return ring->abandoned.load(std::memory_order_acquire) &&
+               ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire);
+    }), rings.end());
+}
+
+void Logger::set_output(std::FILE* out) {
+    drain();
+    std::unique_lock<std::mutex> drain_lock(drain_mutex);
+    output.store(out, std::memory_order_relaxed);
+}
+
+void Logger::write_record(std::FILE* out, const Log_Record& record) {
+    std::fprintf(out, "[%lld.%06lld] %-5s %s",
+                 static_cast<long long>(record.timestamp_us / 1000000),
+                 static_cast<long long>(record.timestamp_us % 1000000),
+                 level_name(record.level), record.event);
+    for (size_t i{}; i < record.field_count; i++) {
+        std::fprintf(out, " %s=%llu", record.fields[i].key, static_cast<unsigned long long>(record.fields[i].value));
+    }
+    if (record.text_len > 0) {
+        std::fprintf(out, ": %.*s", static_cast<int>(record.text_len), record.text);
+    }
+    std::fputc('\n', out);
+}
+
+static void write_to_ring(Log_Level level, const char* event, std::string_view text, const Log_Field* fields, size_t field_count) {
+    Logger& log = logger();
+    Log_Ring* ring = log.thread_ring();
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    if (head - tail >= LOG_RING_CAPACITY) {
+        log.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Log_Record& record = ring->records[head % LOG_RING_CAPACITY];
+    record.timestamp_us = now_us();
+    record.level = level;
+    record.event = event;
+    record.field_count = static_cast<uint8_t>(std::min(field_count, LOG_MAX_FIELDS));
+    std::copy(fields, fields + record.field_count, record.fields);
+    record.text_len = static_cast<uint8_t>(std::min(text.size(), LOG_TEXT_CAPACITY));
+    if (record.text_len > 0) {
+        std::memcpy(record.text, text.data(), record.text_len); // An empty view's data() may be null
+    }
+
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void log_write(Log_Level level, const char* event, std::string_view text, std::initializer_list<Log_Field> fields) {
+    if (static_cast<uint8_t>(level) < logger().level.load(std::memory_order_relaxed)) {
+        return;
+    }
+    write_to_ring(level, event, text, fields.begin(), fields.size());
+}
+
+void log_write_limited(Log_Rate_Limit& limit, Log_Level level, const char* event, std::string_view text, std::initializer_list<Log_Field> fields) {
+    if (static_cast<uint8_t>(level) < logger().level.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    int64_t now = now_us();
+    int64_t window_start = limit.window_start_us.load(std::memory_order_relaxed);
+    if (now - window_start >= 1000000 &&
+        limit.window_start_us.compare_exchange_strong(window_start, now, std::memory_order_relaxed)) {
+        limit.in_window.store(0, std::memory_order_relaxed);
+    }
+    if (limit.in_window.fetch_add(1, std::memory_order_relaxed) >= limit.per_second) {
+        limit.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Log_Field all_fields[LOG_MAX_FIELDS];
+    size_t field_count = std::min(fields.size(), LOG_MAX_FIELDS);
+    std::copy(fields.begin(), fields.begin() + field_count, all_fields);
+
+    uint64_t suppressed = limit.suppressed.exchange(0, std::memory_order_relaxed);
+    if (suppressed > 0) {
+        field_count = std::min(field_count, LOG_MAX_FIELDS - 1);
+        all_fields[field_count++] = Log_Field{"suppressed", suppressed};
+    }
+    write_to_ring(level, event, text, all_fields, field_count);
+}
+
+void log_set_level(Log_Level level) {
+    logger().level.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+void log_set_output(std::FILE* output) {
+    logger().set_output(output);
+}
+
+void log_flush() {
+    logger().drain();
+}
+
+uint64_t log_dropped_records() {
+    return logger().dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,80 @@
+#ifndef SCTP_LOG_HPP
+#define SCTP_LOG_HPP
+
+#include <stdint.h>
+#include <cstdio>
+#include <atomic>
+#include <string_view>
+#include <initializer_list>
+
+enum class Log_Level : uint8_t {
+    Trace = 0,
+    Debug = 1,
+    Info = 2,
+    Warn = 3,
+    Error = 4,
+    Off = 5
+};
+
+// Anything below this level is compiled out, override with -DSCTP_LOG_MIN_LEVEL=<0..5>
+#ifndef SCTP_LOG_MIN_LEVEL
+#define SCTP_LOG_MIN_LEVEL 2
+#endif
+
+constexpr size_t LOG_MAX_FIELDS = 4;
+constexpr size_t LOG_TEXT_CAPACITY = 96;
+
+struct Log_Field {
+    const char* key;
+    uint64_t value;
+};
+
+// Fixed size so that writing a record into a ring never allocates. event and field keys
+// must be string literals, only text is copied (and truncated).
+struct Log_Record {
+    int64_t timestamp_us;
+    Log_Level level;
+    uint8_t field_count;
+    uint8_t text_len;
+    const char* event;
+    Log_Field fields[LOG_MAX_FIELDS];
+    char text[LOG_TEXT_CAPACITY];
+};
+
+// Allows at most per_second records through per call site, the rest are counted and
+// reported on the next record that gets through.
+struct Log_Rate_Limit {
+    uint32_t per_second;
+    std::atomic<int64_t> window_start_us{0};
+    std::atomic<uint32_t> in_window{0};
+    std::atomic<uint64_t> suppressed{0};
+
+    explicit Log_Rate_Limit(uint32_t limit) : per_second(limit) {}
+};
+
+void log_write(Log_Level level, const char* event, std::string_view text, std::initializer_list<Log_Field> fields);
+void log_write_limited(Log_Rate_Limit& limit, Log_Level level, const char* event, std::string_view text, std::initializer_list<Log_Field> fields);
+void log_set_level(Log_Level level); // Runtime filter on top of SCTP_LOG_MIN_LEVEL
+void log_set_output(std::FILE* output);
+void log_flush(); // Blocks until everything logged before the call has been written
+uint64_t log_dropped_records();
+
+constexpr bool log_enabled(Log_Level level) {
+    return static_cast<uint8_t>(level) >= SCTP_LOG_MIN_LEVEL;
+}
+
+template <Log_Level level>
+inline void log_event(const char* event, std::string_view text = {}, std::initializer_list<Log_Field> fields = {}) {
+    if constexpr (log_enabled(level)) {
+        log_write(level, event, text, fields);
+    }
+}
+
+template <Log_Level level>
+inline void log_event_limited(Log_Rate_Limit& limit, const char* event, std::string_view text = {}, std::initializer_list<Log_Field> fields = {}) {
+    if constexpr (log_enabled(level)) {
+        log_write_limited(limit, level, event, text, fields);
+    }
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SCTP_PLATFORM_HPP
+#define SCTP_PLATFORM_HPP
+
+// Socket headers for Winsock2 and POSIX. Only Udp_Transport touches the socket API itself,
+// everything else just needs sockaddr_in and the byte order helpers.
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+typedef int SOCKET;
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+#endif
+
+#endif
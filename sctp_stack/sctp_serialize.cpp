@@ -1,5 +1,6 @@
 #include "sctp_serialize.hpp"
 #include <cstring>
+#include <cstddef>
 #include <stdexcept>
 #include "sctp_checksum.hpp"
 
@@ -194,6 +195,9 @@ void serialize_chunk(const SCTP_Chunk& chunk, std::vector<uint8_t>& out) {
     }
 
     // Compute length
+    if (out.size() - start > UINT16_MAX) {
+        throw std::runtime_error("chunk too long");
+    }
     uint16_t length = static_cast<uint16_t>(out.size() - start);
 
     // Write header
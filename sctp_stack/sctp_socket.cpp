@@ -1,39 +1,20 @@
 #include "sctp_socket.hpp"
 #include "sctp_serialize.hpp"
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <iostream>
+#include "sctp_platform.hpp"
 #include <string_view>
 #include <string>
 #include <mutex>
 #include <vector>
 #include <stdexcept>
 #include <cstring> 
+#include <cstddef>
 #include <random>
 #include "sctp_checksum.hpp"
+#include "sctp_log.hpp"
 
-#pragma comment(lib, "Ws2_32.lib")
+SCTP_Socket::SCTP_Socket() : SCTP_Socket(std::make_unique<Udp_Transport>()) {}
 
-SCTP_Socket::SCTP_Socket() : udp_socket(INVALID_SOCKET) {
-    WSADATA wsaData;
-    int wsaerr;
-    WORD wVersionRequested = MAKEWORD(2, 2);
-    wsaerr = WSAStartup(wVersionRequested, &wsaData);
-
-    if (wsaerr != 0) {
-        std::cout << "Winsock dll not found" << std::endl;
-        return;
-    }
-
-    udp_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-
-    if (udp_socket == INVALID_SOCKET) {
-        std::cout << "Error creating socket: " << WSAGetLastError() << std::endl;
-        WSACleanup();
-        return;
-    }
-    std::cout << "Socket created successfully" << std::endl;
-}
+SCTP_Socket::SCTP_Socket(std::unique_ptr<Datagram_Transport> datagram_transport) : running(false), transport(std::move(datagram_transport)), data_ready(false) {}
 
 bool SCTP_Socket::sctp_bind(std::string_view ip_address, int port) {
     std::string ip_address_string {ip_address};
@@ -42,14 +23,11 @@ bool SCTP_Socket::sctp_bind(std::string_view ip_address, int port) {
     service.sin_addr.s_addr = inet_addr(ip_address_string.c_str());
     service.sin_port = htons(port);
 
-    if (bind(udp_socket, (const sockaddr *)&service, sizeof(service)) == SOCKET_ERROR) {
-        std::cout << "Error binding socket: " << WSAGetLastError() << std::endl;
-        closesocket(udp_socket);
-        WSACleanup();
+    if (!transport->bind(service)) {
         return false;
     }
     local_address = service;
-    std::cout << "Socket bound successfully" << std::endl;
+    log_event<Log_Level::Info>("socket bound", ip_address, {{"port", static_cast<uint64_t>(port)}});
     return true;
 }
 
@@ -57,28 +35,31 @@ SCTP_Socket::~SCTP_Socket() {
     sctp_close();
 }
 
-bool SCTP_Socket::sctp_run() {
+bool SCTP_Socket::sctp_run(Event_Loop_Mode mode) {
     running = true;
+    transport->set_non_blocking();
 
-    // Allows for recvFrom to have non-blocking beehavior
-    u_long mode = 1;
-    ioctlsocket(udp_socket, FIONBIO, &mode);
-
-    event_loop_thread = std::thread(&SCTP_Socket::event_loop, this);
+    if (mode == EVENT_LOOP_THREADED) {
+        event_loop_thread = std::thread(&SCTP_Socket::event_loop, this);
+    }
     return true;
 }
 
+void SCTP_Socket::sctp_set_event_hook(std::function<void(bool data_ready)> hook) {
+    event_hook = std::move(hook);
+}
+
+void SCTP_Socket::sctp_set_close_hook(std::function<void(const Association_Key&)> hook) {
+    close_hook = std::move(hook);
+}
+
 void SCTP_Socket::sctp_close() {
     running = false;
     if (event_loop_thread.joinable()) {
         event_loop_thread.join();
     }
-    if (udp_socket != INVALID_SOCKET) {
-        closesocket(udp_socket);
-        udp_socket = INVALID_SOCKET;
-    }
-    WSACleanup();
-    std::cout << "Socket closed successfully" << std::endl;
+    transport->close();
+    log_event<Log_Level::Info>("socket closed");
 }
 
 Association_Key SCTP_Socket::sctp_associate(std::string_view ip_address, int port) {
@@ -95,6 +76,7 @@ Association_Key SCTP_Socket::sctp_associate(std::string_view ip_address, int por
 
     Association_Key key{to_location};
     Association assoc = init_new_association(key);
+    start_rtt_probe(assoc);
 
     std::unique_lock<std::mutex> assoc_lock(associations_mutex);
     associations.insert_or_assign(key, assoc);
@@ -114,7 +96,7 @@ Association_Key SCTP_Socket::sctp_associate(std::string_view ip_address, int por
         .optional_parameters = {}
     };
 
-    Deliverable init_deliv{key, init_packet};
+    Deliverable init_deliv{key, init_packet, assoc.stats};
 
     std::unique_lock<std::mutex> sending_lock(sending_queue_mutex);
     sending_queue.push(init_deliv);
@@ -139,6 +121,15 @@ Association SCTP_Socket::init_new_association(const Association_Key& key) {
     uint32_t random_next_tsn = dist(gen);
     result.next_tsn = random_next_tsn;
 
+    result.cwnd = INITIAL_CWND;
+    result.handshake_started = transport->now();
+    result.stats = std::make_shared<Association_Stats>();
+    stat_set(result.stats->cwnd, result.cwnd);
+
+    std::unique_lock<std::mutex> stats_lock(stats_mutex);
+    association_stats.insert_or_assign(key, result.stats);
+    stats_lock.unlock();
+
     return result;
 }
 
@@ -147,12 +138,9 @@ int SCTP_Socket::await_established_association(const Association_Key& associatio
     const int sleep_interval_ms = 10;
 
     while (waited_ms < timeout_ms) {
-        std::unique_lock<std::mutex> assoc_lock(associations_mutex);
-        auto it = associations.find(association_id);
-        if (it != associations.end() && it->second.state == ESTABLISHED) {
+        if (is_established(association_id)) {
             return 0;
         }
-        assoc_lock.unlock();
 
         std::this_thread::sleep_for(std::chrono::milliseconds(sleep_interval_ms));
         waited_ms += sleep_interval_ms;
@@ -161,16 +149,34 @@ int SCTP_Socket::await_established_association(const Association_Key& associatio
     return -1;
 }
 
-void SCTP_Socket::sctp_send_data(const sockaddr_in& association_id, const std::vector<uint8_t>& data) {
+bool SCTP_Socket::is_established(const Association_Key& association_id) {
+    std::unique_lock<std::mutex> assoc_lock(associations_mutex);
+    auto it = associations.find(association_id);
+    return it != associations.end() && it->second.state == ESTABLISHED;
+}
+
+bool SCTP_Socket::sctp_send_data(const sockaddr_in& association_id, const std::vector<uint8_t>& data) {
     Association_Key key{association_id};
-    sctp_send_data(key, data);
+    return sctp_send_data(key, data);
+}
+
+bool SCTP_Socket::sctp_send_data(const Association_Key& association_id, const std::vector<uint8_t>& data) {
+    return sctp_send_data(association_id, std::vector<uint8_t>(data));
 }
 
-void SCTP_Socket::sctp_send_data(const Association_Key& association_id, const std::vector<uint8_t>& data) {
+bool SCTP_Socket::sctp_send_data(const Association_Key& association_id, std::vector<uint8_t>&& data) {
+    // The chunk length field would wrap and the datagram would not go out whole
+    if (data.size() > SCTP_MAX_MESSAGE_SIZE) {
+        static Log_Rate_Limit oversized_message_limit{10};
+        log_event_limited<Log_Level::Error>(oversized_message_limit, "message over the single chunk limit not sent", {},
+                                            {{"bytes", data.size()}, {"limit", SCTP_MAX_MESSAGE_SIZE}});
+        return false;
+    }
+
     std::unique_lock<std::mutex> assoc_lock(associations_mutex);
     auto it = associations.find(association_id);
     if (it == associations.end() || it->second.state != ESTABLISHED) {
-        return;
+        return false;
     }
 
     SCTP_Packet data_packet;
@@ -189,16 +195,16 @@ void SCTP_Socket::sctp_send_data(const Association_Key& association_id, const st
             .stream_identifier = 0,
             .stream_seq_num = 0,
             .payload_protocal = 0,
-            .user_data = data
+            .user_data = std::move(data)
         }
     });
+    std::shared_ptr<Association_Stats> assoc_stats = it->second.stats;
     assoc_lock.unlock();
 
-    Deliverable data_deliv{association_id, data_packet};
-
     std::unique_lock<std::mutex> sending_lock(sending_queue_mutex);
-    sending_queue.push(data_deliv);
+    sending_queue.push(Deliverable{association_id, std::move(data_packet), std::move(assoc_stats)});
     sending_lock.unlock();
+    return true;
 }
 
 size_t SCTP_Socket::sctp_recv_data(std::vector<uint8_t>& buffer, Association_Key* out_association_id) {
@@ -213,6 +219,7 @@ size_t SCTP_Socket::sctp_recv_data(std::vector<uint8_t>& buffer, Association_Key
 
         std::vector<uint8_t> data = assoc.ulp_buffer.front();
         assoc.ulp_buffer.pop();
+        stat_set(assoc.stats->ulp_buffer_depth, assoc.ulp_buffer.size());
         assoc_lock.unlock();
 
         size_t to_copy = std::min(buffer.size(), data.size());
@@ -244,6 +251,7 @@ size_t SCTP_Socket::sctp_recv_data_from(const Association_Key& association_id, s
 
     std::vector<uint8_t> data = assoc.ulp_buffer.front();
     assoc.ulp_buffer.pop();
+    stat_set(assoc.stats->ulp_buffer_depth, assoc.ulp_buffer.size());
     assoc_lock.unlock();
 
     size_t to_copy = std::min(buffer.size(), data.size());
@@ -251,38 +259,183 @@ size_t SCTP_Socket::sctp_recv_data_from(const Association_Key& association_id, s
     return to_copy;
 }
 
+bool SCTP_Socket::sctp_recv_message(std::vector<uint8_t>& message, Association_Key* out_association_id) {
+    std::unique_lock<std::mutex> assoc_lock(associations_mutex);
+    for (auto& [key, assoc] : associations) {
+        if (assoc.state != ESTABLISHED || assoc.ulp_buffer.empty()) {
+            continue;
+        }
+        message = std::move(assoc.ulp_buffer.front());
+        assoc.ulp_buffer.pop();
+        stat_set(assoc.stats->ulp_buffer_depth, assoc.ulp_buffer.size());
+        if (out_association_id) {
+            *out_association_id = key;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool SCTP_Socket::sctp_recv_message_from(const Association_Key& association_id, std::vector<uint8_t>& message) {
+    std::unique_lock<std::mutex> assoc_lock(associations_mutex);
+    auto it = associations.find(association_id);
+    if (it == associations.end() || it->second.state != ESTABLISHED || it->second.ulp_buffer.empty()) {
+        return false;
+    }
+    Association& assoc = it->second;
+    message = std::move(assoc.ulp_buffer.front());
+    assoc.ulp_buffer.pop();
+    stat_set(assoc.stats->ulp_buffer_depth, assoc.ulp_buffer.size());
+    return true;
+}
+
 Association_Key SCTP_Socket::get_this_association_key() {
     return Association_Key{local_address};
 }
 
+Socket_Stats SCTP_Socket::stats() const {
+    Socket_Stats result{};
+    result.totals = snapshot_counters(socket_counters);
+
+    std::unique_lock<std::mutex> stats_lock(stats_mutex);
+    result.associations.reserve(association_stats.size());
+    for (const auto& [key, assoc_stats] : association_stats) {
+        result.associations.push_back(snapshot_association_stats(key.address, *assoc_stats));
+    }
+    stats_lock.unlock();
+
+    for (const auto& assoc : result.associations) {
+        result.ulp_buffer_depth += assoc.ulp_buffer_depth;
+        result.ooo_buffer_depth += assoc.ooo_buffer_depth;
+    }
+    return result;
+}
+
+void SCTP_Socket::remove_association(const Association_Key& key) {
+    associations.erase(key);
+    std::unique_lock<std::mutex> stats_lock(stats_mutex);
+    association_stats.erase(key);
+}
+
+void SCTP_Socket::drop_stale_handshakes() {
+    auto now = transport->now();
+    next_handshake_sweep = now + std::chrono::seconds(1);
+
+    std::vector<Association_Key> dropped;
+    std::unique_lock<std::mutex> assoc_lock(associations_mutex);
+    for (auto it = associations.begin(); it != associations.end();) {
+        auto next = std::next(it);
+        if (it->second.state != ESTABLISHED && now - it->second.handshake_started >= HANDSHAKE_TIMEOUT) {
+            static Log_Rate_Limit stale_handshake_limit{10};
+            log_event_limited<Log_Level::Warn>(stale_handshake_limit, "dropped unfinished handshake", {},
+                                               {{"src_port", ntohs(it->first.address.sin_port)}});
+            dropped.push_back(it->first);
+            remove_association(dropped.back());
+        }
+        it = next;
+    }
+    assoc_lock.unlock();
+
+    if (close_hook) {
+        for (const auto& key : dropped) {
+            close_hook(key);
+        }
+    }
+}
+
+std::optional<std::chrono::steady_clock::time_point> SCTP_Socket::sctp_next_timer() {
+    std::unique_lock<std::mutex> assoc_lock(associations_mutex);
+    for (const auto& [key, assoc] : associations) {
+        if (assoc.state != ESTABLISHED) {
+            return next_handshake_sweep;
+        }
+    }
+    return std::nullopt;
+}
+
+void SCTP_Socket::start_rtt_probe(Association& assoc) {
+    assoc.rtt_probe_pending = true;
+    assoc.rtt_probe_sent = transport->now();
+}
+
+// RTT estimation from RFC 4960 6.3.1, sampled on handshake round trips
+void SCTP_Socket::complete_rtt_probe(Association& assoc) {
+    if (!assoc.rtt_probe_pending) {
+        return;
+    }
+    assoc.rtt_probe_pending = false;
+
+    auto elapsed = transport->now() - assoc.rtt_probe_sent;
+    uint32_t rtt_us = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+
+    if (assoc.srtt_us == 0) {
+        assoc.srtt_us = rtt_us;
+        assoc.rttvar_us = rtt_us / 2;
+    } else {
+        uint32_t deviation = assoc.srtt_us > rtt_us ? assoc.srtt_us - rtt_us : rtt_us - assoc.srtt_us;
+        assoc.rttvar_us = (3 * assoc.rttvar_us + deviation) / 4;
+        assoc.srtt_us = (7 * assoc.srtt_us + rtt_us) / 8;
+    }
+
+    stat_set(assoc.stats->srtt_us, assoc.srtt_us);
+    stat_set(assoc.stats->rttvar_us, assoc.rttvar_us);
+}
+
 void SCTP_Socket::event_loop() {
     while (running) {
-        SCTP_Packet pkt;
-        std::unique_lock<std::mutex> sending_lock(sending_queue_mutex);
-        if (!sending_queue.empty()) {
-            handle_send_packet(sending_queue.front());
-            sending_queue.pop();
+        bool did_work = sctp_poll();
+        if (event_hook) {
+            event_hook(data_ready);
+            data_ready = false;
         }
-        sending_lock.unlock();
-
-        uint8_t buffer[RWND];
-        sockaddr_in src{};
-        int src_len = sizeof(src);
-        int n = recvfrom(udp_socket, reinterpret_cast<char*>(buffer), sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&src), &src_len);
-        if (n > 0) {
-            handle_recv_packet(buffer, n, src);
+        // An idle loop gives its timeslice to threads with work, e.g. the server's workers
+        if (!did_work) {
+            std::this_thread::yield();
         }
     }
 }
 
+bool SCTP_Socket::sctp_poll() {
+    bool did_work = false;
+
+    std::unique_lock<std::mutex> sending_lock(sending_queue_mutex);
+    if (!sending_queue.empty()) {
+        handle_send_packet(sending_queue.front());
+        sending_queue.pop();
+        did_work = true;
+    }
+    sending_lock.unlock();
+
+    if (transport->now() >= next_handshake_sweep) {
+        drop_stale_handshakes();
+    }
+
+    uint8_t buffer[RWND];
+    sockaddr_in src{};
+    int n = transport->recv_from(buffer, sizeof(buffer), src);
+    if (n > 0) {
+        handle_recv_packet(buffer, n, src);
+        did_work = true;
+    }
+    return did_work;
+}
+
 void SCTP_Socket::handle_send_packet(const Deliverable& deliverable) {
     std::vector<uint8_t> serialized_packet = serialize_sctp_packet(deliverable.packet);
-    const char* data = reinterpret_cast<const char*>(serialized_packet.data());
-    const sockaddr* to = reinterpret_cast<const sockaddr*>(&deliverable.location.address);
-    sendto(udp_socket, data, serialized_packet.size(), 0, to, sizeof(deliverable.location.address));
+    transport->send_to(serialized_packet.data(), serialized_packet.size(), deliverable.location.address);
+
+    stat_add(socket_counters.packets_out);
+    stat_add(socket_counters.bytes_out, serialized_packet.size());
+    if (deliverable.stats) {
+        stat_add(deliverable.stats->counters.packets_out);
+        stat_add(deliverable.stats->counters.bytes_out, serialized_packet.size());
+    }
 }
 
 void SCTP_Socket::handle_recv_packet(const uint8_t* data, size_t n, const sockaddr_in& src) {
+    stat_add(socket_counters.packets_in);
+    stat_add(socket_counters.bytes_in, n);
+
     uint32_t received_checksum;
     std::memcpy(&received_checksum, data + offsetof(SCTP_Common_Header, checksum), 4);
 
@@ -292,48 +445,79 @@ void SCTP_Socket::handle_recv_packet(const uint8_t* data, size_t n, const sockad
     uint32_t calculated_checksum = calculate_sctp_checksum(data_copy.data(), data_copy.size());
 
     if (calculated_checksum != received_checksum) {
-        std::cout << "Dropped packet with invalid checksum. Received: " << received_checksum 
-                  << ", Calculated: " << calculated_checksum << std::endl;
+        static Log_Rate_Limit checksum_drop_limit{10};
+        log_event_limited<Log_Level::Warn>(checksum_drop_limit, "dropped packet with invalid checksum", {},
+                                           {{"received", received_checksum}, {"calculated", calculated_checksum}});
+        stat_add(socket_counters.checksum_drops);
+        std::unique_lock<std::mutex> assoc_lock(associations_mutex);
+        auto it = associations.find(Association_Key{src});
+        if (it != associations.end()) {
+            stat_add(it->second.stats->counters.checksum_drops);
+        }
         return;
     }
 
     SCTP_Packet in_pkt = deserialize_sctp_packet(data, n);
+    static Log_Rate_Limit handshake_log_limit{100};
 
+    // Counted once per packet, against the association its first accepted chunk was for
+    std::shared_ptr<Association_Stats> assoc_stats;
     for (size_t i{}; i < in_pkt.chunks.size(); i++) {
+        std::shared_ptr<Association_Stats> chunk_stats;
         switch(in_pkt.chunks[i].chunk_header.type) {
             case INIT:
-                std::cout << "Recieved INIT" << std::endl;
-                SCTP_Socket::handle_init(in_pkt.header, in_pkt.chunks[i], src);
+                log_event_limited<Log_Level::Debug>(handshake_log_limit, "received INIT", {}, {{"src_port", ntohs(src.sin_port)}});
+                chunk_stats = SCTP_Socket::handle_init(in_pkt.header, in_pkt.chunks[i], src);
                 break;
             case INIT_ACK:
-                std::cout << "Recieved INIT_ACK" << std::endl;
-                SCTP_Socket::handle_init_ack(in_pkt.header, in_pkt.chunks[i], src);
+                log_event_limited<Log_Level::Debug>(handshake_log_limit, "received INIT_ACK", {}, {{"src_port", ntohs(src.sin_port)}});
+                chunk_stats = SCTP_Socket::handle_init_ack(in_pkt.header, in_pkt.chunks[i], src);
                 break;
             case COOKIE_ECHO:
-                std::cout << "Recieved COOKIE_ECHO" << std::endl;
-                SCTP_Socket::handle_cookie_echo(in_pkt.header, in_pkt.chunks[i], src);
+                log_event_limited<Log_Level::Debug>(handshake_log_limit, "received COOKIE_ECHO", {}, {{"src_port", ntohs(src.sin_port)}});
+                chunk_stats = SCTP_Socket::handle_cookie_echo(in_pkt.header, in_pkt.chunks[i], src);
                 break;
             case COOKIE_ACK:
-                std::cout << "Recieved COOKIE_ACK" << std::endl;
-                SCTP_Socket::handle_cookie_ack(in_pkt.header, in_pkt.chunks[i], src);
+                log_event_limited<Log_Level::Debug>(handshake_log_limit, "received COOKIE_ACK", {}, {{"src_port", ntohs(src.sin_port)}});
+                chunk_stats = SCTP_Socket::handle_cookie_ack(in_pkt.header, in_pkt.chunks[i], src);
                 break;
             case DATA:
-                SCTP_Socket::handle_data(in_pkt.header, in_pkt.chunks[i], src);
+                chunk_stats = SCTP_Socket::handle_data(in_pkt.header, in_pkt.chunks[i], src);
                 break;
         }
+        if (!assoc_stats && chunk_stats) {
+            assoc_stats = std::move(chunk_stats);
+        }
+    }
+    if (assoc_stats) {
+        stat_add(assoc_stats->counters.packets_in);
+        stat_add(assoc_stats->counters.bytes_in, n);
     }
 }
 
-void SCTP_Socket::handle_init(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src) {
+std::shared_ptr<Association_Stats> SCTP_Socket::handle_init(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src) {
     std::unique_lock<std::mutex> assoc_lock(associations_mutex);
     Association_Key assoc_key{src};
-    if (associations.find(assoc_key) != associations.end()) {
-        return;
+    bool restarted = false;
+    auto existing = associations.find(assoc_key);
+    if (existing != associations.end()) {
+        // The same tag is a duplicated or retransmitted INIT, a new one means the peer restarted
+        if (existing->second.peer_ver_tag == std::get<init_chunk_value>(chunk.chunk_value).initiate_tag) {
+            return existing->second.stats;
+        }
+        static Log_Rate_Limit peer_restart_limit{10};
+        log_event_limited<Log_Level::Warn>(peer_restart_limit, "peer restarted association", {},
+                                           {{"src_port", ntohs(src.sin_port)}});
+        remove_association(assoc_key);
+        restarted = true;
     }
 
     Association new_assoc = init_new_association(assoc_key);
     new_assoc.last_peer_tsn = std::get<init_chunk_value>(chunk.chunk_value).initial_tsn - 1;
     new_assoc.peer_ver_tag = std::get<init_chunk_value>(chunk.chunk_value).initiate_tag;
+    new_assoc.peer_rwnd = std::get<init_chunk_value>(chunk.chunk_value).a_rwnd;
+    stat_set(new_assoc.stats->peer_rwnd, new_assoc.peer_rwnd);
+    start_rtt_probe(new_assoc);
     associations.insert_or_assign(assoc_key, new_assoc);
 
     SCTP_Packet init_ack_packet;
@@ -359,26 +543,38 @@ void SCTP_Socket::handle_init(const SCTP_Common_Header& header, const SCTP_Chunk
     });
 
     assoc_lock.unlock();
+    if (restarted && close_hook) {
+        close_hook(assoc_key);
+    }
 
-    Deliverable init_ack_deliv{src, init_ack_packet};
+    Deliverable init_ack_deliv{src, init_ack_packet, new_assoc.stats};
 
     std::unique_lock<std::mutex> sending_lock(sending_queue_mutex);
     sending_queue.push(init_ack_deliv);
     sending_lock.unlock();
+    return new_assoc.stats;
 }
 
-void SCTP_Socket::handle_init_ack(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src) {
+std::shared_ptr<Association_Stats> SCTP_Socket::handle_init_ack(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src) {
     std::unique_lock<std::mutex> assoc_lock(associations_mutex);
     Association_Key assoc_key{src};
     auto it = associations.find(assoc_key);
-    if (it == associations.end() || it->second.state != COOKIE_WAIT) {
-        return;
+    if (it == associations.end()) {
+        return nullptr;
+    }
+    if (it->second.state != COOKIE_WAIT) {
+        return it->second.stats;
     }
 
     Association& assoc = it->second;
+    complete_rtt_probe(assoc);
     assoc.last_peer_tsn = std::get<init_chunk_value>(chunk.chunk_value).initial_tsn - 1;
     assoc.peer_ver_tag = std::get<init_chunk_value>(chunk.chunk_value).initiate_tag;
+    assoc.peer_rwnd = std::get<init_chunk_value>(chunk.chunk_value).a_rwnd;
+    stat_set(assoc.stats->peer_rwnd, assoc.peer_rwnd);
     assoc.state = COOKIE_ECHOED;
+    start_rtt_probe(assoc);
+    std::shared_ptr<Association_Stats> assoc_stats = assoc.stats;
     assoc_lock.unlock();
 
     SCTP_Packet cookie_echo_packet;
@@ -396,23 +592,29 @@ void SCTP_Socket::handle_init_ack(const SCTP_Common_Header& header, const SCTP_C
         }
     });
 
-    Deliverable cookie_echo_deliv{src, cookie_echo_packet};
+    Deliverable cookie_echo_deliv{src, cookie_echo_packet, assoc_stats};
 
     std::unique_lock<std::mutex> sending_lock(sending_queue_mutex);
     sending_queue.push(cookie_echo_deliv);
     sending_lock.unlock();
+    return assoc_stats;
 }
 
-void SCTP_Socket::handle_cookie_echo(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src) {
+std::shared_ptr<Association_Stats> SCTP_Socket::handle_cookie_echo(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src) {
     std::unique_lock<std::mutex> assoc_lock(associations_mutex);
     Association_Key assoc_key{src};
     auto it = associations.find(assoc_key);
-    if (it == associations.end() || it->second.state != COOKIE_WAIT) {
-        return;
+    if (it == associations.end()) {
+        return nullptr;
+    }
+    if (it->second.state != COOKIE_WAIT) {
+        return it->second.stats;
     }
 
     Association& assoc = it->second;
+    complete_rtt_probe(assoc);
     assoc.state = ESTABLISHED;
+    std::shared_ptr<Association_Stats> assoc_stats = assoc.stats;
     assoc_lock.unlock();
 
     SCTP_Packet cookie_ack_packet;
@@ -428,30 +630,38 @@ void SCTP_Socket::handle_cookie_echo(const SCTP_Common_Header& header, const SCT
         .chunk_value = cookie_ack_chunk_value {}
     });
 
-    Deliverable cookie_ack_deliv{src, cookie_ack_packet};
+    Deliverable cookie_ack_deliv{src, cookie_ack_packet, assoc_stats};
 
     std::unique_lock<std::mutex> sending_lock(sending_queue_mutex);
     sending_queue.push(cookie_ack_deliv);
     sending_lock.unlock();
+    return assoc_stats;
 }
-void SCTP_Socket::handle_cookie_ack(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src) {
+std::shared_ptr<Association_Stats> SCTP_Socket::handle_cookie_ack(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src) {
     std::unique_lock<std::mutex> assoc_lock(associations_mutex);
     Association_Key assoc_key{src};
     auto it = associations.find(assoc_key);
-    if (it == associations.end() || it->second.state != COOKIE_ECHOED) {
-        return;
+    if (it == associations.end()) {
+        return nullptr;
+    }
+    if (it->second.state != COOKIE_ECHOED) {
+        return it->second.stats;
     }
 
     Association& assoc = it->second;
+    complete_rtt_probe(assoc);
     assoc.state = ESTABLISHED;
-    assoc_lock.unlock();
+    return assoc.stats;
 }
-void SCTP_Socket::handle_data(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src) {
+std::shared_ptr<Association_Stats> SCTP_Socket::handle_data(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src) {
     std::unique_lock<std::mutex> assoc_lock(associations_mutex);
     Association_Key assoc_key{src};
     auto it = associations.find(assoc_key);
-    if (it == associations.end() || it->second.state != ESTABLISHED) {
-        return;
+    if (it == associations.end()) {
+        return nullptr;
+    }
+    if (it->second.state != ESTABLISHED) {
+        return it->second.stats;
     }
 
     Association& assoc = it->second;
@@ -460,15 +670,24 @@ void SCTP_Socket::handle_data(const SCTP_Common_Header& header, const SCTP_Chunk
         assoc.last_peer_tsn = tsn;
         assoc.ulp_buffer.push(std::get<data_chunk_value>(chunk.chunk_value).user_data);
         read_ooo_buffer(assoc, assoc.last_peer_tsn);
+        data_ready = true;
     } else if (tsn > assoc.last_peer_tsn + 1) {
         assoc.tsn_ooo_buffer[tsn] = std::get<data_chunk_value>(chunk.chunk_value);
+        stat_add(assoc.stats->counters.chunks_reordered);
+        stat_add(socket_counters.chunks_reordered);
     }
+    stat_set(assoc.stats->ulp_buffer_depth, assoc.ulp_buffer.size());
+    stat_set(assoc.stats->ooo_buffer_depth, assoc.tsn_ooo_buffer.size());
+    return assoc.stats;
 }
 
+// tsn is the last TSN delivered in order, anything buffered directly after it can now go up
 void SCTP_Socket::read_ooo_buffer(Association& assoc, uint32_t& tsn) {
-    while (assoc.tsn_ooo_buffer.find(tsn) != assoc.tsn_ooo_buffer.end()) {
-        assoc.ulp_buffer.push(assoc.tsn_ooo_buffer[tsn].user_data);
-        assoc.tsn_ooo_buffer.erase(tsn);
+    auto it = assoc.tsn_ooo_buffer.find(tsn + 1);
+    while (it != assoc.tsn_ooo_buffer.end()) {
+        assoc.ulp_buffer.push(std::move(it->second.user_data));
+        assoc.tsn_ooo_buffer.erase(it);
         tsn++;
+        it = assoc.tsn_ooo_buffer.find(tsn + 1);
     }
 }
\ No newline at end of file
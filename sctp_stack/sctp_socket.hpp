@@ -1,8 +1,7 @@
 #ifndef SCTP_SOCKET_HPP
 #define SCTP_SOCKET_HPP
 
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include "sctp_platform.hpp"
 #include <string_view>
 #include <string>
 #include <functional>
@@ -10,54 +9,98 @@
 #include <thread>
 #include <mutex>
 #include <queue>
+#include <memory>
+#include <optional>
 #include "sctp.hpp"
 #include "sctp_association.hpp"
+#include "sctp_stats.hpp"
+#include "sctp_transport.hpp"
 
 struct Deliverable {
     Association_Key location;
     SCTP_Packet packet;
+    std::shared_ptr<Association_Stats> stats; // Of the association it belongs to, if any
 }; 
 
+// With EVENT_LOOP_MANUAL no thread is started and the owner drives the socket via sctp_poll()
+enum Event_Loop_Mode {
+    EVENT_LOOP_THREADED,
+    EVENT_LOOP_MANUAL
+};
+
 class SCTP_Socket {
     public:
         SCTP_Socket(); 
+        explicit SCTP_Socket(std::unique_ptr<Datagram_Transport> datagram_transport);
         ~SCTP_Socket();
     
     public:
         bool sctp_bind(std::string_view ip_address, int port);
-        bool sctp_run();
+        bool sctp_run(Event_Loop_Mode mode = EVENT_LOOP_THREADED);
+        // Set before sctp_run. In EVENT_LOOP_THREADED mode the event loop calls it after every
+        // iteration, with data_ready when user data was queued for receive since the last call,
+        // so owners get woken on arrival and can run timers without a thread of their own.
+        void sctp_set_event_hook(std::function<void(bool data_ready)> hook);
+        // Set before sctp_run. Called from the thread running sctp_poll once an association is gone,
+        // dropped as an unfinished handshake or replaced by a restarted peer, so owners can free
+        // whatever they keep for it.
+        void sctp_set_close_hook(std::function<void(const Association_Key&)> hook);
+        bool sctp_poll(); // Runs one event loop iteration, returns whether anything was sent or received
+        // When sctp_poll next has timed work (dropping unfinished handshakes), nullopt when there is
+        // none; only meaningful in EVENT_LOOP_MANUAL mode
+        std::optional<std::chrono::steady_clock::time_point> sctp_next_timer();
         void sctp_close();
         Association_Key sctp_associate(std::string_view ip_address, int port); // Adds a new association object to the map and returns the association id
         int await_established_association(const Association_Key& association_id, int timeout_ms);
-        void sctp_send_data(const sockaddr_in& association_id, const std::vector<uint8_t>& data);
-        void sctp_send_data(const Association_Key& association_id, const std::vector<uint8_t>& data);
+        bool is_established(const Association_Key& association_id);
+        // False when the association is not established or data is over SCTP_MAX_MESSAGE_SIZE
+        bool sctp_send_data(const sockaddr_in& association_id, const std::vector<uint8_t>& data);
+        bool sctp_send_data(const Association_Key& association_id, const std::vector<uint8_t>& data);
+        bool sctp_send_data(const Association_Key& association_id, std::vector<uint8_t>&& data); // data becomes the DATA chunk payload without a copy
         size_t sctp_recv_data(std::vector<uint8_t>& buffer, Association_Key* out_association_id = nullptr);
         size_t sctp_recv_data_from(const sockaddr_in& association_id, std::vector<uint8_t>& buffer);
         size_t sctp_recv_data_from(const Association_Key& association_id, std::vector<uint8_t>& buffer);
+        // The next message whole, moved into message without a copy and however large it is
+        bool sctp_recv_message(std::vector<uint8_t>& message, Association_Key* out_association_id = nullptr);
+        bool sctp_recv_message_from(const Association_Key& association_id, std::vector<uint8_t>& message);
         Association_Key get_this_association_key();
+        Socket_Stats stats() const; // Snapshot of transport counters, never blocks the event loop
 
     private:
         bool running;
         int receive_buffer_size;
         sockaddr_in local_address;
-        SOCKET udp_socket;
+        std::unique_ptr<Datagram_Transport> transport;
         std::unordered_map<Association_Key, Association, Association_Hash> associations; // Peer verification tag as the key
         std::mutex associations_mutex;
         std::queue<Deliverable> sending_queue;
         std::mutex sending_queue_mutex;
         std::thread event_loop_thread;
+        std::function<void(bool)> event_hook;
+        std::function<void(const Association_Key&)> close_hook;
+        bool data_ready; // Only touched by the thread running sctp_poll
+        Transport_Counters socket_counters;
+        // Only read by stats(); packet processing goes through Association::stats instead
+        std::unordered_map<Association_Key, std::shared_ptr<Association_Stats>, Association_Hash> association_stats;
+        mutable std::mutex stats_mutex;
+        std::chrono::steady_clock::time_point next_handshake_sweep;
 
         void event_loop();
         Association init_new_association(const Association_Key& key);
         void handle_send_packet(const Deliverable& deliverable);
         void handle_recv_packet(const uint8_t* data, size_t n, const sockaddr_in& src);
         void read_ooo_buffer(Association& assoc, uint32_t& tsn);
+        void remove_association(const Association_Key& key); // With associations_mutex held
+        void drop_stale_handshakes();
+        void start_rtt_probe(Association& assoc);
+        void complete_rtt_probe(Association& assoc);
 
-        void handle_init(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src);
-        void handle_init_ack(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src);
-        void handle_cookie_echo(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src);
-        void handle_cookie_ack(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src);
-        void handle_data(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src);
+        // Each returns the stats of the association the chunk was for, nullptr when it was dropped
+        std::shared_ptr<Association_Stats> handle_init(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src);
+        std::shared_ptr<Association_Stats> handle_init_ack(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src);
+        std::shared_ptr<Association_Stats> handle_cookie_echo(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src);
+        std::shared_ptr<Association_Stats> handle_cookie_ack(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src);
+        std::shared_ptr<Association_Stats> handle_data(const SCTP_Common_Header& header, const SCTP_Chunk& chunk, const sockaddr_in& src);
 };
 
 #endif
\ No newline at end of file
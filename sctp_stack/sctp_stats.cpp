@@ -0,0 +1,26 @@
+#include "sctp_stats.hpp"
+
+Transport_Counters_Snapshot snapshot_counters(const Transport_Counters& counters) {
+    return Transport_Counters_Snapshot {
+        .packets_in = counters.packets_in.load(std::memory_order_relaxed),
+        .packets_out = counters.packets_out.load(std::memory_order_relaxed),
+        .bytes_in = counters.bytes_in.load(std::memory_order_relaxed),
+        .bytes_out = counters.bytes_out.load(std::memory_order_relaxed),
+        .checksum_drops = counters.checksum_drops.load(std::memory_order_relaxed),
+        .chunks_reordered = counters.chunks_reordered.load(std::memory_order_relaxed),
+        .retransmissions = counters.retransmissions.load(std::memory_order_relaxed)
+    };
+}
+
+Association_Stats_Snapshot snapshot_association_stats(const sockaddr_in& peer_address, const Association_Stats& stats) {
+    return Association_Stats_Snapshot {
+        .peer_address = peer_address,
+        .counters = snapshot_counters(stats.counters),
+        .srtt_us = stats.srtt_us.load(std::memory_order_relaxed),
+        .rttvar_us = stats.rttvar_us.load(std::memory_order_relaxed),
+        .cwnd = stats.cwnd.load(std::memory_order_relaxed),
+        .peer_rwnd = stats.peer_rwnd.load(std::memory_order_relaxed),
+        .ulp_buffer_depth = stats.ulp_buffer_depth.load(std::memory_order_relaxed),
+        .ooo_buffer_depth = stats.ooo_buffer_depth.load(std::memory_order_relaxed)
+    };
+}
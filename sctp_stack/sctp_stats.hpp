@@ -0,0 +1,70 @@
+#ifndef SCTP_STATS_HPP
+#define SCTP_STATS_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include "sctp_platform.hpp"
+
+// Counters are only ever bumped with relaxed atomics from the event loop, readers take
+// a snapshot without holding any lock the event loop needs.
+struct Transport_Counters {
+    std::atomic<uint64_t> packets_in{0};
+    std::atomic<uint64_t> packets_out{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+    std::atomic<uint64_t> checksum_drops{0};
+    std::atomic<uint64_t> chunks_reordered{0};
+    std::atomic<uint64_t> retransmissions{0};
+};
+
+struct Association_Stats {
+    Transport_Counters counters;
+    std::atomic<uint32_t> srtt_us{0};
+    std::atomic<uint32_t> rttvar_us{0};
+    std::atomic<uint32_t> cwnd{0};
+    std::atomic<uint32_t> peer_rwnd{0};
+    std::atomic<uint32_t> ulp_buffer_depth{0};
+    std::atomic<uint32_t> ooo_buffer_depth{0};
+};
+
+struct Transport_Counters_Snapshot {
+    uint64_t packets_in;
+    uint64_t packets_out;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t checksum_drops;
+    uint64_t chunks_reordered;
+    uint64_t retransmissions;
+};
+
+struct Association_Stats_Snapshot {
+    sockaddr_in peer_address;
+    Transport_Counters_Snapshot counters;
+    uint32_t srtt_us;
+    uint32_t rttvar_us;
+    uint32_t cwnd;
+    uint32_t peer_rwnd;
+    uint32_t ulp_buffer_depth;
+    uint32_t ooo_buffer_depth;
+};
+
+struct Socket_Stats {
+    Transport_Counters_Snapshot totals;
+    uint64_t ulp_buffer_depth;
+    uint64_t ooo_buffer_depth;
+    std::vector<Association_Stats_Snapshot> associations;
+};
+
+inline void stat_add(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+    counter.fetch_add(n, std::memory_order_relaxed);
+}
+
+inline void stat_set(std::atomic<uint32_t>& value, uint64_t n) {
+    value.store(static_cast<uint32_t>(n), std::memory_order_relaxed);
+}
+
+Transport_Counters_Snapshot snapshot_counters(const Transport_Counters& counters);
+Association_Stats_Snapshot snapshot_association_stats(const sockaddr_in& peer_address, const Association_Stats& stats);
+
+#endif
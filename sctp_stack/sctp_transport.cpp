@@ -0,0 +1,93 @@
+#include "sctp_transport.hpp"
+#include "sctp_log.hpp"
+#include "sctp_platform.hpp"
+
+#ifdef _WIN32
+#pragma comment(lib, "Ws2_32.lib")
+#endif
+
+static uint64_t last_socket_error() {
+#ifdef _WIN32
+    return static_cast<uint64_t>(WSAGetLastError());
+#else
+    return static_cast<uint64_t>(errno);
+#endif
+}
+
+Udp_Transport::Udp_Transport() : udp_socket(INVALID_SOCKET), wsa_started(false) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    int wsaerr;
+    WORD wVersionRequested = MAKEWORD(2, 2);
+    wsaerr = WSAStartup(wVersionRequested, &wsaData);
+
+    if (wsaerr != 0) {
+        log_event<Log_Level::Error>("winsock dll not found");
+        return;
+    }
+    wsa_started = true;
+#endif
+
+    udp_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if (udp_socket == INVALID_SOCKET) {
+        log_event<Log_Level::Error>("error creating socket", {}, {{"error", last_socket_error()}});
+        close();
+        return;
+    }
+    log_event<Log_Level::Info>("socket created");
+}
+
+Udp_Transport::~Udp_Transport() {
+    close();
+}
+
+bool Udp_Transport::bind(const sockaddr_in& address) {
+    if (::bind(udp_socket, (const sockaddr *)&address, sizeof(address)) == SOCKET_ERROR) {
+        log_event<Log_Level::Error>("error binding socket", {}, {{"port", ntohs(address.sin_port)}, {"error", last_socket_error()}});
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool Udp_Transport::set_non_blocking() {
+    // Allows for recvFrom to have non-blocking beehavior
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(udp_socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(udp_socket, F_GETFL, 0);
+    return fcntl(udp_socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+int Udp_Transport::send_to(const uint8_t* data, size_t len, const sockaddr_in& to) {
+    return sendto(udp_socket, reinterpret_cast<const char*>(data), len, 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+}
+
+int Udp_Transport::recv_from(uint8_t* buffer, size_t len, sockaddr_in& from) {
+    socklen_t from_len = sizeof(from);
+    return recvfrom(udp_socket, reinterpret_cast<char*>(buffer), len, 0, reinterpret_cast<sockaddr*>(&from), &from_len);
+}
+
+void Udp_Transport::close() {
+    if (udp_socket != INVALID_SOCKET) {
+#ifdef _WIN32
+        closesocket(udp_socket);
+#else
+        ::close(udp_socket);
+#endif
+        udp_socket = INVALID_SOCKET;
+    }
+#ifdef _WIN32
+    if (wsa_started) {
+        WSACleanup();
+        wsa_started = false;
+    }
+#endif
+}
+
+std::chrono::steady_clock::time_point Udp_Transport::now() const {
+    return std::chrono::steady_clock::now();
+}
@@ -0,0 +1,40 @@
+#ifndef SCTP_TRANSPORT_HPP
+#define SCTP_TRANSPORT_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sctp_platform.hpp"
+#include <chrono>
+
+// Datagram layer underneath SCTP_Socket. recv_from never blocks once set_non_blocking
+// has been called and returns a value <= 0 when nothing is pending.
+class Datagram_Transport {
+    public:
+        virtual ~Datagram_Transport() = default;
+
+        virtual bool bind(const sockaddr_in& address) = 0;
+        virtual bool set_non_blocking() = 0;
+        virtual int send_to(const uint8_t* data, size_t len, const sockaddr_in& to) = 0;
+        virtual int recv_from(uint8_t* buffer, size_t len, sockaddr_in& from) = 0;
+        virtual void close() = 0;
+        virtual std::chrono::steady_clock::time_point now() const = 0;
+};
+
+class Udp_Transport : public Datagram_Transport {
+    public:
+        Udp_Transport();
+        ~Udp_Transport() override;
+
+        bool bind(const sockaddr_in& address) override;
+        bool set_non_blocking() override;
+        int send_to(const uint8_t* data, size_t len, const sockaddr_in& to) override;
+        int recv_from(uint8_t* buffer, size_t len, sockaddr_in& from) override;
+        void close() override;
+        std::chrono::steady_clock::time_point now() const override;
+
+    private:
+        SOCKET udp_socket;
+        bool wsa_started;
+};
+
+#endif